@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+#include <zasm/program/observer.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        enum class BlockFlags : std::uint8_t
+        {
+            None = 0,
+            // The block ends with a return like instruction and leaves the program.
+            Exit = (1U << 0),
+            // The block ends with a branch that has no target within the program,
+            // this includes branches via register, memory, immediate or external labels.
+            IndirectBranch = (1U << 1),
+        };
+        ZASM_ENABLE_ENUM_OPERATORS(BlockFlags);
+    } // namespace detail
+
+    /// <summary>
+    /// Basic block graph over the nodes of a Program. Blocks are delimited by labels, sections
+    /// and branching instructions, calls do not terminate a block.
+    /// The graph registers itself as an Observer and tracks modifications to the Program, calling
+    /// update will only re-scan the blocks affected by the changes since the last update.
+    /// </summary>
+    class ControlFlowGraph final : public Observer
+    {
+    public:
+        enum class BlockId : std::uint32_t
+        {
+            Invalid = std::numeric_limits<std::uint32_t>::max(),
+        };
+
+        using BlockFlags = detail::BlockFlags;
+
+        // Maximum amount of successors a single block can have, taken branch and fallthrough.
+        static constexpr std::size_t kMaxSuccessors = 2;
+
+        struct Block
+        {
+            // First node of the block, null if the block is no longer used.
+            const Node* head{};
+            // Last node of the block, this is the terminating instruction if any.
+            const Node* tail{};
+            BlockFlags flags{};
+
+            constexpr bool isValid() const noexcept
+            {
+                return head != nullptr;
+            }
+
+            constexpr bool hasFlags(BlockFlags other) const noexcept
+            {
+                return (flags & other) != BlockFlags::None;
+            }
+        };
+
+        class BlockList
+        {
+            const BlockId* _begin{};
+            const BlockId* _end{};
+
+        public:
+            constexpr BlockList() noexcept = default;
+            constexpr BlockList(const BlockId* first, const BlockId* last) noexcept
+                : _begin{ first }
+                , _end{ last }
+            {
+            }
+
+            constexpr const BlockId* begin() const noexcept
+            {
+                return _begin;
+            }
+
+            constexpr const BlockId* end() const noexcept
+            {
+                return _end;
+            }
+
+            constexpr std::size_t size() const noexcept
+            {
+                return static_cast<std::size_t>(_end - _begin);
+            }
+
+            constexpr bool empty() const noexcept
+            {
+                return _begin == _end;
+            }
+
+            constexpr BlockId operator[](std::size_t index) const noexcept
+            {
+                return _begin[index]; // NOLINT
+            }
+        };
+
+    private:
+        Program& _program;
+        bool _built{};
+
+        std::vector<Block> _blocks;
+        std::vector<BlockId> _freeBlocks;
+        std::vector<BlockId> _dirtyBlocks;
+        std::vector<BlockId> _updateBlocks;
+        std::vector<BlockId> _unresolvedBlocks;
+        std::vector<std::uint8_t> _blockMarks;
+
+        // Successors are stored with a fixed stride of kMaxSuccessors per block.
+        std::vector<BlockId> _successors;
+        std::vector<std::uint8_t> _successorCount;
+
+        // Predecessors are stored compact, the offsets are indexed by the block id.
+        std::vector<std::uint32_t> _predecessorOffsets;
+        std::vector<BlockId> _predecessors;
+
+        // Maps Node::Id to the block the node belongs to.
+        NodeMap<BlockId> _nodeBlocks{ BlockId::Invalid };
+
+    public:
+        ControlFlowGraph(Program& program);
+        ControlFlowGraph(const ControlFlowGraph&) = delete;
+        ~ControlFlowGraph() override;
+
+        ControlFlowGraph& operator=(const ControlFlowGraph&) = delete;
+
+        /// <summary>
+        /// Builds the graph on first use, subsequent calls will only process the blocks that were
+        /// affected by modifications of the Program.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error update();
+
+        /// <summary>
+        /// Discards all cached information, the next update will rebuild the entire graph.
+        /// </summary>
+        void invalidate() noexcept;
+
+        /// <summary>
+        /// Returns true if there are no pending modifications, the graph is only valid after update.
+        /// </summary>
+        bool isValid() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of block slots, ids are in the range of [0, getBlockCount()).
+        /// Slots of removed blocks are reused, check Block::isValid when iterating.
+        /// </summary>
+        std::size_t getBlockCount() const noexcept;
+
+        /// <summary>
+        /// Returns the block data for the given id, the reference is invalidated by update.
+        /// </summary>
+        const Block& getBlock(BlockId id) const noexcept;
+
+        /// <summary>
+        /// Returns the block that contains the entry point of the program, if no entry point
+        /// is set this is the block of the first node.
+        /// </summary>
+        BlockId getEntryBlock() const noexcept;
+
+        /// <summary>
+        /// Returns the block the node belongs to or BlockId::Invalid if the node is not part of the Program.
+        /// </summary>
+        BlockId getBlockOf(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Returns the block starting with the bound label or BlockId::Invalid if the label is not bound.
+        /// </summary>
+        BlockId getBlockOf(const Label& label) const noexcept;
+
+        /// <summary>
+        /// Returns the blocks control can flow to after the given block, the taken branch comes first.
+        /// </summary>
+        BlockList getSuccessors(BlockId id) const noexcept;
+
+        /// <summary>
+        /// Returns the blocks that have the given block as successor.
+        /// </summary>
+        BlockList getPredecessors(BlockId id) const noexcept;
+
+    public:
+        void onNodeDestroy(const Node* node) override;
+        void onNodeDetach(const Node* node) override;
+        void onNodeInserted(const Node* node) override;
+
+    private:
+        void build();
+        void rescanBlock(BlockId id);
+        void updateSuccessors(BlockId id);
+        void buildPredecessors();
+
+        void removeNode(const Node* node);
+        void setNodeBlock(const Node* node, BlockId id);
+        BlockId allocateBlock();
+        void releaseBlock(BlockId id);
+        void markDirty(BlockId id);
+        void queueUpdate(BlockId id);
+    };
+
+} // namespace zasm
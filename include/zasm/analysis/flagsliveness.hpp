@@ -0,0 +1,79 @@
+#pragma once
+
+#include "controlflowgraph.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Computes which CPU flags are live at each node of the Program using the CPUFlags of the
+    /// instructions. Flags that are written or left undefined end the lifetime of the previous value.
+    /// All flags are considered live when leaving the program, at indirect branches and across calls.
+    /// </summary>
+    class FlagsLiveness
+    {
+    public:
+        /// <summary>
+        /// Flags mask using the bit positions of EFLAGS, same as Instruction::CPUFlags.
+        /// </summary>
+        using FlagsMask = std::uint32_t;
+
+        static constexpr FlagsMask kCF = 1U << 0;
+        static constexpr FlagsMask kPF = 1U << 2;
+        static constexpr FlagsMask kAF = 1U << 4;
+        static constexpr FlagsMask kZF = 1U << 6;
+        static constexpr FlagsMask kSF = 1U << 7;
+        static constexpr FlagsMask kDF = 1U << 10;
+        static constexpr FlagsMask kOF = 1U << 11;
+
+        /// <summary>
+        /// The arithmetic flags, these are the ones modified by add, sub, cmp, test, etc.
+        /// </summary>
+        static constexpr FlagsMask kStatusFlags = kCF | kPF | kAF | kZF | kSF | kOF;
+        static constexpr FlagsMask kAllFlags = ~FlagsMask{ 0 };
+
+    private:
+        Program& _program;
+        ControlFlowGraph& _cfg;
+
+        std::vector<FlagsMask> _blockLiveIn;
+        std::vector<FlagsMask> _blockLiveOut;
+
+        // Flags live after each node.
+        NodeMap<FlagsMask> _liveAfter;
+
+    public:
+        FlagsLiveness(Program& program, ControlFlowGraph& cfg);
+
+        /// <summary>
+        /// Updates the control flow graph and recomputes the flags liveness for the entire program.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns true if any of the flags in the mask may be read after the node.
+        /// Nodes not part of the analysis always report the flags as live.
+        /// </summary>
+        bool isLiveAfter(const Node* node, FlagsMask flags = kStatusFlags) const noexcept;
+
+        /// <summary>
+        /// Returns true if any of the flags in the mask may be read by the node or after it.
+        /// </summary>
+        bool isLiveBefore(const Node* node, FlagsMask flags = kStatusFlags) const noexcept;
+
+        FlagsMask getLiveAfter(const Node* node) const noexcept;
+        FlagsMask getLiveBefore(const Node* node) const noexcept;
+
+        FlagsMask getLiveIn(ControlFlowGraph::BlockId id) const noexcept;
+        FlagsMask getLiveOut(ControlFlowGraph::BlockId id) const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/program/instruction.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        enum class MachineModelForm : std::uint8_t
+        {
+            // Matches every form that has no more specific entry.
+            Any = 0,
+            // No memory operand is accessed.
+            Reg,
+            // A memory operand is read.
+            Load,
+            // A memory operand is written.
+            Store,
+            // A memory operand is read and written.
+            ReadModifyWrite,
+        };
+    } // namespace detail
+
+    /// <summary>
+    /// Cost of an instruction form, the uops of memory accesses are not included and are added
+    /// by the model, see MachineModel.
+    /// </summary>
+    struct MachineModelEntry
+    {
+        using Form = detail::MachineModelForm;
+
+        Instruction::Mnemonic mnemonic{};
+        Form form{};
+        // Cycles until the result is available.
+        std::uint8_t latency{};
+        // Amount of uops executed on the ports.
+        std::uint8_t uops{};
+        // Cycles a single uop blocks its port, larger than 1 for unpipelined units such as the divider.
+        std::uint8_t occupancy{ 1 };
+        // Bit per port the uops can be executed on, 0 if the instruction only takes an issue slot.
+        std::uint16_t ports{};
+    };
+
+    /// <summary>
+    /// Describes the execution resources of a microarchitecture for the ThroughputAnalyzer.
+    /// Entries can be in any order, the first entry per mnemonic and form is used and an entry with a
+    /// specific form takes precedence over Form::Any.
+    /// Loads add a uop on the load ports and the load latency to the dependency chain, stores add a
+    /// store address and a store data uop.
+    /// </summary>
+    struct MachineModel
+    {
+        static constexpr std::int32_t kMaxPorts = 16;
+
+        const char* name{};
+        std::int32_t portCount{};
+        // Uops issued per cycle.
+        std::int32_t issueWidth{};
+        std::int32_t loadLatency{};
+        std::uint16_t loadPorts{};
+        std::uint16_t storeAddressPorts{};
+        std::uint16_t storeDataPorts{};
+        // Register to register moves are eliminated at rename and take no port.
+        bool moveElimination{};
+        // Used for mnemonics without an entry.
+        MachineModelEntry defaultEntry{};
+        const MachineModelEntry* entries{};
+        std::size_t entryCount{};
+
+        /// <summary>
+        /// Intel Skylake client, ports 0, 1, 5 and 6 execute ALU uops, 2 and 3 loads,
+        /// 4 store data and 7 store addresses.
+        /// </summary>
+        static const MachineModel& skylake() noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+
+namespace zasm
+{
+    class Program;
+    class Serializer;
+
+    /// <summary>
+    /// Sample based execution counts of a Program. Sampled addresses are mapped to nodes with the
+    /// address table of the Serializer that produced the sampled code, the serializer must not be
+    /// used for another serialization in between.
+    /// </summary>
+    class Profile
+    {
+        Program& _program;
+        NodeMap<std::uint64_t> _nodeWeights;
+        std::vector<std::uint64_t> _labelWeights;
+        std::uint64_t _totalSamples{};
+        std::uint64_t _unmappedSamples{};
+
+    public:
+        Profile(Program& program);
+
+        /// <summary>
+        /// Adds the count to the node that contains the address, updateLabelWeights has to be
+        /// called before querying label weights.
+        /// </summary>
+        /// <param name="serializer">The serializer that produced the sampled code</param>
+        /// <param name="address">Sampled virtual address</param>
+        /// <param name="count">Amount of samples</param>
+        /// <returns>True if the address belongs to a node</returns>
+        bool addSample(const Serializer& serializer, std::int64_t address, std::uint64_t count = 1);
+
+        /// <summary>
+        /// Parses samples from text, each line contains a hexadecimal address with an optional
+        /// 0x prefix followed by an optional decimal count which defaults to 1.
+        /// Empty lines and lines starting with # are ignored. Updates the label weights.
+        /// </summary>
+        /// <param name="serializer">The serializer that produced the sampled code</param>
+        /// <param name="text">Null terminated text</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error parse(const Serializer& serializer, const char* text);
+
+        /// <summary>
+        /// Reads the file and parses the samples, see parse for the format.
+        /// </summary>
+        /// <param name="serializer">The serializer that produced the sampled code</param>
+        /// <param name="filePath">Path to the sample file</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error load(const Serializer& serializer, const char* filePath);
+
+        /// <summary>
+        /// Recomputes the label weights, a label accumulates the weights of the nodes that follow
+        /// it up to the next label or section.
+        /// </summary>
+        void updateLabelWeights();
+
+        /// <summary>
+        /// Discards all samples.
+        /// </summary>
+        void clear();
+
+        std::uint64_t getNodeWeight(const Node* node) const noexcept;
+        std::uint64_t getLabelWeight(const Label& label) const noexcept;
+
+        std::uint64_t getTotalSamples() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of samples with an address outside of the serialized code.
+        /// </summary>
+        std::uint64_t getUnmappedSamples() const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "controlflowgraph.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <zasm/base/mode.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+#include <zasm/program/register.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Computes which registers are live at each node of the Program using the operand access
+    /// and visibility information of the instructions, this includes hidden operands.
+    /// Registers are tracked by their root, partial writes such as al or ax do not end the
+    /// lifetime of the root register. Registers are considered live when leaving the program
+    /// and calls are assumed to read every register.
+    /// </summary>
+    class RegisterLiveness
+    {
+    public:
+        /// <summary>
+        /// One bit per tracked root register, see getRegMask.
+        /// </summary>
+        using RegMask = std::uint64_t;
+
+        static constexpr std::int32_t kGpBitOffset = 0;
+        static constexpr std::int32_t kVecBitOffset = 16;
+        static constexpr std::int32_t kMaskBitOffset = 48;
+
+    private:
+        Program& _program;
+        ControlFlowGraph& _cfg;
+        RegMask _allRegs{};
+
+        std::vector<RegMask> _blockLiveIn;
+        std::vector<RegMask> _blockLiveOut;
+
+        // Registers live after each node.
+        NodeMap<RegMask> _liveAfter;
+
+    public:
+        RegisterLiveness(Program& program, ControlFlowGraph& cfg);
+
+        /// <summary>
+        /// Updates the control flow graph and recomputes the liveness for the entire program,
+        /// this runs in linear time to the size of the program.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns the mask bit of the root register, general purpose registers are mapped to bits [0, 16),
+        /// vector registers to [16, 48) and mask registers to [48, 56).
+        /// Returns 0 for registers that are not tracked, ex.: segment, flags and instruction pointer.
+        /// </summary>
+        static RegMask getRegMask(MachineMode mode, const Reg& reg) noexcept;
+
+        /// <summary>
+        /// Returns the mask of all registers that can be tracked in the given mode.
+        /// </summary>
+        static RegMask getAllRegsMask(MachineMode mode) noexcept;
+
+        /// <summary>
+        /// Returns true if the value of the register may be read after the node.
+        /// Untracked registers and nodes not part of the analysis are always reported as live.
+        /// </summary>
+        bool isLiveAfter(const Node* node, const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns true if the value of the register may be read by the node or after it.
+        /// </summary>
+        bool isLiveBefore(const Node* node, const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns the registers that are live after the node, all registers if the node is unknown.
+        /// </summary>
+        RegMask getLiveAfter(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Returns the registers that are live before the node executes.
+        /// </summary>
+        RegMask getLiveBefore(const Node* node) const noexcept;
+
+        RegMask getLiveIn(ControlFlowGraph::BlockId id) const noexcept;
+        RegMask getLiveOut(ControlFlowGraph::BlockId id) const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "machinemodel.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        enum class ThroughputBottleneck : std::uint8_t
+        {
+            None = 0,
+            // Uops per cycle the frontend can issue.
+            Issue,
+            // A single execution port, see Report::bottleneckPort.
+            Port,
+            // A dependency chain carried from one iteration into the next.
+            Dependency,
+        };
+    } // namespace detail
+
+    /// <summary>
+    /// Static cost estimation of a range of instructions executed as loop body, similar to llvm-mca.
+    /// Each instruction is looked up in the MachineModel by mnemonic and by the form of its memory access.
+    /// The uops are assigned to the least loaded of their ports, the most constrained uops first, and the
+    /// dependency chains are followed through registers and flags using the operand access of the
+    /// instructions. Memory is assumed not to alias, zero idioms and eliminated moves take no port.
+    /// The estimated cycles per iteration are the largest of the issue, port and loop-carried dependency bounds.
+    /// The analysis runs in linear time to the size of the range.
+    /// </summary>
+    class ThroughputAnalyzer
+    {
+    public:
+        using Bottleneck = detail::ThroughputBottleneck;
+
+        struct Report
+        {
+            double cyclesPerIteration{};
+            // Latency of the critical path of a single iteration.
+            std::int32_t latency{};
+            Bottleneck bottleneck{};
+            // Port with the highest pressure, -1 if no uop is executed on a port.
+            std::int32_t bottleneckPort{ -1 };
+            std::size_t instructions{};
+            std::size_t uops{};
+            // Instructions without an entry in the model, they are estimated with the default entry.
+            std::size_t unknownInstructions{};
+            // Cycles each port is busy per iteration.
+            std::array<double, MachineModel::kMaxPorts> portPressure{};
+        };
+
+    private:
+        struct LookupEntry
+        {
+            // Index into the model entries per MachineModelEntry::Form, -1 if not present.
+            std::array<std::int32_t, 5> forms{ -1, -1, -1, -1, -1 };
+        };
+
+        struct InstrInfo
+        {
+            std::uint32_t firstInput{};
+            std::uint32_t inputCount{};
+            std::uint32_t firstOutput{};
+            std::uint32_t outputCount{};
+            std::int32_t latency{};
+        };
+
+        struct PortUop
+        {
+            std::uint16_t ports{};
+            std::uint8_t occupancy{};
+            std::uint8_t portCount{};
+        };
+
+        Program& _program;
+        const MachineModel& _model;
+        std::vector<LookupEntry> _lookup;
+        // Scratch buffers reused between runs.
+        std::vector<InstrInfo> _instrs;
+        std::vector<std::uint32_t> _slots;
+        std::vector<PortUop> _uops;
+        std::vector<std::int32_t> _readyTimes;
+        Report _report{};
+
+    public:
+        ThroughputAnalyzer(Program& program, const MachineModel& model = MachineModel::skylake());
+
+        /// <summary>
+        /// Analyzes the nodes from first to last, both inclusive. Nodes other than instructions are ignored.
+        /// </summary>
+        /// <param name="first">First node of the loop body</param>
+        /// <param name="last">Last node of the loop body, nullptr to analyze until the end of the program</param>
+        /// <returns>Error::None on success, Error::InvalidParameter if first is nullptr</returns>
+        Error run(const Node* first, const Node* last = nullptr);
+
+        /// <summary>
+        /// Returns the entry of the model used for the mnemonic and form, the default entry if none matches.
+        /// </summary>
+        const MachineModelEntry& getEntry(Instruction::Mnemonic mnemonic, MachineModelEntry::Form form) const noexcept;
+
+        /// <summary>
+        /// Returns the cycles until the results of the instruction are available including the load latency,
+        /// 0 for zero idioms and eliminated moves.
+        /// </summary>
+        std::int32_t getLatency(const Instruction& instr) const noexcept;
+
+        /// <summary>
+        /// Returns the result of the last run.
+        /// </summary>
+        const Report& getReport() const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <zasm/program/register.hpp>
+
+namespace zasm
+{
+    /// <summary>
+    /// Calling conventions of 64 bit code, used by the code generation passes to decide which
+    /// registers have to be preserved across calls and how the stack frame is laid out.
+    /// </summary>
+    enum class CallConv : std::uint8_t
+    {
+        // System V AMD64 ABI, used by Linux, macOS and BSD.
+        SysV,
+        // Microsoft x64 calling convention.
+        Win64,
+    };
+
+    /// <summary>
+    /// Returns true if the callee has to preserve the register, the check is done on the root register.
+    /// For Win64 only the lower 128 bits of xmm6 to xmm15 are preserved so only Xmm registers qualify.
+    /// </summary>
+    /// <param name="callConv">Calling convention</param>
+    /// <param name="reg">Physical register</param>
+    /// <returns>True if the register is callee-saved</returns>
+    bool isCalleeSaved(CallConv callConv, const Reg& reg) noexcept;
+
+    /// <summary>
+    /// Returns the size in bytes the caller has to reserve above the return address for the callee,
+    /// 32 bytes for Win64 and 0 for SysV.
+    /// </summary>
+    std::int32_t getShadowSpaceSize(CallConv callConv) noexcept;
+
+} // namespace zasm
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/codegen/callconv.hpp>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/register.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        enum class FuncFrameOptions : std::uint32_t
+        {
+            None = 0,
+            // Always sets up rbp as frame pointer, otherwise it is only used when the function modifies rsp.
+            PreserveFramePointer = (1U << 0),
+            // Saves the general purpose registers with mov into the frame instead of push/pop.
+            MovSaves = (1U << 1),
+        };
+        ZASM_ENABLE_ENUM_OPERATORS(FuncFrameOptions);
+    } // namespace detail
+
+    /// <summary>
+    /// Generates the prologue and epilogue of a function. The function body is scanned for registers
+    /// that are written according to the operand access, only the clobbered callee-saved registers of
+    /// the calling convention are saved. The prologue is inserted after the entry label and an epilogue
+    /// before every ret of the function.
+    /// Functions that call other functions or save vector registers keep rsp 16 byte aligned, Win64 functions
+    /// also reserve the shadow space for their callees. The frame pointer is omitted unless requested or the
+    /// body modifies rsp with anything other than call, ret, push and pop.
+    ///
+    /// Layout relative to rsp after the prologue: the shadow space, the local area and the save area.
+    /// The local area starts at the same offset RegisterAllocator uses for its spill slots without a managed frame.
+    /// Only supported in 64 bit mode.
+    /// </summary>
+    class FuncFrame
+    {
+    public:
+        using Options = detail::FuncFrameOptions;
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        CallConv _callConv{};
+        Options _options{};
+        std::int32_t _localSize{};
+        std::int32_t _localAlign{ 8 };
+
+        std::vector<Reg> _savedRegs;
+        std::int32_t _localOffset{};
+        std::int32_t _frameSize{};
+        std::int32_t _stackSize{};
+        bool _hasCalls{};
+        bool _hasFramePointer{};
+
+    public:
+        FuncFrame(Program& program, CallConv callConv = CallConv::SysV, Options options = Options::None);
+
+        void setOptions(Options options) noexcept;
+        Options getOptions() const noexcept;
+
+        /// <summary>
+        /// Reserves space for local variables in the frame.
+        /// </summary>
+        /// <param name="size">Size in bytes</param>
+        /// <param name="align">Alignment of the local area, a power of two up to 16</param>
+        /// <returns>Error::InvalidParameter if the size is negative or the alignment is invalid</returns>
+        Error setLocalSize(std::int32_t size, std::int32_t align = 8) noexcept;
+
+        /// <summary>
+        /// Scans the function and inserts the prologue and epilogues. The function starts at the bound
+        /// entry label and ends at the last node or the next section.
+        /// </summary>
+        /// <param name="entry">Bound label of the function</param>
+        /// <param name="last">Last node of the function, nullptr to scan until the next section</param>
+        /// <returns>Error::None on success, Error::InvalidOperation if the function branches to its
+        /// entry label or uses rbp while a frame pointer is required</returns>
+        Error run(const Label& entry, const Node* last = nullptr);
+
+        /// <summary>
+        /// Returns the saved callee-saved registers, 64 bit general purpose registers followed by Xmm registers.
+        /// The frame pointer is not included.
+        /// </summary>
+        const std::vector<Reg>& getSavedRegs() const noexcept;
+
+        /// <summary>
+        /// Returns the offset of the local area relative to rsp after the prologue.
+        /// </summary>
+        std::int32_t getLocalOffset() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of bytes reserved with sub rsp.
+        /// </summary>
+        std::int32_t getFrameSize() const noexcept;
+
+        /// <summary>
+        /// Returns the total amount of bytes the prologue moves rsp, including pushes.
+        /// </summary>
+        std::int32_t getStackSize() const noexcept;
+
+        bool hasCalls() const noexcept;
+        bool hasFramePointer() const noexcept;
+    };
+
+} // namespace zasm
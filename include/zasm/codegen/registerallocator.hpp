@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/codegen/callconv.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/register.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Linear scan register allocator that replaces the virtual registers of a Program with physical
+    /// x86::Gp and vector registers. The program is treated as a single function, live intervals are
+    /// computed over the node list and extended over backward branches so values stay live for the whole loop.
+    /// Intervals that cross a call only receive callee-saved registers, when no register is free the
+    /// interval with the furthest end is spilled to a stack slot. Spilled registers are accessed directly as
+    /// memory operand where the instruction allows it, otherwise they are reloaded into a scratch register.
+    /// Physical registers referenced anywhere in the program are never assigned.
+    /// With a managed frame the used callee-saved registers are pushed and the spill area is reserved before
+    /// the first instruction and released before each ret, the program must not branch to the entry and
+    /// must not modify rsp other than by calls. Only supported in 64 bit mode.
+    /// </summary>
+    class RegisterAllocator
+    {
+    public:
+        struct Stats
+        {
+            std::size_t virtualRegs{};
+            std::size_t spilledRegs{};
+            // Uses of spilled registers replaced by a stack memory operand.
+            std::size_t memoryOperands{};
+            std::size_t spillLoads{};
+            std::size_t spillStores{};
+            // Callee-saved registers pushed by the managed frame.
+            std::size_t savedRegs{};
+            // Bytes reserved with sub rsp by the managed frame.
+            std::int32_t frameSize{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        CallConv _callConv{};
+        bool _manageFrame{ true };
+        // Physical register per virtual register index, Reg::Id::None if spilled or unused.
+        std::vector<Reg> _assignments;
+        // Offset from rsp after the prologue per virtual register index, -1 if not spilled.
+        std::vector<std::int32_t> _spillSlots;
+        std::int32_t _spillAreaSize{};
+        Stats _stats{};
+
+    public:
+        RegisterAllocator(Program& program, CallConv callConv = CallConv::SysV);
+
+        /// <summary>
+        /// Enables or disables the managed frame, enabled by default. Without it callee-saved registers
+        /// are not used and the caller must reserve getSpillAreaSize() bytes at rsp, above the shadow space
+        /// for Win64, before the first instruction.
+        /// </summary>
+        void setManageFrame(bool manageFrame) noexcept;
+        bool getManageFrame() const noexcept;
+
+        /// <summary>
+        /// Assigns all virtual registers and rewrites the instructions.
+        /// </summary>
+        /// <returns>Error::None on success, Error::OutOfRegisters if no scratch registers are left</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns the physical register assigned to the virtual register, the result is invalid
+        /// if the register was spilled or never used.
+        /// </summary>
+        Reg getAssignment(const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns the offset of the spill slot relative to rsp after the prologue, -1 if not spilled.
+        /// </summary>
+        std::int32_t getSpillSlot(const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns the size of the spill area in bytes.
+        /// </summary>
+        std::int32_t getSpillAreaSize() const noexcept;
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+    };
+
+} // namespace zasm
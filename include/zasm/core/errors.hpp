@@ -29,6 +29,12 @@ namespace zasm
         // Serialization.
         EmptyState,
         ImpossibleRelocation,
+        PassLimitReached,
+        // Profile.
+        FileNotFound,
+        InvalidFileFormat,
+        // Register allocation.
+        OutOfRegisters,
     };
 
     static constexpr const char* getErrorName(Error err) noexcept
@@ -55,6 +61,10 @@ namespace zasm
             ERROR_STRING(Error::ImpossibleInstruction);
             ERROR_STRING(Error::EmptyState);
             ERROR_STRING(Error::ImpossibleRelocation);
+            ERROR_STRING(Error::PassLimitReached);
+            ERROR_STRING(Error::FileNotFound);
+            ERROR_STRING(Error::InvalidFileFormat);
+            ERROR_STRING(Error::OutOfRegisters);
             default:
                 assert(false);
                 break;
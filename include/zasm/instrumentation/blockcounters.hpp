@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/flagsliveness.hpp>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        enum class BlockCounterOptions : std::uint32_t
+        {
+            None = 0,
+            // Uses lock inc so the counters are exact when the code runs on multiple threads.
+            Atomic = (1U << 0),
+            // Additionally counts the taken and fallthrough edge of each conditional branch.
+            Edges = (1U << 1),
+        };
+        ZASM_ENABLE_ENUM_OPERATORS(BlockCounterOptions);
+    } // namespace detail
+
+    /// <summary>
+    /// Instruments the executable sections of a Program with 64 bit execution counters at the entry of
+    /// each basic block and optionally on each edge of conditional branches. The counters are stored in
+    /// a writable section that is appended to the program, after the code ran the value of a counter
+    /// is read from the address of its label, see Serializer::getLabelAddress.
+    /// The counter update uses inc qword ptr [counter] where the flags are dead, otherwise a dead
+    /// register is used to increment the counter and as last resort the flags are saved on the stack.
+    /// Only supported in 64 bit mode, the pass must be run only once per program.
+    /// </summary>
+    class BlockCounters
+    {
+    public:
+        using Options = detail::BlockCounterOptions;
+
+        static constexpr const char* kCounterSectionName = ".counters";
+        static constexpr const char* kEdgeSectionName = ".text.counters";
+
+        enum class Kind : std::uint8_t
+        {
+            // Counts the executions of a basic block.
+            Block,
+            // Counts how often a conditional branch was taken.
+            Taken,
+            // Counts how often a conditional branch was not taken.
+            Fallthrough,
+        };
+
+        enum class Form : std::uint8_t
+        {
+            // inc qword ptr [counter], clobbers the flags except CF.
+            Inc,
+            // Loads, increments with lea and stores the counter using a dead register, not atomic.
+            Register,
+            // Saves the flags with pushfq around the inc, skips the red zone.
+            SaveFlags,
+        };
+
+        struct Counter
+        {
+            Kind kind{};
+            Form form{};
+            // Label of the 8 byte counter in the counter section.
+            Label label{};
+            // Label of the counted block or the branch target for edge counters, can be invalid for
+            // blocks that do not start with a label.
+            Label target{};
+            // The first instruction of the block or the branch instruction for edge counters.
+            const Node* node{};
+        };
+
+        struct Stats
+        {
+            std::size_t blockCounters{};
+            std::size_t edgeCounters{};
+            std::size_t incForms{};
+            std::size_t registerForms{};
+            std::size_t saveFlagsForms{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        ControlFlowGraph _cfg;
+        FlagsLiveness _flags;
+        RegisterLiveness _regs;
+        Options _options{};
+        std::vector<Counter> _counters;
+        // Index + 1 of the block counter by label id, 0 if the label has no counter.
+        std::vector<std::size_t> _blockCounters;
+        Stats _stats{};
+
+    public:
+        BlockCounters(Program& program, Options options = Options::None);
+
+        void setOptions(Options options) noexcept;
+        Options getOptions() const noexcept;
+
+        /// <summary>
+        /// Inserts the counters into the program, creates the counter section and, with Options::Edges,
+        /// a code section for the taken edge counters.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        std::size_t getCounterCount() const noexcept;
+
+        /// <summary>
+        /// Returns the counter by index, nullptr if the index is out of bounds.
+        /// </summary>
+        const Counter* getCounter(std::size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns the counter of the block that starts with the label, nullptr if there is none.
+        /// </summary>
+        const Counter* findBlockCounter(const Label& label) const noexcept;
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+    };
+
+} // namespace zasm
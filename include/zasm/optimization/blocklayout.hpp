@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+    class Profile;
+
+    /// <summary>
+    /// Reorders the basic blocks so that the most likely successor of a block directly follows it.
+    /// Jumps to the following block are removed, conditional branches are inverted when the taken
+    /// target follows and jumps are inserted where a fallthrough got separated.
+    /// Blocks never move across sections and the first block of each section stays in place.
+    /// </summary>
+    class BlockLayout
+    {
+    public:
+        static constexpr std::uint64_t kDefaultWeight = 1;
+
+        /// <summary>
+        /// Execution counts of the edges leaving a block.
+        /// </summary>
+        struct EdgeWeights
+        {
+            std::uint64_t taken{ kDefaultWeight };
+            std::uint64_t fallthrough{ kDefaultWeight };
+        };
+
+        struct Stats
+        {
+            // Code size before and after the layout.
+            std::int64_t sizeBefore{};
+            std::int64_t sizeAfter{};
+            // Branches to labels that use the short rel8 form.
+            std::size_t shortBranchesBefore{};
+            std::size_t shortBranchesAfter{};
+            std::size_t blocksMoved{};
+            std::size_t jumpsRemoved{};
+            std::size_t jumpsInserted{};
+            std::size_t branchesInverted{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        ControlFlowGraph _cfg;
+        NodeMap<EdgeWeights> _weights;
+        Stats _stats{};
+
+    public:
+        BlockLayout(Program& program);
+
+        /// <summary>
+        /// Sets the weights of the edges leaving the block that ends with the given node, blocks
+        /// without weights use kDefaultWeight for all edges. On equal weights the original
+        /// fallthrough is preferred.
+        /// </summary>
+        /// <param name="node">The last node of the block, usually the branch instruction</param>
+        /// <param name="weights">Weights of the taken branch and the fallthrough</param>
+        void setEdgeWeights(const Node* node, const EdgeWeights& weights);
+
+        /// <summary>
+        /// Sets the edge weights of all branches to labels from the sampled profile, the taken weight is
+        /// the weight of the target label and the fallthrough weight the weight of the following code.
+        /// </summary>
+        void setEdgeWeights(const Profile& profile);
+
+        /// <summary>
+        /// Reorders the blocks of the entire program, the program is serialized before and after
+        /// to measure the effect.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of bytes the last run removed from the code.
+        /// </summary>
+        std::int64_t getBytesSaved() const noexcept;
+
+        /// <summary>
+        /// Returns how many more branches use the rel8 form after the last run.
+        /// </summary>
+        std::int64_t getBranchesShortened() const noexcept;
+    };
+
+} // namespace zasm
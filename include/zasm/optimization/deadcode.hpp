@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/flagsliveness.hpp>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Removes code that can not affect the result of the program.
+    /// Blocks of executable sections that are unreachable from the entry point, from exported labels and from
+    /// labels whose address is taken by an operand or an embedded label are removed, only the instructions
+    /// and labels of such blocks are destroyed, data and alignment nodes are kept.
+    /// Instructions that only write registers and flags which are dead according to the liveness are
+    /// removed as well, instructions that write memory or have other side effects are always kept.
+    /// </summary>
+    class DeadCodeElimination
+    {
+    public:
+        struct Stats
+        {
+            // Code size before and after the elimination.
+            std::int64_t sizeBefore{};
+            std::int64_t sizeAfter{};
+            std::size_t blocksRemoved{};
+            // Instructions removed from unreachable blocks and dead instructions.
+            std::size_t instructionsRemoved{};
+            std::size_t deadInstructions{};
+        };
+
+    private:
+        Program& _program;
+        ControlFlowGraph _cfg;
+        RegisterLiveness _regLiveness;
+        FlagsLiveness _flagsLiveness;
+        std::vector<Label> _exports;
+        Stats _stats{};
+
+    public:
+        DeadCodeElimination(Program& program);
+
+        /// <summary>
+        /// Marks the label as reachable from outside of the program, the code reachable from it is kept.
+        /// </summary>
+        void addExport(const Label& label);
+
+        /// <summary>
+        /// Removes the unreachable blocks and then the dead instructions until nothing changes or the
+        /// pass limit is reached, the program is serialized before and after to measure the effect.
+        /// </summary>
+        /// <param name="maxPasses">Maximum amount of passes removing dead instructions</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run(std::size_t maxPasses = 4);
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of bytes the last run removed from the code.
+        /// </summary>
+        std::int64_t getBytesEliminated() const noexcept;
+
+    private:
+        Error removeUnreachableBlocks();
+        Error removeDeadInstructions(bool& changed);
+        bool isDead(const Node* node, const Instruction& instr) const noexcept;
+    };
+
+} // namespace zasm
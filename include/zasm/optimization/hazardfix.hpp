@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/core/enumflags.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    namespace detail
+    {
+        enum class HazardFixes : std::uint8_t
+        {
+            None = 0,
+            // mov r8/r16, r/m8/r/m16 is widened to movzx r32 when the bits above the
+            // written part are dead or known to be zero, this avoids the merge with the old value.
+            PartialRegister = (1U << 0),
+            // A zero idiom is inserted in front of popcnt, lzcnt, tzcnt, cvtsi2ss and cvtsi2sd
+            // to break the dependency on the previous value of the destination.
+            FalseDependency = (1U << 1),
+            // Instructions with a 16 bit operand size and a 16 bit immediate are split into a
+            // mov of the immediate into a dead scratch register and the register form.
+            LengthChangingPrefix = (1U << 2),
+            All = PartialRegister | FalseDependency | LengthChangingPrefix,
+        };
+        ZASM_ENABLE_ENUM_OPERATORS(HazardFixes);
+    } // namespace detail
+
+    /// <summary>
+    /// Rewrites instruction sequences that stall the pipeline of modern x86 processors, each fix can be
+    /// enabled separately. The rewrites only apply when the liveness proves that the values changed by
+    /// them are never observed, instructions using virtual registers are not modified.
+    /// </summary>
+    class HazardFix
+    {
+    public:
+        using Fixes = detail::HazardFixes;
+
+        struct Stats
+        {
+            std::size_t partialRegisterWrites{};
+            std::size_t falseDependencies{};
+            std::size_t lengthChangingPrefixes{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        ControlFlowGraph _cfg;
+        RegisterLiveness _regLiveness;
+        Stats _stats{};
+
+    public:
+        HazardFix(Program& program);
+
+        /// <summary>
+        /// Applies the selected fixes to the entire program.
+        /// </summary>
+        /// <param name="fixes">The fixes to apply</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run(Fixes fixes = Fixes::All);
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+
+    private:
+        Error fixPartialRegister(const Node* node, const Instruction& instr, bool& fixed);
+        Error fixFalseDependency(const Node* node, const Instruction& instr, bool& fixed);
+        Error fixLengthChangingPrefix(const Node* node, const Instruction& instr, bool& fixed);
+
+        // Returns true if the bits of the register above the given width are not read after the node.
+        bool isUpperDead(const Node* node, const Reg& reg, std::int32_t width) const noexcept;
+
+        // Returns true if the bits of the register above the given width are zero before the node.
+        bool isUpperZero(const Node* node, const Reg& reg, std::int32_t width) const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/program/nodemap.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+    class Profile;
+
+    /// <summary>
+    /// Moves rarely executed basic blocks into a separate code section at the end of the program
+    /// so the remaining hot code is laid out contiguously. Fallthroughs between hot and cold blocks
+    /// are replaced with explicit jumps, conditional branches are inverted where that avoids a jump.
+    /// </summary>
+    class HotColdSplit
+    {
+    public:
+        static constexpr const char* kColdSectionName = ".text.cold";
+
+        struct Stats
+        {
+            // Size of the executable sections excluding the cold section.
+            std::int64_t hotSizeBefore{};
+            std::int64_t hotSizeAfter{};
+            std::int64_t coldSize{};
+            std::size_t blocksMoved{};
+            std::size_t jumpsInserted{};
+            std::size_t branchesInverted{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        ControlFlowGraph _cfg;
+        NodeMap<bool> _coldNodes;
+        std::vector<bool> _coldLabels;
+        Stats _stats{};
+
+    public:
+        HotColdSplit(Program& program);
+
+        /// <summary>
+        /// Marks the block starting with the label as cold.
+        /// </summary>
+        void markCold(const Label& label);
+
+        /// <summary>
+        /// Marks the block containing the node as cold.
+        /// </summary>
+        void markCold(const Node* node);
+
+        /// <summary>
+        /// Marks the blocks starting with a label that has at most threshold samples as cold.
+        /// </summary>
+        void markCold(const Profile& profile, std::uint64_t threshold = 0);
+
+        /// <summary>
+        /// Removes all marks.
+        /// </summary>
+        void clearMarks();
+
+        /// <summary>
+        /// Moves the cold blocks into a new section named kColdSectionName at the end of the program, if the
+        /// program already has that section from a previous run the blocks are appended to it instead.
+        /// Blocks that start a section, blocks of non executable sections and blocks of the cold section are not moved.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+    };
+
+} // namespace zasm
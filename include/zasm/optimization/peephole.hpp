@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/flagsliveness.hpp>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Pattern driven peephole optimizer, rules match a window of consecutive instructions by
+    /// mnemonic and a predicate on the operands and rewrite the window in place.
+    /// Windows never extend over labels or other non instruction nodes.
+    /// </summary>
+    class Peephole
+    {
+    public:
+        static constexpr std::size_t kMaxWindowSize = 4;
+
+        /// <summary>
+        /// The consecutive instruction nodes a rule is applied to.
+        /// </summary>
+        struct Window
+        {
+            std::array<const Node*, kMaxWindowSize> nodes{};
+            std::size_t size{};
+
+            const Node* getNode(std::size_t index) const noexcept
+            {
+                return nodes[index];
+            }
+
+            const Instruction& get(std::size_t index) const noexcept
+            {
+                return nodes[index]->get<Instruction>();
+            }
+        };
+
+        /// <summary>
+        /// State available to the rules, the liveness information is recomputed before every pass.
+        /// Rewrites should insert new instructions via the assembler and remove replaced nodes
+        /// from the program.
+        /// </summary>
+        struct Context
+        {
+            Program& program;
+            x86::Assembler& assembler;
+            const RegisterLiveness& regLiveness;
+            const FlagsLiveness& flagsLiveness;
+        };
+
+        using MatchFn = bool (*)(const Context& ctx, const Window& window);
+        using RewriteFn = Error (*)(Context& ctx, const Window& window);
+
+        struct Rule
+        {
+            const char* name{};
+            // Mnemonic of each instruction in the window, x86::Mnemonic::Invalid matches any instruction.
+            std::array<x86::Mnemonic, kMaxWindowSize> mnemonics{};
+            std::size_t windowSize{};
+            // Checks the operands and the liveness, called only if the mnemonics matched.
+            MatchFn match{};
+            RewriteFn rewrite{};
+        };
+
+    private:
+        Program& _program;
+        x86::Assembler _assembler;
+        ControlFlowGraph _cfg;
+        RegisterLiveness _regLiveness;
+        FlagsLiveness _flagsLiveness;
+
+        std::vector<Rule> _rules;
+        std::vector<std::size_t> _ruleHits;
+
+    public:
+        Peephole(Program& program);
+
+        /// <summary>
+        /// Adds a rule, rules are tried in the order they were added.
+        /// </summary>
+        void addRule(const Rule& rule);
+
+        /// <summary>
+        /// Adds the rules provided by zasm:
+        /// - mov reg, 0 to xor reg, reg when the flags are dead
+        /// - add/sub reg, 1 to inc/dec reg when the carry flag is dead
+        /// - mov a, b followed by mov b, a drops the second move
+        /// - jmp/jcc to the immediately following label is removed
+        /// </summary>
+        void addDefaultRules();
+
+        /// <summary>
+        /// Applies the rules over the entire program until nothing changes or the pass limit is reached.
+        /// </summary>
+        /// <param name="maxPasses">Maximum amount of passes over the program</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run(std::size_t maxPasses = 4);
+
+        std::size_t getRuleCount() const noexcept;
+        const Rule& getRule(std::size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns how often the rule was applied since construction.
+        /// </summary>
+        std::size_t getRuleHits(std::size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns the total amount of rewrites since construction.
+        /// </summary>
+        std::size_t getRewriteCount() const noexcept;
+    };
+
+} // namespace zasm
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/analysis/machinemodel.hpp>
+#include <zasm/analysis/throughput.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/node.hpp>
+
+namespace zasm
+{
+    class Program;
+
+    /// <summary>
+    /// Latency driven list scheduler, reorders the instructions of each basic block in place so that
+    /// long latency instructions such as loads start as early as possible.
+    /// A dependency graph is built from the register operand access, each individual cpu flag and the
+    /// memory operands of the instructions. Memory accesses are assumed to alias, loads may be reordered
+    /// among each other but never across a store. Branches, calls, returns, instructions with side
+    /// effects such as locked, serializing, port I/O or cli and instructions without meta data are
+    /// barriers that never move and nothing is moved across them.
+    /// The latencies are taken from the MachineModel, the scheduler picks the ready instruction with
+    /// the longest path to the end of the block, ties keep the original order.
+    /// </summary>
+    class Scheduler
+    {
+    public:
+        struct Stats
+        {
+            // Sequences of instructions between barriers that were scheduled.
+            std::size_t regions{};
+            std::size_t instructions{};
+            // Instructions that got moved to a different position.
+            std::size_t instructionsMoved{};
+            // Estimated cycles of all regions executed once on an in-order pipeline with the
+            // issue width of the model, before and after scheduling.
+            std::int64_t cyclesBefore{};
+            std::int64_t cyclesAfter{};
+        };
+
+    private:
+        struct SchedNode
+        {
+            const Node* node{};
+            std::int32_t latency{};
+            // Longest latency path to the end of the region.
+            std::int32_t height{};
+            std::uint32_t firstSucc{};
+            std::uint32_t succCount{};
+            std::uint32_t predCount{};
+            std::int32_t earliest{};
+            std::uint32_t flagsRead{};
+            // Written and undefined flags.
+            std::uint32_t flagsWritten{};
+            // Written flags that are read later or live out of the region.
+            std::uint32_t flagsLive{};
+        };
+
+        struct Edge
+        {
+            std::uint32_t from{};
+            std::uint32_t to{};
+            std::int32_t latency{};
+        };
+
+        Program& _program;
+        const MachineModel& _model;
+        ThroughputAnalyzer _analyzer;
+        Stats _stats{};
+        // Scratch buffers reused between regions.
+        std::vector<SchedNode> _nodes;
+        std::vector<Edge> _edges;
+        std::vector<std::uint32_t> _succs;
+        std::vector<std::int32_t> _succLatencies;
+        std::vector<std::uint32_t> _order;
+        std::vector<std::uint32_t> _available;
+        std::vector<std::uint32_t> _ready;
+        std::vector<std::int32_t> _lastWriter;
+        std::vector<std::vector<std::uint32_t>> _readers;
+        std::vector<std::vector<std::uint32_t>> _deadFlagsWriters;
+        std::vector<std::uint32_t> _touchedSlots;
+
+    public:
+        Scheduler(Program& program, const MachineModel& model = MachineModel::skylake());
+
+        /// <summary>
+        /// Schedules all basic blocks of the program.
+        /// </summary>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error run();
+
+        /// <summary>
+        /// Returns the statistics of the last run.
+        /// </summary>
+        const Stats& getStats() const noexcept;
+
+    private:
+        void scheduleRegion();
+        void buildGraph();
+        void addEdge(std::uint32_t from, std::uint32_t to, std::int32_t latency);
+        void listSchedule();
+        std::int64_t estimateCycles(const std::vector<std::uint32_t>& order);
+    };
+
+} // namespace zasm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zasm
+{
+    /// <summary>
+    /// Pads the output until the address is a multiple of the alignment, the padding
+    /// is resolved by the serializer during layout.
+    /// </summary>
+    class Align
+    {
+    public:
+        // Pads with multi-byte NOPs in executable sections, zeros otherwise.
+        static constexpr std::int32_t kFillNop = -1;
+
+    private:
+        std::int32_t _alignment{};
+        std::int32_t _fill{ kFillNop };
+
+    public:
+        constexpr Align() noexcept = default;
+
+        constexpr Align(std::int32_t alignment, std::int32_t fill = kFillNop) noexcept
+            : _alignment{ alignment }
+            , _fill{ fill }
+        {
+        }
+
+        constexpr std::int32_t getAlignment() const noexcept
+        {
+            return _alignment;
+        }
+
+        constexpr bool isNopFill() const noexcept
+        {
+            return _fill == kFillNop;
+        }
+
+        /// <summary>
+        /// Returns the byte used for padding, only meaningful if isNopFill returns false.
+        /// </summary>
+        constexpr std::uint8_t getFillByte() const noexcept
+        {
+            return static_cast<std::uint8_t>(_fill);
+        }
+    };
+
+} // namespace zasm
@@ -18,7 +18,7 @@ namespace zasm
     public:
         enum class Mnemonic : std::uint16_t;
         enum class Encoding : std::uint8_t;
-        enum class Attribs : std::uint16_t;
+        enum class Attribs : std::uint32_t;
         enum class Category : std::uint8_t;
 
         using Length = std::uint8_t;
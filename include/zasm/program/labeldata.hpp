@@ -16,6 +16,8 @@ namespace zasm
         External = (1U << 0),
         // Label is used for imports, this is typically accompanied with External.
         Import = (1U << 1),
+        // Label of an entry in the constant pool, it is bound by the serializer.
+        Constant = (1U << 2),
     };
     ZASM_ENABLE_ENUM_OPERATORS(LabelFlags);
 
@@ -12,13 +12,32 @@
 
 namespace zasm
 {
+    namespace detail
+    {
+        enum class MemBroadcast : std::uint8_t
+        {
+            None = 0,
+            _1to2,
+            _1to4,
+            _1to8,
+            _1to16,
+            _1to32,
+            _1to64,
+        };
+    } // namespace detail
+
     class Mem
     {
         using RegisterPack = Packed<std::uint32_t, Reg::Id, 10>;
 
+    public:
+        using Broadcast = detail::MemBroadcast;
+
+    private:
         BitSize _bitSize{};
         RegisterPack _segBaseIndex{};
         std::uint8_t _scale{};
+        Broadcast _broadcast{};
         std::int64_t _disp{};
         Label::Id _label{ Label::Id::Invalid };
 
@@ -145,6 +164,26 @@ namespace zasm
         {
             return _label != Label::Id::Invalid;
         }
+
+        constexpr Broadcast getBroadcast() const noexcept
+        {
+            return _broadcast;
+        }
+
+        /// <summary>
+        /// Sets the EVEX embedded broadcast {1toN}, a single element is loaded and replicated to all
+        /// elements of the vector. The size of the memory operand is the size of the element.
+        /// </summary>
+        Mem& setBroadcast(Broadcast broadcast) noexcept
+        {
+            _broadcast = broadcast;
+            return *this;
+        }
+
+        constexpr bool hasBroadcast() const noexcept
+        {
+            return _broadcast != Broadcast::None;
+        }
     };
 
 } // namespace zasm
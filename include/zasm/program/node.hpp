@@ -1,5 +1,6 @@
 #pragma once
 
+#include "align.hpp"
 #include "data.hpp"
 #include "embeddedlabel.hpp"
 #include "instruction.hpp"
@@ -31,7 +32,7 @@ namespace zasm
         const Id _id{ Id::Invalid };
         const Node* _prev{};
         const Node* _next{};
-        const std::variant<NodePoint, Instruction, Label, EmbeddedLabel, Data, Section> _data{};
+        const std::variant<NodePoint, Instruction, Label, EmbeddedLabel, Data, Section, Align> _data{};
 
     protected:
         template<typename T>
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "node.hpp"
+#include "observer.hpp"
+#include "program.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace zasm
+{
+    /// <summary>
+    /// Associates values with nodes using the Node::Id as index into a paged dense array,
+    /// lookups are O(1) and pages are only allocated for id ranges that are used.
+    /// Nodes without an entry report the default value.
+    ///
+    /// When constructed with a Program the map observes it and removes the entries of
+    /// destroyed nodes, otherwise entries of destroyed nodes remain until erased or cleared.
+    /// </summary>
+    template<typename T, std::size_t TPageBits = 10> class NodeMap final : public Observer
+    {
+        static constexpr std::size_t kPageSize = std::size_t{ 1 } << TPageBits;
+        static constexpr std::size_t kPageMask = kPageSize - 1;
+
+        struct Page
+        {
+            std::array<T, kPageSize> values;
+            std::bitset<kPageSize> present;
+        };
+
+        Program* _program{};
+        T _defaultValue{};
+        std::vector<std::unique_ptr<Page>> _pages;
+        std::size_t _size{};
+
+    public:
+        NodeMap() = default;
+
+        explicit NodeMap(const T& defaultValue)
+            : _defaultValue(defaultValue)
+        {
+        }
+
+        /// <summary>
+        /// Creates a map that erases the entry of a node when the node is destroyed.
+        /// </summary>
+        explicit NodeMap(Program& program, const T& defaultValue = T{})
+            : _program(&program)
+            , _defaultValue(defaultValue)
+        {
+            _program->addObserver(*this);
+        }
+
+        NodeMap(const NodeMap&) = delete;
+        NodeMap(NodeMap&&) = delete;
+
+        ~NodeMap() override
+        {
+            if (_program != nullptr)
+            {
+                _program->removeObserver(*this);
+            }
+        }
+
+        NodeMap& operator=(const NodeMap&) = delete;
+        NodeMap& operator=(NodeMap&&) = delete;
+
+        /// <summary>
+        /// Returns the amount of nodes that have an entry.
+        /// </summary>
+        std::size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        const T& getDefault() const noexcept
+        {
+            return _defaultValue;
+        }
+
+        /// <summary>
+        /// Changes the value reported for nodes without an entry, existing entries are kept.
+        /// </summary>
+        void setDefault(const T& defaultValue)
+        {
+            _defaultValue = defaultValue;
+        }
+
+        bool contains(Node::Id id) const noexcept
+        {
+            const auto* page = getPage(id);
+            return page != nullptr && page->present[toSlot(id)];
+        }
+
+        bool contains(const Node* node) const noexcept
+        {
+            return contains(node->getId());
+        }
+
+        /// <summary>
+        /// Returns a pointer to the value of the node or nullptr if there is no entry.
+        /// </summary>
+        T* find(Node::Id id) noexcept
+        {
+            auto* page = getPage(id);
+            if (page == nullptr || !page->present[toSlot(id)])
+            {
+                return nullptr;
+            }
+            return &page->values[toSlot(id)];
+        }
+
+        const T* find(Node::Id id) const noexcept
+        {
+            const auto* page = getPage(id);
+            if (page == nullptr || !page->present[toSlot(id)])
+            {
+                return nullptr;
+            }
+            return &page->values[toSlot(id)];
+        }
+
+        T* find(const Node* node) noexcept
+        {
+            return find(node->getId());
+        }
+
+        const T* find(const Node* node) const noexcept
+        {
+            return find(node->getId());
+        }
+
+        /// <summary>
+        /// Returns the value of the node or the default value if there is no entry.
+        /// </summary>
+        const T& get(Node::Id id) const noexcept
+        {
+            const auto* value = find(id);
+            if (value == nullptr)
+            {
+                return _defaultValue;
+            }
+            return *value;
+        }
+
+        const T& get(const Node* node) const noexcept
+        {
+            return get(node->getId());
+        }
+
+        /// <summary>
+        /// Returns a reference to the value of the node, the entry is created
+        /// with the default value if it does not exist.
+        /// </summary>
+        T& operator[](Node::Id id)
+        {
+            auto& page = getOrCreatePage(id);
+            const auto slot = toSlot(id);
+            if (!page.present[slot])
+            {
+                page.present[slot] = true;
+                page.values[slot] = _defaultValue;
+                _size++;
+            }
+            return page.values[slot];
+        }
+
+        T& operator[](const Node* node)
+        {
+            return operator[](node->getId());
+        }
+
+        void set(Node::Id id, const T& value)
+        {
+            operator[](id) = value;
+        }
+
+        void set(const Node* node, const T& value)
+        {
+            operator[](node->getId()) = value;
+        }
+
+        /// <summary>
+        /// Removes the entry of the node, returns true if there was an entry.
+        /// </summary>
+        bool erase(Node::Id id) noexcept
+        {
+            auto* page = getPage(id);
+            const auto slot = toSlot(id);
+            if (page == nullptr || !page->present[slot])
+            {
+                return false;
+            }
+            page->present[slot] = false;
+            page->values[slot] = _defaultValue;
+            _size--;
+            return true;
+        }
+
+        bool erase(const Node* node) noexcept
+        {
+            return erase(node->getId());
+        }
+
+        /// <summary>
+        /// Removes all entries, allocated pages are kept for reuse.
+        /// </summary>
+        void clear() noexcept
+        {
+            for (auto& page : _pages)
+            {
+                if (page == nullptr || page->present.none())
+                {
+                    continue;
+                }
+                page->present.reset();
+                page->values.fill(_defaultValue);
+            }
+            _size = 0;
+        }
+
+        void onNodeDestroy(const Node* node) override
+        {
+            erase(node->getId());
+        }
+
+    private:
+        static constexpr std::size_t toIndex(Node::Id id) noexcept
+        {
+            return static_cast<std::size_t>(static_cast<std::underlying_type_t<Node::Id>>(id));
+        }
+
+        static constexpr std::size_t toPage(Node::Id id) noexcept
+        {
+            return toIndex(id) >> TPageBits;
+        }
+
+        static constexpr std::size_t toSlot(Node::Id id) noexcept
+        {
+            return toIndex(id) & kPageMask;
+        }
+
+        Page* getPage(Node::Id id) const noexcept
+        {
+            const auto pageIdx = toPage(id);
+            if (pageIdx >= _pages.size())
+            {
+                return nullptr;
+            }
+            return _pages[pageIdx].get();
+        }
+
+        Page& getOrCreatePage(Node::Id id)
+        {
+            const auto pageIdx = toPage(id);
+            if (pageIdx >= _pages.size())
+            {
+                _pages.resize(pageIdx + 1);
+            }
+
+            auto& page = _pages[pageIdx];
+            if (page == nullptr)
+            {
+                page = std::make_unique<Page>();
+                page->values.fill(_defaultValue);
+            }
+            return *page;
+        }
+    };
+
+} // namespace zasm
@@ -29,7 +29,8 @@ namespace zasm
         }
 
         /// <summary>
-        /// This is called before a node is detached.
+        /// This is called before a node is detached, moving a node will also
+        /// call this before the node is unlinked from its current position.
         /// </summary>
         /// <param name="node">The node which will be detached</param>
         virtual void onNodeDetach(const Node* node)
@@ -37,7 +38,8 @@ namespace zasm
         }
 
         /// <summary>
-        /// This is called after a node has been inserted.
+        /// This is called after a node has been inserted, moving a node will also
+        /// call this once the node is linked at its new position.
         /// </summary>
         /// <param name="node">The node which was inserted</param>
         virtual void onNodeInserted(const Node* node)
@@ -166,6 +166,7 @@ namespace zasm
         const Node* createNode(const Data& data);
         const Node* createNode(Data&& data);
         const Node* createNode(const EmbeddedLabel& label);
+        const Node* createNode(const Align& align);
 
     public:
         /// <summary>
@@ -222,6 +223,60 @@ namespace zasm
         /// <returns>Returns LabelData on success, Error on failure.</returns>
         Expected<LabelData, Error> getLabelData(const Label& label) const noexcept;
 
+    public:
+        /// <summary>
+        /// Name of the read-only section the serializer appends for the constant pool.
+        /// </summary>
+        static constexpr const char* kConstPoolSectionName = ".rdata";
+
+        /// <summary>
+        /// Gets or creates a label to a constant in the constant pool, constants with identical bytes share
+        /// the same label and use the highest requested alignment. The pool is not part of the node list,
+        /// the serializer appends it as a read-only section after the last node sorted by descending alignment.
+        /// </summary>
+        /// <param name="data">Pointer to the bytes of the constant</param>
+        /// <param name="size">Size of the constant in bytes</param>
+        /// <param name="align">Alignment of the constant, must be a power of two not above Section::kDefaultAlign</param>
+        /// <returns>Label, invalid label if the parameters are invalid</returns>
+        Label getOrCreateConstant(const void* data, std::size_t size, std::int32_t align);
+
+        /// <summary>
+        /// Returns if the specified label refers to an entry of the constant pool.
+        /// </summary>
+        /// <param name="label">Label to check</param>
+        /// <returns>True if label is a constant</returns>
+        bool isLabelConstant(const Label& label) const noexcept;
+
+        /// <summary>
+        /// Returns the amount of unique constants in the constant pool.
+        /// </summary>
+        std::size_t getConstantCount() const noexcept;
+
+    public:
+        /// <summary>
+        /// Creates a new virtual register, virtual registers can be used like physical registers
+        /// in instructions but have to be replaced by a register allocator before serialization.
+        /// </summary>
+        /// <param name="cls">Register class, Gp allows 8 to 64 bits and Vec 128 to 512 bits</param>
+        /// <param name="size">Size of the register</param>
+        /// <returns>Virtual register, invalid register if the parameters are invalid or the limit is reached</returns>
+        Reg createVirtualReg(Reg::VirtualClass cls, BitSize size);
+
+        /// <summary>
+        /// Returns the class of the virtual register or VirtualClass::Invalid if it does not exist.
+        /// </summary>
+        Reg::VirtualClass getVirtualRegClass(const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns the size of the virtual register or BitSize::_0 if it does not exist.
+        /// </summary>
+        BitSize getVirtualRegSize(const Reg& reg) const noexcept;
+
+        /// <summary>
+        /// Returns the amount of virtual registers created.
+        /// </summary>
+        std::size_t getVirtualRegCount() const noexcept;
+
     public:
         /// <summary>
         /// Creates a new section that can be used to segment code and data.
@@ -270,6 +325,13 @@ namespace zasm
         /// <param name="align">The new alignment</param>
         /// <returns>Error::None on success otherwise see Error</returns>
         Error setSectionAlign(const Section& section, std::int32_t align) noexcept;
+
+        /// <summary>
+        /// Gets the section attributes.
+        /// </summary>
+        /// <param name="section">Section to get the attributes for</param>
+        /// <returns>Section attributes, Section::Attribs::None if an invalid section was supplied.</returns>
+        Section::Attribs getSectionAttribs(const Section& section) const noexcept;
     };
 
 } // namespace zasm
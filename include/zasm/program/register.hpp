@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <zasm/base/mode.hpp>
 #include <zasm/core/bitsize.hpp>
@@ -22,6 +23,29 @@ namespace zasm
             Invalid = 0,
         };
 
+        /// <summary>
+        /// Register class of a virtual register, the size is stored per register in the Program.
+        /// </summary>
+        enum class VirtualClass : std::uint8_t
+        {
+            Invalid = 0,
+            // General purpose register, 8 to 64 bits.
+            Gp,
+            // Vector register, 128 to 512 bits.
+            Vec,
+        };
+
+        /// <summary>
+        /// Ids starting at this value are virtual registers created with Program::createVirtualReg,
+        /// the range is above all physical register ids.
+        /// </summary>
+        static constexpr std::int16_t kFirstVirtualId = 0x1000;
+
+        /// <summary>
+        /// Maximum amount of virtual registers a single Program can create.
+        /// </summary>
+        static constexpr std::size_t kMaxVirtualRegs = 0x7FFF - kFirstVirtualId + 1;
+
     protected:
         Id _reg{ Id::None };
 
@@ -82,6 +106,28 @@ namespace zasm
             return getId() != Id::None;
         }
 
+        /// <summary>
+        /// Returns true if this is a virtual register that has to be assigned by a register allocator
+        /// before the program can be encoded.
+        /// </summary>
+        constexpr bool isVirtual() const noexcept
+        {
+            return static_cast<std::int16_t>(_reg) >= kFirstVirtualId;
+        }
+
+        /// <summary>
+        /// Returns the zero based index of a virtual register, the result is undefined for physical registers.
+        /// </summary>
+        constexpr std::size_t getVirtualIndex() const noexcept
+        {
+            return static_cast<std::size_t>(static_cast<std::int16_t>(_reg) - kFirstVirtualId);
+        }
+
+        static constexpr Reg fromVirtualIndex(std::size_t index) noexcept
+        {
+            return Reg{ static_cast<Id>(static_cast<std::int16_t>(kFirstVirtualId + index)) };
+        }
+
         constexpr bool operator==(const Reg& other) const noexcept
         {
             return _reg == other._reg;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <zasm/core/errors.hpp>
+
+namespace zasm
+{
+    class Serializer;
+
+    /// <summary>
+    /// Compact encoding of the relocations of a Serializer using the layout of PE base relocation blocks.
+    /// Relocations are grouped by the 4 KiB page of their offset in the code buffer, each block starts with
+    /// a header of the page offset and the block size as two 32 bit values followed by a 16 bit entry per
+    /// relocation. The upper 4 bits of an entry hold the type and the lower 12 bits the offset in the page,
+    /// blocks are padded to 4 bytes with an entry of type Absolute.
+    /// </summary>
+    class RelocationTable
+    {
+    public:
+        static constexpr std::int32_t kPageSize = 0x1000;
+
+        // Entry types, same values as IMAGE_REL_BASED_*.
+        static constexpr std::uint16_t kTypeAbsolute = 0;
+        static constexpr std::uint16_t kTypeHighLow = 3;
+        static constexpr std::uint16_t kTypeDir64 = 10;
+
+    private:
+        std::vector<std::uint8_t> _data;
+        std::size_t _entryCount{};
+        std::int64_t _base{};
+
+    public:
+        /// <summary>
+        /// Encodes the relocations of the last serialization, only absolute 32 and 64 bit relocations
+        /// can be encoded.
+        /// </summary>
+        /// <param name="serializer">Serializer with a serialized program</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error build(const Serializer& serializer);
+
+        /// <summary>
+        /// Returns the encoded blocks.
+        /// </summary>
+        const std::uint8_t* getData() const noexcept;
+
+        /// <summary>
+        /// Returns the size of the encoded blocks in bytes.
+        /// </summary>
+        std::size_t getSize() const noexcept;
+
+        /// <summary>
+        /// Returns the amount of relocations in the table, padding entries are not counted.
+        /// </summary>
+        std::size_t getEntryCount() const noexcept;
+
+        /// <summary>
+        /// Returns the base address of the code the table was built for.
+        /// </summary>
+        std::int64_t getBase() const noexcept;
+
+        /// <summary>
+        /// Relocates the code from the base the table was built for to the new base.
+        /// </summary>
+        /// <param name="code">Code buffer of the serialization</param>
+        /// <param name="codeSize">Size of the code buffer</param>
+        /// <param name="newBase">New base address</param>
+        /// <returns>Error::None on success otherwise see Error</returns>
+        Error apply(std::uint8_t* code, std::size_t codeSize, std::int64_t newBase) const;
+
+        /// <summary>
+        /// Streams through the encoded blocks and adds the delta to each relocated value, this only needs the
+        /// encoded bytes so it can be used by a loader without the table object. The code is modified in place,
+        /// on failure the relocations before the failing entry have already been applied.
+        /// </summary>
+        /// <param name="data">Encoded blocks</param>
+        /// <param name="size">Size of the encoded blocks in bytes</param>
+        /// <param name="code">Code buffer to relocate</param>
+        /// <param name="codeSize">Size of the code buffer</param>
+        /// <param name="delta">Difference between the new and the old base address</param>
+        /// <returns>Error::None on success, Error::InvalidParameter for malformed blocks, Error::OutOfBounds
+        /// for entries outside of the code and Error::ImpossibleRelocation if a 32 bit value overflows</returns>
+        static Error apply(
+            const std::uint8_t* data, std::size_t size, std::uint8_t* code, std::size_t codeSize, std::int64_t delta);
+    };
+
+} // namespace zasm
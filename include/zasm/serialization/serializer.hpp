@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <zasm/core/enumflags.hpp>
 #include <zasm/core/errors.hpp>
 #include <zasm/core/expected.hpp>
 #include <zasm/encoder/encoder.hpp>
@@ -13,7 +14,22 @@ namespace zasm
     namespace detail
     {
         struct SerializerState;
-    }
+
+        enum class SerializerOptions : std::uint32_t
+        {
+            None = 0,
+            // Encodes instructions in the shortest semantically equivalent form, ex.: mov rax, 1 as mov eax, 1.
+            ShortestEncoding = (1U << 0),
+            // Pads jumps and macro fused cmp/test + jcc pairs with NOPs so they do not cross or end on a
+            // 32 byte boundary, this avoids the penalty of the Intel JCC erratum microcode update.
+            AlignBranches = (1U << 1),
+            // Creates one pointer sized slot per referenced import label in a data section and rewrites the uses
+            // into call/jmp [slot] and mov reg, [slot], the loader only has to patch the slots. Memory operands
+            // referencing an import keep their external relocation.
+            ImportSlots = (1U << 2),
+        };
+        ZASM_ENABLE_ENUM_OPERATORS(SerializerOptions);
+    } // namespace detail
 
     struct SectionInfo
     {
@@ -35,11 +51,37 @@ namespace zasm
         Label::Id label{ Label::Id::Invalid };
     };
 
+    struct VeneerInfo
+    {
+        // Address of the veneer, the 8 byte slot holding the target follows the jump.
+        std::int64_t address{};
+        std::int64_t target{};
+    };
+
     class Serializer
     {
         std::unique_ptr<detail::SerializerState> _state;
 
     public:
+        using Options = detail::SerializerOptions;
+
+        /// <summary>
+        /// Name of the executable section the serializer appends for veneers. A veneer is a jmp qword ptr [rip+x]
+        /// followed by an 8 byte slot with the target, branches to targets outside of the rel32 range are routed
+        /// through it. Branches to the same target share one veneer.
+        /// </summary>
+        static constexpr const char* kVeneerSectionName = ".veneer";
+
+        /// <summary>
+        /// Size of a single veneer including the slot.
+        /// </summary>
+        static constexpr std::int32_t kVeneerSize = 16;
+
+        /// <summary>
+        /// Name of the data section the serializer appends for import slots, see Options::ImportSlots.
+        /// </summary>
+        static constexpr const char* kImportSectionName = ".idata";
+
         Serializer();
         Serializer(const Serializer&) = delete;
         Serializer(Serializer&& other) noexcept;
@@ -48,12 +90,35 @@ namespace zasm
         Serializer& operator=(const Serializer&) = delete;
         Serializer& operator=(Serializer&& other) noexcept;
 
+        /// <summary>
+        /// Sets the options used by the following serialize calls.
+        /// </summary>
+        /// <param name="options">Serializer options</param>
+        void setOptions(Options options) noexcept;
+
+        /// <summary>
+        /// Returns the options used for serialization.
+        /// </summary>
+        Options getOptions() const noexcept;
+
+        /// <summary>
+        /// Provides the address of an external label for the following serialize calls, references to the label
+        /// are encoded with the absolute address and produce no external relocation. Branches to the label use
+        /// a veneer if the address is outside of the rel32 range, rip relative memory operands that can not reach
+        /// the address keep their external relocation. Relative uses that reach the address get a Rel32
+        /// relocation without a label, relocate adjusts them as the address does not move with the code.
+        /// </summary>
+        /// <param name="label">External label</param>
+        /// <param name="address">Absolute address of the label</param>
+        void setExternalLabelAddress(const Label& label, std::int64_t address);
+
         /// <summary>
         /// Serializes the all the nodes in the Program to the encoder and
         /// resolves the address of each label.
         /// </summary>
         /// <param name="newBase">Virtual base address at where the code starts</param>
-        /// <returns>If successful returns Error::None otherwise check Error value.</returns>
+        /// <returns>If successful returns Error::None otherwise check Error value, Error::PassLimitReached
+        /// if the layout did not converge.</returns>
         Error serialize(const Program& program, std::int64_t newBase);
 
         /// <summary>
@@ -69,6 +134,8 @@ namespace zasm
 
         /// <summary>
         /// Attempts to relocate the current serialized code to the new specified base address.
+        /// Fails with Error::ImpossibleRelocation if a relative use of a known external address
+        /// is out of range from the new base.
         /// </summary>
         /// <param name="newBase">Virtual base address at where the code starts</param>
         /// <returns>If successful returns Error::None otherwise check Error value.</returns>
@@ -123,6 +190,42 @@ namespace zasm
         /// <returns>Address of label or -1 if the label is not bound or found.</returns>
         std::int64_t getLabelAddress(Label::Id labelId) const noexcept;
 
+        /// <summary>
+        /// Returns the offset of the node in the code buffer from the last serialization.
+        /// </summary>
+        /// <param name="node">Node that was part of the serialized range</param>
+        /// <returns>Offset of the node or -1 if the node is null or was not serialized</returns>
+        std::int32_t getNodeOffset(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Returns the virtual address of the node from the last serialization.
+        /// </summary>
+        /// <param name="node">Node that was part of the serialized range</param>
+        /// <returns>Address of the node or -1 if the node is null or was not serialized</returns>
+        std::int64_t getNodeAddress(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Returns the amount of bytes the node was encoded to in the last serialization.
+        /// </summary>
+        /// <param name="node">Node that was part of the serialized range</param>
+        /// <returns>Length of the node or -1 if the node is null or was not serialized</returns>
+        std::int32_t getNodeLength(const Node* node) const noexcept;
+
+        /// <summary>
+        /// Finds the node which encoded bytes contain the virtual address, this is a binary search
+        /// over the serialized nodes. Nodes without data such as labels are never returned.
+        /// </summary>
+        /// <param name="address">Virtual address</param>
+        /// <returns>The node or nullptr if no node covers the address</returns>
+        const Node* findNodeAt(std::int64_t address) const noexcept;
+
+        /// <summary>
+        /// Same as findNodeAt but using the offset in the code buffer.
+        /// </summary>
+        /// <param name="offset">Offset in the code buffer</param>
+        /// <returns>The node or nullptr if no node covers the offset</returns>
+        const Node* findNodeAtOffset(std::int32_t offset) const noexcept;
+
         /// <summary>
         /// Returns the amount of relocation items.
         /// </summary>
@@ -147,6 +250,32 @@ namespace zasm
         /// <returns>Pointer to relocation info or null in case the index does not exist</returns>
         const RelocationInfo* getExternalRelocation(std::size_t index) const noexcept;
 
+        /// <summary>
+        /// Returns the amount of import slots created by the last serialization, this is zero unless
+        /// Options::ImportSlots is used.
+        /// </summary>
+        std::size_t getImportSlotCount() const noexcept;
+
+        /// <summary>
+        /// Returns the import slot of the specified index, the slot is described as an absolute relocation
+        /// of the import label that the loader has to patch with the address of the import.
+        /// </summary>
+        /// <param name="index">Index of the import slot</param>
+        /// <returns>Pointer to relocation info or null in case the index does not exist</returns>
+        const RelocationInfo* getImportSlot(std::size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns the amount of veneers created by the last serialization.
+        /// </summary>
+        std::size_t getVeneerCount() const noexcept;
+
+        /// <summary>
+        /// Returns the veneer info of the specified index.
+        /// </summary>
+        /// <param name="index">Index of the veneer</param>
+        /// <returns>Pointer to veneer info or null in case the index does not exist</returns>
+        const VeneerInfo* getVeneer(std::size_t index) const noexcept;
+
         /// <summary>
         /// Clears the current serialized state.
         /// </summary>
@@ -4,6 +4,8 @@
 
 #include <cstddef>
 #include <memory>
+#include <type_traits>
+#include <vector>
 #include <zasm/core/errors.hpp>
 #include <zasm/program/instruction.hpp>
 #include <zasm/program/observer.hpp>
@@ -27,6 +29,18 @@ namespace zasm::x86
         Attribs _attribState{};
         std::unique_ptr<InstrGenerator> _generator{};
 
+        struct JumpTable
+        {
+            // The instruction loading the entry, rewritten when the entry size changes.
+            const Node* load{};
+            Label table{};
+            Reg::Id index{};
+            Reg::Id base{};
+            BitSize entrySize{};
+            std::size_t entryCount{};
+        };
+        std::vector<JumpTable> _jumpTables;
+
     public:
         Assembler(Program& _program);
         ~Assembler();
@@ -54,6 +68,53 @@ namespace zasm::x86
         /// </summary>
         Label getOrCreateImportLabel(const char* moduleName, const char* entryName);
 
+        /// <summary>
+        /// Returns a label to the bytes in the read-only constant pool, see Program::getOrCreateConstant.
+        /// The constant is not inserted at the cursor, reference it with a memory operand such as
+        /// x86::xmmword_ptr(x86::rip, label).
+        /// </summary>
+        /// <param name="data">Pointer to the bytes of the constant</param>
+        /// <param name="size">Size of the constant in bytes</param>
+        /// <param name="align">Alignment of the constant</param>
+        /// <returns>Label, invalid label if the parameters are invalid</returns>
+        Label constPool(const void* data, std::size_t size, std::int32_t align);
+
+        /// <summary>
+        /// Returns a label to the value in the read-only constant pool, see Program::getOrCreateConstant.
+        /// </summary>
+        /// <param name="value">The constant, ex.: std::array<float, 4></param>
+        /// <param name="align">Alignment of the constant, defaults to the alignment of the type</param>
+        /// <returns>Label, invalid label if the parameters are invalid</returns>
+        template<typename T> Label constPool(const T& value, std::int32_t align = static_cast<std::int32_t>(alignof(T)))
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Constants must be trivially copyable");
+            return constPool(&value, sizeof(T), align);
+        }
+
+        /// <summary>
+        /// Creates a virtual general purpose register, see Program::createVirtualReg.
+        /// Virtual registers can be used in place of physical registers and memory base/index registers,
+        /// the instructions are validated with physical placeholders and RegisterAllocator assigns them.
+        /// </summary>
+        /// <param name="size">Size of the register, 8 to 64 bits</param>
+        /// <returns>Register, invalid if the size is not supported in the current mode</returns>
+        Gp createVirtualGp(BitSize size);
+
+        /// <summary>
+        /// Creates a virtual 128 bit vector register, see createVirtualGp.
+        /// </summary>
+        Xmm createVirtualXmm();
+
+        /// <summary>
+        /// Creates a virtual 256 bit vector register, see createVirtualGp.
+        /// </summary>
+        Ymm createVirtualYmm();
+
+        /// <summary>
+        /// Creates a virtual 512 bit vector register, see createVirtualGp.
+        /// </summary>
+        Zmm createVirtualZmm();
+
         /// <summary>
         /// Binds the label to a node and inserts it at the current position.
         /// </summary>
@@ -72,6 +133,15 @@ namespace zasm::x86
         Error section(
             const char* name, Section::Attribs attribs = Section::kDefaultAttribs, std::int32_t align = Section::kDefaultAlign);
 
+        /// <summary>
+        /// Pads the output until the next node is aligned, the padding is computed by the serializer.
+        /// Code sections are padded with multi-byte NOPs unless a fill byte is specified.
+        /// </summary>
+        /// <param name="alignment">Alignment in bytes, must be a power of two</param>
+        /// <param name="fill">Byte used for padding or Align::kFillNop</param>
+        /// <returns>Error</returns>
+        Error align(std::int32_t alignment, std::int32_t fill = Align::kFillNop);
+
     public:
         // Data emitter.
         Error db(std::uint8_t val, std::size_t repeatCount = 1);
@@ -103,6 +173,49 @@ namespace zasm::x86
         Error embedLabel(Label label);
         Error embedLabelRel(Label label, Label relativeTo, BitSize size);
 
+    public:
+        struct SwitchCase
+        {
+            std::int64_t value{};
+            Label target{};
+        };
+
+        // Ranges with fewer cases are lowered to compares.
+        static constexpr std::size_t kMinJumpTableCases = 4;
+        // Minimum percentage of values in the range that must have a case to use a jump table.
+        static constexpr std::size_t kMinJumpTableDensity = 40;
+        static constexpr std::size_t kMaxJumpTableEntries = 4096;
+
+        /// <summary>
+        /// Lowers a switch on the signed value of the register at the current cursor. Dense ranges of cases
+        /// are dispatched with a bounds checked jump table of 32 bit entries relative to the table, the
+        /// remaining cases with a binary search compare tree. Values without a case jump to defaultTarget.
+        /// The value register is clobbered by the jump table dispatch, the scratch register holds the table
+        /// address. Call compactJumpTables once all targets are bound to shrink the entries.
+        /// </summary>
+        /// <param name="value">32 or 64 bit register holding the value</param>
+        /// <param name="scratch">Register different from value</param>
+        /// <param name="cases">The cases, the values must be unique</param>
+        /// <param name="count">Number of cases</param>
+        /// <param name="defaultTarget">Label to jump to when no case matches</param>
+        /// <returns>Error</returns>
+        Error switchJump(const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget);
+
+        /// <summary>
+        /// Serializes the program and rewrites the jump tables created by switchJump to use the smallest
+        /// entry size, 8, 16 or 32 bit, that fits the distances of the final layout.
+        /// </summary>
+        /// <returns>Error</returns>
+        Error compactJumpTables();
+
+    private:
+        Error lowerSwitchRange(
+            const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget);
+        Error emitJumpTable(
+            const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget);
+        Error emitJumpTableLoad(const JumpTable& table);
+        Error resizeJumpTable(JumpTable& table, BitSize entrySize, const Node*& cursor);
+
     public:
         template<typename... TArgs> Error emit(Mnemonic mnemonic, TArgs&&... args)
         {
@@ -152,6 +265,60 @@ namespace zasm::x86
             return *this;
         }
 
+        /// <summary>
+        /// EVEX zeroing-masking {z} for the next instruction, the opmask is the explicit Mask operand.
+        /// </summary>
+        Assembler& z() noexcept
+        {
+            addAttrib(Attribs::Zeroing);
+            return *this;
+        }
+
+        /// <summary>
+        /// EVEX suppress all exceptions {sae} for the next instruction.
+        /// </summary>
+        Assembler& sae() noexcept
+        {
+            addAttrib(Attribs::Sae);
+            return *this;
+        }
+
+        /// <summary>
+        /// EVEX embedded rounding for the next instruction, round to nearest {rn-sae}.
+        /// </summary>
+        Assembler& rn_sae() noexcept
+        {
+            addAttrib(Attribs::RnSae);
+            return *this;
+        }
+
+        /// <summary>
+        /// EVEX embedded rounding for the next instruction, round down {rd-sae}.
+        /// </summary>
+        Assembler& rd_sae() noexcept
+        {
+            addAttrib(Attribs::RdSae);
+            return *this;
+        }
+
+        /// <summary>
+        /// EVEX embedded rounding for the next instruction, round up {ru-sae}.
+        /// </summary>
+        Assembler& ru_sae() noexcept
+        {
+            addAttrib(Attribs::RuSae);
+            return *this;
+        }
+
+        /// <summary>
+        /// EVEX embedded rounding for the next instruction, round toward zero {rz-sae}.
+        /// </summary>
+        Assembler& rz_sae() noexcept
+        {
+            addAttrib(Attribs::RzSae);
+            return *this;
+        }
+
     private:
         /// <summary>
         /// Observer events, this ensures the cursor remains valid.
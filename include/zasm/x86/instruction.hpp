@@ -1952,6 +1952,15 @@ namespace zasm::x86
         OperandSize16 = (1U << 8),
         OperandSize32 = (1U << 9),
         OperandSize64 = (1U << 10),
+        // EVEX zeroing-masking {z}, elements not selected by the opmask are zeroed instead of merged.
+        Zeroing = (1U << 11),
+        // EVEX suppress all exceptions {sae}, implied by the rounding modes.
+        Sae = (1U << 12),
+        // EVEX embedded rounding, only valid for register operands.
+        RnSae = (1U << 13),
+        RdSae = (1U << 14),
+        RuSae = (1U << 15),
+        RzSae = (1U << 16),
     };
     ZASM_ENABLE_ENUM_OPERATORS(Attribs);
 
@@ -1,8 +1,26 @@
 #pragma once
 
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/flagsliveness.hpp>
+#include <zasm/analysis/machinemodel.hpp>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/analysis/throughput.hpp>
+#include <zasm/codegen/callconv.hpp>
+#include <zasm/codegen/funcframe.hpp>
+#include <zasm/codegen/registerallocator.hpp>
 #include <zasm/core/errors.hpp>
 #include <zasm/decoder/decoder.hpp>
 #include <zasm/encoder/encoder.hpp>
+#include <zasm/instrumentation/blockcounters.hpp>
+#include <zasm/optimization/blocklayout.hpp>
+#include <zasm/optimization/deadcode.hpp>
+#include <zasm/optimization/hazardfix.hpp>
+#include <zasm/optimization/hotcoldsplit.hpp>
+#include <zasm/optimization/peephole.hpp>
+#include <zasm/optimization/scheduler.hpp>
+#include <zasm/program/nodemap.hpp>
 #include <zasm/program/program.hpp>
+#include <zasm/serialization/relocationtable.hpp>
 #include <zasm/serialization/serializer.hpp>
 #include <zasm/x86/x86.hpp>
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    // Creates a program with a branch every 8 instructions and a label every 32 instructions.
+    static void createBranchyProgram(x86::Assembler& assembler, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        zasm::Label label = assembler.createLabel();
+        assembler.bind(label);
+
+        for (std::int64_t i = 0; i < count; ++i)
+        {
+            if (i % 32 == 31)
+            {
+                label = assembler.createLabel();
+                assembler.bind(label);
+            }
+            if (i % 8 == 7)
+            {
+                assembler.jnz(label);
+            }
+            else
+            {
+                assembler.add(eax, Imm(i));
+            }
+        }
+        assembler.ret();
+    }
+
+    static void BM_ControlFlowGraph_Build(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        createBranchyProgram(assembler, state.range(0));
+
+        for (auto _ : state)
+        {
+            ControlFlowGraph cfg(program);
+            cfg.update();
+
+            benchmark::DoNotOptimize(cfg.getBlockCount());
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ControlFlowGraph_Build)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(4096, 1 << 20);
+
+    static void BM_ControlFlowGraph_Update(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        createBranchyProgram(assembler, state.range(0));
+
+        ControlFlowGraph cfg(program);
+        cfg.update();
+
+        // Edit at the middle of the program.
+        const auto* pos = program.getHead();
+        for (std::int64_t i = 0; i < state.range(0) / 2; ++i)
+        {
+            pos = pos->getNext();
+        }
+
+        for (auto _ : state)
+        {
+            // Inserting and removing a branch splits and merges a block.
+            assembler.setCursor(pos);
+            assembler.jmp(rax);
+            const auto* node = assembler.getCursor();
+            cfg.update();
+
+            program.destroy(node);
+            cfg.update();
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ControlFlowGraph_Update)->Unit(benchmark::kMicrosecond)->RangeMultiplier(2)->Range(4096, 1 << 20);
+
+} // namespace zasm::benchmarks
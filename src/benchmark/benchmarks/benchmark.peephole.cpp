@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include <zasm/optimization/peephole.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    // Creates naive code as typically produced by simple code generators.
+    static void createNaiveProgram(x86::Assembler& assembler, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        for (std::int64_t i = 0; i < count; i += 8)
+        {
+            auto label = assembler.createLabel();
+
+            assembler.mov(eax, Imm(0));
+            assembler.add(rcx, Imm(1));
+            assembler.mov(rdx, rcx);
+            assembler.mov(rcx, rdx);
+            assembler.sub(rdx, Imm(1));
+            assembler.add(rax, rdx);
+            assembler.jmp(label);
+            assembler.bind(label);
+            assembler.cmp(rax, rcx);
+        }
+        assembler.ret();
+    }
+
+    static void BM_Peephole(benchmark::State& state)
+    {
+        std::size_t sizeBefore = 0;
+        std::size_t sizeAfter = 0;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+
+            Program program(MachineMode::AMD64);
+            x86::Assembler assembler(program);
+            createNaiveProgram(assembler, state.range(0));
+
+            Serializer serializer;
+            serializer.serialize(program, 0x00400000);
+            sizeBefore = serializer.getCodeSize();
+
+            Peephole peephole(program);
+            peephole.addDefaultRules();
+
+            state.ResumeTiming();
+
+            peephole.run();
+
+            state.PauseTiming();
+            serializer.serialize(program, 0x00400000);
+            sizeAfter = serializer.getCodeSize();
+            state.ResumeTiming();
+        }
+
+        state.counters["BytesBefore"] = static_cast<double>(sizeBefore);
+        state.counters["BytesAfter"] = static_cast<double>(sizeAfter);
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Peephole)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(4096, 1 << 20);
+
+} // namespace zasm::benchmarks
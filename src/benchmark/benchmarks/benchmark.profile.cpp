@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include <testdata/instructions.hpp>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static void BM_ProfileAddSamples(benchmark::State& state)
+    {
+        constexpr std::int64_t kBase = 0x00400000;
+        constexpr std::int64_t kSampleCount = 1'000'000;
+
+        Program program(MachineMode::AMD64);
+        x86::Assembler assembler(program);
+        Serializer serializer;
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            const auto& instr = tests::data::Instructions[i % std::size(tests::data::Instructions)];
+            instr.emitter(assembler);
+        }
+
+        serializer.serialize(program, kBase);
+
+        const auto codeSize = static_cast<std::int64_t>(serializer.getCodeSize());
+
+        Profile profile(program);
+        for (auto _ : state)
+        {
+            std::int64_t offset = 0;
+            for (std::int64_t i = 0; i < kSampleCount; ++i)
+            {
+                offset = (offset + 7919) % codeSize;
+                profile.addSample(serializer, kBase + offset);
+            }
+            profile.updateLabelWeights();
+        }
+
+        state.counters["Samples"] = benchmark::Counter(
+            static_cast<double>(kSampleCount), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ProfileAddSamples)->Unit(benchmark::kMillisecond)->RangeMultiplier(16)->Range(4096, 1 << 20);
+
+} // namespace zasm::benchmarks
@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static void BM_RegisterAllocator(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+
+        std::vector<Gp> regs;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            regs.clear();
+
+            // Chains of short lived temporaries with a few long lived values so some registers spill.
+            for (int64_t i = 0; i < state.range(0); i += 4)
+            {
+                if (i % 64 == 0)
+                {
+                    regs.push_back(assembler.createVirtualGp(BitSize::_64));
+                    assembler.mov(regs.back(), Imm(i));
+                }
+                const auto tmp = assembler.createVirtualGp(BitSize::_64);
+                const auto& acc = regs[regs.size() / 2];
+                assembler.mov(tmp, acc);
+                assembler.add(tmp, Imm(i));
+                assembler.xor_(tmp, regs.back());
+                assembler.add(acc, tmp);
+            }
+            for (const auto& reg : regs)
+            {
+                assembler.add(rax, reg);
+            }
+            assembler.ret();
+
+            state.ResumeTiming();
+
+            RegisterAllocator allocator(program);
+            allocator.run();
+
+            state.counters["Instructions"] = benchmark::Counter(
+                static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+                benchmark::Counter::OneK::kIs1000);
+        }
+    }
+    BENCHMARK(BM_RegisterAllocator)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(4096, 8 << 14);
+
+} // namespace zasm::benchmarks
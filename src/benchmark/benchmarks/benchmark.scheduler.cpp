@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    // Loads placed directly before their use as produced by simple code generators.
+    static void createDotKernel(x86::Assembler& assembler, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        const Ymm values[] = { ymm2, ymm3, ymm4, ymm5, ymm6, ymm7, ymm8, ymm9 };
+
+        for (std::int64_t i = 0; i < count; i += 2)
+        {
+            const auto disp = static_cast<std::int32_t>((i % 64) * 32);
+            const auto& value = values[(i / 2) % 8];
+
+            assembler.vmovups(value, ymmword_ptr(rsi, disp));
+            assembler.vfmadd231ps((i / 2) % 2 == 0 ? ymm0 : ymm1, value, ymmword_ptr(rdi, disp));
+        }
+    }
+
+    static void createSumKernel(x86::Assembler& assembler, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        const Gp64 values[] = { rax, rdx, r8, r9 };
+
+        for (std::int64_t i = 0; i < count; i += 2)
+        {
+            const auto& value = values[(i / 2) % 4];
+
+            assembler.mov(value, qword_ptr(rsi, static_cast<std::int32_t>((i % 512) * 8)));
+            assembler.add(rcx, value);
+        }
+    }
+
+    static void createPolyKernel(x86::Assembler& assembler, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        for (std::int64_t i = 0; i < count; i += 4)
+        {
+            const auto disp = static_cast<std::int32_t>((i % 512) * 8);
+
+            assembler.imul(rax, rcx);
+            assembler.mov(rdx, qword_ptr(rsi, disp));
+            assembler.add(rax, rdx);
+            assembler.lea(rbx, qword_ptr(rbx, rdx, 2, 0));
+        }
+    }
+
+    using KernelFn = void (*)(x86::Assembler&, std::int64_t);
+
+    static void runScheduler(benchmark::State& state, KernelFn kernel, std::int64_t count)
+    {
+        Scheduler::Stats stats{};
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+
+            Program program(MachineMode::AMD64);
+            x86::Assembler assembler(program);
+            kernel(assembler, count);
+            assembler.ret();
+
+            Scheduler scheduler(program);
+
+            state.ResumeTiming();
+
+            scheduler.run();
+
+            state.PauseTiming();
+            stats = scheduler.getStats();
+            state.ResumeTiming();
+        }
+
+        state.counters["CyclesBefore"] = static_cast<double>(stats.cyclesBefore);
+        state.counters["CyclesAfter"] = static_cast<double>(stats.cyclesAfter);
+        state.counters["Speedup"] = stats.cyclesAfter != 0
+            ? static_cast<double>(stats.cyclesBefore) / static_cast<double>(stats.cyclesAfter)
+            : 1.0;
+        state.counters["Moved"] = static_cast<double>(stats.instructionsMoved);
+    }
+
+    static void BM_Scheduler(benchmark::State& state)
+    {
+        runScheduler(state, createPolyKernel, state.range(0));
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Scheduler)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1024, 1 << 18);
+
+    // Estimated cycles of a single execution of the kernels on an in-order pipeline before and after scheduling.
+    static void BM_SchedulerKernel(benchmark::State& state)
+    {
+        constexpr std::int64_t kKernelSize = 64;
+
+        switch (state.range(0))
+        {
+            case 0:
+                state.SetLabel("dot");
+                runScheduler(state, createDotKernel, kKernelSize);
+                break;
+            case 1:
+                state.SetLabel("sum");
+                runScheduler(state, createSumKernel, kKernelSize);
+                break;
+            default:
+                state.SetLabel("poly");
+                runScheduler(state, createPolyKernel, kKernelSize);
+                break;
+        }
+    }
+    BENCHMARK(BM_SchedulerKernel)->Unit(benchmark::kMicrosecond)->DenseRange(0, 2);
+
+} // namespace zasm::benchmarks
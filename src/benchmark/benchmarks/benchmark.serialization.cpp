@@ -1,6 +1,7 @@
 #include <benchmark/benchmark.h>
 #include <functional>
 #include <testdata/instructions.hpp>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::benchmarks
@@ -54,4 +55,92 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_Serialization)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(4096, 8 << 18);
 
+    static void BM_SerializationFindNodeAt(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            const auto& instr = tests::data::Instructions[i % std::size(tests::data::Instructions)];
+            instr.emitter(assembler);
+        }
+
+        serializer.serialize(program, 0x00400000);
+
+        const auto codeSize = static_cast<std::int64_t>(serializer.getCodeSize());
+
+        std::int64_t offset = 0;
+        for (auto _ : state)
+        {
+            // Walk the code with a stride that is co-prime to most sizes to avoid a predictable pattern.
+            offset = (offset + 7919) % codeSize;
+            benchmark::DoNotOptimize(serializer.findNodeAt(0x00400000 + offset));
+        }
+    }
+    BENCHMARK(BM_SerializationFindNodeAt)->RangeMultiplier(4)->Range(4096, 4 << 20);
+
+    static void serializeRelocations(Program& program, Serializer& serializer, std::int64_t count)
+    {
+        using namespace zasm::x86;
+
+        Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+        for (int64_t i = 0; i < count; ++i)
+        {
+            assembler.mov(rax, label);
+        }
+        assembler.bind(label);
+        assembler.ret();
+
+        serializer.serialize(program, 0x140000000);
+    }
+
+    static void BM_SerializationRelocate(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        Serializer serializer;
+        serializeRelocations(program, serializer, state.range(0));
+
+        std::int64_t base = 0x140000000;
+        for (auto _ : state)
+        {
+            base += 0x10000;
+            serializer.relocate(base);
+        }
+
+        state.counters["MetadataBytes"] = static_cast<double>(serializer.getRelocationCount() * sizeof(RelocationInfo));
+        state.counters["Relocations"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_SerializationRelocate)->Unit(benchmark::kMicrosecond)->RangeMultiplier(4)->Range(4096, 1 << 18);
+
+    static void BM_RelocationTableApply(benchmark::State& state)
+    {
+        Program program(MachineMode::AMD64);
+        Serializer serializer;
+        serializeRelocations(program, serializer, state.range(0));
+
+        RelocationTable table;
+        table.build(serializer);
+
+        std::vector<std::uint8_t> code(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+        for (auto _ : state)
+        {
+            RelocationTable::apply(table.getData(), table.getSize(), code.data(), code.size(), 0x10000);
+            benchmark::ClobberMemory();
+        }
+
+        state.counters["MetadataBytes"] = static_cast<double>(table.getSize());
+        state.counters["Relocations"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_RelocationTableApply)->Unit(benchmark::kMicrosecond)->RangeMultiplier(4)->Range(4096, 1 << 18);
+
 } // namespace zasm::benchmarks
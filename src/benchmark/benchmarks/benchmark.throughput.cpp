@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static void BM_ThroughputAnalyzer(benchmark::State& state)
+    {
+        using namespace zasm::x86;
+
+        Program program(MachineMode::AMD64);
+        Assembler assembler(program);
+
+        // A typical vector kernel body.
+        for (int64_t i = 0; i < state.range(0); i += 4)
+        {
+            assembler.vmovups(ymm0, ymmword_ptr(rsi, rcx, 4, static_cast<int32_t>(i * 8)));
+            assembler.vfmadd231ps(ymm1, ymm0, ymm2);
+            assembler.vmovups(ymmword_ptr(rdi, rcx, 4, static_cast<int32_t>(i * 8)), ymm1);
+            assembler.add(rcx, Imm(8));
+        }
+
+        ThroughputAnalyzer analyzer(program);
+
+        for (auto _ : state)
+        {
+            analyzer.run(program.getHead());
+            benchmark::DoNotOptimize(analyzer.getReport().cyclesPerIteration);
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ThroughputAnalyzer)->Unit(benchmark::kMicrosecond)->RangeMultiplier(4)->Range(16, 4096);
+
+} // namespace zasm::benchmarks
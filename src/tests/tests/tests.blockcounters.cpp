@@ -0,0 +1,200 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <zasm/instrumentation/blockcounters.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static x86::Mnemonic getMnemonic(const Node* node)
+    {
+        return static_cast<x86::Mnemonic>(node->get<Instruction>().getMnemonic());
+    }
+
+    TEST(BlockCountersTests, IncWhenFlagsDead)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelEntry = a.createLabel();
+        ASSERT_EQ(a.bind(labelEntry), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        BlockCounters counters(program);
+        ASSERT_EQ(counters.run(), Error::None);
+
+        ASSERT_EQ(counters.getCounterCount(), 1U);
+        const auto* counter = counters.findBlockCounter(labelEntry);
+        ASSERT_NE(counter, nullptr);
+        ASSERT_EQ(counter->kind, BlockCounters::Kind::Block);
+        ASSERT_EQ(counter->form, BlockCounters::Form::Inc);
+        ASSERT_EQ(counter->target.getId(), labelEntry.getId());
+        ASSERT_EQ(counters.getStats().incForms, 1U);
+
+        // The counter is placed after the label.
+        const auto* node = program.getHead()->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Inc);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Mem>(0).getLabelId(), counter->label.getId());
+        ASSERT_EQ(node->getNext(), counter->node);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(serializer.getSectionCount(), 2U);
+
+        const auto* info = serializer.getSectionInfo(1);
+        ASSERT_STREQ(info->name, BlockCounters::kCounterSectionName);
+        ASSERT_EQ(info->attribs, Section::Attribs::Data);
+        ASSERT_EQ(serializer.getLabelAddress(counter->label.getId()), info->address);
+    }
+
+    // The flags of the cmp are consumed in the block of labelA and rax is overwritten on every path.
+    static void buildFlagsLive(x86::Assembler& a, Label& labelA, Label& labelB)
+    {
+        labelA = a.createLabel();
+        labelB = a.createLabel();
+        auto labelExit = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jmp(labelA), Error::None);
+        ASSERT_EQ(a.bind(labelA), Error::None);
+        ASSERT_EQ(a.jz(labelB), Error::None);
+        ASSERT_EQ(a.jmp(labelExit), Error::None);
+        ASSERT_EQ(a.bind(labelB), Error::None);
+        ASSERT_EQ(a.jmp(labelExit), Error::None);
+        ASSERT_EQ(a.bind(labelExit), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, x86::rdx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+    }
+
+    TEST(BlockCountersTests, RegisterWhenFlagsLive)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        Label labelA, labelB;
+        buildFlagsLive(a, labelA, labelB);
+
+        BlockCounters counters(program);
+        ASSERT_EQ(counters.run(), Error::None);
+        ASSERT_EQ(counters.getCounterCount(), 5U);
+
+        const auto* counterA = counters.findBlockCounter(labelA);
+        ASSERT_NE(counterA, nullptr);
+        ASSERT_EQ(counterA->form, BlockCounters::Form::Register);
+
+        const auto* node = counterA->node->getPrev();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Mov);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Reg>(1), x86::rax);
+        node = node->getPrev();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Lea);
+        node = node->getPrev();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Mov);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Reg>(0), x86::rax);
+
+        const auto* counterB = counters.findBlockCounter(labelB);
+        ASSERT_NE(counterB, nullptr);
+        ASSERT_EQ(counterB->form, BlockCounters::Form::Inc);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(BlockCountersTests, SaveFlagsWhenAtomic)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        Label labelA, labelB;
+        buildFlagsLive(a, labelA, labelB);
+
+        BlockCounters counters(program, BlockCounters::Options::Atomic);
+        ASSERT_EQ(counters.run(), Error::None);
+
+        const auto* counterA = counters.findBlockCounter(labelA);
+        ASSERT_NE(counterA, nullptr);
+        ASSERT_EQ(counterA->form, BlockCounters::Form::SaveFlags);
+        ASSERT_EQ(counters.getStats().saveFlagsForms, 1U);
+        ASSERT_EQ(counters.getStats().registerForms, 0U);
+
+        const std::array<x86::Mnemonic, 5> expected = {
+            x86::Mnemonic::Lea, x86::Mnemonic::Pushfq, x86::Mnemonic::Inc, x86::Mnemonic::Popfq, x86::Mnemonic::Lea,
+        };
+        const auto* node = counterA->node;
+        for (auto it = expected.rbegin(); it != expected.rend(); ++it)
+        {
+            node = node->getPrev();
+            ASSERT_EQ(getMnemonic(node), *it);
+        }
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(BlockCountersTests, EdgeCounters)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelSkip = a.createLabel();
+
+        ASSERT_EQ(a.test(x86::ecx, x86::ecx), Error::None);
+        ASSERT_EQ(a.jz(labelSkip), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.bind(labelSkip), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        BlockCounters counters(program, BlockCounters::Options::Edges);
+        ASSERT_EQ(counters.run(), Error::None);
+
+        const auto& stats = counters.getStats();
+        ASSERT_EQ(stats.blockCounters, 3U);
+        ASSERT_EQ(stats.edgeCounters, 2U);
+        ASSERT_EQ(counters.getCounterCount(), 5U);
+
+        const BlockCounters::Counter* taken = nullptr;
+        const BlockCounters::Counter* fallthrough = nullptr;
+        for (std::size_t i = 0; i < counters.getCounterCount(); ++i)
+        {
+            const auto* counter = counters.getCounter(i);
+            if (counter->kind == BlockCounters::Kind::Taken)
+            {
+                taken = counter;
+            }
+            else if (counter->kind == BlockCounters::Kind::Fallthrough)
+            {
+                fallthrough = counter;
+            }
+        }
+        ASSERT_NE(taken, nullptr);
+        ASSERT_NE(fallthrough, nullptr);
+        ASSERT_EQ(taken->target.getId(), labelSkip.getId());
+        ASSERT_EQ(taken->node, fallthrough->node);
+
+        // The branch leads to the trampoline, the fallthrough is counted right after it.
+        const auto* branch = taken->node;
+        ASSERT_EQ(getMnemonic(branch), x86::Mnemonic::Jz);
+        ASSERT_NE(branch->get<Instruction>().getOperand<Label>(0).getId(), labelSkip.getId());
+        ASSERT_EQ(getMnemonic(branch->getNext()), x86::Mnemonic::Inc);
+        ASSERT_EQ(
+            branch->getNext()->get<Instruction>().getOperand<Mem>(0).getLabelId(), fallthrough->label.getId());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(serializer.getSectionCount(), 3U);
+        ASSERT_STREQ(serializer.getSectionInfo(1)->name, BlockCounters::kEdgeSectionName);
+        ASSERT_STREQ(serializer.getSectionInfo(2)->name, BlockCounters::kCounterSectionName);
+    }
+
+    TEST(BlockCountersTests, RequiresAMD64)
+    {
+        Program program(MachineMode::I386);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.ret(), Error::None);
+
+        BlockCounters counters(program);
+        ASSERT_EQ(counters.run(), Error::InvalidMode);
+        ASSERT_EQ(counters.getCounterCount(), 0U);
+    }
+
+} // namespace zasm::tests
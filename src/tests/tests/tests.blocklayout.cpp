@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include <zasm/optimization/blocklayout.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static x86::Mnemonic getMnemonic(const Node* node)
+    {
+        return static_cast<x86::Mnemonic>(node->get<Instruction>().getMnemonic());
+    }
+
+    // Returns the next instruction node skipping labels.
+    static const Node* nextInstr(const Node* node)
+    {
+        node = node->getNext();
+        while (node != nullptr && !node->holds<Instruction>())
+        {
+            node = node->getNext();
+        }
+        return node;
+    }
+
+    TEST(BlockLayoutTests, RemovesJumps)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label02), Error::None);
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.add(x86::eax, Imm(2)), Error::None);
+        ASSERT_EQ(a.jmp(label01), Error::None);
+
+        BlockLayout layout(program);
+        ASSERT_EQ(layout.run(), Error::None);
+
+        const auto& stats = layout.getStats();
+        ASSERT_EQ(stats.jumpsRemoved, 2U);
+        ASSERT_EQ(stats.jumpsInserted, 0U);
+        ASSERT_EQ(stats.blocksMoved, 1U);
+        ASSERT_EQ(layout.getBytesSaved(), 4);
+
+        const auto* node = program.getHead();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Mov);
+        node = nextInstr(node);
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Add);
+        node = nextInstr(node);
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Ret);
+        ASSERT_EQ(nextInstr(node), nullptr);
+    }
+
+    TEST(BlockLayoutTests, InvertsBranch)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jz(label02), Error::None);
+        const auto* nodeJz = a.getCursor();
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(2)), Error::None);
+        const auto* nodeHot = a.getCursor();
+        ASSERT_EQ(a.ret(), Error::None);
+
+        BlockLayout layout(program);
+        layout.setEdgeWeights(nodeJz, { 100, 1 });
+        ASSERT_EQ(layout.run(), Error::None);
+
+        ASSERT_EQ(layout.getStats().branchesInverted, 1U);
+        ASSERT_EQ(layout.getStats().jumpsInserted, 0U);
+
+        const auto* node = nextInstr(program.getHead());
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Jnz);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0).getId(), label01.getId());
+        ASSERT_EQ(nextInstr(node), nodeHot);
+    }
+
+    TEST(BlockLayoutTests, InsertsJumpForSeparatedFallthrough)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+        auto label03 = a.createLabel();
+
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        const auto* nodeEntry = a.getCursor();
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.add(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label03), Error::None);
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label03), Error::None);
+        ASSERT_EQ(a.sub(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label01), Error::None);
+        const auto* nodeBackEdge = a.getCursor();
+
+        BlockLayout layout(program);
+        layout.setEdgeWeights(nodeBackEdge, { 100, 0 });
+        ASSERT_EQ(layout.run(), Error::None);
+
+        const auto& stats = layout.getStats();
+        ASSERT_EQ(stats.jumpsRemoved, 1U);
+        ASSERT_EQ(stats.jumpsInserted, 1U);
+
+        // The entry block now jumps to its former fallthrough.
+        const auto* node = nodeEntry->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Jmp);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0).getId(), label01.getId());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+    }
+
+    TEST(BlockLayoutTests, InvertsBranchAndInsertsJump)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+        auto label03 = a.createLabel();
+        auto label04 = a.createLabel();
+        auto label05 = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jz(label02), Error::None);
+        const auto* nodeJz = a.getCursor();
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(2)), Error::None);
+        const auto* nodeFallthrough = a.getCursor();
+        ASSERT_EQ(a.bind(label03), Error::None);
+        ASSERT_EQ(a.add(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label05), Error::None);
+        ASSERT_EQ(a.bind(label04), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label05), Error::None);
+        ASSERT_EQ(a.sub(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label03), Error::None);
+        const auto* nodeBackEdge = a.getCursor();
+
+        BlockLayout layout(program);
+        layout.setEdgeWeights(nodeJz, { 100, 1 });
+        layout.setEdgeWeights(nodeBackEdge, { 100, 0 });
+        ASSERT_EQ(layout.run(), Error::None);
+
+        const auto& stats = layout.getStats();
+        ASSERT_EQ(stats.branchesInverted, 1U);
+        ASSERT_EQ(stats.jumpsInserted, 1U);
+        ASSERT_EQ(stats.jumpsRemoved, 1U);
+
+        const auto* node = nextInstr(program.getHead());
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Jnz);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0).getId(), label01.getId());
+
+        // The jump inserted after the inverted branch is kept.
+        node = nodeFallthrough->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Jmp);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0).getId(), label03.getId());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+    }
+
+    TEST(BlockLayoutTests, KeepsSectionStart)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+
+        ASSERT_EQ(a.jmp(label01), Error::None);
+        ASSERT_EQ(a.section(".data", Section::Attribs::Data), Error::None);
+        const auto* nodeSection = a.getCursor();
+        ASSERT_EQ(a.dq(0), Error::None);
+        ASSERT_EQ(a.section(".text"), Error::None);
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        BlockLayout layout(program);
+        ASSERT_EQ(layout.run(), Error::None);
+
+        // Blocks do not move across sections.
+        ASSERT_EQ(layout.getStats().blocksMoved, 0U);
+        ASSERT_EQ(layout.getStats().jumpsRemoved, 0U);
+        ASSERT_EQ(program.getHead()->getNext(), nodeSection);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,117 @@
+#include <array>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(ConstPoolTests, Deduplicate)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        const std::array<float, 4> values{ 1.0f, 2.0f, 3.0f, 4.0f };
+        const std::array<float, 4> sameValues{ 1.0f, 2.0f, 3.0f, 4.0f };
+        const std::array<float, 4> otherValues{ 4.0f, 3.0f, 2.0f, 1.0f };
+
+        const auto label = a.constPool(values, 16);
+        ASSERT_TRUE(label.isValid());
+        ASSERT_TRUE(program.isLabelConstant(label));
+
+        ASSERT_EQ(a.constPool(sameValues, 16).getId(), label.getId());
+        ASSERT_NE(a.constPool(otherValues, 16).getId(), label.getId());
+        ASSERT_EQ(program.getConstantCount(), 2U);
+
+        // Same bytes with a different size are a different constant.
+        ASSERT_NE(a.constPool(values.data(), sizeof(float) * 2, 16).getId(), label.getId());
+        ASSERT_EQ(program.getConstantCount(), 3U);
+
+        // Pool labels are bound by the serializer.
+        ASSERT_EQ(a.bind(label), Error::LabelAlreadyBound);
+    }
+
+    TEST(ConstPoolTests, InvalidParameters)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        const std::uint64_t value = 1;
+        ASSERT_FALSE(a.constPool(value, 0).isValid());
+        ASSERT_FALSE(a.constPool(value, 3).isValid());
+        ASSERT_FALSE(a.constPool(value, Section::kDefaultAlign * 2).isValid());
+        ASSERT_FALSE(a.constPool(&value, 0, 8).isValid());
+        ASSERT_FALSE(a.constPool(nullptr, 8, 8).isValid());
+        ASSERT_EQ(program.getConstantCount(), 0U);
+    }
+
+    TEST(ConstPoolTests, SortedByAlignment)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        const std::uint32_t value4 = 0x11223344;
+        const std::uint64_t value8 = 0x1122334455667788;
+        const std::array<std::uint8_t, 16> value16{ 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+                                                    0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10 };
+        std::array<std::uint8_t, 32> value32{};
+        value32.fill(0xAB);
+
+        const auto label4 = a.constPool(value4);
+        const auto label8 = a.constPool(value8);
+        const auto label16 = a.constPool(value16, 16);
+        const auto label32 = a.constPool(value32, 32);
+
+        ASSERT_EQ(a.movaps(x86::xmm0, x86::xmmword_ptr(x86::rip, label16)), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, x86::qword_ptr(x86::rip, label8)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+
+        ASSERT_EQ(serializer.getSectionCount(), 2U);
+        const auto* info = serializer.getSectionInfo(1);
+        ASSERT_STREQ(info->name, Program::kConstPoolSectionName);
+        ASSERT_EQ(info->attribs, Section::Attribs::RData);
+        ASSERT_EQ(info->address, 0x2000);
+        ASSERT_EQ(info->physicalSize, 32 + 16 + 8 + 4);
+
+        ASSERT_EQ(serializer.getLabelAddress(label32.getId()), 0x2000);
+        ASSERT_EQ(serializer.getLabelAddress(label16.getId()), 0x2020);
+        ASSERT_EQ(serializer.getLabelAddress(label8.getId()), 0x2030);
+        ASSERT_EQ(serializer.getLabelAddress(label4.getId()), 0x2038);
+
+        const auto* pool = serializer.getCode() + info->offset;
+        ASSERT_EQ(std::memcmp(pool, value32.data(), value32.size()), 0);
+        ASSERT_EQ(std::memcmp(pool + 0x20, value16.data(), value16.size()), 0);
+        ASSERT_EQ(std::memcmp(pool + 0x30, &value8, sizeof(value8)), 0);
+        ASSERT_EQ(std::memcmp(pool + 0x38, &value4, sizeof(value4)), 0);
+
+        // movaps xmm0, xmmword ptr [rip+0x1019]
+        const std::array<std::uint8_t, 7> expected = { 0x0F, 0x28, 0x05, 0x19, 0x10, 0x00, 0x00 };
+        ASSERT_EQ(std::memcmp(serializer.getCode(), expected.data(), expected.size()), 0);
+    }
+
+    TEST(ConstPoolTests, MergeAlignment)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        const std::uint32_t value4 = 0x11223344;
+        const std::uint64_t value8 = 0x1122334455667788;
+
+        const auto labelA = a.constPool(value8, 8);
+        const auto labelB = a.constPool(value4, 4);
+        ASSERT_EQ(a.constPool(value4, 16).getId(), labelB.getId());
+
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+
+        // The 4 byte constant now requires 16 byte alignment and is placed first.
+        ASSERT_EQ(serializer.getLabelAddress(labelB.getId()), 0x2000);
+        ASSERT_EQ(serializer.getLabelAddress(labelA.getId()), 0x2008);
+        ASSERT_EQ(serializer.getSectionInfo(1)->physicalSize, 16);
+    }
+
+} // namespace zasm::tests
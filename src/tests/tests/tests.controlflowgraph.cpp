@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using BlockId = ControlFlowGraph::BlockId;
+
+    // Compares the incrementally updated graph against a freshly built one.
+    static void expectSameGraph(Program& program, const ControlFlowGraph& cfg)
+    {
+        ControlFlowGraph fresh(program);
+        ASSERT_EQ(fresh.update(), Error::None);
+
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto& blockA = cfg.getBlock(cfg.getBlockOf(node));
+            const auto& blockB = fresh.getBlock(fresh.getBlockOf(node));
+            ASSERT_TRUE(blockA.isValid());
+            ASSERT_EQ(blockA.head, blockB.head);
+            ASSERT_EQ(blockA.tail, blockB.tail);
+            ASSERT_EQ(blockA.flags, blockB.flags);
+
+            if (blockA.head != node)
+            {
+                continue;
+            }
+
+            const auto succA = cfg.getSuccessors(cfg.getBlockOf(node));
+            const auto succB = fresh.getSuccessors(fresh.getBlockOf(node));
+            ASSERT_EQ(succA.size(), succB.size());
+            for (std::size_t i = 0; i < succA.size(); ++i)
+            {
+                ASSERT_EQ(cfg.getBlock(succA[i]).head, fresh.getBlock(succB[i]).head);
+            }
+
+            const auto predA = cfg.getPredecessors(cfg.getBlockOf(node));
+            const auto predB = fresh.getPredecessors(fresh.getBlockOf(node));
+            ASSERT_EQ(predA.size(), predB.size());
+        }
+    }
+
+    TEST(ControlFlowGraphTests, SingleBlock)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.add(x86::rax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_TRUE(cfg.isValid());
+
+        const auto entry = cfg.getEntryBlock();
+        ASSERT_NE(entry, BlockId::Invalid);
+
+        const auto& block = cfg.getBlock(entry);
+        ASSERT_EQ(block.head, program.getHead());
+        ASSERT_EQ(block.tail, program.getTail());
+        ASSERT_TRUE(block.hasFlags(ControlFlowGraph::BlockFlags::Exit));
+        ASSERT_TRUE(cfg.getSuccessors(entry).empty());
+        ASSERT_TRUE(cfg.getPredecessors(entry).empty());
+    }
+
+    TEST(ControlFlowGraphTests, ConditionalBranch)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelLoop = a.createLabel();
+        auto labelExit = a.createLabel();
+
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.bind(labelLoop), Error::None);
+        ASSERT_EQ(a.inc(x86::eax), Error::None);
+        ASSERT_EQ(a.cmp(x86::eax, Imm(10)), Error::None);
+        ASSERT_EQ(a.jz(labelExit), Error::None);
+        ASSERT_EQ(a.jmp(labelLoop), Error::None);
+        ASSERT_EQ(a.bind(labelExit), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+
+        const auto blockEntry = cfg.getEntryBlock();
+        const auto blockLoop = cfg.getBlockOf(labelLoop);
+        const auto blockExit = cfg.getBlockOf(labelExit);
+        ASSERT_NE(blockLoop, BlockId::Invalid);
+        ASSERT_NE(blockExit, BlockId::Invalid);
+
+        // Entry falls through into the loop.
+        auto succ = cfg.getSuccessors(blockEntry);
+        ASSERT_EQ(succ.size(), 1);
+        ASSERT_EQ(succ[0], blockLoop);
+
+        // Taken branch first then fallthrough into the jmp block.
+        succ = cfg.getSuccessors(blockLoop);
+        ASSERT_EQ(succ.size(), 2);
+        ASSERT_EQ(succ[0], blockExit);
+
+        const auto blockJmp = succ[1];
+        succ = cfg.getSuccessors(blockJmp);
+        ASSERT_EQ(succ.size(), 1);
+        ASSERT_EQ(succ[0], blockLoop);
+
+        ASSERT_EQ(cfg.getPredecessors(blockLoop).size(), 2);
+        ASSERT_EQ(cfg.getPredecessors(blockExit).size(), 1);
+        ASSERT_TRUE(cfg.getBlock(blockExit).hasFlags(ControlFlowGraph::BlockFlags::Exit));
+    }
+
+    TEST(ControlFlowGraphTests, IndirectBranch)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.jmp(x86::rax), Error::None);
+        ASSERT_EQ(a.nop(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+
+        const auto entry = cfg.getEntryBlock();
+        ASSERT_TRUE(cfg.getBlock(entry).hasFlags(ControlFlowGraph::BlockFlags::IndirectBranch));
+        ASSERT_TRUE(cfg.getSuccessors(entry).empty());
+        ASSERT_NE(cfg.getBlockOf(program.getTail()), entry);
+    }
+
+    TEST(ControlFlowGraphTests, IncrementalSplitAndMerge)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        for (int i = 0; i < 8; i++)
+        {
+            ASSERT_EQ(a.mov(x86::eax, Imm(i)), Error::None);
+        }
+        const auto* middle = a.getCursor();
+        for (int i = 0; i < 8; i++)
+        {
+            ASSERT_EQ(a.mov(x86::ebx, Imm(i)), Error::None);
+        }
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_EQ(cfg.getBlock(cfg.getEntryBlock()).tail, program.getTail());
+
+        // Inserting a label splits the block.
+        auto label = a.createLabel();
+        a.setCursor(middle);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_FALSE(cfg.isValid());
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_TRUE(cfg.isValid());
+
+        const auto blockLabel = cfg.getBlockOf(label);
+        ASSERT_NE(blockLabel, cfg.getEntryBlock());
+        ASSERT_EQ(cfg.getBlock(cfg.getEntryBlock()).tail, middle);
+        ASSERT_EQ(cfg.getSuccessors(cfg.getEntryBlock()).size(), 1);
+        ASSERT_EQ(cfg.getSuccessors(cfg.getEntryBlock())[0], blockLabel);
+        expectSameGraph(program, cfg);
+
+        // Removing it again merges both blocks.
+        const auto* labelNode = middle->getNext();
+        program.destroy(labelNode);
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_EQ(cfg.getBlock(cfg.getEntryBlock()).tail, program.getTail());
+        expectSameGraph(program, cfg);
+    }
+
+    TEST(ControlFlowGraphTests, IncrementalBranchEdits)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelA = a.createLabel();
+        auto labelB = a.createLabel();
+
+        ASSERT_EQ(a.bind(labelA), Error::None);
+        for (int i = 0; i < 16; i++)
+        {
+            ASSERT_EQ(a.add(x86::eax, Imm(i)), Error::None);
+        }
+        ASSERT_EQ(a.bind(labelB), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+
+        // Insert branches in the middle of the first block.
+        const auto* node = program.getHead();
+        for (int i = 0; i < 4; i++)
+        {
+            node = node->getNext();
+        }
+        a.setCursor(node);
+        ASSERT_EQ(a.jz(labelB), Error::None);
+        const auto* nodeJz = a.getCursor();
+        for (int i = 0; i < 4; i++)
+        {
+            node = node->getNext();
+        }
+        a.setCursor(node);
+        ASSERT_EQ(a.jmp(labelA), Error::None);
+        const auto* nodeJmp = a.getCursor();
+
+        ASSERT_EQ(cfg.update(), Error::None);
+        expectSameGraph(program, cfg);
+        ASSERT_EQ(cfg.getPredecessors(cfg.getBlockOf(labelB)).size(), 1);
+        ASSERT_EQ(cfg.getPredecessors(cfg.getBlockOf(labelA)).size(), 1);
+
+        // Move the jmp before the jz, creates an empty fallthrough path.
+        program.moveBefore(nodeJz, nodeJmp);
+        ASSERT_EQ(cfg.update(), Error::None);
+        expectSameGraph(program, cfg);
+
+        // Remove both branches.
+        program.destroy(nodeJz);
+        program.destroy(nodeJmp);
+        ASSERT_EQ(cfg.update(), Error::None);
+        expectSameGraph(program, cfg);
+        ASSERT_EQ(cfg.getBlock(cfg.getEntryBlock()).tail->getNext()->holds<Label>(), true);
+    }
+
+    TEST(ControlFlowGraphTests, IncrementalClear)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.dec(x86::ecx), Error::None);
+        ASSERT_EQ(a.jnz(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        ASSERT_EQ(cfg.update(), Error::None);
+
+        program.clear();
+        a.setCursor(nullptr);
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_EQ(cfg.getEntryBlock(), BlockId::Invalid);
+
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(cfg.update(), Error::None);
+        ASSERT_EQ(cfg.getBlock(cfg.getEntryBlock()).head, program.getHead());
+        expectSameGraph(program, cfg);
+    }
+
+} // namespace zasm::tests
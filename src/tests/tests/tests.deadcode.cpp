@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(DeadCodeTests, UnreachableBlock)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.jmp(label), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(2)), Error::None);
+        ASSERT_EQ(a.add(x86::ecx, x86::ecx), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        const auto& stats = dce.getStats();
+        ASSERT_EQ(stats.blocksRemoved, 1U);
+        ASSERT_EQ(stats.instructionsRemoved, 2U);
+        ASSERT_EQ(stats.deadInstructions, 0U);
+        ASSERT_EQ(stats.sizeBefore, 15);
+        ASSERT_EQ(stats.sizeAfter, 8);
+        ASSERT_EQ(dce.getBytesEliminated(), 7);
+        ASSERT_EQ(program.size(), 4U);
+    }
+
+    TEST(DeadCodeTests, ExportedLabelIsKept)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto exported = a.createLabel();
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(exported), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        dce.addExport(exported);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        ASSERT_EQ(dce.getStats().blocksRemoved, 0U);
+        ASSERT_EQ(program.size(), 4U);
+
+        DeadCodeElimination dce2(program);
+        ASSERT_EQ(dce2.run(), Error::None);
+
+        ASSERT_EQ(dce2.getStats().blocksRemoved, 1U);
+        ASSERT_EQ(program.size(), 1U);
+    }
+
+    TEST(DeadCodeTests, AddressTakenLabelIsKept)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        auto data = a.createLabel();
+        ASSERT_EQ(a.lea(x86::rax, x86::qword_ptr(x86::rip, label)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(data), Error::None);
+        ASSERT_EQ(a.embedLabel(label), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        // Only the unreferenced label in front of the data is removed, the embedded label stays.
+        ASSERT_EQ(dce.getStats().blocksRemoved, 1U);
+        ASSERT_EQ(dce.getStats().instructionsRemoved, 0U);
+        ASSERT_EQ(program.size(), 6U);
+    }
+
+    TEST(DeadCodeTests, OverwrittenRegister)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::ecx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(2)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, x86::ecx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        const auto* second = program.getHead()->getNext();
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        ASSERT_EQ(dce.getStats().deadInstructions, 1U);
+        ASSERT_EQ(program.getHead(), second);
+        ASSERT_EQ(dce.getBytesEliminated(), 5);
+    }
+
+    TEST(DeadCodeTests, OverwrittenFlags)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // The result of add is overwritten by mov and the flags by cmp.
+        ASSERT_EQ(a.add(x86::ecx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(2)), Error::None);
+        ASSERT_EQ(a.cmp(x86::ecx, x86::eax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        ASSERT_EQ(dce.getStats().deadInstructions, 1U);
+        ASSERT_EQ(program.size(), 3U);
+        ASSERT_EQ(program.getHead()->get<Instruction>().getMnemonic(), x86::Mnemonic::Mov);
+    }
+
+    TEST(DeadCodeTests, LiveFlagsAreKept)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.sub(x86::ecx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(2)), Error::None);
+        ASSERT_EQ(a.jnz(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        // The result of sub is dead but jnz reads the flags.
+        ASSERT_EQ(dce.getStats().deadInstructions, 0U);
+        ASSERT_EQ(program.size(), 5U);
+    }
+
+    TEST(DeadCodeTests, CascadingRemoval)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::ecx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::edx, x86::ecx), Error::None);
+        ASSERT_EQ(a.mov(x86::edx, Imm(3)), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(4)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(1), Error::None);
+        ASSERT_EQ(dce.getStats().deadInstructions, 1U);
+
+        ASSERT_EQ(dce.run(), Error::None);
+        ASSERT_EQ(dce.getStats().deadInstructions, 1U);
+        ASSERT_EQ(program.size(), 3U);
+    }
+
+    TEST(DeadCodeTests, SideEffectsAreKept)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::dword_ptr(x86::rdi), x86::ecx), Error::None);
+        ASSERT_EQ(a.rdtsc(), Error::None);
+        ASSERT_EQ(a.push(x86::rcx), Error::None);
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.xor_(x86::edx, x86::edx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        DeadCodeElimination dce(program);
+        ASSERT_EQ(dce.run(), Error::None);
+
+        ASSERT_EQ(dce.getStats().deadInstructions, 0U);
+        ASSERT_EQ(program.size(), 7U);
+    }
+
+} // namespace zasm::tests
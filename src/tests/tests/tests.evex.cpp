@@ -0,0 +1,190 @@
+#include "../testutils.hpp"
+
+#include <Zydis/Decoder.h>
+#include <gtest/gtest.h>
+#include <zasm/formatter/formatter.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    // Decodes the serialized code with Zydis directly to compare the EVEX state with what zasm encoded.
+    static ZydisDecodedInstruction decodeWithZydis(const Serializer& serializer)
+    {
+        ZydisDecoder decoder{};
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+        ZydisDecodedInstruction instr{};
+        std::array<ZydisDecodedOperand, ZYDIS_MAX_OPERAND_COUNT> ops{};
+        const auto status = ZydisDecoderDecodeFull(
+            &decoder, serializer.getCode(), serializer.getCodeSize(), &instr, ops.data());
+        EXPECT_EQ(status, ZYAN_STATUS_SUCCESS);
+        return instr;
+    }
+
+    TEST(EvexTests, MaskZeroing)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.z().vaddps(x86::zmm0, x86::k1, x86::zmm1, x86::zmm2), Error::None);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_TRUE(instr.hasAttrib(x86::Attribs::Zeroing));
+        ASSERT_EQ(formatter::toString(program), "vaddps zmm0{k1}{z}, zmm1, zmm2");
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), "62F174C958C2");
+
+        const auto decoded = decodeWithZydis(serializer);
+        ASSERT_EQ(decoded.avx.mask.reg, ZYDIS_REGISTER_K1);
+        ASSERT_EQ(decoded.avx.mask.mode, ZYDIS_MASK_MODE_ZEROING);
+    }
+
+    TEST(EvexTests, MaskMerging)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.vmovups(x86::zmmword_ptr(x86::rax), x86::k1, x86::zmm0), Error::None);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_FALSE(instr.hasAttrib(x86::Attribs::Zeroing));
+        ASSERT_EQ(formatter::toString(program), "vmovups zmmword ptr ds:[rax]{k1}, zmm0");
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), "62F17C491100");
+
+        const auto decoded = decodeWithZydis(serializer);
+        ASSERT_EQ(decoded.avx.mask.reg, ZYDIS_REGISTER_K1);
+        ASSERT_EQ(decoded.avx.mask.mode, ZYDIS_MASK_MODE_MERGING);
+    }
+
+    TEST(EvexTests, Broadcast)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(
+            a.vaddps(x86::zmm0, x86::k0, x86::zmm1, x86::dword_ptr(x86::rax).setBroadcast(Mem::Broadcast::_1to16)),
+            Error::None);
+        ASSERT_EQ(
+            a.vaddpd(x86::zmm0, x86::k0, x86::zmm1, x86::qword_ptr(x86::rax).setBroadcast(Mem::Broadcast::_1to8)),
+            Error::None);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        const auto& mem = instr.getOperand<Mem>(3);
+        ASSERT_EQ(mem.getBroadcast(), Mem::Broadcast::_1to16);
+        ASSERT_EQ(mem.getBitSize(), BitSize::_32);
+        ASSERT_EQ(formatter::toString(program, program.getHead()), "vaddps zmm0, zmm1, dword ptr ds:[rax]{1to16}");
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), "62F17458580062F1F5585800");
+
+        const auto decoded = decodeWithZydis(serializer);
+        ASSERT_EQ(decoded.avx.broadcast.mode, ZYDIS_BROADCAST_MODE_1_TO_16);
+        ASSERT_FALSE(decoded.avx.broadcast.is_static);
+    }
+
+    TEST(EvexTests, StaticBroadcastIsNotDecorated)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.vbroadcastss(x86::zmm0, x86::k0, x86::dword_ptr(x86::rax)), Error::None);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_FALSE(instr.getOperand<Mem>(2).hasBroadcast());
+    }
+
+    TEST(EvexTests, EmbeddedRounding)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.rn_sae().vaddps(x86::zmm0, x86::k0, x86::zmm1, x86::zmm2), Error::None);
+        ASSERT_EQ(a.rz_sae().vaddps(x86::zmm0, x86::k0, x86::zmm1, x86::zmm2), Error::None);
+
+        const auto* node = program.getHead();
+        ASSERT_TRUE(node->get<Instruction>().hasAttrib(x86::Attribs::RnSae));
+        ASSERT_FALSE(node->get<Instruction>().hasAttrib(x86::Attribs::Sae));
+        ASSERT_TRUE(node->getNext()->get<Instruction>().hasAttrib(x86::Attribs::RzSae));
+        ASSERT_EQ(formatter::toString(program, node), "vaddps zmm0, zmm1, zmm2, {rn-sae}");
+        ASSERT_EQ(formatter::toString(program, node->getNext()), "vaddps zmm0, zmm1, zmm2, {rz-sae}");
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), "62F1741858C262F1747858C2");
+
+        const auto decoded = decodeWithZydis(serializer);
+        ASSERT_EQ(decoded.avx.rounding.mode, ZYDIS_ROUNDING_MODE_RN);
+        ASSERT_TRUE(decoded.avx.has_sae);
+    }
+
+    TEST(EvexTests, SuppressAllExceptions)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.sae().vmaxps(x86::zmm0, x86::k0, x86::zmm1, x86::zmm2), Error::None);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_TRUE(instr.hasAttrib(x86::Attribs::Sae));
+        ASSERT_EQ(formatter::toString(program), "vmaxps zmm0, zmm1, zmm2, {sae}");
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+
+        const auto decoded = decodeWithZydis(serializer);
+        ASSERT_TRUE(decoded.avx.has_sae);
+        ASSERT_EQ(decoded.avx.rounding.mode, ZYDIS_ROUNDING_MODE_INVALID);
+    }
+
+    TEST(EvexTests, RoundingRequiresRegisters)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(
+            a.rn_sae().vaddps(x86::zmm0, x86::k0, x86::zmm1, x86::zmmword_ptr(x86::rax)), Error::ImpossibleInstruction);
+        // The failed instruction does not leave the rounding attribute behind.
+        ASSERT_EQ(a.vaddps(x86::zmm0, x86::k0, x86::zmm1, x86::zmmword_ptr(x86::rax)), Error::None);
+    }
+
+    TEST(EvexTests, DecodeRoundTrip)
+    {
+        // vaddps zmm0{k1}{z}, zmm1, dword ptr [rax]{1to16}
+        // vaddps zmm0, zmm1, zmm2, {ru-sae}
+        const auto input = hexDecode("62F174D9580062F1745858C2");
+
+        Decoder decoder(MachineMode::AMD64);
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        std::size_t offset = 0;
+        while (offset < input.size())
+        {
+            auto decoded = decoder.decode(input.data() + offset, input.size() - offset, 0x1000 + offset);
+            ASSERT_TRUE(decoded);
+            ASSERT_EQ(a.emit(*decoded), Error::None);
+            offset += decoded->getLength();
+        }
+
+        const auto* node = program.getHead();
+        const auto& first = node->get<Instruction>();
+        ASSERT_TRUE(first.hasAttrib(x86::Attribs::Zeroing));
+        ASSERT_EQ(first.getOperand<Mem>(3).getBroadcast(), Mem::Broadcast::_1to16);
+        ASSERT_EQ(formatter::toString(program, node), "vaddps zmm0{k1}{z}, zmm1, dword ptr ds:[rax]{1to16}");
+
+        const auto& second = node->getNext()->get<Instruction>();
+        ASSERT_TRUE(second.hasAttrib(x86::Attribs::RuSae));
+        ASSERT_FALSE(second.hasAttrib(x86::Attribs::Zeroing));
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(hexEncode(serializer.getCode(), serializer.getCodeSize()), "62F174D9580062F1745858C2");
+    }
+
+} // namespace zasm::tests
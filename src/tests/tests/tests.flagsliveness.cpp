@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <zasm/analysis/flagsliveness.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(FlagsLivenessTests, OverwrittenIsDead)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.add(x86::rax, Imm(1)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.cmp(x86::rax, Imm(2)), Error::None);
+        const auto* nodeB = a.getCursor();
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        FlagsLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        ASSERT_FALSE(liveness.isLiveAfter(nodeA));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeB));
+    }
+
+    TEST(FlagsLivenessTests, ConditionalBranch)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::rax, Imm(1)), Error::None);
+        const auto* nodeCmp = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rcx, Imm(1)), Error::None);
+        const auto* nodeMov = a.getCursor();
+        ASSERT_EQ(a.jz(label), Error::None);
+        const auto* nodeJz = a.getCursor();
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.sub(x86::rcx, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        FlagsLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        // mov does not touch the flags, jz reads ZF.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeCmp, FlagsLiveness::kZF));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeCmp, FlagsLiveness::kCF));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeMov, FlagsLiveness::kZF));
+        ASSERT_TRUE(liveness.isLiveBefore(nodeJz, FlagsLiveness::kZF));
+
+        // Both successors overwrite the flags.
+        ASSERT_FALSE(liveness.isLiveAfter(nodeJz));
+    }
+
+    TEST(FlagsLivenessTests, Loop)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+
+        ASSERT_EQ(a.stc(), Error::None);
+        const auto* nodeStc = a.getCursor();
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.adc(x86::rax, x86::rdx), Error::None);
+        ASSERT_EQ(a.lea(x86::rcx, x86::qword_ptr(x86::rcx, -1)), Error::None);
+        const auto* nodeLea = a.getCursor();
+        ASSERT_EQ(a.jrcxz(label), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        FlagsLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        // The carry is read by adc on every iteration.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeStc, FlagsLiveness::kCF));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeLea, FlagsLiveness::kCF));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeStc, FlagsLiveness::kZF));
+    }
+
+    TEST(FlagsLivenessTests, Call)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.cld(), Error::None);
+        const auto* nodeCld = a.getCursor();
+        ASSERT_EQ(a.call(label), Error::None);
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        FlagsLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        ASSERT_TRUE(liveness.isLiveAfter(nodeCld, FlagsLiveness::kDF));
+        ASSERT_EQ(liveness.getLiveAfter(nodeCld), FlagsLiveness::kAllFlags);
+    }
+
+} // namespace zasm::tests
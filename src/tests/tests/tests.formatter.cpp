@@ -159,6 +159,19 @@ namespace zasm::tests
         ASSERT_EQ(nodeStr, std::string("db 0xf3"));
     }
 
+    TEST(FormatterTests, Align)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        assembler.align(16);
+        assembler.align(8, 0xCC);
+
+        auto nodeStr = formatter::toString(program);
+        ASSERT_EQ(nodeStr, std::string(".align 16\n.align 8, 0xcc"));
+    }
+
     TEST(FormatterTests, DataTimes15Db)
     {
         Program program(MachineMode::AMD64);
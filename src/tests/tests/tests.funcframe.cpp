@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static std::size_t countMnemonic(const Program& program, x86::Mnemonic mnemonic)
+    {
+        std::size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr != nullptr && static_cast<x86::Mnemonic>(instr->getMnemonic()) == mnemonic)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static x86::Mnemonic getMnemonic(const Node* node)
+    {
+        return static_cast<x86::Mnemonic>(node->get<Instruction>().getMnemonic());
+    }
+
+    TEST(FuncFrameTests, LeafWithoutSaves)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, x86::ecx), Error::None);
+        // Reading callee-saved registers does not require a save.
+        ASSERT_EQ(a.add(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        ASSERT_TRUE(frame.getSavedRegs().empty());
+        ASSERT_EQ(frame.getStackSize(), 0);
+        ASSERT_FALSE(frame.hasCalls());
+        ASSERT_FALSE(frame.hasFramePointer());
+        ASSERT_EQ(program.size(), 4U);
+    }
+
+    TEST(FuncFrameTests, SavesClobberedRegs)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::rbx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::r12d, x86::ebx), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::r12), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, x86::rcx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        const auto& saved = frame.getSavedRegs();
+        ASSERT_EQ(saved.size(), 2U);
+        ASSERT_EQ(saved[0], x86::rbx);
+        ASSERT_EQ(saved[1], x86::r12);
+
+        // Leaf functions are not padded.
+        ASSERT_EQ(frame.getFrameSize(), 0);
+        ASSERT_EQ(frame.getStackSize(), 16);
+
+        const auto* node = program.getHead()->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Push);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Reg>(0), x86::rbx);
+        ASSERT_EQ(getMnemonic(node->getNext()), x86::Mnemonic::Push);
+
+        const auto* tail = program.getTail();
+        ASSERT_EQ(getMnemonic(tail), x86::Mnemonic::Ret);
+        ASSERT_EQ(getMnemonic(tail->getPrev()), x86::Mnemonic::Pop);
+        ASSERT_EQ(tail->getPrev()->get<Instruction>().getOperand<Reg>(0), x86::rbx);
+        ASSERT_EQ(tail->getPrev()->getPrev()->get<Instruction>().getOperand<Reg>(0), x86::r12);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(FuncFrameTests, AlignsForCalls)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, Imm(0x12345678)), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        ASSERT_TRUE(frame.hasCalls());
+        ASSERT_TRUE(frame.getSavedRegs().empty());
+        ASSERT_EQ(frame.getFrameSize(), 8);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Sub), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Add), 1U);
+    }
+
+    TEST(FuncFrameTests, SaveCompensatesAlignment)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::rbx, x86::rdi), Error::None);
+        ASSERT_EQ(a.call(x86::rsi), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        // The push of rbx already aligns the stack.
+        ASSERT_EQ(frame.getSavedRegs().size(), 1U);
+        ASSERT_EQ(frame.getFrameSize(), 0);
+        ASSERT_EQ(frame.getStackSize(), 8);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Sub), 0U);
+    }
+
+    TEST(FuncFrameTests, Win64SavesXmm)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.movaps(x86::xmm6, x86::xmm0), Error::None);
+        ASSERT_EQ(a.movaps(x86::xmm4, x86::xmm6), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program, CallConv::Win64);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        const auto& saved = frame.getSavedRegs();
+        ASSERT_EQ(saved.size(), 1U);
+        ASSERT_EQ(saved[0], x86::xmm6);
+
+        // Shadow space, one aligned xmm slot and the padding.
+        ASSERT_EQ(frame.getLocalOffset(), 32);
+        ASSERT_EQ(frame.getFrameSize(), 56);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Movdqa), 2U);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(FuncFrameTests, SysVDoesNotSaveXmm)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.movaps(x86::xmm6, x86::xmm0), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program, CallConv::SysV);
+        ASSERT_EQ(frame.run(func), Error::None);
+        ASSERT_TRUE(frame.getSavedRegs().empty());
+        ASSERT_EQ(frame.getStackSize(), 0);
+    }
+
+    TEST(FuncFrameTests, FramePointerForDynamicStack)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.sub(x86::rsp, x86::rcx), Error::None);
+        ASSERT_EQ(a.mov(x86::rbx, x86::rsp), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        ASSERT_TRUE(frame.hasFramePointer());
+        ASSERT_EQ(frame.getSavedRegs().size(), 1U);
+        ASSERT_EQ(frame.getStackSize(), 16);
+
+        // rsp is restored from rbp.
+        const auto* tail = program.getTail();
+        ASSERT_EQ(getMnemonic(tail->getPrev()), x86::Mnemonic::Pop);
+        ASSERT_EQ(tail->getPrev()->get<Instruction>().getOperand<Reg>(0), x86::rbp);
+        ASSERT_EQ(getMnemonic(tail->getPrev()->getPrev()), x86::Mnemonic::Pop);
+        ASSERT_EQ(getMnemonic(tail->getPrev()->getPrev()->getPrev()), x86::Mnemonic::Lea);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(FuncFrameTests, FramePointerConflict)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::rbp, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program, CallConv::SysV, FuncFrame::Options::PreserveFramePointer);
+        ASSERT_EQ(frame.run(func), Error::InvalidOperation);
+    }
+
+    TEST(FuncFrameTests, MovSaves)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.mov(x86::rbx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::r15, Imm(2)), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program, CallConv::SysV, FuncFrame::Options::MovSaves);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        ASSERT_EQ(frame.getSavedRegs().size(), 2U);
+        ASSERT_EQ(frame.getFrameSize(), 24);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Push), 0U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Pop), 0U);
+        // Two saves, two restores and the two instructions of the body.
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Mov), 6U);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(FuncFrameTests, LocalArea)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.movaps(x86::xmmword_ptr(x86::rsp), x86::xmm0), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.setLocalSize(-1), Error::InvalidParameter);
+        ASSERT_EQ(frame.setLocalSize(16, 3), Error::InvalidParameter);
+        ASSERT_EQ(frame.setLocalSize(24, 16), Error::None);
+        ASSERT_EQ(frame.run(func), Error::None);
+
+        ASSERT_EQ(frame.getLocalOffset(), 0);
+        ASSERT_EQ(frame.getFrameSize(), 24);
+    }
+
+    TEST(FuncFrameTests, BranchToEntry)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto func = a.createLabel();
+        ASSERT_EQ(a.bind(func), Error::None);
+        ASSERT_EQ(a.dec(x86::rbx), Error::None);
+        ASSERT_EQ(a.jnz(func), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        FuncFrame frame(program);
+        ASSERT_EQ(frame.run(func), Error::InvalidOperation);
+    }
+
+} // namespace zasm::tests
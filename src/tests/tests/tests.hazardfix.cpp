@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(HazardFixTests, PartialRegisterUpperDead)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::al, x86::byte_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.mov(x86::byte_ptr(x86::rsi), x86::al), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().partialRegisterWrites, 1U);
+        ASSERT_EQ(program.size(), 4U);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_EQ(instr.getMnemonic(), x86::Mnemonic::Movzx);
+        ASSERT_EQ(instr.getOperand<Reg>(0), x86::eax);
+        ASSERT_EQ(instr.getOperand<Mem>(1).getBase(), x86::rdi);
+        ASSERT_EQ(instr.getOperand<Mem>(1).getBitSize(program.getMode()), BitSize::_8);
+    }
+
+    TEST(HazardFixTests, PartialRegisterUpperZero)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.mov(x86::ax, x86::word_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().partialRegisterWrites, 1U);
+
+        const auto& instr = program.getHead()->getNext()->get<Instruction>();
+        ASSERT_EQ(instr.getMnemonic(), x86::Mnemonic::Movzx);
+        ASSERT_EQ(instr.getOperand<Reg>(0), x86::eax);
+    }
+
+    TEST(HazardFixTests, PartialRegisterUpperLive)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // The upper bits of eax are unknown and observed by the caller.
+        ASSERT_EQ(a.mov(x86::al, x86::byte_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().partialRegisterWrites, 0U);
+        ASSERT_EQ(program.getHead()->get<Instruction>().getMnemonic(), x86::Mnemonic::Mov);
+    }
+
+    TEST(HazardFixTests, FalseDependencyPopcnt)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.popcnt(x86::eax, x86::ecx), Error::None);
+        ASSERT_EQ(a.popcnt(x86::edx, x86::edx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        // The second popcnt already depends on its destination through the source.
+        ASSERT_EQ(pass.getStats().falseDependencies, 1U);
+        ASSERT_EQ(program.size(), 4U);
+
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_EQ(instr.getMnemonic(), x86::Mnemonic::Xor);
+        ASSERT_EQ(instr.getOperand<Reg>(0), x86::eax);
+        ASSERT_EQ(instr.getOperand<Reg>(1), x86::eax);
+
+        // Running again does not insert another zero idiom.
+        ASSERT_EQ(pass.run(), Error::None);
+        ASSERT_EQ(pass.getStats().falseDependencies, 0U);
+        ASSERT_EQ(program.size(), 4U);
+    }
+
+    TEST(HazardFixTests, FalseDependencyMemorySource)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // The address depends on the destination.
+        ASSERT_EQ(a.lzcnt(x86::rax, x86::qword_ptr(x86::rax)), Error::None);
+        ASSERT_EQ(a.tzcnt(x86::rcx, x86::qword_ptr(x86::rax)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().falseDependencies, 1U);
+        ASSERT_EQ(program.size(), 4U);
+
+        const auto& instr = program.getHead()->getNext()->get<Instruction>();
+        ASSERT_EQ(instr.getMnemonic(), x86::Mnemonic::Xor);
+        ASSERT_EQ(instr.getOperand<Reg>(0), x86::ecx);
+    }
+
+    TEST(HazardFixTests, FalseDependencyCvtsi2ss)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.cvtsi2ss(x86::xmm0, x86::eax), Error::None);
+        ASSERT_EQ(a.movss(x86::dword_ptr(x86::rdi), x86::xmm0), Error::None);
+        ASSERT_EQ(a.movaps(x86::xmm0, x86::xmm1), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().falseDependencies, 1U);
+        ASSERT_EQ(program.getHead()->get<Instruction>().getMnemonic(), x86::Mnemonic::Xorps);
+    }
+
+    TEST(HazardFixTests, FalseDependencyCvtsi2ssUpperLive)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // The upper elements of xmm0 are read by the caller.
+        ASSERT_EQ(a.cvtsi2ss(x86::xmm0, x86::eax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().falseDependencies, 0U);
+        ASSERT_EQ(program.size(), 2U);
+    }
+
+    TEST(HazardFixTests, LengthChangingPrefixRegister)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.add(x86::ax, Imm(0x1234)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 1U);
+        ASSERT_EQ(program.size(), 5U);
+
+        // rax is used by the instruction, rcx is the first dead scratch register.
+        const auto& mov = program.getHead()->get<Instruction>();
+        ASSERT_EQ(mov.getMnemonic(), x86::Mnemonic::Mov);
+        ASSERT_EQ(mov.getOperand<Reg>(0), x86::ecx);
+        ASSERT_EQ(mov.getOperand<Imm>(1).value<std::int64_t>(), 0x1234);
+
+        const auto& add = program.getHead()->getNext()->get<Instruction>();
+        ASSERT_EQ(add.getMnemonic(), x86::Mnemonic::Add);
+        ASSERT_EQ(add.getOperand<Reg>(0), x86::ax);
+        ASSERT_EQ(add.getOperand<Reg>(1), x86::cx);
+    }
+
+    TEST(HazardFixTests, LengthChangingPrefixMemory)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::word_ptr(x86::rdi), Imm(0x1234)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 1U);
+
+        const auto& store = program.getHead()->getNext()->get<Instruction>();
+        ASSERT_EQ(store.getMnemonic(), x86::Mnemonic::Mov);
+        ASSERT_EQ(store.getOperand<Mem>(0).getBase(), x86::rdi);
+        ASSERT_EQ(store.getOperand<Reg>(1), x86::ax);
+    }
+
+    TEST(HazardFixTests, LengthChangingPrefixImm8)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.add(x86::cx, Imm(-2)), Error::None);
+        ASSERT_EQ(a.mov(x86::ax, Imm(0x1234)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        // The imm8 form has no 16 bit immediate and the register form of mov is not affected.
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 0U);
+        ASSERT_EQ(program.size(), 4U);
+    }
+
+    TEST(HazardFixTests, LengthChangingPrefixNoScratch)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // Every register is live at the exit.
+        ASSERT_EQ(a.add(x86::cx, Imm(0x1234)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(), Error::None);
+
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 0U);
+        ASSERT_EQ(program.size(), 2U);
+    }
+
+    TEST(HazardFixTests, SelectedFixes)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::al, x86::byte_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.popcnt(x86::edx, x86::ecx), Error::None);
+        ASSERT_EQ(a.add(x86::cx, Imm(0x1234)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HazardFix pass(program);
+        ASSERT_EQ(pass.run(HazardFix::Fixes::None), Error::None);
+        ASSERT_EQ(program.size(), 5U);
+
+        ASSERT_EQ(pass.run(HazardFix::Fixes::FalseDependency), Error::None);
+        ASSERT_EQ(pass.getStats().partialRegisterWrites, 0U);
+        ASSERT_EQ(pass.getStats().falseDependencies, 1U);
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 0U);
+        ASSERT_EQ(program.size(), 6U);
+
+        ASSERT_EQ(pass.run(HazardFix::Fixes::PartialRegister | HazardFix::Fixes::LengthChangingPrefix), Error::None);
+        ASSERT_EQ(pass.getStats().partialRegisterWrites, 1U);
+        ASSERT_EQ(pass.getStats().falseDependencies, 0U);
+        ASSERT_EQ(pass.getStats().lengthChangingPrefixes, 1U);
+        ASSERT_EQ(program.size(), 7U);
+    }
+
+} // namespace zasm::tests
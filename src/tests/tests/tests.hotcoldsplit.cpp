@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/optimization/hotcoldsplit.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static x86::Mnemonic getMnemonic(const Node* node)
+    {
+        return static_cast<x86::Mnemonic>(node->get<Instruction>().getMnemonic());
+    }
+
+    TEST(HotColdSplitTests, MoveErrorPath)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelError = a.createLabel();
+        auto labelOk = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        const auto* nodeCmp = a.getCursor();
+        ASSERT_EQ(a.jz(labelOk), Error::None);
+        ASSERT_EQ(a.bind(labelError), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(-1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(labelOk), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HotColdSplit split(program);
+        split.markCold(labelError);
+        ASSERT_EQ(split.run(), Error::None);
+
+        const auto& stats = split.getStats();
+        ASSERT_EQ(stats.blocksMoved, 1U);
+        ASSERT_EQ(stats.branchesInverted, 1U);
+        ASSERT_EQ(stats.jumpsInserted, 0U);
+        ASSERT_EQ(stats.hotSizeBefore, 17);
+        // jnz to the cold section needs rel32.
+        ASSERT_EQ(stats.hotSizeAfter, 15);
+        ASSERT_EQ(stats.coldSize, 6);
+
+        // The branch now leads into the cold section and the hot path falls through.
+        const auto* node = nodeCmp->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Jnz);
+        ASSERT_EQ(node->get<Instruction>().getOperand<Label>(0).getId(), labelError.getId());
+        ASSERT_TRUE(node->getNext()->holds<Label>());
+
+        ASSERT_TRUE(program.getTail()->holds<Instruction>());
+        ASSERT_EQ(getMnemonic(program.getTail()), x86::Mnemonic::Ret);
+    }
+
+    TEST(HotColdSplitTests, ColdFallthrough)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelSlow = a.createLabel();
+        auto labelFast = a.createLabel();
+
+        ASSERT_EQ(a.test(x86::ecx, x86::ecx), Error::None);
+        ASSERT_EQ(a.jz(labelFast), Error::None);
+        ASSERT_EQ(a.bind(labelSlow), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        const auto* nodeCall = a.getCursor();
+        ASSERT_EQ(a.mov(x86::eax, Imm(2)), Error::None);
+        ASSERT_EQ(a.bind(labelFast), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HotColdSplit split(program);
+        split.markCold(nodeCall);
+        ASSERT_EQ(split.run(), Error::None);
+
+        const auto& stats = split.getStats();
+        ASSERT_EQ(stats.blocksMoved, 1U);
+        ASSERT_EQ(stats.branchesInverted, 1U);
+        ASSERT_EQ(stats.jumpsInserted, 1U);
+        ASSERT_LT(stats.hotSizeAfter, stats.hotSizeBefore);
+
+        // The cold block jumps back to the hot code.
+        const auto* tail = program.getTail();
+        ASSERT_EQ(getMnemonic(tail), x86::Mnemonic::Jmp);
+        ASSERT_EQ(tail->get<Instruction>().getOperand<Label>(0).getId(), labelFast.getId());
+    }
+
+    TEST(HotColdSplitTests, NoFallthroughIntoNextSection)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelCold = a.createLabel();
+
+        ASSERT_EQ(a.test(x86::ecx, x86::ecx), Error::None);
+        ASSERT_EQ(a.jz(labelCold), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(labelCold), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(2)), Error::None);
+        ASSERT_EQ(a.section(".data", Section::Attribs::Data), Error::None);
+        const auto* nodeData = a.getCursor();
+        ASSERT_EQ(a.dd(0x11223344), Error::None);
+
+        HotColdSplit split(program);
+        split.markCold(labelCold);
+        ASSERT_EQ(split.run(), Error::None);
+
+        // The end of .text does not fall into .data, no jump or label is added for it.
+        const auto& stats = split.getStats();
+        ASSERT_EQ(stats.blocksMoved, 1U);
+        ASSERT_EQ(stats.jumpsInserted, 0U);
+        ASSERT_TRUE(nodeData->getNext()->holds<Data>());
+        ASSERT_EQ(getMnemonic(program.getTail()), x86::Mnemonic::Mov);
+    }
+
+    TEST(HotColdSplitTests, RunTwiceReusesColdSection)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelError = a.createLabel();
+        auto labelOk = a.createLabel();
+        auto labelWarn = a.createLabel();
+        auto labelDone = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jz(labelOk), Error::None);
+        ASSERT_EQ(a.bind(labelError), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(-1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(labelOk), Error::None);
+        ASSERT_EQ(a.cmp(x86::edx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jz(labelDone), Error::None);
+        ASSERT_EQ(a.bind(labelWarn), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(-2)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(labelDone), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        HotColdSplit split(program);
+        split.markCold(labelError);
+        ASSERT_EQ(split.run(), Error::None);
+        ASSERT_EQ(split.getStats().blocksMoved, 1U);
+
+        // The block moved by the first run stays in place.
+        split.markCold(labelWarn);
+        ASSERT_EQ(split.run(), Error::None);
+        ASSERT_EQ(split.getStats().blocksMoved, 1U);
+        ASSERT_EQ(split.getStats().coldSize, 12);
+
+        std::size_t coldSections = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* section = node->getIf<Section>(); section != nullptr)
+            {
+                if (std::string(program.getSectionName(*section)) == HotColdSplit::kColdSectionName)
+                {
+                    coldSections++;
+                }
+            }
+        }
+        ASSERT_EQ(coldSections, 1U);
+
+        // Both cold blocks are in the same section, the second one follows the first.
+        const auto* labelNode = program.getTail()->getPrev()->getPrev();
+        ASSERT_TRUE(labelNode->holds<Label>());
+        ASSERT_EQ(labelNode->get<Label>().getId(), labelWarn.getId());
+        ASSERT_EQ(getMnemonic(labelNode->getPrev()), x86::Mnemonic::Ret);
+    }
+
+    TEST(HotColdSplitTests, MarkColdFromProfile)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelError = a.createLabel();
+        auto labelOk = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::ecx, Imm(0)), Error::None);
+        ASSERT_EQ(a.jz(labelOk), Error::None);
+        ASSERT_EQ(a.bind(labelError), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(-1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        ASSERT_EQ(a.bind(labelOk), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        const auto* nodeHot = a.getCursor();
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // Only the success path was sampled.
+        Profile profile(program);
+        ASSERT_TRUE(profile.addSample(serializer, serializer.getNodeAddress(nodeHot), 100));
+        profile.updateLabelWeights();
+
+        HotColdSplit split(program);
+        split.markCold(profile);
+        ASSERT_EQ(split.run(), Error::None);
+
+        ASSERT_EQ(split.getStats().blocksMoved, 1U);
+        ASSERT_LT(split.getStats().hotSizeAfter, split.getStats().hotSizeBefore);
+    }
+
+} // namespace zasm::tests
@@ -111,4 +111,153 @@ namespace zasm::tests
         ASSERT_EQ(std::string(labelData->moduleName), std::string("kernel32.dll"));
     }
 
-} // namespace zasm::tests
\ No newline at end of file
+    TEST(ImportLabelTests, ImportSlotsX64)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto labelImpExitProcess = program.getOrCreateImportLabel("kernel32.dll", "ExitProcess");
+        const auto labelImpGetTickCount = program.getOrCreateImportLabel("kernel32.dll", "GetTickCount");
+
+        ASSERT_EQ(assembler.call(labelImpExitProcess), Error::None);
+        ASSERT_EQ(assembler.mov(x86::rax, labelImpExitProcess), Error::None);
+        ASSERT_EQ(assembler.call(labelImpGetTickCount), Error::None);
+        ASSERT_EQ(assembler.call(labelImpExitProcess), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setOptions(Serializer::Options::ImportSlots);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // call [rip+slot0], mov rax, [rip+slot0], call [rip+slot1], call [rip+slot0], ret, slot0, slot1
+        const std::array<uint8_t, 42> expected = {
+            0xFF, 0x15, 0xFA, 0x0F, 0x00, 0x00, 0x48, 0x8B, 0x05, 0xF3, 0x0F, 0x00, 0x00, 0xFF,
+            0x15, 0xF5, 0x0F, 0x00, 0x00, 0xFF, 0x15, 0xE7, 0x0F, 0x00, 0x00, 0xC3, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        ASSERT_EQ(serializer.getSectionCount(), 2);
+        const auto* sect = serializer.getSectionInfo(1);
+        ASSERT_NE(sect, nullptr);
+        ASSERT_EQ(std::string(sect->name), std::string(Serializer::kImportSectionName));
+        ASSERT_EQ(sect->attribs, Section::Attribs::Data);
+
+        // The uses reference the slots, only the slots have to be patched.
+        ASSERT_EQ(serializer.getRelocationCount(), 0);
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 0);
+        ASSERT_EQ(serializer.getImportSlotCount(), 2);
+
+        const auto* slot = serializer.getImportSlot(0);
+        ASSERT_NE(slot, nullptr);
+        ASSERT_EQ(slot->kind, RelocationType::Abs);
+        ASSERT_EQ(slot->address, 0x0000000000402000);
+        ASSERT_EQ(slot->size, BitSize::_64);
+        ASSERT_EQ(slot->offset, 26);
+        ASSERT_EQ(slot->label, labelImpExitProcess.getId());
+
+        slot = serializer.getImportSlot(1);
+        ASSERT_NE(slot, nullptr);
+        ASSERT_EQ(slot->address, 0x0000000000402008);
+        ASSERT_EQ(slot->offset, 34);
+        ASSERT_EQ(slot->label, labelImpGetTickCount.getId());
+
+        ASSERT_EQ(serializer.getImportSlot(2), nullptr);
+    }
+
+    TEST(ImportLabelTests, ImportSlotsKeepMemoryOperands)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        const auto labelImpExitProcess = program.getOrCreateImportLabel("kernel32.dll", "ExitProcess");
+
+        ASSERT_EQ(assembler.mov(x86::rax, x86::qword_ptr(labelImpExitProcess)), Error::None);
+        ASSERT_EQ(assembler.lea(x86::rcx, x86::qword_ptr(labelImpExitProcess)), Error::None);
+
+        Serializer serializer;
+        serializer.setOptions(Serializer::Options::ImportSlots);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // Both reference the import itself and not its address, they are not rewritten.
+        const std::array<uint8_t, 14> expected = {
+            0x48, 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8D, 0x0D, 0x00, 0x00, 0x00, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        ASSERT_EQ(serializer.getSectionCount(), 1);
+        ASSERT_EQ(serializer.getImportSlotCount(), 0);
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 2);
+        ASSERT_EQ(serializer.getExternalRelocation(0)->kind, RelocationType::Rel32);
+        ASSERT_EQ(serializer.getExternalRelocation(0)->offset, 3);
+        ASSERT_EQ(serializer.getExternalRelocation(1)->kind, RelocationType::Rel32);
+        ASSERT_EQ(serializer.getExternalRelocation(1)->offset, 10);
+    }
+
+    TEST(ImportLabelTests, ImportSlotsX86)
+    {
+        Program program(MachineMode::I386);
+
+        x86::Assembler assembler(program);
+
+        const auto labelImpExitProcess = program.getOrCreateImportLabel("kernel32.dll", "ExitProcess");
+
+        ASSERT_EQ(assembler.call(labelImpExitProcess), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setOptions(Serializer::Options::ImportSlots);
+        ASSERT_EQ(serializer.serialize(program, 0x00401000), Error::None);
+
+        // call [slot], ret, slot
+        const std::array<uint8_t, 11> expected = {
+            0xFF, 0x15, 0x00, 0x20, 0x40, 0x00, 0xC3, 0x00, 0x00, 0x00, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        // The absolute address of the slot is relocated with the image.
+        ASSERT_EQ(serializer.getRelocationCount(), 1);
+        const auto* relocInfo = serializer.getRelocation(0);
+        ASSERT_NE(relocInfo, nullptr);
+        ASSERT_EQ(relocInfo->kind, RelocationType::Abs);
+        ASSERT_EQ(relocInfo->offset, 2);
+        ASSERT_EQ(relocInfo->size, BitSize::_32);
+
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 0);
+        ASSERT_EQ(serializer.getImportSlotCount(), 1);
+
+        const auto* slot = serializer.getImportSlot(0);
+        ASSERT_NE(slot, nullptr);
+        ASSERT_EQ(slot->address, 0x00402000);
+        ASSERT_EQ(slot->size, BitSize::_32);
+        ASSERT_EQ(slot->offset, 7);
+
+        ASSERT_EQ(serializer.relocate(0x00801000), Error::None);
+        ASSERT_EQ(serializer.getImportSlot(0)->address, 0x00802000);
+        ASSERT_EQ(serializer.getCode()[4], 0x80);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <zasm/program/nodemap.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(NodeMapTests, SetGetErase)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.nop(), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.nop(), Error::None);
+        const auto* nodeB = a.getCursor();
+
+        NodeMap<int> map(-1);
+        ASSERT_TRUE(map.empty());
+        ASSERT_EQ(map.get(nodeA), -1);
+        ASSERT_EQ(map.find(nodeA), nullptr);
+
+        map.set(nodeA, 10);
+        map[nodeB] += 5;
+
+        ASSERT_EQ(map.size(), 2U);
+        ASSERT_TRUE(map.contains(nodeA));
+        ASSERT_EQ(map.get(nodeA), 10);
+        // Created entries start with the default value.
+        ASSERT_EQ(map.get(nodeB), 4);
+
+        ASSERT_TRUE(map.erase(nodeA));
+        ASSERT_FALSE(map.erase(nodeA));
+        ASSERT_FALSE(map.contains(nodeA));
+        ASSERT_EQ(map.get(nodeA), -1);
+        ASSERT_EQ(map.size(), 1U);
+
+        map.clear();
+        ASSERT_TRUE(map.empty());
+        ASSERT_EQ(map.get(nodeB), -1);
+    }
+
+    TEST(NodeMapTests, ManyNodes)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            ASSERT_EQ(a.nop(), Error::None);
+        }
+
+        NodeMap<std::size_t, 4> map;
+        std::size_t index = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            map.set(node, index++);
+        }
+        ASSERT_EQ(map.size(), program.size());
+
+        index = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            ASSERT_EQ(map.get(node), index++);
+        }
+    }
+
+    TEST(NodeMapTests, AutoCleanup)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.nop(), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.nop(), Error::None);
+        const auto* nodeB = a.getCursor();
+
+        NodeMap<int> map(program);
+        map.set(nodeA, 1);
+        map.set(nodeB, 2);
+
+        program.destroy(nodeA);
+        ASSERT_EQ(map.size(), 1U);
+        ASSERT_EQ(map.get(nodeB), 2);
+
+        program.clear();
+        ASSERT_TRUE(map.empty());
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <zasm/optimization/peephole.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static x86::Mnemonic getMnemonic(const Node* node)
+    {
+        return static_cast<x86::Mnemonic>(node->get<Instruction>().getMnemonic());
+    }
+
+    TEST(PeepholeTests, MovZeroAndIncDec)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        ASSERT_EQ(a.add(x86::rcx, Imm(1)), Error::None);
+        ASSERT_EQ(a.sub(x86::rdx, Imm(1)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        const auto sizeBefore = serializer.getCodeSize();
+
+        Peephole peephole(program);
+        peephole.addDefaultRules();
+        ASSERT_EQ(peephole.run(), Error::None);
+
+        ASSERT_EQ(program.size(), 4U);
+        const auto* node = program.getHead();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Xor);
+        node = node->getNext();
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Inc);
+        node = node->getNext();
+        // The flags are live when leaving the program, sub is kept.
+        ASSERT_EQ(getMnemonic(node), x86::Mnemonic::Sub);
+        ASSERT_EQ(peephole.getRewriteCount(), 2U);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_LT(serializer.getCodeSize(), sizeBefore);
+    }
+
+    TEST(PeepholeTests, MovZeroFlagsLive)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+
+        ASSERT_EQ(a.cmp(x86::rcx, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(0)), Error::None);
+        const auto* nodeMov = a.getCursor();
+        ASSERT_EQ(a.jz(label), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Peephole peephole(program);
+        peephole.addDefaultRules();
+        ASSERT_EQ(peephole.run(), Error::None);
+
+        ASSERT_EQ(getMnemonic(nodeMov), x86::Mnemonic::Mov);
+        ASSERT_EQ(peephole.getRewriteCount(), 0U);
+    }
+
+    TEST(PeepholeTests, MovSwapBack)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.mov(x86::rbx, x86::rax), Error::None);
+        // Not redundant, writing ecx clears the upper half of rcx.
+        ASSERT_EQ(a.mov(x86::edx, x86::ecx), Error::None);
+        ASSERT_EQ(a.mov(x86::ecx, x86::edx), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Peephole peephole(program);
+        peephole.addDefaultRules();
+        ASSERT_EQ(peephole.run(), Error::None);
+
+        ASSERT_EQ(program.size(), 4U);
+        ASSERT_EQ(peephole.getRewriteCount(), 1U);
+    }
+
+    TEST(PeepholeTests, BranchToNext)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+        auto label03 = a.createLabel();
+
+        ASSERT_EQ(a.jmp(label01), Error::None);
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.jz(label03), Error::None);
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.bind(label03), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Peephole peephole(program);
+        peephole.addDefaultRules();
+        ASSERT_EQ(peephole.run(), Error::None);
+
+        ASSERT_EQ(peephole.getRewriteCount(), 1U);
+        ASSERT_TRUE(program.getHead()->holds<Label>());
+    }
+
+    TEST(PeepholeTests, CustomRule)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.nop(), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Peephole peephole(program);
+
+        Peephole::Rule rule{};
+        rule.name = "drop-nop";
+        rule.mnemonics = { x86::Mnemonic::Nop };
+        rule.windowSize = 1;
+        rule.match = [](const Peephole::Context&, const Peephole::Window&) { return true; };
+        rule.rewrite = [](Peephole::Context& ctx, const Peephole::Window& window) {
+            ctx.program.destroy(window.getNode(0));
+            return Error::None;
+        };
+        peephole.addRule(rule);
+
+        ASSERT_EQ(peephole.run(), Error::None);
+        ASSERT_EQ(program.size(), 1U);
+        ASSERT_EQ(peephole.getRuleHits(0), 3U);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <string>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(ProfileTests, ParseSamples)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label01 = a.createLabel();
+        auto label02 = a.createLabel();
+        auto label03 = a.createLabel();
+
+        ASSERT_EQ(a.nop(), Error::None);
+        const auto* nodeNop = a.getCursor();
+        ASSERT_EQ(a.bind(label01), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, Imm(1)), Error::None);
+        const auto* nodeMov = a.getCursor();
+        ASSERT_EQ(a.bind(label02), Error::None);
+        ASSERT_EQ(a.bind(label03), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+        const auto* nodeRet = a.getCursor();
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Profile profile(program);
+        const char* samples = "# address count\n"
+                              "401000 3\n"
+                              "0x401001\n"
+                              "\n"
+                              "  401003\t2\r\n"
+                              "401006 10\n"
+                              "500000 7";
+        ASSERT_EQ(profile.parse(serializer, samples), Error::None);
+
+        ASSERT_EQ(profile.getTotalSamples(), 23U);
+        ASSERT_EQ(profile.getUnmappedSamples(), 7U);
+        ASSERT_EQ(profile.getNodeWeight(nodeNop), 3U);
+        ASSERT_EQ(profile.getNodeWeight(nodeMov), 3U);
+        ASSERT_EQ(profile.getNodeWeight(nodeRet), 10U);
+        ASSERT_EQ(profile.getLabelWeight(label01), 3U);
+        // Consecutive labels share the weight.
+        ASSERT_EQ(profile.getLabelWeight(label02), 10U);
+        ASSERT_EQ(profile.getLabelWeight(label03), 10U);
+
+        profile.clear();
+        ASSERT_EQ(profile.getTotalSamples(), 0U);
+        ASSERT_EQ(profile.getNodeWeight(nodeRet), 0U);
+        ASSERT_EQ(profile.getLabelWeight(label01), 0U);
+    }
+
+    TEST(ProfileTests, InvalidFormat)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Profile profile(program);
+        ASSERT_EQ(profile.parse(serializer, "40100z 1\n"), Error::InvalidFileFormat);
+        ASSERT_EQ(profile.parse(serializer, "401000 1 2\n"), Error::InvalidFileFormat);
+        ASSERT_EQ(profile.parse(serializer, "401000 x\n"), Error::InvalidFileFormat);
+    }
+
+    TEST(ProfileTests, LoadFile)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.ret(), Error::None);
+        const auto* nodeRet = a.getCursor();
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        const auto filePath = ::testing::TempDir() + "zasm_profile_samples.txt";
+        std::FILE* file = std::fopen(filePath.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::fputs("401000 42\n", file);
+        std::fclose(file);
+
+        Profile profile(program);
+        ASSERT_EQ(profile.load(serializer, filePath.c_str()), Error::None);
+        ASSERT_EQ(profile.getNodeWeight(nodeRet), 42U);
+        std::remove(filePath.c_str());
+
+        ASSERT_EQ(profile.load(serializer, filePath.c_str()), Error::FileNotFound);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,310 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <zasm/formatter/formatter.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static std::size_t countMnemonic(const Program& program, x86::Mnemonic mnemonic)
+    {
+        std::size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr != nullptr && static_cast<x86::Mnemonic>(instr->getMnemonic()) == mnemonic)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static bool hasVirtualRegs(const Program& program)
+    {
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr)
+            {
+                continue;
+            }
+            for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+            {
+                const auto& op = instr->getOperand(i);
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr && reg->isVirtual())
+                {
+                    return true;
+                }
+                if (const auto* mem = op.getIf<Mem>(); mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    TEST(RegisterAllocatorTests, VirtualRegs)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto v0 = a.createVirtualGp(BitSize::_32);
+        ASSERT_TRUE(v0.isVirtual());
+        ASSERT_EQ(program.getVirtualRegCount(), 1U);
+        ASSERT_EQ(program.getVirtualRegClass(v0), Reg::VirtualClass::Gp);
+        ASSERT_EQ(program.getVirtualRegSize(v0), BitSize::_32);
+
+        auto v1 = a.createVirtualXmm();
+        ASSERT_EQ(program.getVirtualRegClass(v1), Reg::VirtualClass::Vec);
+        ASSERT_EQ(program.getVirtualRegSize(v1), BitSize::_128);
+
+        ASSERT_FALSE(program.createVirtualReg(Reg::VirtualClass::Gp, BitSize::_128).isValid());
+        ASSERT_FALSE(program.createVirtualReg(Reg::VirtualClass::Vec, BitSize::_64).isValid());
+        ASSERT_FALSE(x86::rax.isVirtual());
+
+        ASSERT_EQ(a.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(a.add(v0, dword_ptr(x86::rax, 4)), Error::None);
+        ASSERT_EQ(a.movd(v1, x86::Gp32(v0.getId())), Error::None);
+
+        // The instructions keep the virtual registers.
+        const auto& instr = program.getHead()->get<Instruction>();
+        ASSERT_EQ(instr.getOperand<Reg>(0), v0);
+        ASSERT_EQ(formatter::toString(program, program.getHead()), "mov v0, 1");
+
+        // Encoding requires the registers to be allocated.
+        Serializer serializer;
+        ASSERT_NE(serializer.serialize(program, 0x1000), Error::None);
+
+        program.clear();
+        ASSERT_EQ(program.getVirtualRegCount(), 0U);
+    }
+
+    TEST(RegisterAllocatorTests, AllocateWithoutSpills)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto v0 = a.createVirtualGp(BitSize::_64);
+        auto v1 = a.createVirtualGp(BitSize::_64);
+        auto v2 = a.createVirtualGp(BitSize::_32);
+
+        ASSERT_EQ(a.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(v1, Imm(2)), Error::None);
+        ASSERT_EQ(a.add(v0, v1), Error::None);
+        ASSERT_EQ(a.mov(v2, dword_ptr(v0, v1, 4, 0)), Error::None);
+        ASSERT_EQ(a.mov(x86::eax, v2), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::None);
+
+        // rax is used by the program so it is never assigned.
+        ASSERT_EQ(allocator.getAssignment(v0), x86::rcx);
+        ASSERT_EQ(allocator.getAssignment(v1), x86::rdx);
+        // v0 and v1 die at the load.
+        ASSERT_EQ(allocator.getAssignment(v2), x86::esi);
+        ASSERT_EQ(allocator.getSpillSlot(v0), -1);
+
+        const auto& stats = allocator.getStats();
+        ASSERT_EQ(stats.virtualRegs, 3U);
+        ASSERT_EQ(stats.spilledRegs, 0U);
+        ASSERT_EQ(stats.savedRegs, 0U);
+        ASSERT_EQ(stats.frameSize, 0);
+
+        ASSERT_EQ(program.size(), 6U);
+        ASSERT_FALSE(hasVirtualRegs(program));
+
+        const auto& load = program.getHead()->getNext()->getNext()->getNext()->get<Instruction>();
+        ASSERT_EQ(load.getOperand<Reg>(0), x86::esi);
+        ASSERT_EQ(load.getOperand<Mem>(1).getBase(), x86::rcx);
+        ASSERT_EQ(load.getOperand<Mem>(1).getIndex(), x86::rdx);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, SpillUnderPressure)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        std::array<x86::Gp, 20> regs{};
+        for (std::size_t i = 0; i < regs.size(); ++i)
+        {
+            regs[i] = a.createVirtualGp(BitSize::_64);
+            ASSERT_EQ(a.mov(regs[i], Imm(i)), Error::None);
+        }
+        for (std::size_t i = 1; i < regs.size(); ++i)
+        {
+            ASSERT_EQ(a.add(regs[0], regs[i]), Error::None);
+        }
+        ASSERT_EQ(a.mov(x86::rax, regs[0]), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::None);
+
+        const auto& stats = allocator.getStats();
+        ASSERT_EQ(stats.virtualRegs, 20U);
+        // 13 registers without rax, 3 of them are reserved as scratch registers once spilling is required.
+        ASSERT_EQ(stats.spilledRegs, 10U);
+        ASSERT_EQ(stats.savedRegs, 5U);
+        ASSERT_GT(stats.memoryOperands, 0U);
+        ASSERT_GT(stats.frameSize, 0);
+        ASSERT_EQ((stats.frameSize + stats.savedRegs * 8) % 16, 8U);
+        ASSERT_GE(allocator.getSpillAreaSize(), 8);
+
+        std::size_t spilled = 0;
+        for (const auto& reg : regs)
+        {
+            const auto slot = allocator.getSpillSlot(reg);
+            if (slot == -1)
+            {
+                ASSERT_TRUE(allocator.getAssignment(reg).isGp64());
+                continue;
+            }
+            ASSERT_FALSE(allocator.getAssignment(reg).isValid());
+            ASSERT_LT(slot, stats.frameSize);
+            spilled++;
+        }
+        ASSERT_EQ(spilled, stats.spilledRegs);
+
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Push), 5U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Pop), 5U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Sub), 1U);
+        ASSERT_FALSE(hasVirtualRegs(program));
+
+        // The epilogue is right before the ret.
+        const auto* tail = program.getTail();
+        ASSERT_EQ(static_cast<x86::Mnemonic>(tail->get<Instruction>().getMnemonic()), x86::Mnemonic::Ret);
+        ASSERT_EQ(static_cast<x86::Mnemonic>(tail->getPrev()->get<Instruction>().getMnemonic()), x86::Mnemonic::Pop);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, CallUsesCalleeSaved)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto v0 = a.createVirtualGp(BitSize::_64);
+        auto v1 = a.createVirtualGp(BitSize::_64);
+
+        ASSERT_EQ(a.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(a.mov(v1, Imm(2)), Error::None);
+        ASSERT_EQ(a.mov(x86::rdi, v1), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, Imm(0x12345678)), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.add(x86::rax, v0), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::None);
+
+        ASSERT_EQ(allocator.getAssignment(v0), x86::rbx);
+        ASSERT_EQ(allocator.getAssignment(v1), x86::rcx);
+
+        // Saving rbx keeps the stack aligned at the call.
+        const auto& stats = allocator.getStats();
+        ASSERT_EQ(stats.savedRegs, 1U);
+        ASSERT_EQ(stats.frameSize, 0);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Push), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Pop), 1U);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, Win64ShadowSpace)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto v0 = a.createVirtualXmm();
+
+        ASSERT_EQ(a.movd(v0, x86::ecx), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, Imm(0x12345678)), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.movd(x86::eax, v0), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        RegisterAllocator allocator(program, CallConv::Win64);
+        ASSERT_EQ(allocator.run(), Error::None);
+
+        // No vector register is preserved by the frame, the value lives in a slot above the shadow space.
+        ASSERT_FALSE(allocator.getAssignment(v0).isValid());
+        ASSERT_EQ(allocator.getSpillSlot(v0), 32);
+
+        const auto& stats = allocator.getStats();
+        ASSERT_EQ(stats.spilledRegs, 1U);
+        ASSERT_EQ(stats.spillStores, 1U);
+        ASSERT_EQ(stats.spillLoads, 1U);
+        ASSERT_EQ(stats.frameSize, 56);
+        ASSERT_FALSE(hasVirtualRegs(program));
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, LiveAcrossBackEdge)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto loop = a.createLabel();
+        auto v0 = a.createVirtualGp(BitSize::_64);
+        auto v1 = a.createVirtualGp(BitSize::_64);
+
+        ASSERT_EQ(a.mov(v0, Imm(10)), Error::None);
+        ASSERT_EQ(a.bind(loop), Error::None);
+        ASSERT_EQ(a.sub(v0, Imm(1)), Error::None);
+        // v1 starts after the last use of v0 but v0 is still needed by the next iteration.
+        ASSERT_EQ(a.mov(v1, Imm(5)), Error::None);
+        ASSERT_EQ(a.mov(qword_ptr(x86::rdi), v1), Error::None);
+        ASSERT_EQ(a.jnz(loop), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::None);
+
+        ASSERT_TRUE(allocator.getAssignment(v0).isValid());
+        ASSERT_TRUE(allocator.getAssignment(v1).isValid());
+        ASSERT_NE(allocator.getAssignment(v0), allocator.getAssignment(v1));
+    }
+
+    TEST(RegisterAllocatorTests, BranchToEntry)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto entry = a.createLabel();
+        auto v0 = a.createVirtualGp(BitSize::_64);
+
+        ASSERT_EQ(a.bind(entry), Error::None);
+        ASSERT_EQ(a.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(a.call(x86::rax), Error::None);
+        ASSERT_EQ(a.test(v0, v0), Error::None);
+        ASSERT_EQ(a.jnz(entry), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        // The prologue would be executed on each iteration.
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::InvalidOperation);
+    }
+
+    TEST(RegisterAllocatorTests, RequiresAMD64)
+    {
+        Program program(MachineMode::I386);
+        x86::Assembler a(program);
+
+        auto v0 = a.createVirtualGp(BitSize::_32);
+        ASSERT_EQ(a.mov(v0, Imm(1)), Error::None);
+        ASSERT_FALSE(a.createVirtualGp(BitSize::_64).isValid());
+
+        RegisterAllocator allocator(program);
+        ASSERT_EQ(allocator.run(), Error::InvalidMode);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <zasm/analysis/registerliveness.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(RegisterLivenessTests, OverwrittenIsDead)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, Imm(1)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rax, Imm(2)), Error::None);
+        const auto* nodeB = a.getCursor();
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        ASSERT_FALSE(liveness.isLiveAfter(nodeA, x86::rax));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeA, x86::eax));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeA, x86::rbx));
+
+        // Everything is live when leaving the program.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeB, x86::rax));
+        ASSERT_EQ(liveness.getLiveAfter(nodeB), RegisterLiveness::getAllRegsMask(MachineMode::AMD64));
+    }
+
+    TEST(RegisterLivenessTests, PartialWrites)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, Imm(1)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.mov(x86::al, Imm(2)), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, Imm(1)), Error::None);
+        const auto* nodeC = a.getCursor();
+        ASSERT_EQ(a.mov(x86::ecx, Imm(2)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        // Writing al keeps the upper bits of rax.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeA, x86::rax));
+        // Writing ecx zero extends into rcx.
+        ASSERT_FALSE(liveness.isLiveAfter(nodeC, x86::rcx));
+    }
+
+    TEST(RegisterLivenessTests, MemoryOperands)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rsi, Imm(0)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rdx, Imm(0)), Error::None);
+        const auto* nodeB = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rax, x86::qword_ptr(x86::rsi, x86::rdx, 8, 0)), Error::None);
+        const auto* nodeC = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rsi, Imm(0)), Error::None);
+        ASSERT_EQ(a.mov(x86::rdx, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        ASSERT_TRUE(liveness.isLiveAfter(nodeA, x86::rsi));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeB, x86::rdx));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeB, x86::rax));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeC, x86::rsi));
+        ASSERT_FALSE(liveness.isLiveAfter(nodeC, x86::rdx));
+    }
+
+    TEST(RegisterLivenessTests, ZeroIdiom)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, Imm(1)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        ASSERT_FALSE(liveness.isLiveAfter(nodeA, x86::rax));
+    }
+
+    TEST(RegisterLivenessTests, HiddenOperands)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rsp, Imm(0x1000)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.push(x86::rbx), Error::None);
+        ASSERT_EQ(a.mov(x86::rsp, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        // push implicitly reads rsp.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeA, x86::rsp));
+    }
+
+    TEST(RegisterLivenessTests, Loop)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+
+        ASSERT_EQ(a.mov(x86::rdx, Imm(1)), Error::None);
+        const auto* nodeA = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rcx, Imm(10)), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.add(x86::rax, x86::rdx), Error::None);
+        ASSERT_EQ(a.dec(x86::rcx), Error::None);
+        ASSERT_EQ(a.jnz(label), Error::None);
+        const auto* nodeJnz = a.getCursor();
+        ASSERT_EQ(a.mov(x86::rdx, Imm(0)), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, Imm(0)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        ControlFlowGraph cfg(program);
+        RegisterLiveness liveness(program, cfg);
+        ASSERT_EQ(liveness.run(), Error::None);
+
+        // rdx is read on every iteration.
+        ASSERT_TRUE(liveness.isLiveAfter(nodeA, x86::rdx));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeJnz, x86::rdx));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeJnz, x86::rcx));
+        ASSERT_TRUE(liveness.isLiveAfter(nodeJnz, x86::rax));
+
+        // The block after the loop overwrites both.
+        const auto blockExit = cfg.getBlockOf(nodeJnz->getNext());
+        const auto liveIn = liveness.getLiveIn(blockExit);
+        ASSERT_EQ(liveIn & RegisterLiveness::getRegMask(MachineMode::AMD64, x86::rdx), 0U);
+        ASSERT_EQ(liveIn & RegisterLiveness::getRegMask(MachineMode::AMD64, x86::rcx), 0U);
+    }
+
+} // namespace zasm::tests
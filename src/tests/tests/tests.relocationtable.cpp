@@ -0,0 +1,151 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <vector>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(RelocationTableTests, BlockLayout)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.mov(x86::rax, label), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x140000000), Error::None);
+        ASSERT_EQ(serializer.getRelocationCount(), 1U);
+
+        RelocationTable table;
+        ASSERT_EQ(table.build(serializer), Error::None);
+        ASSERT_EQ(table.getEntryCount(), 1U);
+        ASSERT_EQ(table.getBase(), 0x140000000);
+
+        // Page 0, block size 12, dir64 at offset 2 and the padding entry.
+        const std::array<std::uint8_t, 12> expected = {
+            0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x02, 0xA0, 0x00, 0x00,
+        };
+        ASSERT_EQ(table.getSize(), expected.size());
+
+        const auto* data = table.getData();
+        ASSERT_NE(data, nullptr);
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+    }
+
+    TEST(RelocationTableTests, ApplyMatchesRelocateX64)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // 10 bytes per mov, the relocations span three pages.
+        constexpr std::size_t kCount = 1000;
+
+        auto label = a.createLabel();
+        for (std::size_t i = 0; i < kCount; ++i)
+        {
+            ASSERT_EQ(a.mov(x86::rax, label), Error::None);
+        }
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.embedLabel(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x140000000), Error::None);
+        ASSERT_EQ(serializer.getRelocationCount(), kCount + 1);
+
+        RelocationTable table;
+        ASSERT_EQ(table.build(serializer), Error::None);
+        ASSERT_EQ(table.getEntryCount(), kCount + 1);
+
+        // At least an order of magnitude smaller than the relocation infos.
+        ASSERT_LT(table.getSize() * 10, serializer.getRelocationCount() * sizeof(RelocationInfo));
+
+        std::vector<std::uint8_t> code(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+        ASSERT_EQ(table.apply(code.data(), code.size(), 0x7FF600000000), Error::None);
+
+        ASSERT_EQ(serializer.relocate(0x7FF600000000), Error::None);
+        ASSERT_EQ(code.size(), serializer.getCodeSize());
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+            ASSERT_EQ(code[i], serializer.getCode()[i]);
+        }
+    }
+
+    TEST(RelocationTableTests, ApplyMatchesRelocateX86)
+    {
+        Program program(MachineMode::I386);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        for (std::size_t i = 0; i < 2000; ++i)
+        {
+            ASSERT_EQ(a.mov(x86::eax, label), Error::None);
+        }
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.embedLabel(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x00400000), Error::None);
+
+        RelocationTable table;
+        ASSERT_EQ(table.build(serializer), Error::None);
+        ASSERT_EQ(table.getEntryCount(), serializer.getRelocationCount());
+
+        std::vector<std::uint8_t> code(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+
+        // The streaming form only needs the bytes and the delta.
+        ASSERT_EQ(
+            RelocationTable::apply(table.getData(), table.getSize(), code.data(), code.size(), 0x00800000 - 0x00400000),
+            Error::None);
+
+        ASSERT_EQ(serializer.relocate(0x00800000), Error::None);
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+            ASSERT_EQ(code[i], serializer.getCode()[i]);
+        }
+
+        // 32 bit values can not be moved above 4 GiB.
+        ASSERT_EQ(table.apply(code.data(), code.size(), 0x100000000), Error::ImpossibleRelocation);
+    }
+
+    TEST(RelocationTableTests, MalformedInput)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.mov(x86::rax, label), Error::None);
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x140000000), Error::None);
+
+        RelocationTable table;
+        ASSERT_EQ(table.build(serializer), Error::None);
+
+        std::vector<std::uint8_t> code(serializer.getCode(), serializer.getCode() + serializer.getCodeSize());
+
+        // Entry past the end of the code.
+        ASSERT_EQ(table.apply(code.data(), 4, 0), Error::OutOfBounds);
+
+        // Truncated block.
+        ASSERT_EQ(RelocationTable::apply(table.getData(), 6, code.data(), code.size(), 0), Error::InvalidParameter);
+
+        // Block size smaller than the header.
+        std::vector<std::uint8_t> data(table.getData(), table.getData() + table.getSize());
+        data[4] = 4;
+        ASSERT_EQ(RelocationTable::apply(data.data(), data.size(), code.data(), code.size(), 0), Error::InvalidParameter);
+
+        // An empty table does nothing.
+        ASSERT_EQ(RelocationTable::apply(nullptr, 0, code.data(), code.size(), 0x1000), Error::None);
+    }
+
+} // namespace zasm::tests
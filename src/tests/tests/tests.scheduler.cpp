@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static std::vector<x86::Mnemonic> getMnemonics(const Program& program)
+    {
+        std::vector<x86::Mnemonic> res;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                res.push_back(static_cast<x86::Mnemonic>(instr->getMnemonic()));
+            }
+        }
+        return res;
+    }
+
+    TEST(SchedulerTests, HoistsLoad)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.add(x86::rcx, Imm(1)), Error::None);
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        const std::vector<x86::Mnemonic> expected = {
+            x86::Mnemonic::Imul,
+            x86::Mnemonic::Mov,
+            x86::Mnemonic::Imul,
+            x86::Mnemonic::Add,
+        };
+        ASSERT_EQ(getMnemonics(program), expected);
+
+        const auto& stats = scheduler.getStats();
+        ASSERT_EQ(stats.regions, 1U);
+        ASSERT_EQ(stats.instructions, 4U);
+        ASSERT_EQ(stats.instructionsMoved, 1U);
+        ASSERT_EQ(stats.cyclesBefore, 9);
+        ASSERT_EQ(stats.cyclesAfter, 6);
+        ASSERT_EQ(program.size(), 4U);
+    }
+
+    TEST(SchedulerTests, DependencyChainUnchanged)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::rax, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.add(x86::rax, x86::rcx), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::qword_ptr(x86::rsi), x86::rax), Error::None);
+
+        const auto* head = program.getHead();
+        const auto* tail = program.getTail();
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        ASSERT_EQ(program.getHead(), head);
+        ASSERT_EQ(program.getTail(), tail);
+        ASSERT_EQ(scheduler.getStats().instructionsMoved, 0U);
+        ASSERT_EQ(scheduler.getStats().cyclesBefore, scheduler.getStats().cyclesAfter);
+    }
+
+    TEST(SchedulerTests, BarriersStayInPlace)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.add(x86::rcx, Imm(1)), Error::None);
+        ASSERT_EQ(a.jnz(label), Error::None);
+        ASSERT_EQ(a.mov(x86::rdx, x86::qword_ptr(x86::rdi)), Error::None);
+
+        const auto* head = program.getHead();
+        const auto* branch = program.getTail()->getPrev();
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        ASSERT_EQ(program.getHead(), head);
+        ASSERT_EQ(program.getTail()->getPrev(), branch);
+
+        const std::vector<x86::Mnemonic> expected = {
+            x86::Mnemonic::Imul, x86::Mnemonic::Mov, x86::Mnemonic::Imul,
+            x86::Mnemonic::Add,  x86::Mnemonic::Jnz, x86::Mnemonic::Mov,
+        };
+        ASSERT_EQ(getMnemonics(program), expected);
+        ASSERT_EQ(scheduler.getStats().regions, 1U);
+    }
+
+    TEST(SchedulerTests, StoresStayAroundSideEffects)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.mov(x86::qword_ptr(x86::rsi), x86::rcx), Error::None);
+        ASSERT_EQ(a.out_(x86::dx, x86::al), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.cli(), Error::None);
+        ASSERT_EQ(a.mov(x86::qword_ptr(x86::rdi), x86::rcx), Error::None);
+        ASSERT_EQ(a.add(x86::rax, Imm(1)), Error::None);
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        // Neither store can cross the port write or enter the interrupt disabled window.
+        const std::vector<x86::Mnemonic> expected = {
+            x86::Mnemonic::Mov, x86::Mnemonic::Out, x86::Mnemonic::Imul, x86::Mnemonic::Imul,
+            x86::Mnemonic::Cli, x86::Mnemonic::Mov, x86::Mnemonic::Add,
+        };
+        ASSERT_EQ(getMnemonics(program), expected);
+    }
+
+    TEST(SchedulerTests, LoadsStayBehindStores)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::qword_ptr(x86::rsi), x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.add(x86::rcx, Imm(1)), Error::None);
+
+        const auto* store = program.getHead()->getNext()->getNext();
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        // The memory may alias, the load can not be hoisted above the store.
+        ASSERT_EQ(program.getHead()->getNext()->getNext(), store);
+        ASSERT_EQ(scheduler.getStats().instructionsMoved, 0U);
+    }
+
+    TEST(SchedulerTests, FlagsReadersKeepTheirWriter)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.cmp(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.mov(x86::rdx, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.setz(x86::cl), Error::None);
+        ASSERT_EQ(a.imul(x86::r8, x86::rdx), Error::None);
+        ASSERT_EQ(a.add(x86::r9, Imm(1)), Error::None);
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        // The dead flags of imul may not end up between cmp and setz, add writes the final flags.
+        const auto mnemonics = getMnemonics(program);
+        ASSERT_EQ(mnemonics.size(), 5U);
+
+        const auto indexOf = [&](x86::Mnemonic mnemonic) {
+            return std::find(mnemonics.begin(), mnemonics.end(), mnemonic) - mnemonics.begin();
+        };
+        ASSERT_LT(indexOf(x86::Mnemonic::Cmp), indexOf(x86::Mnemonic::Setz));
+        ASSERT_LT(indexOf(x86::Mnemonic::Setz), indexOf(x86::Mnemonic::Imul));
+        ASSERT_LT(indexOf(x86::Mnemonic::Imul), indexOf(x86::Mnemonic::Add));
+        ASSERT_LT(indexOf(x86::Mnemonic::Mov), indexOf(x86::Mnemonic::Imul));
+    }
+
+    TEST(SchedulerTests, PartialFlagsWrite)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.xor_(x86::r8d, x86::r8d), Error::None);
+        ASSERT_EQ(a.add(x86::rax, x86::rbx), Error::None);
+        ASSERT_EQ(a.inc(x86::rcx), Error::None);
+        ASSERT_EQ(a.adc(x86::rdx, Imm(0)), Error::None);
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        // inc does not write the carry, adc reads the one of add which the xor may not overwrite.
+        const auto mnemonics = getMnemonics(program);
+        ASSERT_EQ(mnemonics.size(), 4U);
+
+        const auto indexOf = [&](x86::Mnemonic mnemonic) {
+            return std::find(mnemonics.begin(), mnemonics.end(), mnemonic) - mnemonics.begin();
+        };
+        ASSERT_LT(indexOf(x86::Mnemonic::Xor), indexOf(x86::Mnemonic::Add));
+        ASSERT_LT(indexOf(x86::Mnemonic::Add), indexOf(x86::Mnemonic::Adc));
+        ASSERT_LT(indexOf(x86::Mnemonic::Inc), indexOf(x86::Mnemonic::Adc));
+    }
+
+    TEST(SchedulerTests, StackOrderPreserved)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.push(x86::rax), Error::None);
+        ASSERT_EQ(a.push(x86::rcx), Error::None);
+        ASSERT_EQ(a.mov(x86::rdx, x86::qword_ptr(x86::rdi)), Error::None);
+        ASSERT_EQ(a.pop(x86::rcx), Error::None);
+        ASSERT_EQ(a.pop(x86::rax), Error::None);
+
+        std::vector<const Node*> stackOps;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (node->get<Instruction>().getMnemonic() != x86::Mnemonic::Mov)
+            {
+                stackOps.push_back(node);
+            }
+        }
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+
+        // All of them read and write rsp and access the stack.
+        auto it = stackOps.begin();
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (node->get<Instruction>().getMnemonic() != x86::Mnemonic::Mov)
+            {
+                ASSERT_NE(it, stackOps.end());
+                ASSERT_EQ(node, *it);
+                ++it;
+            }
+        }
+        ASSERT_EQ(it, stackOps.end());
+    }
+
+    TEST(SchedulerTests, EmptyProgram)
+    {
+        Program program(MachineMode::AMD64);
+
+        Scheduler scheduler(program);
+        ASSERT_EQ(scheduler.run(), Error::None);
+        ASSERT_EQ(scheduler.getStats().regions, 0U);
+        ASSERT_EQ(scheduler.getStats().instructions, 0U);
+    }
+
+} // namespace zasm::tests
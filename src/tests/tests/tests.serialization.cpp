@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <gtest/gtest.h>
 #include <zasm/zasm.hpp>
@@ -798,4 +800,283 @@ namespace zasm::tests
         }
     }
 
+    TEST(SerializationTests, NodeOffsetAndAddress)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label01 = assembler.createLabel();
+
+        ASSERT_EQ(assembler.nop(), Error::None);
+        const auto* nodeNop = assembler.getCursor();
+        ASSERT_EQ(assembler.bind(label01), Error::None);
+        const auto* nodeLabel = assembler.getCursor();
+        ASSERT_EQ(assembler.mov(x86::eax, Imm(1)), Error::None);
+        const auto* nodeMov = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), Error::None);
+        const auto* nodeRet = assembler.getCursor();
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), 7U);
+
+        ASSERT_EQ(serializer.getNodeOffset(nodeNop), 0);
+        ASSERT_EQ(serializer.getNodeOffset(nodeLabel), 1);
+        ASSERT_EQ(serializer.getNodeOffset(nodeMov), 1);
+        ASSERT_EQ(serializer.getNodeOffset(nodeRet), 6);
+        ASSERT_EQ(serializer.getNodeAddress(nodeRet), 0x0000000000401006);
+
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000400FFF), nullptr);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000401000), nodeNop);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000401001), nodeMov);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000401005), nodeMov);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000401006), nodeRet);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000401007), nullptr);
+        ASSERT_EQ(serializer.findNodeAtOffset(3), nodeMov);
+
+        ASSERT_EQ(serializer.relocate(0x0000000000500000), Error::None);
+        ASSERT_EQ(serializer.getNodeAddress(nodeRet), 0x0000000000500006);
+        ASSERT_EQ(serializer.findNodeAt(0x0000000000500002), nodeMov);
+
+        // Nodes created after serialization are unknown.
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(serializer.getNodeOffset(assembler.getCursor()), -1);
+
+        ASSERT_EQ(serializer.getNodeOffset(nullptr), -1);
+        ASSERT_EQ(serializer.getNodeAddress(nullptr), -1);
+        ASSERT_EQ(serializer.getNodeLength(nullptr), -1);
+    }
+
+    TEST(SerializationTests, ShortestEncodingMov)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(x86::rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(x86::rcx, Imm(0x80000000)), Error::None);
+        ASSERT_EQ(assembler.mov(x86::rdx, Imm(-1)), Error::None);
+
+        Serializer serializer;
+        serializer.setOptions(Serializer::Options::ShortestEncoding);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        const std::array<std::uint8_t, 17> expected = {
+            0xB8, 0x01, 0x00, 0x00, 0x00,             // mov eax, 1
+            0xB9, 0x00, 0x00, 0x00, 0x80,             // mov ecx, 0x80000000
+            0x48, 0xC7, 0xC2, 0xFF, 0xFF, 0xFF, 0xFF, // mov rdx, -1
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+    }
+
+    TEST(SerializationTests, ShortestEncodingZero)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label01 = assembler.createLabel();
+
+        // Flags are overwritten by add, becomes xor eax, eax.
+        ASSERT_EQ(assembler.mov(x86::rax, Imm(0)), Error::None);
+        const auto* nodeA = assembler.getCursor();
+        ASSERT_EQ(assembler.add(x86::rcx, x86::rdx), Error::None);
+        // Flags are read by jz, becomes mov ecx, 0.
+        ASSERT_EQ(assembler.mov(x86::rcx, Imm(0)), Error::None);
+        const auto* nodeB = assembler.getCursor();
+        ASSERT_EQ(assembler.jz(label01), Error::None);
+        ASSERT_EQ(assembler.xor_(x86::rdx, x86::rdx), Error::None);
+        const auto* nodeC = assembler.getCursor();
+        ASSERT_EQ(assembler.bind(label01), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        const auto sizeBefore = serializer.getCodeSize();
+
+        serializer.setOptions(Serializer::Options::ShortestEncoding);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_LT(serializer.getCodeSize(), sizeBefore);
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+
+        const auto offsetA = serializer.getNodeOffset(nodeA);
+        ASSERT_EQ(serializer.getNodeOffset(nodeA->getNext()) - offsetA, 2);
+        ASSERT_EQ(data[offsetA], 0x31);
+
+        const auto offsetB = serializer.getNodeOffset(nodeB);
+        ASSERT_EQ(serializer.getNodeOffset(nodeB->getNext()) - offsetB, 5);
+        ASSERT_EQ(data[offsetB], 0xB9);
+
+        const auto offsetC = serializer.getNodeOffset(nodeC);
+        ASSERT_EQ(serializer.getNodeOffset(nodeC->getNext()) - offsetC, 2);
+    }
+
+    TEST(SerializationTests, AlignMultiByteNop)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.align(32), Error::None);
+        const auto* nodeAlign = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), Error::None);
+        const auto* nodeRet = assembler.getCursor();
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), 33U);
+        ASSERT_EQ(serializer.getNodeOffset(nodeAlign), 1);
+        ASSERT_EQ(serializer.getNodeOffset(nodeRet), 32);
+
+        // 31 bytes of padding, two 15 byte NOPs followed by a single byte NOP.
+        const std::array<std::uint8_t, 15> nop15 = {
+            0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+        };
+        const auto* data = serializer.getCode();
+        ASSERT_TRUE(std::equal(nop15.begin(), nop15.end(), data + 1));
+        ASSERT_TRUE(std::equal(nop15.begin(), nop15.end(), data + 16));
+        ASSERT_EQ(data[31], 0x90);
+        ASSERT_EQ(data[32], 0xC3);
+
+        // Already aligned, no padding.
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000400FFF), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), 2U);
+    }
+
+    TEST(SerializationTests, AlignFill)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        ASSERT_EQ(assembler.align(3), Error::InvalidParameter);
+        ASSERT_EQ(assembler.align(4, 0x100), Error::InvalidParameter);
+
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.align(8, 0xCC), Error::None);
+        ASSERT_EQ(assembler.section(".data", Section::Attribs::Data), Error::None);
+        ASSERT_EQ(assembler.db(0x11), Error::None);
+        // Data sections are padded with zeros.
+        ASSERT_EQ(assembler.align(4), Error::None);
+        ASSERT_EQ(assembler.db(0x22), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        const std::array<std::uint8_t, 8> expectedCode = { 0xC3, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC };
+        const auto* data = serializer.getCode();
+        ASSERT_TRUE(std::equal(expectedCode.begin(), expectedCode.end(), data));
+
+        const auto* sectData = serializer.getSectionInfo(1);
+        ASSERT_NE(sectData, nullptr);
+        const std::array<std::uint8_t, 5> expectedData = { 0x11, 0x00, 0x00, 0x00, 0x22 };
+        ASSERT_TRUE(std::equal(expectedData.begin(), expectedData.end(), data + sectData->offset));
+    }
+
+    TEST(SerializationTests, AlignBranchRelaxation)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label01 = assembler.createLabel();
+
+        ASSERT_EQ(assembler.jmp(label01), Error::None);
+        ASSERT_EQ(assembler.align(16), Error::None);
+        const auto* nodeAlign = assembler.getCursor();
+        for (int i = 0; i < 100; ++i)
+        {
+            ASSERT_EQ(assembler.nop(), Error::None);
+        }
+        ASSERT_EQ(assembler.bind(label01), Error::None);
+        const auto* nodeLabel = assembler.getCursor();
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // The jump shrinks to rel8 and the padding grows to keep the alignment.
+        const auto* data = serializer.getCode();
+        ASSERT_EQ(data[0], 0xEB);
+        ASSERT_EQ(serializer.getNodeOffset(nodeAlign), 2);
+        ASSERT_EQ(serializer.getNodeOffset(nodeAlign->getNext()), 16);
+        ASSERT_EQ(serializer.getNodeOffset(nodeLabel), 116);
+        ASSERT_EQ(data[1], 116 - 2);
+    }
+
+    TEST(SerializationTests, AlignBranchesJmp)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label01 = assembler.createLabel();
+
+        ASSERT_EQ(assembler.bind(label01), Error::None);
+        ASSERT_EQ(assembler.db(0xCC, 30), Error::None);
+        // Ends on the 32 byte boundary.
+        ASSERT_EQ(assembler.jmp(label01), Error::None);
+        const auto* nodeJmp = assembler.getCursor();
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getNodeOffset(nodeJmp), 30);
+
+        serializer.setOptions(Serializer::Options::AlignBranches);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getNodeOffset(nodeJmp), 32);
+        ASSERT_EQ(serializer.getCodeSize(), 34U);
+
+        const auto* data = serializer.getCode();
+        ASSERT_EQ(data[30], 0x66);
+        ASSERT_EQ(data[31], 0x90);
+        ASSERT_EQ(data[32], 0xEB);
+        ASSERT_EQ(data[33], static_cast<std::uint8_t>(-34));
+    }
+
+    TEST(SerializationTests, AlignBranchesFused)
+    {
+        Program program(MachineMode::AMD64);
+
+        x86::Assembler assembler(program);
+
+        auto label01 = assembler.createLabel();
+
+        ASSERT_EQ(assembler.bind(label01), Error::None);
+        ASSERT_EQ(assembler.db(0xCC, 10), Error::None);
+        // Within the window, no padding.
+        ASSERT_EQ(assembler.cmp(x86::eax, x86::ecx), Error::None);
+        const auto* nodeCmpA = assembler.getCursor();
+        ASSERT_EQ(assembler.jz(label01), Error::None);
+        ASSERT_EQ(assembler.db(0xCC, 14), Error::None);
+        // The pair crosses the boundary, the padding goes in front of cmp.
+        ASSERT_EQ(assembler.cmp(x86::eax, x86::ecx), Error::None);
+        const auto* nodeCmpB = assembler.getCursor();
+        ASSERT_EQ(assembler.jnz(label01), Error::None);
+        const auto* nodeJnz = assembler.getCursor();
+
+        Serializer serializer;
+        serializer.setOptions(Serializer::Options::AlignBranches);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        ASSERT_EQ(serializer.getNodeOffset(nodeCmpA), 10);
+        ASSERT_EQ(serializer.getNodeOffset(nodeCmpB), 32);
+        ASSERT_EQ(serializer.getNodeOffset(nodeJnz), 34);
+
+        const std::array<std::uint8_t, 4> nop4 = { 0x0F, 0x1F, 0x40, 0x00 };
+        const auto* data = serializer.getCode();
+        ASSERT_TRUE(std::equal(nop4.begin(), nop4.end(), data + 28));
+    }
+
 } // namespace zasm::tests
@@ -0,0 +1,158 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static std::size_t countMnemonic(const Program& program, x86::Mnemonic mnemonic)
+    {
+        std::size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr != nullptr && static_cast<x86::Mnemonic>(instr->getMnemonic()) == mnemonic)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static std::size_t countEntries(const Program& program, BitSize size)
+    {
+        std::size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* entry = node->getIf<EmbeddedLabel>();
+            if (entry != nullptr && entry->getSize() == size)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    TEST(SwitchTests, SparseCompareTree)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelDefault = a.createLabel();
+        std::array<x86::Assembler::SwitchCase, 5> cases{};
+        const std::array<std::int64_t, 5> values{ 100000, 1, 10000, 100, 1000 };
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            cases[i].value = values[i];
+            cases[i].target = a.createLabel();
+        }
+
+        ASSERT_EQ(a.switchJump(x86::ecx, x86::eax, cases.data(), cases.size(), labelDefault), Error::None);
+        for (const auto& c : cases)
+        {
+            ASSERT_EQ(a.bind(c.target), Error::None);
+            ASSERT_EQ(a.ret(), Error::None);
+        }
+        ASSERT_EQ(a.bind(labelDefault), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        // One split at the median, then 2 and 3 linear compares.
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Cmp), 6U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Jnl), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Jz), 5U);
+        ASSERT_EQ(countEntries(program, BitSize::_32), 0U);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(SwitchTests, DenseJumpTable)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelDefault = a.createLabel();
+        std::array<x86::Assembler::SwitchCase, 6> cases{};
+        const std::array<std::int64_t, 6> values{ 10, 11, 12, 14, 15, 17 };
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            cases[i].value = values[i];
+            cases[i].target = a.createLabel();
+        }
+
+        ASSERT_EQ(a.switchJump(x86::ecx, x86::rdx, cases.data(), cases.size(), labelDefault), Error::None);
+        for (const auto& c : cases)
+        {
+            ASSERT_EQ(a.bind(c.target), Error::None);
+            ASSERT_EQ(a.mov(x86::eax, Imm(c.value)), Error::None);
+            ASSERT_EQ(a.ret(), Error::None);
+        }
+        ASSERT_EQ(a.bind(labelDefault), Error::None);
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        // movsxd rcx, ecx; sub rcx, 10; cmp rcx, 7; ja default; lea; movsxd; add; jmp rcx
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Cmp), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Jnbe), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Movsxd), 2U);
+        ASSERT_EQ(countEntries(program, BitSize::_32), 8U);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+
+        ASSERT_EQ(a.compactJumpTables(), Error::None);
+        ASSERT_EQ(countEntries(program, BitSize::_32), 0U);
+        ASSERT_EQ(countEntries(program, BitSize::_8), 8U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Movsxd), 1U);
+        ASSERT_EQ(countMnemonic(program, x86::Mnemonic::Movsx), 1U);
+
+        // The cursor stays at the end of the program.
+        ASSERT_EQ(a.getCursor(), program.getTail());
+
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+
+        // Each entry holds the distance from the table to the target, 13 and 16 use the default.
+        const EmbeddedLabel* entries[8]{};
+        std::size_t entryCount = 0;
+        Label table{};
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* entry = node->getIf<EmbeddedLabel>(); entry != nullptr)
+            {
+                table = entry->getRelativeLabel();
+                entries[entryCount++] = entry;
+            }
+        }
+        ASSERT_EQ(entryCount, 8U);
+        ASSERT_EQ(entries[3]->getLabel().getId(), labelDefault.getId());
+        ASSERT_EQ(entries[6]->getLabel().getId(), labelDefault.getId());
+
+        const auto tableAddress = serializer.getLabelAddress(table.getId());
+        const auto* code = serializer.getCode();
+        for (std::size_t i = 0; i < entryCount; ++i)
+        {
+            const auto expected = serializer.getLabelAddress(entries[i]->getLabel().getId()) - tableAddress;
+            ASSERT_EQ(static_cast<std::int8_t>(code[tableAddress - 0x1000 + i]), expected);
+        }
+    }
+
+    TEST(SwitchTests, InvalidParameters)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto labelDefault = a.createLabel();
+        std::array<x86::Assembler::SwitchCase, 2> cases{};
+        cases[0] = { 1, a.createLabel() };
+        cases[1] = { 1, a.createLabel() };
+
+        ASSERT_EQ(a.switchJump(x86::ecx, x86::rdx, cases.data(), cases.size(), labelDefault), Error::InvalidParameter);
+        ASSERT_EQ(a.switchJump(x86::ecx, x86::rcx, cases.data(), 1, labelDefault), Error::InvalidParameter);
+        ASSERT_EQ(a.switchJump(x86::cx, x86::rdx, cases.data(), 1, labelDefault), Error::InvalidParameter);
+
+        // Cases must fit the value register.
+        cases[1].value = 0x100000000;
+        ASSERT_EQ(a.switchJump(x86::ecx, x86::rdx, cases.data(), cases.size(), labelDefault), Error::InvalidParameter);
+        ASSERT_EQ(a.switchJump(x86::rcx, x86::rdx, cases.data(), cases.size(), labelDefault), Error::None);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(ThroughputTests, DependencyChain)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.instructions, 1U);
+        ASSERT_EQ(report.uops, 1U);
+        ASSERT_EQ(report.latency, 3);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 3.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Dependency);
+        ASSERT_EQ(report.bottleneckPort, 1);
+    }
+
+    TEST(ThroughputTests, PortPressure)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // Independent address computations only execute on ports 1 and 5.
+        ASSERT_EQ(a.lea(x86::rax, x86::qword_ptr(x86::rcx, 1)), Error::None);
+        ASSERT_EQ(a.lea(x86::rdx, x86::qword_ptr(x86::rcx, 2)), Error::None);
+        ASSERT_EQ(a.lea(x86::rsi, x86::qword_ptr(x86::rcx, 3)), Error::None);
+        ASSERT_EQ(a.lea(x86::rdi, x86::qword_ptr(x86::rcx, 4)), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.latency, 1);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 2.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Port);
+        ASSERT_EQ(report.bottleneckPort, 1);
+        ASSERT_DOUBLE_EQ(report.portPressure[1], 2.0);
+        ASSERT_DOUBLE_EQ(report.portPressure[5], 2.0);
+        ASSERT_DOUBLE_EQ(report.portPressure[0], 0.0);
+    }
+
+    TEST(ThroughputTests, SpreadsOverPorts)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // Uops that can use all four ALU ports are balanced across iterations.
+        ASSERT_EQ(a.movzx(x86::eax, x86::cl), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 0.25);
+        ASSERT_DOUBLE_EQ(report.portPressure[0], 0.25);
+        ASSERT_DOUBLE_EQ(report.portPressure[6], 0.25);
+    }
+
+    TEST(ThroughputTests, IssueBound)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // Zero idioms are handled at rename and only take an issue slot.
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+        ASSERT_EQ(a.xor_(x86::ecx, x86::ecx), Error::None);
+        ASSERT_EQ(a.xor_(x86::edx, x86::edx), Error::None);
+        ASSERT_EQ(a.xor_(x86::ebx, x86::ebx), Error::None);
+        ASSERT_EQ(a.xor_(x86::esi, x86::esi), Error::None);
+        ASSERT_EQ(a.xor_(x86::edi, x86::edi), Error::None);
+        ASSERT_EQ(a.xor_(x86::r8d, x86::r8d), Error::None);
+        ASSERT_EQ(a.xor_(x86::r9d, x86::r9d), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.uops, 8U);
+        ASSERT_EQ(report.latency, 0);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 2.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Issue);
+        ASSERT_EQ(report.bottleneckPort, -1);
+    }
+
+    TEST(ThroughputTests, ChainThroughEliminatedMove)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // The move is eliminated but rcx still carries the result of the first imul into the second.
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::rax), Error::None);
+        ASSERT_EQ(a.imul(x86::rcx, x86::rcx), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, x86::rcx), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.uops, 4U);
+        ASSERT_EQ(report.latency, 6);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 6.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Dependency);
+    }
+
+    TEST(ThroughputTests, LoadLatency)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        // Pointer chasing.
+        ASSERT_EQ(a.mov(x86::rax, x86::qword_ptr(x86::rax)), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.uops, 1U);
+        ASSERT_EQ(report.latency, 5);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 5.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Dependency);
+        ASSERT_DOUBLE_EQ(report.portPressure[2] + report.portPressure[3], 1.0);
+    }
+
+    TEST(ThroughputTests, StoreUops)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.add(x86::qword_ptr(x86::rdi), x86::rax), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        // Load, add, store address and store data.
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.uops, 4U);
+        ASSERT_DOUBLE_EQ(report.portPressure[4], 1.0);
+    }
+
+    TEST(ThroughputTests, UnpipelinedDivider)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.vdivps(x86::ymm0, x86::ymm1, x86::ymm2), Error::None);
+        ASSERT_EQ(a.vdivps(x86::ymm3, x86::ymm1, x86::ymm2), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(program.getHead()), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.latency, 11);
+        ASSERT_DOUBLE_EQ(report.cyclesPerIteration, 10.0);
+        ASSERT_EQ(report.bottleneck, ThroughputAnalyzer::Bottleneck::Port);
+        ASSERT_EQ(report.bottleneckPort, 0);
+    }
+
+    TEST(ThroughputTests, Range)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.imul(x86::rax, x86::rax), Error::None);
+        ASSERT_EQ(a.stc(), Error::None);
+        ASSERT_EQ(a.imul(x86::rcx, x86::rcx), Error::None);
+
+        const auto* second = program.getHead()->getNext();
+
+        ThroughputAnalyzer analyzer(program);
+        ASSERT_EQ(analyzer.run(second, second), Error::None);
+
+        const auto& report = analyzer.getReport();
+        ASSERT_EQ(report.instructions, 1U);
+        ASSERT_EQ(report.unknownInstructions, 1U);
+
+        ASSERT_EQ(analyzer.run(nullptr), Error::InvalidParameter);
+        ASSERT_EQ(analyzer.getReport().instructions, 0U);
+    }
+
+    TEST(ThroughputTests, EntryForms)
+    {
+        Program program(MachineMode::AMD64);
+        ThroughputAnalyzer analyzer(program);
+
+        const auto mov = static_cast<Instruction::Mnemonic>(x86::Mnemonic::Mov);
+        ASSERT_EQ(analyzer.getEntry(mov, MachineModelEntry::Form::Load).uops, 0);
+        ASSERT_EQ(analyzer.getEntry(mov, MachineModelEntry::Form::Reg).uops, 1);
+
+        const auto stc = static_cast<Instruction::Mnemonic>(x86::Mnemonic::Stc);
+        ASSERT_EQ(&analyzer.getEntry(stc, MachineModelEntry::Form::Reg), &MachineModel::skylake().defaultEntry);
+    }
+
+    TEST(ThroughputTests, InstructionLatency)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.imul(x86::rax, x86::rcx), Error::None);
+        ASSERT_EQ(a.imul(x86::rax, x86::qword_ptr(x86::rcx)), Error::None);
+        ASSERT_EQ(a.xor_(x86::eax, x86::eax), Error::None);
+
+        ThroughputAnalyzer analyzer(program);
+
+        const auto* node = program.getHead();
+        ASSERT_EQ(analyzer.getLatency(node->get<Instruction>()), 3);
+        node = node->getNext();
+        ASSERT_EQ(analyzer.getLatency(node->get<Instruction>()), 8);
+        node = node->getNext();
+        ASSERT_EQ(analyzer.getLatency(node->get<Instruction>()), 0);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,218 @@
+#include <array>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static constexpr std::int64_t kBase = 0x140000000;
+    static constexpr std::int64_t kFarTargetA = 0x7FF012345678;
+    static constexpr std::int64_t kFarTargetB = 0x7FF0ABCDEF00;
+
+    template<typename T> static T readValue(const Serializer& serializer, std::int32_t offset)
+    {
+        T value{};
+        std::memcpy(&value, serializer.getCode() + offset, sizeof(T));
+        return value;
+    }
+
+    TEST(VeneerTests, FarImmediateCall)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.call(Imm(kFarTargetA)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        ASSERT_EQ(serializer.getSectionCount(), 2U);
+        const auto* sect = serializer.getSectionInfo(1);
+        ASSERT_NE(sect, nullptr);
+        ASSERT_EQ(std::string(sect->name), std::string(Serializer::kVeneerSectionName));
+        ASSERT_EQ(sect->address, kBase + 0x1000);
+        ASSERT_EQ(sect->offset, 6);
+        ASSERT_EQ(sect->physicalSize, Serializer::kVeneerSize);
+
+        ASSERT_EQ(serializer.getVeneerCount(), 1U);
+        const auto* veneer = serializer.getVeneer(0);
+        ASSERT_NE(veneer, nullptr);
+        ASSERT_EQ(veneer->address, kBase + 0x1000);
+        ASSERT_EQ(veneer->target, kFarTargetA);
+        ASSERT_EQ(serializer.getVeneer(1), nullptr);
+
+        const std::array<std::uint8_t, 22> expected = {
+            0xE8, 0xFB, 0x0F, 0x00, 0x00, 0xC3, 0xFF, 0x25, 0x02, 0x00, 0x00,
+            0x00, 0xCC, 0xCC, 0x78, 0x56, 0x34, 0x12, 0xF0, 0x07, 0x00, 0x00,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        ASSERT_EQ(serializer.getRelocationCount(), 0U);
+
+        // The call and the veneer move together, the slot keeps the absolute target.
+        ASSERT_EQ(serializer.relocate(kBase + 0x10000), Error::None);
+        ASSERT_EQ(serializer.getVeneer(0)->address, kBase + 0x11000);
+        ASSERT_EQ(readValue<std::int64_t>(serializer, 14), kFarTargetA);
+    }
+
+    TEST(VeneerTests, SharedVeneers)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.call(Imm(kFarTargetA)), Error::None);
+        ASSERT_EQ(a.jz(Imm(kFarTargetA)), Error::None);
+        ASSERT_EQ(a.call(Imm(kFarTargetB)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        ASSERT_EQ(serializer.getVeneerCount(), 2U);
+        const auto veneerA = serializer.getVeneer(0)->address;
+        const auto veneerB = serializer.getVeneer(1)->address;
+        ASSERT_EQ(serializer.getVeneer(0)->target, kFarTargetA);
+        ASSERT_EQ(serializer.getVeneer(1)->target, kFarTargetB);
+        ASSERT_EQ(veneerB, veneerA + Serializer::kVeneerSize);
+
+        // call rel32, jz rel32, call rel32.
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), veneerA - (kBase + 5));
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 7), veneerA - (kBase + 11));
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 12), veneerB - (kBase + 16));
+    }
+
+    TEST(VeneerTests, InRangeTargetIsDirect)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        ASSERT_EQ(a.call(Imm(kBase + 0x70000000)), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        ASSERT_EQ(serializer.getVeneerCount(), 0U);
+        ASSERT_EQ(serializer.getSectionCount(), 1U);
+        ASSERT_EQ(serializer.getCodeSize(), 6U);
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), 0x70000000 - 5);
+    }
+
+    TEST(VeneerTests, FarExternalLabel)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto external = program.createExternalLabel("puts");
+        ASSERT_EQ(a.call(external), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setExternalLabelAddress(external, kFarTargetB);
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        ASSERT_EQ(serializer.getVeneerCount(), 1U);
+        ASSERT_EQ(serializer.getVeneer(0)->target, kFarTargetB);
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), serializer.getVeneer(0)->address - (kBase + 5));
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 0U);
+        ASSERT_EQ(serializer.getLabelAddress(external.getId()), kFarTargetB);
+    }
+
+    TEST(VeneerTests, NearExternalLabel)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto external = program.createExternalLabel("helper");
+        ASSERT_EQ(a.call(external), Error::None);
+        ASSERT_EQ(a.mov(x86::rax, external), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setExternalLabelAddress(external, kBase + 0x2000);
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        ASSERT_EQ(serializer.getVeneerCount(), 0U);
+        ASSERT_EQ(serializer.getSectionCount(), 1U);
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), 0x2000 - 5);
+        ASSERT_EQ(readValue<std::int64_t>(serializer, 7), kBase + 0x2000);
+
+        // The address is absolute, only the relative call has to be adjusted when the code moves.
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 0U);
+        ASSERT_EQ(serializer.getRelocationCount(), 1U);
+        const auto* reloc = serializer.getRelocation(0);
+        ASSERT_NE(reloc, nullptr);
+        ASSERT_EQ(reloc->kind, RelocationType::Rel32);
+        ASSERT_EQ(reloc->offset, 1);
+        ASSERT_EQ(reloc->label, Label::Id::Invalid);
+
+        ASSERT_EQ(serializer.relocate(kBase + 0x1000), Error::None);
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), 0x1000 - 5);
+        ASSERT_EQ(readValue<std::int64_t>(serializer, 7), kBase + 0x2000);
+
+        // The address can not be reached from the new base.
+        ASSERT_EQ(serializer.relocate(kFarTargetA), Error::ImpossibleRelocation);
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 1), 0x1000 - 5);
+    }
+
+    TEST(VeneerTests, FarExternalMemoryOperand)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto externalFar = program.createExternalLabel("table");
+        auto externalNear = program.createExternalLabel("counter");
+        ASSERT_EQ(a.lea(x86::rax, x86::qword_ptr(externalFar)), Error::None);
+        ASSERT_EQ(a.mov(x86::rcx, x86::qword_ptr(externalFar)), Error::None);
+        ASSERT_EQ(a.lea(x86::rdx, x86::qword_ptr(externalNear)), Error::None);
+        ASSERT_EQ(a.call(externalFar), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setExternalLabelAddress(externalFar, kFarTargetA);
+        serializer.setExternalLabelAddress(externalNear, kBase + 0x2000);
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        // Only the branch can use a veneer, the far memory operands keep their relocation.
+        ASSERT_EQ(serializer.getVeneerCount(), 1U);
+        ASSERT_EQ(serializer.getExternalRelocationCount(), 2U);
+        for (std::size_t i = 0; i < serializer.getExternalRelocationCount(); ++i)
+        {
+            const auto* reloc = serializer.getExternalRelocation(i);
+            ASSERT_NE(reloc, nullptr);
+            ASSERT_EQ(reloc->kind, RelocationType::Rel32);
+            ASSERT_EQ(reloc->size, BitSize::_32);
+            ASSERT_EQ(reloc->offset, 3 + static_cast<std::int32_t>(i) * 7);
+            ASSERT_EQ(reloc->label, externalFar.getId());
+            ASSERT_EQ(readValue<std::int32_t>(serializer, reloc->offset), 0);
+        }
+
+        // The near address is reachable and encoded directly, it is adjusted on relocation.
+        ASSERT_EQ(readValue<std::int32_t>(serializer, 17), 0x2000 - 21);
+        ASSERT_EQ(serializer.getRelocationCount(), 1U);
+        ASSERT_EQ(serializer.getRelocation(0)->kind, RelocationType::Rel32);
+        ASSERT_EQ(serializer.getRelocation(0)->offset, 17);
+    }
+
+    TEST(VeneerTests, NonExternalLabelAddress)
+    {
+        Program program(MachineMode::AMD64);
+        x86::Assembler a(program);
+
+        auto label = a.createLabel();
+        ASSERT_EQ(a.bind(label), Error::None);
+        ASSERT_EQ(a.ret(), Error::None);
+
+        Serializer serializer;
+        serializer.setExternalLabelAddress(label, kFarTargetA);
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::InvalidLabel);
+    }
+
+} // namespace zasm::tests
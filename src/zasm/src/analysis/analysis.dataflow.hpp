@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+
+namespace zasm::detail
+{
+    // Per block sets of a bitmask based dataflow problem.
+    template<typename TMask> struct BlockSets
+    {
+        // Bits used before being defined within the block.
+        TMask gen{};
+        // Bits defined within the block.
+        TMask kill{};
+        TMask in{};
+        TMask out{};
+    };
+
+    // Solves a backward problem such as liveness, in = gen | (out & ~kill) and out is the union
+    // of the successors in. Blocks that leave the program or have unknown successors get exitMask
+    // as additional out set. The sets are indexed by the block id.
+    template<typename TMask>
+    void solveBackward(const ControlFlowGraph& cfg, std::vector<BlockSets<TMask>>& sets, const TMask exitMask)
+    {
+        using BlockId = ControlFlowGraph::BlockId;
+        using BlockFlags = ControlFlowGraph::BlockFlags;
+
+        const auto blockCount = cfg.getBlockCount();
+
+        std::vector<BlockId> worklist;
+        std::vector<bool> queued(blockCount);
+        worklist.reserve(blockCount);
+
+        // Blocks are popped from the back, seed them so the last blocks in the program are processed first.
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            const auto id = static_cast<BlockId>(i);
+            if (cfg.getBlock(id).isValid())
+            {
+                worklist.push_back(id);
+                queued[i] = true;
+            }
+        }
+
+        while (!worklist.empty())
+        {
+            const auto id = worklist.back();
+            worklist.pop_back();
+
+            const auto idx = static_cast<std::size_t>(id);
+            queued[idx] = false;
+
+            const auto& block = cfg.getBlock(id);
+            const auto successors = cfg.getSuccessors(id);
+
+            TMask out{};
+            if (successors.empty() || block.hasFlags(BlockFlags::Exit | BlockFlags::IndirectBranch))
+            {
+                out = exitMask;
+            }
+            for (const auto succ : successors)
+            {
+                out |= sets[static_cast<std::size_t>(succ)].in;
+            }
+
+            auto& entry = sets[idx];
+            entry.out = out;
+
+            const TMask in = entry.gen | (out & ~entry.kill);
+            if (in == entry.in)
+            {
+                continue;
+            }
+            entry.in = in;
+
+            for (const auto pred : cfg.getPredecessors(id))
+            {
+                const auto predIdx = static_cast<std::size_t>(pred);
+                if (!queued[predIdx])
+                {
+                    queued[predIdx] = true;
+                    worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+} // namespace zasm::detail
@@ -0,0 +1,589 @@
+#include "zasm/analysis/controlflowgraph.hpp"
+
+#include "../program/program.state.hpp"
+#include "../x86/x86.controlflow.hpp"
+
+#include <algorithm>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    enum BlockMark : std::uint8_t
+    {
+        // Block requires a re-scan of its nodes.
+        kMarkDirty = (1U << 0),
+        // Block is queued to update its successors.
+        kMarkQueued = (1U << 1),
+        // Block was modified, predecessors are queued to update their successors.
+        kMarkChanged = (1U << 2),
+    };
+
+    static constexpr std::size_t toIndex(ControlFlowGraph::BlockId id) noexcept
+    {
+        return static_cast<std::size_t>(id);
+    }
+
+    // Returns true if the node must start a new block.
+    static bool isLeader(const Node* node) noexcept
+    {
+        const auto* prev = node->getPrev();
+        if (prev == nullptr)
+        {
+            return true;
+        }
+        if (node->holds<Label>() || node->holds<Section>())
+        {
+            return true;
+        }
+        if (const auto* instr = prev->getIf<Instruction>(); instr != nullptr)
+        {
+            return x86::isBlockTerminator(instr->getMnemonic());
+        }
+        return false;
+    }
+
+    ControlFlowGraph::ControlFlowGraph(Program& program)
+        : _program(program)
+    {
+        _program.addObserver(*this);
+    }
+
+    ControlFlowGraph::~ControlFlowGraph()
+    {
+        _program.removeObserver(*this);
+    }
+
+    Error ControlFlowGraph::update()
+    {
+        if (!_built)
+        {
+            build();
+            return Error::None;
+        }
+
+        if (_dirtyBlocks.empty() && _updateBlocks.empty())
+        {
+            return Error::None;
+        }
+
+        // Branches to labels that were not part of the program could be resolved now.
+        for (const auto id : _unresolvedBlocks)
+        {
+            queueUpdate(id);
+        }
+        _unresolvedBlocks.clear();
+
+        // Re-scanning can split blocks and mark additional blocks as dirty.
+        for (std::size_t i = 0; i < _dirtyBlocks.size(); ++i)
+        {
+            const auto id = _dirtyBlocks[i];
+            queueUpdate(id);
+
+            if (_blocks[toIndex(id)].isValid() && (_blockMarks[toIndex(id)] & kMarkDirty) != 0)
+            {
+                rescanBlock(id);
+            }
+        }
+        _dirtyBlocks.clear();
+
+        for (const auto id : _updateBlocks)
+        {
+            _blockMarks[toIndex(id)] = 0;
+            if (_blocks[toIndex(id)].isValid())
+            {
+                updateSuccessors(id);
+            }
+        }
+        _updateBlocks.clear();
+
+        buildPredecessors();
+
+        return Error::None;
+    }
+
+    void ControlFlowGraph::invalidate() noexcept
+    {
+        _built = false;
+    }
+
+    bool ControlFlowGraph::isValid() const noexcept
+    {
+        return _built && _dirtyBlocks.empty() && _updateBlocks.empty();
+    }
+
+    std::size_t ControlFlowGraph::getBlockCount() const noexcept
+    {
+        return _blocks.size();
+    }
+
+    const ControlFlowGraph::Block& ControlFlowGraph::getBlock(BlockId id) const noexcept
+    {
+        static const Block kInvalidBlock{};
+
+        const auto idx = toIndex(id);
+        if (idx >= _blocks.size())
+        {
+            return kInvalidBlock;
+        }
+        return _blocks[idx];
+    }
+
+    ControlFlowGraph::BlockId ControlFlowGraph::getEntryBlock() const noexcept
+    {
+        const auto entryPoint = _program.getEntryPoint();
+        if (entryPoint.isValid())
+        {
+            return getBlockOf(entryPoint);
+        }
+        return getBlockOf(_program.getHead());
+    }
+
+    ControlFlowGraph::BlockId ControlFlowGraph::getBlockOf(const Node* node) const noexcept
+    {
+        if (node == nullptr)
+        {
+            return BlockId::Invalid;
+        }
+
+        return _nodeBlocks.get(node);
+    }
+
+    ControlFlowGraph::BlockId ControlFlowGraph::getBlockOf(const Label& label) const noexcept
+    {
+        const auto& labels = _program.getState().labels;
+
+        const auto idx = static_cast<std::size_t>(label.getId());
+        if (!label.isValid() || idx >= labels.size())
+        {
+            return BlockId::Invalid;
+        }
+        return getBlockOf(labels[idx].node);
+    }
+
+    ControlFlowGraph::BlockList ControlFlowGraph::getSuccessors(BlockId id) const noexcept
+    {
+        const auto idx = toIndex(id);
+        if (idx >= _successorCount.size())
+        {
+            return {};
+        }
+
+        const auto* first = _successors.data() + (idx * kMaxSuccessors);
+        return { first, first + _successorCount[idx] };
+    }
+
+    ControlFlowGraph::BlockList ControlFlowGraph::getPredecessors(BlockId id) const noexcept
+    {
+        const auto idx = toIndex(id);
+        if (idx + 1 >= _predecessorOffsets.size())
+        {
+            return {};
+        }
+
+        const auto* data = _predecessors.data();
+        return { data + _predecessorOffsets[idx], data + _predecessorOffsets[idx + 1] };
+    }
+
+    void ControlFlowGraph::onNodeDestroy(const Node* node)
+    {
+        removeNode(node);
+    }
+
+    void ControlFlowGraph::onNodeDetach(const Node* node)
+    {
+        removeNode(node);
+    }
+
+    void ControlFlowGraph::onNodeInserted(const Node* node)
+    {
+        if (!_built)
+        {
+            return;
+        }
+
+        const auto* prev = node->getPrev();
+        const auto* next = node->getNext();
+
+        if (const auto prevBlock = getBlockOf(prev); prevBlock != BlockId::Invalid)
+        {
+            auto& block = _blocks[toIndex(prevBlock)];
+            if (block.tail == prev)
+            {
+                block.tail = node;
+            }
+            setNodeBlock(node, prevBlock);
+            markDirty(prevBlock);
+        }
+        else if (const auto nextBlock = getBlockOf(next); nextBlock != BlockId::Invalid)
+        {
+            auto& block = _blocks[toIndex(nextBlock)];
+            block.head = node;
+            setNodeBlock(node, nextBlock);
+            markDirty(nextBlock);
+        }
+        else if (prev == nullptr && next == nullptr)
+        {
+            const auto newBlock = allocateBlock();
+            auto& block = _blocks[toIndex(newBlock)];
+            block.head = node;
+            block.tail = node;
+            setNodeBlock(node, newBlock);
+            markDirty(newBlock);
+        }
+        else
+        {
+            // Neighbours are not tracked, this can only happen if the graph is out of sync.
+            _built = false;
+            return;
+        }
+
+        // The next node may no longer start a block or now has to.
+        if (next != nullptr)
+        {
+            markDirty(getBlockOf(next));
+        }
+    }
+
+    void ControlFlowGraph::build()
+    {
+        _blocks.clear();
+        _freeBlocks.clear();
+        _dirtyBlocks.clear();
+        _updateBlocks.clear();
+        _unresolvedBlocks.clear();
+        _blockMarks.clear();
+        _successors.clear();
+        _successorCount.clear();
+        _predecessorOffsets.clear();
+        _predecessors.clear();
+        _nodeBlocks.clear();
+
+        auto curBlock = BlockId::Invalid;
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (curBlock == BlockId::Invalid || isLeader(node))
+            {
+                if (curBlock != BlockId::Invalid)
+                {
+                    _blocks[toIndex(curBlock)].tail = node->getPrev();
+                }
+                curBlock = allocateBlock();
+                _blocks[toIndex(curBlock)].head = node;
+            }
+            setNodeBlock(node, curBlock);
+        }
+
+        if (curBlock != BlockId::Invalid)
+        {
+            _blocks[toIndex(curBlock)].tail = _program.getTail();
+        }
+
+        for (std::size_t i = 0; i < _blocks.size(); ++i)
+        {
+            updateSuccessors(static_cast<BlockId>(i));
+        }
+
+        // allocateBlock queues every new block, nothing left to do for those.
+        for (const auto id : _updateBlocks)
+        {
+            _blockMarks[toIndex(id)] = 0;
+        }
+        _updateBlocks.clear();
+
+        buildPredecessors();
+
+        _built = true;
+    }
+
+    void ControlFlowGraph::rescanBlock(BlockId id)
+    {
+        // If the head is no longer a leader the block merges with the previous one.
+        const auto* start = _blocks[toIndex(id)].head;
+        while (!isLeader(start))
+        {
+            id = getBlockOf(start->getPrev());
+            start = _blocks[toIndex(id)].head;
+        }
+
+        auto curBlock = id;
+        _blockMarks[toIndex(curBlock)] &= ~kMarkDirty;
+        queueUpdate(curBlock);
+
+        const auto* node = start;
+        while (node != nullptr)
+        {
+            const auto oldBlock = getBlockOf(node);
+            if (oldBlock != curBlock && oldBlock != BlockId::Invalid)
+            {
+                auto& block = _blocks[toIndex(oldBlock)];
+                if (block.head == node)
+                {
+                    // Node no longer starts a block, absorb it.
+                    _blockMarks[toIndex(oldBlock)] &= ~kMarkDirty;
+                    queueUpdate(oldBlock);
+                    releaseBlock(oldBlock);
+                }
+                else if (block.isValid() && getBlockOf(node->getPrev()) == oldBlock)
+                {
+                    // Split, the remaining nodes of the old block belong now to the current.
+                    block.tail = node->getPrev();
+                    queueUpdate(oldBlock);
+                }
+            }
+
+            setNodeBlock(node, curBlock);
+
+            const auto* next = node->getNext();
+            if (next != nullptr && !isLeader(next))
+            {
+                node = next;
+                continue;
+            }
+
+            _blocks[toIndex(curBlock)].tail = node;
+            if (next == nullptr)
+            {
+                break;
+            }
+
+            const auto nextBlock = getBlockOf(next);
+            if (nextBlock != BlockId::Invalid && _blocks[toIndex(nextBlock)].head == next)
+            {
+                // Reached a block that was not modified, everything after it is unaffected.
+                if ((_blockMarks[toIndex(nextBlock)] & kMarkDirty) == 0)
+                {
+                    break;
+                }
+
+                curBlock = nextBlock;
+                _blockMarks[toIndex(curBlock)] &= ~kMarkDirty;
+                queueUpdate(curBlock);
+            }
+            else
+            {
+                curBlock = allocateBlock();
+                _blocks[toIndex(curBlock)].head = next;
+            }
+
+            node = next;
+        }
+    }
+
+    void ControlFlowGraph::updateSuccessors(BlockId id)
+    {
+        const auto idx = toIndex(id);
+
+        auto& block = _blocks[idx];
+        auto* successors = _successors.data() + (idx * kMaxSuccessors);
+        auto& count = _successorCount[idx];
+
+        block.flags = BlockFlags::None;
+        count = 0;
+
+        bool hasFallthrough = true;
+        if (const auto* instr = block.tail->getIf<Instruction>(); instr != nullptr)
+        {
+            const auto mnemonic = instr->getMnemonic();
+            if (x86::isReturn(mnemonic))
+            {
+                block.flags = block.flags | BlockFlags::Exit;
+                hasFallthrough = false;
+            }
+            else if (x86::isBranch(mnemonic))
+            {
+                hasFallthrough = x86::isConditionalBranch(mnemonic);
+
+                auto target = BlockId::Invalid;
+                if (const auto* label = instr->getOperandIf<Label>(0); label != nullptr)
+                {
+                    target = getBlockOf(*label);
+                    if (target == BlockId::Invalid && !_program.isLabelExternal(*label))
+                    {
+                        _unresolvedBlocks.push_back(id);
+                    }
+                }
+
+                if (target != BlockId::Invalid)
+                {
+                    successors[count++] = target;
+                }
+                else
+                {
+                    block.flags = block.flags | BlockFlags::IndirectBranch;
+                }
+            }
+        }
+
+        if (hasFallthrough)
+        {
+            const auto fallthrough = getBlockOf(block.tail->getNext());
+            if (fallthrough != BlockId::Invalid && (count == 0 || successors[0] != fallthrough))
+            {
+                successors[count++] = fallthrough;
+            }
+        }
+    }
+
+    void ControlFlowGraph::buildPredecessors()
+    {
+        const auto blockCount = _blocks.size();
+
+        _predecessorOffsets.assign(blockCount + 1, 0);
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            for (const auto succ : getSuccessors(static_cast<BlockId>(i)))
+            {
+                _predecessorOffsets[toIndex(succ) + 1]++;
+            }
+        }
+
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            _predecessorOffsets[i + 1] += _predecessorOffsets[i];
+        }
+
+        _predecessors.resize(_predecessorOffsets[blockCount]);
+
+        // Fill using the start offsets as cursors, shifts them by one entry afterwards.
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            for (const auto succ : getSuccessors(static_cast<BlockId>(i)))
+            {
+                _predecessors[_predecessorOffsets[toIndex(succ)]++] = static_cast<BlockId>(i);
+            }
+        }
+
+        for (std::size_t i = blockCount; i > 0; --i)
+        {
+            _predecessorOffsets[i] = _predecessorOffsets[i - 1];
+        }
+        _predecessorOffsets[0] = 0;
+    }
+
+    void ControlFlowGraph::removeNode(const Node* node)
+    {
+        if (!_built)
+        {
+            return;
+        }
+
+        const auto id = getBlockOf(node);
+        if (id == BlockId::Invalid)
+        {
+            return;
+        }
+
+        const auto* prev = node->getPrev();
+        const auto* next = node->getNext();
+
+        _nodeBlocks.erase(node);
+
+        auto& block = _blocks[toIndex(id)];
+        if (block.head == node && block.tail == node)
+        {
+            markDirty(id);
+            releaseBlock(id);
+        }
+        else
+        {
+            if (block.head == node)
+            {
+                block.head = next;
+            }
+            else if (block.tail == node)
+            {
+                block.tail = prev;
+            }
+            markDirty(id);
+        }
+
+        // The next node may now start a block or no longer has to.
+        if (next != nullptr)
+        {
+            markDirty(getBlockOf(next));
+        }
+    }
+
+    void ControlFlowGraph::setNodeBlock(const Node* node, BlockId id)
+    {
+        _nodeBlocks.set(node, id);
+    }
+
+    ControlFlowGraph::BlockId ControlFlowGraph::allocateBlock()
+    {
+        auto id = BlockId::Invalid;
+        if (!_freeBlocks.empty())
+        {
+            id = _freeBlocks.back();
+            _freeBlocks.pop_back();
+        }
+        else
+        {
+            id = static_cast<BlockId>(_blocks.size());
+            _blocks.emplace_back();
+            _blockMarks.push_back(0);
+            _successors.resize(_successors.size() + kMaxSuccessors, BlockId::Invalid);
+            _successorCount.push_back(0);
+        }
+
+        _blocks[toIndex(id)] = Block{};
+        _blockMarks[toIndex(id)] &= ~kMarkDirty;
+
+        // The id may have been used before, the old predecessors need to be updated as well.
+        queueUpdate(id);
+
+        return id;
+    }
+
+    void ControlFlowGraph::releaseBlock(BlockId id)
+    {
+        _blocks[toIndex(id)] = Block{};
+        _successorCount[toIndex(id)] = 0;
+        _freeBlocks.push_back(id);
+    }
+
+    void ControlFlowGraph::markDirty(BlockId id)
+    {
+        if (id == BlockId::Invalid)
+        {
+            return;
+        }
+
+        auto& mark = _blockMarks[toIndex(id)];
+        if ((mark & kMarkDirty) != 0)
+        {
+            return;
+        }
+
+        mark |= kMarkDirty;
+        _dirtyBlocks.push_back(id);
+    }
+
+    void ControlFlowGraph::queueUpdate(BlockId id)
+    {
+        const auto queueBlock = [this](BlockId blockId) {
+            auto& mark = _blockMarks[toIndex(blockId)];
+            if ((mark & kMarkQueued) == 0)
+            {
+                mark |= kMarkQueued;
+                _updateBlocks.push_back(blockId);
+            }
+        };
+
+        queueBlock(id);
+
+        auto& mark = _blockMarks[toIndex(id)];
+        if ((mark & kMarkChanged) != 0)
+        {
+            return;
+        }
+        mark |= kMarkChanged;
+
+        // Predecessors from the last update may refer to this block as successor.
+        for (const auto pred : getPredecessors(id))
+        {
+            queueBlock(pred);
+        }
+    }
+
+} // namespace zasm
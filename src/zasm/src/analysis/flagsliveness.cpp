@@ -0,0 +1,161 @@
+#include "zasm/analysis/flagsliveness.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+#include "analysis.dataflow.hpp"
+
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    using FlagsMask = FlagsLiveness::FlagsMask;
+
+    struct FlagsUseDef
+    {
+        FlagsMask use{};
+        FlagsMask def{};
+    };
+
+    static FlagsUseDef getUseDef(const Node* node) noexcept
+    {
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr)
+        {
+            return {};
+        }
+
+        // Without meta data the instruction may read any flag.
+        if (!instr->isMetaDataValid())
+        {
+            return { FlagsLiveness::kAllFlags, 0 };
+        }
+
+        // The callee may read any flag, ex.: direction flag.
+        if (x86::isCall(instr->getMnemonic()))
+        {
+            return { FlagsLiveness::kAllFlags, 0 };
+        }
+
+        const auto& flags = instr->getCPUFlags();
+
+        FlagsUseDef res{};
+        res.use = flags.read;
+        res.def = flags.write | flags.undefined;
+        return res;
+    }
+
+    FlagsLiveness::FlagsLiveness(Program& program, ControlFlowGraph& cfg)
+        : _program(program)
+        , _cfg(cfg)
+        , _liveAfter(kAllFlags)
+    {
+    }
+
+    Error FlagsLiveness::run()
+    {
+        if (auto err = _cfg.update(); err != Error::None)
+        {
+            return err;
+        }
+
+        const auto blockCount = _cfg.getBlockCount();
+
+        std::vector<detail::BlockSets<FlagsMask>> sets(blockCount);
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            const auto& block = _cfg.getBlock(static_cast<ControlFlowGraph::BlockId>(i));
+            if (!block.isValid())
+            {
+                continue;
+            }
+
+            auto& entry = sets[i];
+            for (const auto* node = block.tail;; node = node->getPrev())
+            {
+                const auto ud = getUseDef(node);
+                entry.gen = ud.use | (entry.gen & ~ud.def);
+                entry.kill |= ud.def;
+
+                if (node == block.head)
+                {
+                    break;
+                }
+            }
+        }
+
+        detail::solveBackward(_cfg, sets, kAllFlags);
+
+        _blockLiveIn.resize(blockCount);
+        _blockLiveOut.resize(blockCount);
+        _liveAfter.clear();
+
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            _blockLiveIn[i] = sets[i].in;
+            _blockLiveOut[i] = sets[i].out;
+
+            const auto& block = _cfg.getBlock(static_cast<ControlFlowGraph::BlockId>(i));
+            if (!block.isValid())
+            {
+                continue;
+            }
+
+            auto live = sets[i].out;
+            for (const auto* node = block.tail;; node = node->getPrev())
+            {
+                _liveAfter.set(node, live);
+
+                const auto ud = getUseDef(node);
+                live = ud.use | (live & ~ud.def);
+
+                if (node == block.head)
+                {
+                    break;
+                }
+            }
+        }
+
+        return Error::None;
+    }
+
+    bool FlagsLiveness::isLiveAfter(const Node* node, FlagsMask flags) const noexcept
+    {
+        return (getLiveAfter(node) & flags) != 0;
+    }
+
+    bool FlagsLiveness::isLiveBefore(const Node* node, FlagsMask flags) const noexcept
+    {
+        return (getLiveBefore(node) & flags) != 0;
+    }
+
+    FlagsMask FlagsLiveness::getLiveAfter(const Node* node) const noexcept
+    {
+        return _liveAfter.get(node);
+    }
+
+    FlagsMask FlagsLiveness::getLiveBefore(const Node* node) const noexcept
+    {
+        const auto ud = getUseDef(node);
+        return ud.use | (getLiveAfter(node) & ~ud.def);
+    }
+
+    FlagsMask FlagsLiveness::getLiveIn(ControlFlowGraph::BlockId id) const noexcept
+    {
+        const auto idx = static_cast<std::size_t>(id);
+        if (idx >= _blockLiveIn.size())
+        {
+            return kAllFlags;
+        }
+        return _blockLiveIn[idx];
+    }
+
+    FlagsMask FlagsLiveness::getLiveOut(ControlFlowGraph::BlockId id) const noexcept
+    {
+        const auto idx = static_cast<std::size_t>(id);
+        if (idx >= _blockLiveOut.size())
+        {
+            return kAllFlags;
+        }
+        return _blockLiveOut[idx];
+    }
+
+} // namespace zasm
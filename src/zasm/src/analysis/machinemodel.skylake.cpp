@@ -0,0 +1,280 @@
+#include "zasm/analysis/machinemodel.hpp"
+
+#include <array>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm
+{
+    namespace
+    {
+        using Form = MachineModelEntry::Form;
+        using M = x86::Mnemonic;
+
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+        constexpr std::uint16_t kP0 = 1U << 0;
+        constexpr std::uint16_t kP1 = 1U << 1;
+        constexpr std::uint16_t kP2 = 1U << 2;
+        constexpr std::uint16_t kP3 = 1U << 3;
+        constexpr std::uint16_t kP4 = 1U << 4;
+        constexpr std::uint16_t kP5 = 1U << 5;
+        constexpr std::uint16_t kP6 = 1U << 6;
+        constexpr std::uint16_t kP7 = 1U << 7;
+
+        constexpr std::uint16_t kP01 = kP0 | kP1;
+        constexpr std::uint16_t kP05 = kP0 | kP5;
+        constexpr std::uint16_t kP06 = kP0 | kP6;
+        constexpr std::uint16_t kP15 = kP1 | kP5;
+        constexpr std::uint16_t kP015 = kP0 | kP1 | kP5;
+        constexpr std::uint16_t kP0156 = kP0 | kP1 | kP5 | kP6;
+
+        constexpr MachineModelEntry entry(
+            M mnemonic, Form form, std::uint8_t latency, std::uint8_t uops, std::uint16_t ports,
+            std::uint8_t occupancy = 1) noexcept
+        {
+            return MachineModelEntry{ static_cast<Instruction::Mnemonic>(mnemonic), form, latency, uops, occupancy, ports };
+        }
+
+        // Latencies and ports of the register forms, memory forms only list the differences.
+        constexpr std::array kSkylakeEntries = {
+            // General purpose.
+            entry(M::Adc, Form::Any, 1, 1, kP06),
+            entry(M::Add, Form::Any, 1, 1, kP0156),
+            entry(M::And, Form::Any, 1, 1, kP0156),
+            entry(M::Andn, Form::Any, 1, 1, kP15),
+            entry(M::Bsf, Form::Any, 3, 1, kP1),
+            entry(M::Bsr, Form::Any, 3, 1, kP1),
+            entry(M::Bswap, Form::Any, 2, 2, kP0156),
+            entry(M::Call, Form::Any, 2, 1, kP6),
+            entry(M::Cdq, Form::Any, 1, 1, kP06),
+            entry(M::Cdqe, Form::Any, 1, 1, kP0156),
+            entry(M::Cmovb, Form::Any, 1, 1, kP06),
+            entry(M::Cmovbe, Form::Any, 2, 2, kP06),
+            entry(M::Cmovl, Form::Any, 1, 1, kP06),
+            entry(M::Cmovle, Form::Any, 1, 1, kP06),
+            entry(M::Cmovnb, Form::Any, 1, 1, kP06),
+            entry(M::Cmovnbe, Form::Any, 2, 2, kP06),
+            entry(M::Cmovnl, Form::Any, 1, 1, kP06),
+            entry(M::Cmovnle, Form::Any, 1, 1, kP06),
+            entry(M::Cmovno, Form::Any, 1, 1, kP06),
+            entry(M::Cmovnp, Form::Any, 1, 1, kP06),
+            entry(M::Cmovns, Form::Any, 1, 1, kP06),
+            entry(M::Cmovnz, Form::Any, 1, 1, kP06),
+            entry(M::Cmovo, Form::Any, 1, 1, kP06),
+            entry(M::Cmovp, Form::Any, 1, 1, kP06),
+            entry(M::Cmovs, Form::Any, 1, 1, kP06),
+            entry(M::Cmovz, Form::Any, 1, 1, kP06),
+            entry(M::Cmp, Form::Any, 1, 1, kP0156),
+            entry(M::Cqo, Form::Any, 1, 1, kP06),
+            entry(M::Dec, Form::Any, 1, 1, kP0156),
+            entry(M::Div, Form::Any, 35, 1, kP0, 21),
+            entry(M::Idiv, Form::Any, 42, 1, kP0, 24),
+            entry(M::Imul, Form::Any, 3, 1, kP1),
+            entry(M::Inc, Form::Any, 1, 1, kP0156),
+            entry(M::Jb, Form::Any, 1, 1, kP06),
+            entry(M::Jbe, Form::Any, 1, 1, kP06),
+            entry(M::Jl, Form::Any, 1, 1, kP06),
+            entry(M::Jle, Form::Any, 1, 1, kP06),
+            entry(M::Jmp, Form::Any, 1, 1, kP6),
+            entry(M::Jnb, Form::Any, 1, 1, kP06),
+            entry(M::Jnbe, Form::Any, 1, 1, kP06),
+            entry(M::Jnl, Form::Any, 1, 1, kP06),
+            entry(M::Jnle, Form::Any, 1, 1, kP06),
+            entry(M::Jns, Form::Any, 1, 1, kP06),
+            entry(M::Jnz, Form::Any, 1, 1, kP06),
+            entry(M::Js, Form::Any, 1, 1, kP06),
+            entry(M::Jz, Form::Any, 1, 1, kP06),
+            entry(M::Lea, Form::Any, 1, 1, kP15),
+            entry(M::Lzcnt, Form::Any, 3, 1, kP1),
+            entry(M::Mov, Form::Any, 1, 1, kP0156),
+            entry(M::Mov, Form::Load, 0, 0, 0),
+            entry(M::Mov, Form::Store, 0, 0, 0),
+            entry(M::Movsx, Form::Any, 1, 1, kP0156),
+            entry(M::Movsx, Form::Load, 0, 0, 0),
+            entry(M::Movsxd, Form::Any, 1, 1, kP0156),
+            entry(M::Movsxd, Form::Load, 0, 0, 0),
+            entry(M::Movzx, Form::Any, 1, 1, kP0156),
+            entry(M::Movzx, Form::Load, 0, 0, 0),
+            entry(M::Mul, Form::Any, 3, 2, kP15),
+            entry(M::Neg, Form::Any, 1, 1, kP0156),
+            entry(M::Nop, Form::Any, 0, 1, 0),
+            entry(M::Not, Form::Any, 1, 1, kP0156),
+            entry(M::Or, Form::Any, 1, 1, kP0156),
+            entry(M::Pop, Form::Any, 0, 0, 0),
+            entry(M::Popcnt, Form::Any, 3, 1, kP1),
+            entry(M::Push, Form::Any, 0, 0, 0),
+            entry(M::Ret, Form::Any, 1, 1, kP6),
+            entry(M::Rol, Form::Any, 1, 1, kP06),
+            entry(M::Ror, Form::Any, 1, 1, kP06),
+            entry(M::Rorx, Form::Any, 1, 1, kP06),
+            entry(M::Sar, Form::Any, 1, 1, kP06),
+            entry(M::Sarx, Form::Any, 1, 1, kP06),
+            entry(M::Sbb, Form::Any, 1, 1, kP06),
+            entry(M::Setb, Form::Any, 1, 1, kP06),
+            entry(M::Setnz, Form::Any, 1, 1, kP06),
+            entry(M::Setz, Form::Any, 1, 1, kP06),
+            entry(M::Shl, Form::Any, 1, 1, kP06),
+            entry(M::Shlx, Form::Any, 1, 1, kP06),
+            entry(M::Shr, Form::Any, 1, 1, kP06),
+            entry(M::Shrx, Form::Any, 1, 1, kP06),
+            entry(M::Sub, Form::Any, 1, 1, kP0156),
+            entry(M::Test, Form::Any, 1, 1, kP0156),
+            entry(M::Tzcnt, Form::Any, 3, 1, kP1),
+            entry(M::Xchg, Form::Any, 2, 3, kP0156),
+            entry(M::Xor, Form::Any, 1, 1, kP0156),
+            // SSE.
+            entry(M::Addpd, Form::Any, 4, 1, kP01),
+            entry(M::Addps, Form::Any, 4, 1, kP01),
+            entry(M::Addsd, Form::Any, 4, 1, kP01),
+            entry(M::Addss, Form::Any, 4, 1, kP01),
+            entry(M::Andpd, Form::Any, 1, 1, kP015),
+            entry(M::Andps, Form::Any, 1, 1, kP015),
+            entry(M::Cvtsi2sd, Form::Any, 5, 2, kP015),
+            entry(M::Cvtsi2ss, Form::Any, 5, 2, kP015),
+            entry(M::Divpd, Form::Any, 14, 1, kP0, 4),
+            entry(M::Divps, Form::Any, 11, 1, kP0, 3),
+            entry(M::Divsd, Form::Any, 14, 1, kP0, 4),
+            entry(M::Divss, Form::Any, 11, 1, kP0, 3),
+            entry(M::Movaps, Form::Any, 1, 1, kP015),
+            entry(M::Movaps, Form::Load, 0, 0, 0),
+            entry(M::Movaps, Form::Store, 0, 0, 0),
+            entry(M::Movd, Form::Any, 2, 1, kP05),
+            entry(M::Movdqa, Form::Any, 1, 1, kP015),
+            entry(M::Movdqa, Form::Load, 0, 0, 0),
+            entry(M::Movdqa, Form::Store, 0, 0, 0),
+            entry(M::Movdqu, Form::Any, 1, 1, kP015),
+            entry(M::Movdqu, Form::Load, 0, 0, 0),
+            entry(M::Movdqu, Form::Store, 0, 0, 0),
+            entry(M::Movq, Form::Any, 2, 1, kP05),
+            entry(M::Movups, Form::Any, 1, 1, kP015),
+            entry(M::Movups, Form::Load, 0, 0, 0),
+            entry(M::Movups, Form::Store, 0, 0, 0),
+            entry(M::Mulpd, Form::Any, 4, 1, kP01),
+            entry(M::Mulps, Form::Any, 4, 1, kP01),
+            entry(M::Mulsd, Form::Any, 4, 1, kP01),
+            entry(M::Mulss, Form::Any, 4, 1, kP01),
+            entry(M::Orps, Form::Any, 1, 1, kP015),
+            entry(M::Paddd, Form::Any, 1, 1, kP015),
+            entry(M::Paddq, Form::Any, 1, 1, kP015),
+            entry(M::Pand, Form::Any, 1, 1, kP015),
+            entry(M::Pcmpeqd, Form::Any, 1, 1, kP01),
+            entry(M::Pmovmskb, Form::Any, 2, 1, kP0),
+            entry(M::Pmulld, Form::Any, 10, 2, kP01),
+            entry(M::Pmuludq, Form::Any, 5, 1, kP01),
+            entry(M::Por, Form::Any, 1, 1, kP015),
+            entry(M::Pshufd, Form::Any, 1, 1, kP5),
+            entry(M::Pslld, Form::Any, 1, 1, kP01),
+            entry(M::Psrld, Form::Any, 1, 1, kP01),
+            entry(M::Psubd, Form::Any, 1, 1, kP015),
+            entry(M::Pxor, Form::Any, 1, 1, kP015),
+            entry(M::Shufps, Form::Any, 1, 1, kP5),
+            entry(M::Sqrtps, Form::Any, 12, 1, kP0, 3),
+            entry(M::Subpd, Form::Any, 4, 1, kP01),
+            entry(M::Subps, Form::Any, 4, 1, kP01),
+            entry(M::Xorpd, Form::Any, 1, 1, kP015),
+            entry(M::Xorps, Form::Any, 1, 1, kP015),
+            // AVX, AVX2 and AVX-512.
+            entry(M::Vaddpd, Form::Any, 4, 1, kP01),
+            entry(M::Vaddps, Form::Any, 4, 1, kP01),
+            entry(M::Vandps, Form::Any, 1, 1, kP015),
+            entry(M::Vblendps, Form::Any, 1, 1, kP015),
+            entry(M::Vbroadcastss, Form::Any, 3, 1, kP5),
+            entry(M::Vbroadcastss, Form::Load, 0, 0, 0),
+            entry(M::Vcvtsi2ss, Form::Any, 5, 2, kP015),
+            entry(M::Vdivps, Form::Any, 11, 1, kP0, 5),
+            entry(M::Vextractf128, Form::Any, 3, 1, kP5),
+            entry(M::Vfmadd132ps, Form::Any, 4, 1, kP01),
+            entry(M::Vfmadd213ps, Form::Any, 4, 1, kP01),
+            entry(M::Vfmadd231pd, Form::Any, 4, 1, kP01),
+            entry(M::Vfmadd231ps, Form::Any, 4, 1, kP01),
+            entry(M::Vinsertf128, Form::Any, 3, 1, kP5),
+            entry(M::Vmaxps, Form::Any, 4, 1, kP01),
+            entry(M::Vminps, Form::Any, 4, 1, kP01),
+            entry(M::Vmovaps, Form::Any, 1, 1, kP015),
+            entry(M::Vmovaps, Form::Load, 0, 0, 0),
+            entry(M::Vmovaps, Form::Store, 0, 0, 0),
+            entry(M::Vmovd, Form::Any, 2, 1, kP05),
+            entry(M::Vmovdqa, Form::Any, 1, 1, kP015),
+            entry(M::Vmovdqa, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqa, Form::Store, 0, 0, 0),
+            entry(M::Vmovdqa32, Form::Any, 1, 1, kP05),
+            entry(M::Vmovdqa32, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqa32, Form::Store, 0, 0, 0),
+            entry(M::Vmovdqa64, Form::Any, 1, 1, kP05),
+            entry(M::Vmovdqa64, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqa64, Form::Store, 0, 0, 0),
+            entry(M::Vmovdqu, Form::Any, 1, 1, kP015),
+            entry(M::Vmovdqu, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqu, Form::Store, 0, 0, 0),
+            entry(M::Vmovdqu32, Form::Any, 1, 1, kP05),
+            entry(M::Vmovdqu32, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqu32, Form::Store, 0, 0, 0),
+            entry(M::Vmovdqu64, Form::Any, 1, 1, kP05),
+            entry(M::Vmovdqu64, Form::Load, 0, 0, 0),
+            entry(M::Vmovdqu64, Form::Store, 0, 0, 0),
+            entry(M::Vmovmskps, Form::Any, 2, 1, kP0),
+            entry(M::Vmovq, Form::Any, 2, 1, kP05),
+            entry(M::Vmovups, Form::Any, 1, 1, kP015),
+            entry(M::Vmovups, Form::Load, 0, 0, 0),
+            entry(M::Vmovups, Form::Store, 0, 0, 0),
+            entry(M::Vmulpd, Form::Any, 4, 1, kP01),
+            entry(M::Vmulps, Form::Any, 4, 1, kP01),
+            entry(M::Vorps, Form::Any, 1, 1, kP015),
+            entry(M::Vpaddd, Form::Any, 1, 1, kP015),
+            entry(M::Vpand, Form::Any, 1, 1, kP015),
+            entry(M::Vpandd, Form::Any, 1, 1, kP05),
+            entry(M::Vpblendd, Form::Any, 1, 1, kP015),
+            entry(M::Vpbroadcastd, Form::Any, 3, 1, kP5),
+            entry(M::Vpbroadcastd, Form::Load, 0, 0, 0),
+            entry(M::Vpcmpeqd, Form::Any, 1, 1, kP01),
+            entry(M::Vperm2f128, Form::Any, 3, 1, kP5),
+            entry(M::Vpermd, Form::Any, 3, 1, kP5),
+            entry(M::Vpermq, Form::Any, 3, 1, kP5),
+            entry(M::Vpmaxsd, Form::Any, 1, 1, kP01),
+            entry(M::Vpminsd, Form::Any, 1, 1, kP01),
+            entry(M::Vpmovmskb, Form::Any, 2, 1, kP0),
+            entry(M::Vpmulld, Form::Any, 10, 2, kP01),
+            entry(M::Vpor, Form::Any, 1, 1, kP015),
+            entry(M::Vpord, Form::Any, 1, 1, kP05),
+            entry(M::Vpshufd, Form::Any, 1, 1, kP5),
+            entry(M::Vpslld, Form::Any, 1, 1, kP01),
+            entry(M::Vpsllq, Form::Any, 1, 1, kP01),
+            entry(M::Vpsrad, Form::Any, 1, 1, kP01),
+            entry(M::Vpsrld, Form::Any, 1, 1, kP01),
+            entry(M::Vpsrlq, Form::Any, 1, 1, kP01),
+            entry(M::Vpsubd, Form::Any, 1, 1, kP015),
+            entry(M::Vpunpckldq, Form::Any, 1, 1, kP5),
+            entry(M::Vpxor, Form::Any, 1, 1, kP015),
+            entry(M::Vpxord, Form::Any, 1, 1, kP05),
+            entry(M::Vpxorq, Form::Any, 1, 1, kP05),
+            entry(M::Vshufps, Form::Any, 1, 1, kP5),
+            entry(M::Vsqrtps, Form::Any, 12, 1, kP0, 6),
+            entry(M::Vsubpd, Form::Any, 4, 1, kP01),
+            entry(M::Vsubps, Form::Any, 4, 1, kP01),
+            entry(M::Vunpcklps, Form::Any, 1, 1, kP5),
+            entry(M::Vxorps, Form::Any, 1, 1, kP015),
+            entry(M::Vzeroupper, Form::Any, 1, 4, kP0156),
+        };
+
+        constexpr MachineModel kSkylake{
+            "skylake",
+            8,
+            4,
+            5,
+            kP2 | kP3,
+            kP2 | kP3 | kP7,
+            kP4,
+            true,
+            MachineModelEntry{ Instruction::Mnemonic{}, Form::Any, 1, 1, 1, kP0156 },
+            kSkylakeEntries.data(),
+            kSkylakeEntries.size(),
+        };
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+
+    } // namespace
+
+    const MachineModel& MachineModel::skylake() noexcept
+    {
+        return kSkylake;
+    }
+
+} // namespace zasm
@@ -0,0 +1,205 @@
+#include "zasm/analysis/profile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
+
+namespace zasm
+{
+    static bool isSpace(char c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skipSpaces(const char* str) noexcept
+    {
+        while (isSpace(*str))
+        {
+            str++;
+        }
+        return str;
+    }
+
+    Profile::Profile(Program& program)
+        : _program(program)
+        , _nodeWeights(program, 0)
+    {
+    }
+
+    bool Profile::addSample(const Serializer& serializer, std::int64_t address, std::uint64_t count)
+    {
+        _totalSamples += count;
+
+        const auto* node = serializer.findNodeAt(address);
+        if (node == nullptr)
+        {
+            _unmappedSamples += count;
+            return false;
+        }
+
+        _nodeWeights[node] += count;
+        return true;
+    }
+
+    Error Profile::parse(const Serializer& serializer, const char* text)
+    {
+        const char* cur = text;
+        while (*cur != '\0')
+        {
+            cur = skipSpaces(cur);
+
+            if (*cur == '#')
+            {
+                while (*cur != '\0' && *cur != '\n')
+                {
+                    cur++;
+                }
+            }
+
+            if (*cur == '\n')
+            {
+                cur++;
+                continue;
+            }
+            if (*cur == '\0')
+            {
+                break;
+            }
+
+            char* end = nullptr;
+            const auto address = std::strtoull(cur, &end, 16);
+            if (end == cur || (*end != '\0' && *end != '\n' && !isSpace(*end)))
+            {
+                return Error::InvalidFileFormat;
+            }
+            cur = skipSpaces(end);
+
+            std::uint64_t count = 1;
+            if (*cur != '\0' && *cur != '\n')
+            {
+                count = std::strtoull(cur, &end, 10);
+                if (end == cur)
+                {
+                    return Error::InvalidFileFormat;
+                }
+                cur = skipSpaces(end);
+                if (*cur != '\0' && *cur != '\n')
+                {
+                    return Error::InvalidFileFormat;
+                }
+            }
+
+            addSample(serializer, static_cast<std::int64_t>(address), count);
+        }
+
+        updateLabelWeights();
+
+        return Error::None;
+    }
+
+    Error Profile::load(const Serializer& serializer, const char* filePath)
+    {
+        std::FILE* file = std::fopen(filePath, "rb");
+        if (file == nullptr)
+        {
+            return Error::FileNotFound;
+        }
+
+        std::string text;
+
+        char buffer[4096];
+        std::size_t bytesRead = 0;
+        while ((bytesRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            text.append(buffer, bytesRead);
+        }
+        std::fclose(file);
+
+        return parse(serializer, text.c_str());
+    }
+
+    void Profile::updateLabelWeights()
+    {
+        std::fill(_labelWeights.begin(), _labelWeights.end(), 0);
+
+        // Consecutive labels share the weight of the nodes that follow.
+        std::vector<std::size_t> activeLabels;
+        bool lastWasLabel = false;
+
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* label = node->getIf<Label>(); label != nullptr)
+            {
+                if (!lastWasLabel)
+                {
+                    activeLabels.clear();
+                }
+
+                const auto labelIdx = static_cast<std::size_t>(label->getId());
+                if (labelIdx >= _labelWeights.size())
+                {
+                    _labelWeights.resize(labelIdx + 1);
+                }
+
+                activeLabels.push_back(labelIdx);
+                lastWasLabel = true;
+                continue;
+            }
+
+            lastWasLabel = false;
+
+            if (node->holds<Section>())
+            {
+                activeLabels.clear();
+                continue;
+            }
+
+            const auto weight = _nodeWeights.get(node);
+            if (weight == 0)
+            {
+                continue;
+            }
+            for (const auto labelIdx : activeLabels)
+            {
+                _labelWeights[labelIdx] += weight;
+            }
+        }
+    }
+
+    void Profile::clear()
+    {
+        _nodeWeights.clear();
+        _labelWeights.clear();
+        _totalSamples = 0;
+        _unmappedSamples = 0;
+    }
+
+    std::uint64_t Profile::getNodeWeight(const Node* node) const noexcept
+    {
+        return _nodeWeights.get(node);
+    }
+
+    std::uint64_t Profile::getLabelWeight(const Label& label) const noexcept
+    {
+        const auto labelIdx = static_cast<std::size_t>(label.getId());
+        if (labelIdx >= _labelWeights.size())
+        {
+            return 0;
+        }
+        return _labelWeights[labelIdx];
+    }
+
+    std::uint64_t Profile::getTotalSamples() const noexcept
+    {
+        return _totalSamples;
+    }
+
+    std::uint64_t Profile::getUnmappedSamples() const noexcept
+    {
+        return _unmappedSamples;
+    }
+
+} // namespace zasm
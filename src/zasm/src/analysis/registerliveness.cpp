@@ -0,0 +1,285 @@
+#include "zasm/analysis/registerliveness.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+#include "analysis.dataflow.hpp"
+
+#include <Zydis/Zydis.h>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm
+{
+    using RegMask = RegisterLiveness::RegMask;
+
+    struct UseDef
+    {
+        RegMask use{};
+        RegMask def{};
+    };
+
+    static constexpr RegMask makeBits(std::int32_t offset, std::int32_t count) noexcept
+    {
+        return ((RegMask{ 1 } << count) - 1) << offset;
+    }
+
+    // Writes to the root or to a 32 bit register in 64 bit mode replace the entire register.
+    static bool isFullWrite(MachineMode mode, const Reg& reg) noexcept
+    {
+        if (reg == reg.getRoot(mode))
+        {
+            return true;
+        }
+        return mode == MachineMode::AMD64 && reg.isGp32();
+    }
+
+    // Instructions that produce zero without depending on the value, ex.: xor eax, eax
+    static bool isZeroIdiom(const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Xor:
+            case x86::Mnemonic::Sub:
+            case x86::Mnemonic::Pxor:
+            case x86::Mnemonic::Xorps:
+            case x86::Mnemonic::Xorpd:
+                break;
+            default:
+                return false;
+        }
+
+        const auto* regA = instr.getOperandIf<Reg>(0);
+        const auto* regB = instr.getOperandIf<Reg>(1);
+        return regA != nullptr && regB != nullptr && *regA == *regB;
+    }
+
+    static UseDef getUseDef(MachineMode mode, const Instruction& instr, RegMask allRegs) noexcept
+    {
+        UseDef res{};
+
+        // The callee may read any register.
+        if (x86::isCall(instr.getMnemonic()))
+        {
+            res.use = allRegs;
+        }
+
+        const bool hasAccessInfo = instr.isMetaDataValid();
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = instr.getOperand(i);
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+            {
+                const auto mask = RegisterLiveness::getRegMask(mode, *reg);
+                if (!hasAccessInfo)
+                {
+                    // Without meta data every register operand is assumed to be read.
+                    res.use |= mask;
+                    continue;
+                }
+
+                const auto access = instr.getOperandAccess(i);
+                if ((access & Operand::Access::MaskRead) != Operand::Access::None)
+                {
+                    res.use |= mask;
+                }
+                if ((access & Operand::Access::Write) != Operand::Access::None && isFullWrite(mode, *reg))
+                {
+                    res.def |= mask;
+                }
+            }
+            else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+            {
+                res.use |= RegisterLiveness::getRegMask(mode, mem->getBase());
+                res.use |= RegisterLiveness::getRegMask(mode, mem->getIndex());
+            }
+        }
+
+        if (hasAccessInfo && isZeroIdiom(instr))
+        {
+            res.use &= ~RegisterLiveness::getRegMask(mode, instr.getOperand<Reg>(0));
+        }
+
+        return res;
+    }
+
+    static UseDef getUseDef(MachineMode mode, const Node* node, RegMask allRegs) noexcept
+    {
+        if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+        {
+            return getUseDef(mode, *instr, allRegs);
+        }
+        return {};
+    }
+
+    RegisterLiveness::RegisterLiveness(Program& program, ControlFlowGraph& cfg)
+        : _program(program)
+        , _cfg(cfg)
+        , _allRegs(getAllRegsMask(program.getMode()))
+        , _liveAfter(_allRegs)
+    {
+    }
+
+    Error RegisterLiveness::run()
+    {
+        if (auto err = _cfg.update(); err != Error::None)
+        {
+            return err;
+        }
+
+        const auto mode = _program.getMode();
+        _allRegs = getAllRegsMask(mode);
+
+        const auto blockCount = _cfg.getBlockCount();
+
+        std::vector<detail::BlockSets<RegMask>> sets(blockCount);
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            const auto& block = _cfg.getBlock(static_cast<ControlFlowGraph::BlockId>(i));
+            if (!block.isValid())
+            {
+                continue;
+            }
+
+            auto& entry = sets[i];
+            for (const auto* node = block.tail;; node = node->getPrev())
+            {
+                const auto ud = getUseDef(mode, node, _allRegs);
+                entry.gen = ud.use | (entry.gen & ~ud.def);
+                entry.kill |= ud.def;
+
+                if (node == block.head)
+                {
+                    break;
+                }
+            }
+        }
+
+        detail::solveBackward(_cfg, sets, _allRegs);
+
+        _blockLiveIn.resize(blockCount);
+        _blockLiveOut.resize(blockCount);
+        _liveAfter.setDefault(_allRegs);
+        _liveAfter.clear();
+
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            _blockLiveIn[i] = sets[i].in;
+            _blockLiveOut[i] = sets[i].out;
+
+            const auto& block = _cfg.getBlock(static_cast<ControlFlowGraph::BlockId>(i));
+            if (!block.isValid())
+            {
+                continue;
+            }
+
+            auto live = sets[i].out;
+            for (const auto* node = block.tail;; node = node->getPrev())
+            {
+                _liveAfter.set(node, live);
+
+                const auto ud = getUseDef(mode, node, _allRegs);
+                live = ud.use | (live & ~ud.def);
+
+                if (node == block.head)
+                {
+                    break;
+                }
+            }
+        }
+
+        return Error::None;
+    }
+
+    RegMask RegisterLiveness::getRegMask(MachineMode mode, const Reg& reg) noexcept
+    {
+        if (!reg.isValid())
+        {
+            return 0;
+        }
+
+        const auto root = reg.getRoot(mode);
+        const auto index = root.getPhysicalIndex();
+        if (index < 0)
+        {
+            return 0;
+        }
+
+        switch (static_cast<ZydisRegisterClass>(root.getClass()))
+        {
+            case ZYDIS_REGCLASS_GPR32:
+            case ZYDIS_REGCLASS_GPR64:
+                return RegMask{ 1 } << (kGpBitOffset + index);
+            case ZYDIS_REGCLASS_XMM:
+            case ZYDIS_REGCLASS_YMM:
+            case ZYDIS_REGCLASS_ZMM:
+                return RegMask{ 1 } << (kVecBitOffset + index);
+            case ZYDIS_REGCLASS_MASK:
+                return RegMask{ 1 } << (kMaskBitOffset + index);
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    RegMask RegisterLiveness::getAllRegsMask(MachineMode mode) noexcept
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+        if (mode == MachineMode::AMD64)
+        {
+            return makeBits(kGpBitOffset, 16) | makeBits(kVecBitOffset, 32) | makeBits(kMaskBitOffset, 8);
+        }
+        return makeBits(kGpBitOffset, 8) | makeBits(kVecBitOffset, 8) | makeBits(kMaskBitOffset, 8);
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
+    }
+
+    bool RegisterLiveness::isLiveAfter(const Node* node, const Reg& reg) const noexcept
+    {
+        const auto mask = getRegMask(_program.getMode(), reg);
+        if (mask == 0)
+        {
+            return true;
+        }
+        return (getLiveAfter(node) & mask) != 0;
+    }
+
+    bool RegisterLiveness::isLiveBefore(const Node* node, const Reg& reg) const noexcept
+    {
+        const auto mask = getRegMask(_program.getMode(), reg);
+        if (mask == 0)
+        {
+            return true;
+        }
+        return (getLiveBefore(node) & mask) != 0;
+    }
+
+    RegMask RegisterLiveness::getLiveAfter(const Node* node) const noexcept
+    {
+        return _liveAfter.get(node);
+    }
+
+    RegMask RegisterLiveness::getLiveBefore(const Node* node) const noexcept
+    {
+        const auto ud = getUseDef(_program.getMode(), node, _allRegs);
+        return ud.use | (getLiveAfter(node) & ~ud.def);
+    }
+
+    RegMask RegisterLiveness::getLiveIn(ControlFlowGraph::BlockId id) const noexcept
+    {
+        const auto idx = static_cast<std::size_t>(id);
+        if (idx >= _blockLiveIn.size())
+        {
+            return getAllRegsMask(_program.getMode());
+        }
+        return _blockLiveIn[idx];
+    }
+
+    RegMask RegisterLiveness::getLiveOut(ControlFlowGraph::BlockId id) const noexcept
+    {
+        const auto idx = static_cast<std::size_t>(id);
+        if (idx >= _blockLiveOut.size())
+        {
+            return getAllRegsMask(_program.getMode());
+        }
+        return _blockLiveOut[idx];
+    }
+
+} // namespace zasm
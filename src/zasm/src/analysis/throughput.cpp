@@ -0,0 +1,466 @@
+#include "zasm/analysis/throughput.hpp"
+
+#include "../x86/x86.regaccess.hpp"
+
+#include <Zydis/Zydis.h>
+#include <algorithm>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm
+{
+    using Form = MachineModelEntry::Form;
+
+    // Slot of the flags in the ready times, registers follow.
+    static constexpr std::uint32_t kFlagsSlot = 0;
+    static constexpr std::uint32_t kFirstRegSlot = 1;
+    static constexpr std::uint32_t kVirtualRegSlot = kFirstRegSlot + ZYDIS_REGISTER_MAX_VALUE;
+
+    // Iterations simulated to measure the growth of loop-carried dependency chains.
+    static constexpr std::int32_t kDependencyIterations = 8;
+
+    // Iterations the uops are distributed over, divisible by the common port counts 2, 3 and 4.
+    static constexpr std::int32_t kPressureIterations = 12;
+
+    static std::uint8_t countPorts(std::uint16_t ports) noexcept
+    {
+        std::uint8_t count = 0;
+        for (; ports != 0; ports &= static_cast<std::uint16_t>(ports - 1))
+        {
+            count++;
+        }
+        return count;
+    }
+
+    static Form getForm(const Instruction& instr) noexcept
+    {
+        const bool hasAccessInfo = instr.isMetaDataValid();
+
+        bool reads = false;
+        bool writes = false;
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            if (!instr.getOperand(i).holds<Mem>())
+            {
+                continue;
+            }
+
+            // lea and nop only compute the address.
+            const auto access = hasAccessInfo ? instr.getOperandAccess(i) : Operand::Access::Read;
+            reads |= (access & Operand::Access::MaskRead) != Operand::Access::None;
+            writes |= (access & Operand::Access::MaskWrite) != Operand::Access::None;
+        }
+
+        if (reads && writes)
+        {
+            return Form::ReadModifyWrite;
+        }
+        if (reads)
+        {
+            return Form::Load;
+        }
+        if (writes)
+        {
+            return Form::Store;
+        }
+        return Form::Reg;
+    }
+
+    // Instructions that produce a constant without depending on the value, ex.: xor eax, eax
+    static bool isZeroIdiom(const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Xor:
+            case x86::Mnemonic::Sub:
+            case x86::Mnemonic::Pxor:
+            case x86::Mnemonic::Psubd:
+            case x86::Mnemonic::Xorps:
+            case x86::Mnemonic::Xorpd:
+                break;
+            case x86::Mnemonic::Vpxor:
+            case x86::Mnemonic::Vpxord:
+            case x86::Mnemonic::Vpxorq:
+            case x86::Mnemonic::Vxorps:
+            case x86::Mnemonic::Vxorpd:
+            case x86::Mnemonic::Vpsubd:
+            {
+                const auto* regB = instr.getOperandIf<Reg>(1);
+                const auto* regC = instr.getOperandIf<Reg>(2);
+                return regB != nullptr && regC != nullptr && *regB == *regC;
+            }
+            default:
+                return false;
+        }
+
+        const auto* regA = instr.getOperandIf<Reg>(0);
+        const auto* regB = instr.getOperandIf<Reg>(1);
+        return regA != nullptr && regB != nullptr && *regA == *regB;
+    }
+
+    // Register to register moves handled by the renamer.
+    static bool isEliminableMove(MachineMode mode, const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Mov:
+            case x86::Mnemonic::Movaps:
+            case x86::Mnemonic::Movups:
+            case x86::Mnemonic::Movdqa:
+            case x86::Mnemonic::Movdqu:
+            case x86::Mnemonic::Vmovaps:
+            case x86::Mnemonic::Vmovups:
+            case x86::Mnemonic::Vmovdqa:
+            case x86::Mnemonic::Vmovdqu:
+                break;
+            default:
+                return false;
+        }
+
+        const auto* dst = instr.getOperandIf<Reg>(0);
+        const auto* src = instr.getOperandIf<Reg>(1);
+        if (dst == nullptr || src == nullptr || dst->isVirtual() || src->isVirtual())
+        {
+            return false;
+        }
+
+        // Only full width general purpose moves are eliminated.
+        if (dst->isGp())
+        {
+            return dst->isGp32() || dst->getBitSize(mode) == BitSize::_64;
+        }
+        return true;
+    }
+
+    // Implicit stack pointer updates of push, pop, call and ret are handled by the stack engine and do
+    // not form a dependency chain.
+    static bool isTrackedReg(MachineMode mode, const Reg& reg, bool hidden) noexcept
+    {
+        if (!x86::isTrackedReg(reg))
+        {
+            return false;
+        }
+        if (hidden && !reg.isVirtual() && reg.isGp())
+        {
+            const auto root = static_cast<ZydisRegister>(reg.getRoot(mode).getId());
+            return root != ZYDIS_REGISTER_RSP && root != ZYDIS_REGISTER_ESP;
+        }
+        return true;
+    }
+
+    static std::uint32_t getRegSlot(MachineMode mode, const Reg& reg) noexcept
+    {
+        if (reg.isVirtual())
+        {
+            return kVirtualRegSlot + static_cast<std::uint32_t>(reg.getVirtualIndex());
+        }
+        return kFirstRegSlot + static_cast<std::uint32_t>(reg.getRoot(mode).getId());
+    }
+
+    ThroughputAnalyzer::ThroughputAnalyzer(Program& program, const MachineModel& model)
+        : _program(program)
+        , _model(model)
+        , _lookup(ZYDIS_MNEMONIC_MAX_VALUE + 1)
+    {
+        for (std::size_t i = 0; i < model.entryCount; ++i)
+        {
+            const auto& entry = model.entries[i]; // NOLINT
+            const auto mnemonicIdx = static_cast<std::size_t>(entry.mnemonic);
+            const auto formIdx = static_cast<std::size_t>(entry.form);
+            if (mnemonicIdx >= _lookup.size() || formIdx >= _lookup[mnemonicIdx].forms.size())
+            {
+                continue;
+            }
+            // The first entry wins, later duplicates are ignored.
+            auto& index = _lookup[mnemonicIdx].forms[formIdx];
+            if (index == -1)
+            {
+                index = static_cast<std::int32_t>(i);
+            }
+        }
+    }
+
+    const MachineModelEntry& ThroughputAnalyzer::getEntry(Instruction::Mnemonic mnemonic, Form form) const noexcept
+    {
+        const auto mnemonicIdx = static_cast<std::size_t>(mnemonic);
+        if (mnemonicIdx >= _lookup.size())
+        {
+            return _model.defaultEntry;
+        }
+
+        const auto& forms = _lookup[mnemonicIdx].forms;
+        auto index = forms[static_cast<std::size_t>(form)];
+        if (index == -1)
+        {
+            index = forms[static_cast<std::size_t>(Form::Any)];
+        }
+        if (index == -1)
+        {
+            return _model.defaultEntry;
+        }
+        return _model.entries[index]; // NOLINT
+    }
+
+    std::int32_t ThroughputAnalyzer::getLatency(const Instruction& instr) const noexcept
+    {
+        if (instr.isMetaDataValid()
+            && (isZeroIdiom(instr) || (_model.moveElimination && isEliminableMove(_program.getMode(), instr))))
+        {
+            return 0;
+        }
+
+        const auto form = getForm(instr);
+        std::int32_t latency = getEntry(instr.getMnemonic(), form).latency;
+        if (form == Form::Load || form == Form::ReadModifyWrite)
+        {
+            latency += _model.loadLatency;
+        }
+        return latency;
+    }
+
+    Error ThroughputAnalyzer::run(const Node* first, const Node* last)
+    {
+        _report = {};
+        _instrs.clear();
+        _slots.clear();
+        _uops.clear();
+
+        if (first == nullptr)
+        {
+            return Error::InvalidParameter;
+        }
+
+        const auto mode = _program.getMode();
+
+        const auto addUop = [this](std::uint16_t ports, std::uint8_t occupancy) {
+            _report.uops++;
+            if (ports != 0)
+            {
+                _uops.push_back(PortUop{ ports, occupancy, countPorts(ports) });
+            }
+        };
+
+        for (const auto* node = first; node != nullptr; node = node->getNext())
+        {
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                _report.instructions++;
+
+                InstrInfo info{};
+                info.firstInput = static_cast<std::uint32_t>(_slots.size());
+
+                const auto form = getForm(*instr);
+                const auto& entry = getEntry(instr->getMnemonic(), form);
+                if (&entry == &_model.defaultEntry)
+                {
+                    _report.unknownInstructions++;
+                }
+
+                const bool hasAccessInfo = instr->isMetaDataValid();
+                const bool zeroIdiom = hasAccessInfo && isZeroIdiom(*instr);
+                const bool moveEliminated = hasAccessInfo && !zeroIdiom && _model.moveElimination
+                    && isEliminableMove(mode, *instr);
+
+                if (zeroIdiom || moveEliminated)
+                {
+                    // Only takes an issue slot, the result is available immediately.
+                    addUop(0, 0);
+                }
+                else
+                {
+                    info.latency = entry.latency;
+                    for (std::uint8_t i = 0; i < entry.uops; ++i)
+                    {
+                        addUop(entry.ports, entry.occupancy);
+                    }
+
+                    if (form == Form::Load || form == Form::ReadModifyWrite)
+                    {
+                        addUop(_model.loadPorts, 1);
+                        info.latency += _model.loadLatency;
+                    }
+                    if (form == Form::Store || form == Form::ReadModifyWrite)
+                    {
+                        addUop(_model.storeAddressPorts, 1);
+                        addUop(_model.storeDataPorts, 1);
+                    }
+                }
+
+                // Inputs, zero idioms do not depend on them while an eliminated move forwards its input
+                // to the destination without latency.
+                if (!zeroIdiom)
+                {
+                    for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+                    {
+                        const auto& op = instr->getOperand(i);
+                        const bool hidden = hasAccessInfo && instr->isOperandHidden(i);
+                        if (const auto* reg = op.getIf<Reg>(); reg != nullptr && isTrackedReg(mode, *reg, hidden))
+                        {
+                            // Without meta data the first operand is assumed to be read and written.
+                            const auto access = hasAccessInfo ? instr->getOperandAccess(i)
+                                                              : (i == 0 ? Operand::Access::ReadWrite : Operand::Access::Read);
+
+                            const bool reads = (access & Operand::Access::MaskRead) != Operand::Access::None;
+                            const bool condWrite = (access & Operand::Access::CondWrite) != Operand::Access::None;
+                            const bool writes = (access & Operand::Access::MaskWrite) != Operand::Access::None;
+                            if (reads || condWrite || (writes && x86::isPartialWrite(mode, *reg)))
+                            {
+                                _slots.push_back(getRegSlot(mode, *reg));
+                            }
+                        }
+                        else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                        {
+                            if (isTrackedReg(mode, mem->getBase(), hidden))
+                            {
+                                _slots.push_back(getRegSlot(mode, mem->getBase()));
+                            }
+                            if (isTrackedReg(mode, mem->getIndex(), hidden))
+                            {
+                                _slots.push_back(getRegSlot(mode, mem->getIndex()));
+                            }
+                        }
+                    }
+                    if (hasAccessInfo && instr->getCPUFlags().read != 0)
+                    {
+                        _slots.push_back(kFlagsSlot);
+                    }
+                }
+                info.inputCount = static_cast<std::uint32_t>(_slots.size()) - info.firstInput;
+
+                // Outputs, zero idioms have no inputs so they break the dependency.
+                info.firstOutput = static_cast<std::uint32_t>(_slots.size());
+                for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+                {
+                    const auto* reg = instr->getOperandIf<Reg>(i);
+                    const bool hidden = hasAccessInfo && instr->isOperandHidden(i);
+                    if (reg == nullptr || !isTrackedReg(mode, *reg, hidden))
+                    {
+                        continue;
+                    }
+                    const auto access = hasAccessInfo ? instr->getOperandAccess(i)
+                                                      : (i == 0 ? Operand::Access::ReadWrite : Operand::Access::Read);
+                    if ((access & Operand::Access::MaskWrite) != Operand::Access::None)
+                    {
+                        _slots.push_back(getRegSlot(mode, *reg));
+                    }
+                }
+                if (!hasAccessInfo || instr->getCPUFlags().write != 0 || instr->getCPUFlags().undefined != 0)
+                {
+                    _slots.push_back(kFlagsSlot);
+                }
+                info.outputCount = static_cast<std::uint32_t>(_slots.size()) - info.firstOutput;
+
+                _instrs.push_back(info);
+            }
+
+            if (node == last)
+            {
+                break;
+            }
+        }
+
+        if (_instrs.empty())
+        {
+            return Error::None;
+        }
+
+        // Dependency chains, iterations are simulated without resource limits to measure how much the
+        // chains carried into the next iteration grow per iteration.
+        _readyTimes.assign(kVirtualRegSlot + _program.getVirtualRegCount(), 0);
+
+        std::array<std::int32_t, kDependencyIterations> iterationEnd{};
+        for (std::int32_t iteration = 0; iteration < kDependencyIterations; ++iteration)
+        {
+            std::int32_t end = 0;
+            for (const auto& info : _instrs)
+            {
+                std::int32_t start = 0;
+                for (std::uint32_t i = 0; i < info.inputCount; ++i)
+                {
+                    start = std::max(start, _readyTimes[_slots[info.firstInput + i]]);
+                }
+
+                const auto done = start + info.latency;
+                for (std::uint32_t i = 0; i < info.outputCount; ++i)
+                {
+                    _readyTimes[_slots[info.firstOutput + i]] = done;
+                }
+                end = std::max(end, done);
+            }
+            // The iteration can not complete before the previous one.
+            iterationEnd[iteration] = iteration > 0 ? std::max(end, iterationEnd[iteration - 1]) : end;
+        }
+
+        constexpr auto kHalf = kDependencyIterations / 2;
+        _report.latency = iterationEnd[0];
+        const auto dependencyBound = static_cast<double>(iterationEnd[kDependencyIterations - 1] - iterationEnd[kHalf - 1])
+            / kHalf;
+
+        // Port pressure, the most constrained uops are assigned first to the least loaded port.
+        std::stable_sort(
+            _uops.begin(), _uops.end(), [](const PortUop& a, const PortUop& b) { return a.portCount < b.portCount; });
+
+        std::array<std::uint32_t, MachineModel::kMaxPorts> portLoad{};
+        const auto portCount = std::min(_model.portCount, MachineModel::kMaxPorts);
+        for (const auto& uop : _uops)
+        {
+            for (std::int32_t iteration = 0; iteration < kPressureIterations; ++iteration)
+            {
+                std::int32_t best = -1;
+                for (std::int32_t port = 0; port < portCount; ++port)
+                {
+                    if ((uop.ports & (1U << port)) == 0)
+                    {
+                        continue;
+                    }
+                    if (best == -1 || portLoad[port] < portLoad[best])
+                    {
+                        best = port;
+                    }
+                }
+                if (best != -1)
+                {
+                    portLoad[best] += uop.occupancy;
+                }
+            }
+        }
+
+        double portBound = 0.0;
+        for (std::int32_t port = 0; port < portCount; ++port)
+        {
+            _report.portPressure[port] = static_cast<double>(portLoad[port]) / kPressureIterations;
+            if (portLoad[port] != 0 && (_report.bottleneckPort == -1 || portLoad[port] > portLoad[_report.bottleneckPort]))
+            {
+                _report.bottleneckPort = port;
+                portBound = _report.portPressure[port];
+            }
+        }
+
+        const auto issueBound = static_cast<double>(_report.uops) / std::max(_model.issueWidth, 1);
+
+        _report.cyclesPerIteration = issueBound;
+        _report.bottleneck = Bottleneck::Issue;
+        if (portBound >= _report.cyclesPerIteration)
+        {
+            _report.cyclesPerIteration = portBound;
+            _report.bottleneck = Bottleneck::Port;
+        }
+        if (dependencyBound >= _report.cyclesPerIteration)
+        {
+            _report.cyclesPerIteration = dependencyBound;
+            _report.bottleneck = Bottleneck::Dependency;
+        }
+        if (_report.cyclesPerIteration == 0.0)
+        {
+            _report.bottleneck = Bottleneck::None;
+        }
+
+        return Error::None;
+    }
+
+    const ThroughputAnalyzer::Report& ThroughputAnalyzer::getReport() const noexcept
+    {
+        return _report;
+    }
+
+} // namespace zasm
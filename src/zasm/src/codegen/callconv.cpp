@@ -0,0 +1,50 @@
+#include "zasm/codegen/callconv.hpp"
+
+namespace zasm
+{
+    // Physical indices of the general purpose registers.
+    static constexpr std::uint32_t kGpRbx = 1U << 3;
+    static constexpr std::uint32_t kGpRsp = 1U << 4;
+    static constexpr std::uint32_t kGpRbp = 1U << 5;
+    static constexpr std::uint32_t kGpRsi = 1U << 6;
+    static constexpr std::uint32_t kGpRdi = 1U << 7;
+    static constexpr std::uint32_t kGpR12ToR15 = 0xFU << 12;
+
+    static constexpr std::uint32_t kSysVCalleeSavedGp = kGpRbx | kGpRsp | kGpRbp | kGpR12ToR15;
+    static constexpr std::uint32_t kWin64CalleeSavedGp = kSysVCalleeSavedGp | kGpRsi | kGpRdi;
+    // xmm6 to xmm15.
+    static constexpr std::uint32_t kWin64CalleeSavedXmm = 0xFFC0U;
+
+    bool isCalleeSaved(CallConv callConv, const Reg& reg) noexcept
+    {
+        if (!reg.isValid() || reg.isVirtual())
+        {
+            return false;
+        }
+
+        const auto index = reg.getPhysicalIndex();
+        if (index < 0 || index >= 32)
+        {
+            return false;
+        }
+        const auto mask = 1U << index;
+
+        if (reg.isGp())
+        {
+            const auto calleeSaved = callConv == CallConv::Win64 ? kWin64CalleeSavedGp : kSysVCalleeSavedGp;
+            return (calleeSaved & mask) != 0;
+        }
+        if (reg.isXmm())
+        {
+            return callConv == CallConv::Win64 && (kWin64CalleeSavedXmm & mask) != 0;
+        }
+
+        return false;
+    }
+
+    std::int32_t getShadowSpaceSize(CallConv callConv) noexcept
+    {
+        return callConv == CallConv::Win64 ? 32 : 0;
+    }
+
+} // namespace zasm
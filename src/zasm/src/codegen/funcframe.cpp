@@ -0,0 +1,404 @@
+#include "zasm/codegen/funcframe.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <Zydis/Zydis.h>
+#include <zasm/core/math.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/memory.hpp>
+
+namespace zasm
+{
+    static constexpr std::int8_t kRspIndex = 4;
+    static constexpr std::int8_t kRbpIndex = 5;
+
+    static x86::Gp getGp64(std::int8_t index) noexcept
+    {
+        return x86::Gp{ static_cast<Reg::Id>(ZydisRegisterEncode(ZYDIS_REGCLASS_GPR64, index)) };
+    }
+
+    static x86::Xmm getXmm(std::int8_t index) noexcept
+    {
+        return x86::Xmm{ static_cast<Reg::Id>(ZydisRegisterEncode(ZYDIS_REGCLASS_XMM, index)) };
+    }
+
+    // Instructions that modify rsp in a balanced way, the frame remains addressable through rsp.
+    static bool isStackOperation(Instruction::Mnemonic mnemonic) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Call:
+            case x86::Mnemonic::Ret:
+            case x86::Mnemonic::Push:
+            case x86::Mnemonic::Pop:
+            case x86::Mnemonic::Pushfq:
+            case x86::Mnemonic::Popfq:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    FuncFrame::FuncFrame(Program& program, CallConv callConv, Options options)
+        : _program(program)
+        , _assembler(program)
+        , _callConv(callConv)
+        , _options(options)
+    {
+    }
+
+    void FuncFrame::setOptions(Options options) noexcept
+    {
+        _options = options;
+    }
+
+    FuncFrame::Options FuncFrame::getOptions() const noexcept
+    {
+        return _options;
+    }
+
+    Error FuncFrame::setLocalSize(std::int32_t size, std::int32_t align) noexcept
+    {
+        if (size < 0 || align <= 0 || align > 16 || (align & (align - 1)) != 0)
+        {
+            return Error::InvalidParameter;
+        }
+        _localSize = size;
+        _localAlign = align;
+        return Error::None;
+    }
+
+    Error FuncFrame::run(const Label& entry, const Node* last)
+    {
+        _savedRegs.clear();
+        _localOffset = 0;
+        _frameSize = 0;
+        _stackSize = 0;
+        _hasCalls = false;
+        _hasFramePointer = false;
+
+        if (_program.getMode() != MachineMode::AMD64)
+        {
+            return Error::InvalidMode;
+        }
+
+        const auto labelData = _program.getLabelData(entry);
+        if (!labelData.hasValue())
+        {
+            return labelData.error();
+        }
+        const auto* entryNode = labelData.value().node;
+        if (entryNode == nullptr)
+        {
+            return Error::LabelNotFound;
+        }
+
+        std::uint32_t clobberedGp = 0;
+        std::uint32_t clobberedVec = 0;
+        bool modifiesRsp = false;
+        bool branchesToEntry = false;
+        std::vector<const Node*> returns;
+
+        for (const auto* node = entryNode->getNext(); node != nullptr; node = node->getNext())
+        {
+            if (node->holds<Section>())
+            {
+                break;
+            }
+
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                const auto mnemonic = instr->getMnemonic();
+                if (x86::isCall(mnemonic))
+                {
+                    _hasCalls = true;
+                }
+                else if (x86::isBranch(mnemonic))
+                {
+                    const auto* target = instr->getOperandIf<Label>(0);
+                    branchesToEntry |= target != nullptr && target->getId() == entry.getId();
+                }
+                else if (static_cast<x86::Mnemonic>(mnemonic) == x86::Mnemonic::Ret)
+                {
+                    returns.push_back(node);
+                }
+
+                for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+                {
+                    const auto* reg = instr->getOperandIf<Reg>(i);
+                    if (reg == nullptr || !reg->isValid() || reg->isVirtual())
+                    {
+                        continue;
+                    }
+
+                    // Without meta data every register operand is assumed to be written.
+                    const auto access = instr->isMetaDataValid() ? instr->getOperandAccess(i) : Operand::Access::Write;
+                    if ((access & Operand::Access::MaskWrite) == Operand::Access::None)
+                    {
+                        continue;
+                    }
+
+                    const auto index = reg->getPhysicalIndex();
+                    if (index < 0 || index >= 32)
+                    {
+                        continue;
+                    }
+                    if (reg->isGp())
+                    {
+                        if (index == kRspIndex)
+                        {
+                            modifiesRsp |= !isStackOperation(mnemonic);
+                            continue;
+                        }
+                        clobberedGp |= 1U << index;
+                    }
+                    else if (reg->isXmm() || reg->isYmm() || reg->isZmm())
+                    {
+                        clobberedVec |= 1U << index;
+                    }
+                }
+            }
+
+            if (node == last)
+            {
+                break;
+            }
+        }
+
+        _hasFramePointer = modifiesRsp || (_options & Options::PreserveFramePointer) != Options::None;
+        if (_hasFramePointer && (clobberedGp & (1U << kRbpIndex)) != 0)
+        {
+            return Error::InvalidOperation;
+        }
+
+        std::vector<std::int8_t> savedGp;
+        std::vector<std::int8_t> savedXmm;
+        for (std::int8_t index = 0; index < 16; ++index)
+        {
+            if ((clobberedGp & (1U << index)) != 0 && isCalleeSaved(_callConv, getGp64(index)))
+            {
+                savedGp.push_back(index);
+            }
+            if ((clobberedVec & (1U << index)) != 0 && isCalleeSaved(_callConv, getXmm(index)))
+            {
+                savedXmm.push_back(index);
+            }
+        }
+
+        const bool movSaves = (_options & Options::MovSaves) != Options::None;
+
+        // Win64 reserves the shadow space also for locals so they start at the same offset as the spill slots
+        // of the register allocator.
+        const auto shadowSpace = (_hasCalls || _localSize != 0) ? getShadowSpaceSize(_callConv) : 0;
+
+        _localOffset = math::alignTo<std::int32_t>(shadowSpace, _localAlign);
+        auto size = _localOffset + _localSize;
+
+        std::int32_t xmmOffset = 0;
+        if (!savedXmm.empty())
+        {
+            xmmOffset = math::alignTo<std::int32_t>(size, 16);
+            size = xmmOffset + static_cast<std::int32_t>(savedXmm.size()) * 16;
+        }
+
+        std::int32_t gpOffset = 0;
+        if (movSaves && !savedGp.empty())
+        {
+            gpOffset = math::alignTo<std::int32_t>(size, 8);
+            size = gpOffset + static_cast<std::int32_t>(savedGp.size()) * 8;
+        }
+
+        const auto pushCount = static_cast<std::int32_t>((_hasFramePointer ? 1 : 0) + (movSaves ? 0 : savedGp.size()));
+        const auto pushSize = pushCount * 8;
+
+        // Leaf functions without aligned saves or locals do not need the padding.
+        const bool needsAlignment = _hasCalls || !savedXmm.empty() || (_localAlign == 16 && _localSize != 0);
+        if (needsAlignment)
+        {
+            // The return address misaligns rsp by 8 on entry.
+            const auto total = 8 + pushSize + size;
+            size += math::alignTo<std::int32_t>(total, 16) - total;
+        }
+        else
+        {
+            size = math::alignTo<std::int32_t>(size, 8);
+        }
+
+        _frameSize = size;
+        _stackSize = pushSize + size;
+
+        for (const auto index : savedGp)
+        {
+            _savedRegs.push_back(getGp64(index));
+        }
+        for (const auto index : savedXmm)
+        {
+            _savedRegs.push_back(getXmm(index));
+        }
+
+        if (_stackSize == 0)
+        {
+            return Error::None;
+        }
+        if (branchesToEntry)
+        {
+            // The prologue would be executed again.
+            return Error::InvalidOperation;
+        }
+
+        // Prologue.
+        _assembler.setCursor(entryNode);
+        if (_hasFramePointer)
+        {
+            if (auto err = _assembler.push(x86::rbp); err != Error::None)
+            {
+                return err;
+            }
+            if (auto err = _assembler.mov(x86::rbp, x86::rsp); err != Error::None)
+            {
+                return err;
+            }
+        }
+        if (!movSaves)
+        {
+            for (const auto index : savedGp)
+            {
+                if (auto err = _assembler.push(getGp64(index)); err != Error::None)
+                {
+                    return err;
+                }
+            }
+        }
+        if (_frameSize != 0)
+        {
+            if (auto err = _assembler.sub(x86::rsp, Imm(_frameSize)); err != Error::None)
+            {
+                return err;
+            }
+        }
+        for (std::size_t i = 0; i < savedXmm.size(); ++i)
+        {
+            const auto disp = xmmOffset + static_cast<std::int32_t>(i) * 16;
+            if (auto err = _assembler.movdqa(x86::xmmword_ptr(x86::rsp, disp), getXmm(savedXmm[i])); err != Error::None)
+            {
+                return err;
+            }
+        }
+        if (movSaves)
+        {
+            for (std::size_t i = 0; i < savedGp.size(); ++i)
+            {
+                const auto disp = gpOffset + static_cast<std::int32_t>(i) * 8;
+                if (auto err = _assembler.mov(x86::qword_ptr(x86::rsp, disp), getGp64(savedGp[i])); err != Error::None)
+                {
+                    return err;
+                }
+            }
+        }
+
+        // With a frame pointer rsp is unknown at the ret, the save area is addressed through rbp.
+        const auto pushesAfterRbp = movSaves ? 0 : static_cast<std::int32_t>(savedGp.size()) * 8;
+        const auto base = _hasFramePointer ? x86::rbp : x86::rsp;
+        const auto baseOffset = _hasFramePointer ? -(pushesAfterRbp + _frameSize) : 0;
+
+        // Epilogues.
+        for (const auto* ret : returns)
+        {
+            _assembler.setCursor(ret->getPrev());
+
+            for (std::size_t i = 0; i < savedXmm.size(); ++i)
+            {
+                const auto disp = baseOffset + xmmOffset + static_cast<std::int32_t>(i) * 16;
+                if (auto err = _assembler.movdqa(getXmm(savedXmm[i]), x86::xmmword_ptr(base, disp)); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            if (movSaves)
+            {
+                for (std::size_t i = 0; i < savedGp.size(); ++i)
+                {
+                    const auto disp = baseOffset + gpOffset + static_cast<std::int32_t>(i) * 8;
+                    if (auto err = _assembler.mov(getGp64(savedGp[i]), x86::qword_ptr(base, disp)); err != Error::None)
+                    {
+                        return err;
+                    }
+                }
+            }
+
+            if (_hasFramePointer)
+            {
+                if (pushesAfterRbp != 0)
+                {
+                    if (auto err = _assembler.lea(x86::rsp, x86::qword_ptr(x86::rbp, -pushesAfterRbp)); err != Error::None)
+                    {
+                        return err;
+                    }
+                }
+                else if (auto err = _assembler.mov(x86::rsp, x86::rbp); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            else if (_frameSize != 0)
+            {
+                if (auto err = _assembler.add(x86::rsp, Imm(_frameSize)); err != Error::None)
+                {
+                    return err;
+                }
+            }
+
+            if (!movSaves)
+            {
+                for (auto it = savedGp.rbegin(); it != savedGp.rend(); ++it)
+                {
+                    if (auto err = _assembler.pop(getGp64(*it)); err != Error::None)
+                    {
+                        return err;
+                    }
+                }
+            }
+            if (_hasFramePointer)
+            {
+                if (auto err = _assembler.pop(x86::rbp); err != Error::None)
+                {
+                    return err;
+                }
+            }
+        }
+
+        return Error::None;
+    }
+
+    const std::vector<Reg>& FuncFrame::getSavedRegs() const noexcept
+    {
+        return _savedRegs;
+    }
+
+    std::int32_t FuncFrame::getLocalOffset() const noexcept
+    {
+        return _localOffset;
+    }
+
+    std::int32_t FuncFrame::getFrameSize() const noexcept
+    {
+        return _frameSize;
+    }
+
+    std::int32_t FuncFrame::getStackSize() const noexcept
+    {
+        return _stackSize;
+    }
+
+    bool FuncFrame::hasCalls() const noexcept
+    {
+        return _hasCalls;
+    }
+
+    bool FuncFrame::hasFramePointer() const noexcept
+    {
+        return _hasFramePointer;
+    }
+
+} // namespace zasm
@@ -0,0 +1,972 @@
+#include "zasm/codegen/registerallocator.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <Zydis/Zydis.h>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+#include <zasm/core/math.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/memory.hpp>
+
+namespace zasm
+{
+    static constexpr std::uint32_t kNoPos = std::numeric_limits<std::uint32_t>::max();
+
+    static constexpr std::size_t kGpClass = 0;
+    static constexpr std::size_t kVecClass = 1;
+    static constexpr std::size_t kNumClasses = 2;
+
+    // Caller-saved registers first so leaf code does not need to save anything, rsp and rbp are never assigned.
+    static constexpr std::array<std::int8_t, 14> kGpOrder = { 0, 1, 2, 6, 7, 8, 9, 10, 11, 3, 12, 13, 14, 15 };
+    static constexpr std::array<std::int8_t, 16> kVecOrder = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    // An instruction has at most three distinct registers of a class that need a reload, ex.: lea v0, [v1+v2].
+    static constexpr std::size_t kScratchCount = 3;
+
+    namespace
+    {
+        struct Interval
+        {
+            std::uint32_t start{ kNoPos };
+            std::uint32_t end{};
+            std::size_t cls{};
+            std::int8_t reg{ -1 };
+            // The first occurrence reads the value, it may be live on entry of a surrounding loop.
+            bool firstIsUse{};
+            bool crossesCall{};
+            bool spilled{};
+        };
+
+        // Position range of a backward branch, from the target label to the branch.
+        struct LoopRange
+        {
+            std::uint32_t from{};
+            std::uint32_t to{};
+        };
+
+        struct ClassInfo
+        {
+            const std::int8_t* order{};
+            std::size_t orderSize{};
+            // Registers that may be assigned.
+            std::uint32_t allowed{};
+            // Registers preserved across calls.
+            std::uint32_t calleeSaved{};
+            std::array<std::int8_t, kScratchCount> scratch{};
+            std::size_t scratchCount{};
+            bool scratchReserved{};
+        };
+
+        struct SpillUse
+        {
+            Reg reg{};
+            Reg scratch{};
+            bool read{};
+            bool write{};
+            bool inMem{};
+            std::size_t count{};
+        };
+    } // namespace
+
+    static std::size_t getClassIndex(Reg::VirtualClass cls) noexcept
+    {
+        return cls == Reg::VirtualClass::Vec ? kVecClass : kGpClass;
+    }
+
+    static Reg getPhysicalReg(Reg::VirtualClass cls, std::int8_t index, BitSize size) noexcept
+    {
+        if (cls == Reg::VirtualClass::Gp)
+        {
+            const auto root = x86::Gp{ static_cast<Reg::Id>(ZydisRegisterEncode(ZYDIS_REGCLASS_GPR64, index)) };
+            switch (size)
+            {
+                case BitSize::_8:
+                    return root.r8();
+                case BitSize::_16:
+                    return root.r16();
+                case BitSize::_32:
+                    return root.r32();
+                default:
+                    break;
+            }
+            return root;
+        }
+
+        auto regClass = ZYDIS_REGCLASS_XMM;
+        if (size == BitSize::_256)
+        {
+            regClass = ZYDIS_REGCLASS_YMM;
+        }
+        else if (size == BitSize::_512)
+        {
+            regClass = ZYDIS_REGCLASS_ZMM;
+        }
+        return Reg{ static_cast<Reg::Id>(ZydisRegisterEncode(regClass, index)) };
+    }
+
+    static std::int32_t getSlotSize(Reg::VirtualClass cls, BitSize size) noexcept
+    {
+        // General purpose slots are always 8 bytes to keep them aligned.
+        if (cls == Reg::VirtualClass::Gp)
+        {
+            return 8;
+        }
+        return getBitSize(size) / 8;
+    }
+
+    // Instructions that behave differently with a memory operand.
+    static bool allowsSpillOperand(Instruction::Mnemonic mnemonic) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Bt:
+            case x86::Mnemonic::Btc:
+            case x86::Mnemonic::Btr:
+            case x86::Mnemonic::Bts:
+            case x86::Mnemonic::Pop:
+            case x86::Mnemonic::Xchg:
+                return false;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    static bool hasVirtualRegs(const Instruction& instr) noexcept
+    {
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = instr.getOperand(i);
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr && reg->isVirtual())
+            {
+                return true;
+            }
+            if (const auto* mem = op.getIf<Mem>(); mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static Operand::Access getAccess(const Instruction& instr, std::size_t index) noexcept
+    {
+        if (!instr.isMetaDataValid())
+        {
+            return Operand::Access::ReadWrite;
+        }
+        return instr.getOperandAccess(index);
+    }
+
+    static bool isUse(Operand::Access access) noexcept
+    {
+        // A conditional write keeps the previous value.
+        return (access & (Operand::Access::MaskRead | Operand::Access::CondWrite)) != Operand::Access::None;
+    }
+
+    static bool isDef(Operand::Access access) noexcept
+    {
+        return (access & Operand::Access::MaskWrite) != Operand::Access::None;
+    }
+
+    RegisterAllocator::RegisterAllocator(Program& program, CallConv callConv)
+        : _program(program)
+        , _assembler(program)
+        , _callConv(callConv)
+    {
+    }
+
+    void RegisterAllocator::setManageFrame(bool manageFrame) noexcept
+    {
+        _manageFrame = manageFrame;
+    }
+
+    bool RegisterAllocator::getManageFrame() const noexcept
+    {
+        return _manageFrame;
+    }
+
+    Error RegisterAllocator::run()
+    {
+        _stats = {};
+        _assignments.clear();
+        _spillSlots.clear();
+        _spillAreaSize = 0;
+
+        if (_program.getMode() != MachineMode::AMD64)
+        {
+            return Error::InvalidMode;
+        }
+
+        const auto regCount = _program.getVirtualRegCount();
+        if (regCount == 0)
+        {
+            return Error::None;
+        }
+
+        std::vector<Interval> intervals(regCount);
+        for (std::size_t i = 0; i < regCount; ++i)
+        {
+            intervals[i].cls = getClassIndex(_program.getVirtualRegClass(Reg::fromVirtualIndex(i)));
+        }
+
+        std::vector<std::uint32_t> labelPos;
+        std::vector<std::uint32_t> labelPositions;
+        std::vector<std::pair<std::uint32_t, Label::Id>> branches;
+        std::vector<std::uint32_t> indirectJumps;
+        std::vector<Label::Id> embeddedTargets;
+        std::vector<std::uint32_t> calls;
+        std::vector<const Node*> returns;
+
+        // Physical registers used by the program, rsp and rbp are always excluded.
+        std::array<std::uint32_t, kNumClasses> reserved{ (1U << 4) | (1U << 5), 0 };
+
+        const Node* entryNode = nullptr;
+        std::uint32_t entryPos = kNoPos;
+
+        const auto touch = [&](const Reg& reg, std::uint32_t pos, bool use) {
+            auto& interval = intervals[reg.getVirtualIndex()];
+            if (interval.start == kNoPos)
+            {
+                interval.start = pos;
+                interval.firstIsUse = use;
+            }
+            else if (interval.start == pos)
+            {
+                interval.firstIsUse |= use;
+            }
+            interval.end = pos;
+        };
+
+        const auto reserve = [&](const Reg& reg) {
+            if (!reg.isValid() || reg.isVirtual())
+            {
+                return;
+            }
+            const auto index = reg.getPhysicalIndex();
+            if (index < 0 || index >= 32)
+            {
+                return;
+            }
+            if (reg.isGp())
+            {
+                reserved[kGpClass] |= 1U << index;
+            }
+            else if (reg.isXmm() || reg.isYmm() || reg.isZmm())
+            {
+                reserved[kVecClass] |= 1U << index;
+            }
+        };
+
+        const auto isKnownReg = [&](const Reg& reg) { return reg.getVirtualIndex() < regCount; };
+
+        std::uint32_t pos = 0;
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext(), pos += 2)
+        {
+            if (const auto* label = node->getIf<Label>(); label != nullptr)
+            {
+                const auto labelIdx = static_cast<std::size_t>(label->getId());
+                if (labelIdx >= labelPos.size())
+                {
+                    labelPos.resize(labelIdx + 1, kNoPos);
+                }
+                labelPos[labelIdx] = pos;
+                labelPositions.push_back(pos);
+                continue;
+            }
+            if (const auto* embedded = node->getIf<EmbeddedLabel>(); embedded != nullptr)
+            {
+                embeddedTargets.push_back(embedded->getLabel().getId());
+                continue;
+            }
+
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr)
+            {
+                continue;
+            }
+
+            if (entryNode == nullptr)
+            {
+                entryNode = node;
+                entryPos = pos;
+            }
+
+            for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+            {
+                const auto& op = instr->getOperand(i);
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                {
+                    if (!reg->isVirtual())
+                    {
+                        reserve(*reg);
+                        continue;
+                    }
+                    if (!isKnownReg(*reg))
+                    {
+                        return Error::InvalidOperation;
+                    }
+                    touch(*reg, pos, isUse(getAccess(*instr, i)));
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    for (const auto& reg : { mem->getBase(), mem->getIndex() })
+                    {
+                        if (!reg.isVirtual())
+                        {
+                            reserve(reg);
+                            continue;
+                        }
+                        if (!isKnownReg(reg))
+                        {
+                            return Error::InvalidOperation;
+                        }
+                        touch(reg, pos, true);
+                    }
+                }
+            }
+
+            const auto mnemonic = instr->getMnemonic();
+            if (x86::isCall(mnemonic))
+            {
+                calls.push_back(pos);
+            }
+            else if (x86::isBranch(mnemonic))
+            {
+                if (const auto* target = instr->getOperandIf<Label>(0); target != nullptr)
+                {
+                    branches.emplace_back(pos, target->getId());
+                }
+                else
+                {
+                    indirectJumps.push_back(pos);
+                }
+            }
+            else if (static_cast<x86::Mnemonic>(mnemonic) == x86::Mnemonic::Ret)
+            {
+                returns.push_back(node);
+            }
+        }
+
+        const auto getLabelPos = [&](Label::Id id) {
+            const auto idx = static_cast<std::size_t>(id);
+            return idx < labelPos.size() ? labelPos[idx] : kNoPos;
+        };
+
+        // Backward branches form the loops, jump tables can target any of their labels.
+        std::vector<LoopRange> loops;
+        bool branchesToEntry = false;
+        for (const auto& [branchPos, target] : branches)
+        {
+            const auto targetPos = getLabelPos(target);
+            if (targetPos == kNoPos || targetPos > branchPos)
+            {
+                continue;
+            }
+            branchesToEntry |= targetPos <= entryPos;
+            loops.push_back({ targetPos, branchPos });
+        }
+        if (!indirectJumps.empty())
+        {
+            std::sort(embeddedTargets.begin(), embeddedTargets.end());
+            embeddedTargets.erase(std::unique(embeddedTargets.begin(), embeddedTargets.end()), embeddedTargets.end());
+            for (const auto jumpPos : indirectJumps)
+            {
+                for (const auto target : embeddedTargets)
+                {
+                    const auto targetPos = getLabelPos(target);
+                    if (targetPos == kNoPos || targetPos > jumpPos)
+                    {
+                        continue;
+                    }
+                    branchesToEntry |= targetPos <= entryPos;
+                    loops.push_back({ targetPos, jumpPos });
+                }
+            }
+        }
+
+        // Labels within an interval are join points, the first definition might not be executed on every path.
+        const auto hasLabelWithin = [&](std::uint32_t from, std::uint32_t to) {
+            const auto it = std::upper_bound(labelPositions.begin(), labelPositions.end(), from);
+            return it != labelPositions.end() && *it <= to;
+        };
+
+        // Values live at the loop header or at the backward branch have to stay live for the entire loop.
+        for (bool changed = !loops.empty(); changed;)
+        {
+            changed = false;
+            for (const auto& loop : loops)
+            {
+                for (auto& interval : intervals)
+                {
+                    if (interval.start == kNoPos || interval.end < loop.from || interval.start > loop.to)
+                    {
+                        continue;
+                    }
+                    if (interval.start < loop.from)
+                    {
+                        if (interval.end < loop.to)
+                        {
+                            interval.end = loop.to;
+                            changed = true;
+                        }
+                        continue;
+                    }
+                    if (!interval.firstIsUse && !hasLabelWithin(interval.start, interval.end))
+                    {
+                        continue;
+                    }
+                    if (interval.start != loop.from || interval.end < loop.to)
+                    {
+                        interval.start = loop.from;
+                        interval.end = std::max(interval.end, loop.to);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        std::vector<std::uint32_t> order;
+        order.reserve(regCount);
+        for (std::size_t i = 0; i < regCount; ++i)
+        {
+            auto& interval = intervals[i];
+            if (interval.start == kNoPos)
+            {
+                continue;
+            }
+            const auto it = std::upper_bound(calls.begin(), calls.end(), interval.start);
+            interval.crossesCall = it != calls.end() && *it < interval.end;
+            order.push_back(static_cast<std::uint32_t>(i));
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+            return intervals[lhs].start < intervals[rhs].start;
+        });
+
+        _stats.virtualRegs = order.size();
+
+        std::array<ClassInfo, kNumClasses> classes{};
+        classes[kGpClass].order = kGpOrder.data();
+        classes[kGpClass].orderSize = kGpOrder.size();
+        classes[kVecClass].order = kVecOrder.data();
+        classes[kVecClass].orderSize = kVecOrder.size();
+
+        for (std::size_t cls = 0; cls < kNumClasses; ++cls)
+        {
+            auto& info = classes[cls];
+            const auto regCls = cls == kGpClass ? Reg::VirtualClass::Gp : Reg::VirtualClass::Vec;
+            for (std::size_t i = 0; i < info.orderSize; ++i)
+            {
+                const auto index = info.order[i];
+                const auto mask = 1U << index;
+                if ((reserved[cls] & mask) != 0)
+                {
+                    continue;
+                }
+                const bool calleeSaved = isCalleeSaved(_callConv, getPhysicalReg(regCls, index, BitSize::_128));
+                // Callee-saved registers have to be saved by the managed frame, Win64 vector registers are never saved.
+                if (calleeSaved && (!_manageFrame || cls == kVecClass))
+                {
+                    continue;
+                }
+                info.allowed |= mask;
+                if (calleeSaved)
+                {
+                    info.calleeSaved |= mask;
+                }
+            }
+            // The scratch registers are taken from the end of the caller-saved registers.
+            for (std::size_t i = info.orderSize; i-- > 0 && info.scratchCount < kScratchCount;)
+            {
+                const auto index = info.order[i];
+                const auto mask = 1U << index;
+                if ((info.allowed & mask) != 0 && (info.calleeSaved & mask) == 0)
+                {
+                    info.scratch[info.scratchCount++] = index;
+                }
+            }
+        }
+
+        // Runs the linear scan, the scratch registers are only reserved for classes that need to spill.
+        while (true)
+        {
+            std::array<std::vector<std::uint32_t>, kNumClasses> active;
+            std::array<std::uint32_t, kNumClasses> freeRegs{};
+            for (std::size_t cls = 0; cls < kNumClasses; ++cls)
+            {
+                freeRegs[cls] = classes[cls].allowed;
+                if (classes[cls].scratchReserved)
+                {
+                    for (std::size_t i = 0; i < classes[cls].scratchCount; ++i)
+                    {
+                        freeRegs[cls] &= ~(1U << classes[cls].scratch[i]);
+                    }
+                }
+            }
+
+            for (const auto idx : order)
+            {
+                auto& interval = intervals[idx];
+                interval.reg = -1;
+                interval.spilled = false;
+
+                const auto cls = interval.cls;
+                const auto& info = classes[cls];
+                auto& act = active[cls];
+
+                for (std::size_t i = 0; i < act.size();)
+                {
+                    const auto& other = intervals[act[i]];
+                    if (other.end < interval.start)
+                    {
+                        freeRegs[cls] |= 1U << other.reg;
+                        act[i] = act.back();
+                        act.pop_back();
+                        continue;
+                    }
+                    ++i;
+                }
+
+                const auto candidates = interval.crossesCall ? info.calleeSaved : ~0U;
+
+                for (std::size_t i = 0; i < info.orderSize; ++i)
+                {
+                    const auto mask = 1U << info.order[i];
+                    if ((freeRegs[cls] & candidates & mask) != 0)
+                    {
+                        interval.reg = info.order[i];
+                        freeRegs[cls] &= ~mask;
+                        break;
+                    }
+                }
+                if (interval.reg != -1)
+                {
+                    act.push_back(idx);
+                    continue;
+                }
+
+                // Spill the interval that ends last, either an active one with a suitable register or this one.
+                std::size_t victim = act.size();
+                for (std::size_t i = 0; i < act.size(); ++i)
+                {
+                    const auto& other = intervals[act[i]];
+                    if ((candidates & (1U << other.reg)) == 0)
+                    {
+                        continue;
+                    }
+                    if (victim == act.size() || other.end > intervals[act[victim]].end)
+                    {
+                        victim = i;
+                    }
+                }
+                if (victim != act.size() && intervals[act[victim]].end > interval.end)
+                {
+                    auto& other = intervals[act[victim]];
+                    interval.reg = other.reg;
+                    other.reg = -1;
+                    other.spilled = true;
+                    act[victim] = idx;
+                }
+                else
+                {
+                    interval.spilled = true;
+                }
+            }
+
+            bool rerun = false;
+            for (const auto idx : order)
+            {
+                auto& info = classes[intervals[idx].cls];
+                if (intervals[idx].spilled && !info.scratchReserved)
+                {
+                    info.scratchReserved = true;
+                    rerun = true;
+                }
+            }
+            if (!rerun)
+            {
+                break;
+            }
+        }
+
+        // Spill slots, intervals that do not overlap share slots of the same size.
+        const bool hasCalls = !calls.empty();
+        const auto shadowSpace = (hasCalls || !_manageFrame) ? getShadowSpaceSize(_callConv) : 0;
+
+        _assignments.resize(regCount);
+        _spillSlots.resize(regCount, -1);
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> activeSlots;
+        std::vector<std::pair<std::int32_t, std::int32_t>> freeSlots;
+        std::uint32_t savedRegs = 0;
+
+        for (const auto idx : order)
+        {
+            const auto& interval = intervals[idx];
+            const auto reg = Reg::fromVirtualIndex(idx);
+            const auto regCls = _program.getVirtualRegClass(reg);
+            const auto regSize = _program.getVirtualRegSize(reg);
+
+            if (!interval.spilled)
+            {
+                _assignments[idx] = getPhysicalReg(regCls, interval.reg, regSize);
+                if ((classes[interval.cls].calleeSaved & (1U << interval.reg)) != 0)
+                {
+                    savedRegs |= 1U << interval.reg;
+                }
+                continue;
+            }
+
+            _stats.spilledRegs++;
+
+            for (std::size_t i = 0; i < activeSlots.size();)
+            {
+                const auto other = activeSlots[i].first;
+                if (intervals[other].end < interval.start)
+                {
+                    const auto otherReg = Reg::fromVirtualIndex(other);
+                    const auto otherSize = getSlotSize(_program.getVirtualRegClass(otherReg), _program.getVirtualRegSize(otherReg));
+                    freeSlots.emplace_back(otherSize, static_cast<std::int32_t>(activeSlots[i].second));
+                    activeSlots[i] = activeSlots.back();
+                    activeSlots.pop_back();
+                    continue;
+                }
+                ++i;
+            }
+
+            const auto slotSize = getSlotSize(regCls, regSize);
+            std::int32_t offset = -1;
+            for (std::size_t i = 0; i < freeSlots.size(); ++i)
+            {
+                if (freeSlots[i].first == slotSize)
+                {
+                    offset = freeSlots[i].second;
+                    freeSlots[i] = freeSlots.back();
+                    freeSlots.pop_back();
+                    break;
+                }
+            }
+            if (offset == -1)
+            {
+                offset = math::alignTo<std::int32_t>(_spillAreaSize, std::min<std::int32_t>(slotSize, 16));
+                _spillAreaSize = offset + slotSize;
+            }
+            activeSlots.emplace_back(idx, static_cast<std::uint32_t>(offset));
+
+            _spillSlots[idx] = shadowSpace + offset;
+        }
+
+        // Pushes keep rsp 16 byte aligned at calls, on entry rsp is 8 bytes off due to the return address.
+        std::size_t savedCount = 0;
+        for (auto mask = savedRegs; mask != 0; mask &= mask - 1)
+        {
+            savedCount++;
+        }
+        const auto pushSize = static_cast<std::int32_t>(savedCount * 8);
+
+        std::int32_t frameSize = 0;
+        if (_manageFrame && (savedCount != 0 || _spillAreaSize != 0 || shadowSpace != 0))
+        {
+            frameSize = math::alignTo<std::int32_t>(shadowSpace + _spillAreaSize + pushSize + 8, 16) - pushSize - 8;
+        }
+        if (_manageFrame && (savedCount != 0 || frameSize != 0) && branchesToEntry)
+        {
+            // The prologue would be executed again.
+            return Error::InvalidOperation;
+        }
+
+        if (_manageFrame && (savedCount != 0 || frameSize != 0))
+        {
+            _assembler.setCursor(entryNode->getPrev());
+            for (std::int8_t index = 0; index < 16; ++index)
+            {
+                if ((savedRegs & (1U << index)) == 0)
+                {
+                    continue;
+                }
+                const auto reg = getPhysicalReg(Reg::VirtualClass::Gp, index, BitSize::_64);
+                if (auto err = _assembler.push(x86::Gp(reg.getId())); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            if (frameSize != 0)
+            {
+                if (auto err = _assembler.sub(x86::rsp, Imm(frameSize)); err != Error::None)
+                {
+                    return err;
+                }
+            }
+
+            for (const auto* ret : returns)
+            {
+                _assembler.setCursor(ret->getPrev());
+                if (frameSize != 0)
+                {
+                    if (auto err = _assembler.add(x86::rsp, Imm(frameSize)); err != Error::None)
+                    {
+                        return err;
+                    }
+                }
+                for (std::int8_t index = 15; index >= 0; --index)
+                {
+                    if ((savedRegs & (1U << index)) == 0)
+                    {
+                        continue;
+                    }
+                    const auto reg = getPhysicalReg(Reg::VirtualClass::Gp, index, BitSize::_64);
+                    if (auto err = _assembler.pop(x86::Gp(reg.getId())); err != Error::None)
+                    {
+                        return err;
+                    }
+                }
+            }
+
+            _stats.savedRegs = savedCount;
+            _stats.frameSize = frameSize;
+        }
+
+        const auto getSpillMem = [&](const Reg& reg) {
+            const auto idx = reg.getVirtualIndex();
+            return x86::ptr(_program.getVirtualRegSize(reg), x86::rsp, _spillSlots[idx]);
+        };
+
+        const auto emitSpillMove = [&](const Reg& reg, const Reg& scratch, bool load) -> Error {
+            const auto mem = getSpillMem(reg);
+            auto mnemonic = x86::Mnemonic::Mov;
+            if (_program.getVirtualRegClass(reg) == Reg::VirtualClass::Vec)
+            {
+                switch (_program.getVirtualRegSize(reg))
+                {
+                    case BitSize::_128:
+                        mnemonic = x86::Mnemonic::Movdqu;
+                        break;
+                    case BitSize::_256:
+                        mnemonic = x86::Mnemonic::Vmovdqu;
+                        break;
+                    default:
+                        mnemonic = x86::Mnemonic::Vmovdqu64;
+                        break;
+                }
+            }
+            if (load)
+            {
+                return _assembler.emit(mnemonic, scratch, mem);
+            }
+            return _assembler.emit(mnemonic, mem, scratch);
+        };
+
+        // Rewrite the instructions, nodes are replaced because they are immutable.
+        const Node* next = nullptr;
+        for (const auto* node = _program.getHead(); node != nullptr; node = next)
+        {
+            next = node->getNext();
+
+            const auto* instrPtr = node->getIf<Instruction>();
+            if (instrPtr == nullptr || !hasVirtualRegs(*instrPtr))
+            {
+                continue;
+            }
+
+            auto instr = *instrPtr;
+
+            std::array<SpillUse, ZYDIS_ENCODER_MAX_OPERANDS * 2> spills{};
+            std::size_t spillCount = 0;
+            std::size_t memOperands = 0;
+
+            const auto addSpill = [&](const Reg& reg, bool read, bool write, bool inMem) {
+                for (std::size_t i = 0; i < spillCount; ++i)
+                {
+                    if (spills[i].reg == reg)
+                    {
+                        spills[i].read |= read;
+                        spills[i].write |= write;
+                        spills[i].inMem |= inMem;
+                        spills[i].count++;
+                        return;
+                    }
+                }
+                spills[spillCount++] = { reg, Reg{}, read, write, inMem, 1 };
+            };
+
+            for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                const auto& op = instr.getOperand(i);
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                {
+                    if (!reg->isVirtual())
+                    {
+                        continue;
+                    }
+                    const auto& assigned = _assignments[reg->getVirtualIndex()];
+                    if (assigned.isValid())
+                    {
+                        instr.setOperand(i, assigned);
+                    }
+                    else
+                    {
+                        const auto access = getAccess(instr, i);
+                        addSpill(*reg, isUse(access), isDef(access), false);
+                    }
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    memOperands++;
+                    auto newMem = *mem;
+                    for (const auto& reg : { mem->getBase(), mem->getIndex() })
+                    {
+                        if (!reg.isVirtual())
+                        {
+                            continue;
+                        }
+                        const auto& assigned = _assignments[reg.getVirtualIndex()];
+                        if (!assigned.isValid())
+                        {
+                            addSpill(reg, true, false, true);
+                            continue;
+                        }
+                        if (reg == mem->getBase())
+                        {
+                            newMem.setBase(assigned);
+                        }
+                        if (reg == mem->getIndex())
+                        {
+                            newMem.setIndex(assigned);
+                        }
+                    }
+                    instr.setOperand(i, newMem);
+                }
+            }
+
+            _assembler.setCursor(node->getPrev());
+
+            // Try to access the slot directly, ex.: add rax, qword ptr [rsp+8]
+            if (spillCount == 1 && spills[0].count == 1 && !spills[0].inMem && memOperands == 0
+                && _program.getVirtualRegClass(spills[0].reg) == Reg::VirtualClass::Gp
+                && allowsSpillOperand(instr.getMnemonic()))
+            {
+                auto memInstr = instr;
+                for (std::size_t i = 0; i < memInstr.getOperandCount(); ++i)
+                {
+                    if (const auto* reg = std::as_const(memInstr).getOperandIf<Reg>(i); reg != nullptr && *reg == spills[0].reg)
+                    {
+                        memInstr.setOperand(i, getSpillMem(spills[0].reg));
+                        break;
+                    }
+                }
+                if (_assembler.emit(memInstr) == Error::None)
+                {
+                    _program.destroy(node);
+                    _stats.memoryOperands++;
+                    continue;
+                }
+            }
+
+            std::array<std::size_t, kNumClasses> scratchUsed{};
+            for (std::size_t i = 0; i < spillCount; ++i)
+            {
+                auto& spill = spills[i];
+                const auto cls = _program.getVirtualRegClass(spill.reg);
+                const auto& info = classes[getClassIndex(cls)];
+                auto& used = scratchUsed[getClassIndex(cls)];
+                if (used >= info.scratchCount)
+                {
+                    return Error::OutOfRegisters;
+                }
+                spill.scratch = getPhysicalReg(cls, info.scratch[used++], _program.getVirtualRegSize(spill.reg));
+            }
+
+            const auto getScratch = [&](const Reg& reg) {
+                for (std::size_t i = 0; i < spillCount; ++i)
+                {
+                    if (spills[i].reg == reg)
+                    {
+                        return spills[i].scratch;
+                    }
+                }
+                return reg;
+            };
+
+            for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                const auto& op = instr.getOperand(i);
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr && reg->isVirtual())
+                {
+                    instr.setOperand(i, getScratch(*reg));
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    auto newMem = *mem;
+                    newMem.setBase(getScratch(mem->getBase()));
+                    newMem.setIndex(getScratch(mem->getIndex()));
+                    instr.setOperand(i, newMem);
+                }
+            }
+
+            for (std::size_t i = 0; i < spillCount; ++i)
+            {
+                if (!spills[i].read)
+                {
+                    continue;
+                }
+                if (auto err = emitSpillMove(spills[i].reg, spills[i].scratch, true); err != Error::None)
+                {
+                    return err;
+                }
+                _stats.spillLoads++;
+            }
+
+            const auto* newNode = _program.createNode(std::move(instr));
+            _assembler.setCursor(_program.insertAfter(_assembler.getCursor(), newNode));
+
+            for (std::size_t i = 0; i < spillCount; ++i)
+            {
+                if (!spills[i].write)
+                {
+                    continue;
+                }
+                if (auto err = emitSpillMove(spills[i].reg, spills[i].scratch, false); err != Error::None)
+                {
+                    return err;
+                }
+                _stats.spillStores++;
+            }
+
+            _program.destroy(node);
+        }
+
+        return Error::None;
+    }
+
+    Reg RegisterAllocator::getAssignment(const Reg& reg) const noexcept
+    {
+        if (!reg.isVirtual() || reg.getVirtualIndex() >= _assignments.size())
+        {
+            return Reg{};
+        }
+        return _assignments[reg.getVirtualIndex()];
+    }
+
+    std::int32_t RegisterAllocator::getSpillSlot(const Reg& reg) const noexcept
+    {
+        if (!reg.isVirtual() || reg.getVirtualIndex() >= _spillSlots.size())
+        {
+            return -1;
+        }
+        return _spillSlots[reg.getVirtualIndex()];
+    }
+
+    std::int32_t RegisterAllocator::getSpillAreaSize() const noexcept
+    {
+        return _spillAreaSize;
+    }
+
+    const RegisterAllocator::Stats& RegisterAllocator::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+} // namespace zasm
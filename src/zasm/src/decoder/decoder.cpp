@@ -13,6 +13,34 @@ namespace zasm
         return Reg{ static_cast<Reg::Id>(reg) };
     }
 
+    static constexpr Mem::Broadcast getBroadcast(const ZydisDecodedInstruction& instr) noexcept
+    {
+        // Static broadcasts are implied by the instruction and not encoded with EVEX.b.
+        if (instr.avx.broadcast.is_static != 0)
+        {
+            return Mem::Broadcast::None;
+        }
+
+        switch (instr.avx.broadcast.mode)
+        {
+            case ZYDIS_BROADCAST_MODE_1_TO_2:
+                return Mem::Broadcast::_1to2;
+            case ZYDIS_BROADCAST_MODE_1_TO_4:
+                return Mem::Broadcast::_1to4;
+            case ZYDIS_BROADCAST_MODE_1_TO_8:
+                return Mem::Broadcast::_1to8;
+            case ZYDIS_BROADCAST_MODE_1_TO_16:
+                return Mem::Broadcast::_1to16;
+            case ZYDIS_BROADCAST_MODE_1_TO_32:
+                return Mem::Broadcast::_1to32;
+            case ZYDIS_BROADCAST_MODE_1_TO_64:
+                return Mem::Broadcast::_1to64;
+            default:
+                break;
+        }
+        return Mem::Broadcast::None;
+    }
+
     static Operand getOperand(
         const ZydisDecodedInstruction& instr, const ZydisDecodedOperand& srcOp, std::uint64_t address) noexcept
     {
@@ -26,8 +54,11 @@ namespace zasm
         }
         if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_MEMORY)
         {
-            return Mem{ toBitSize(srcOp.size),   getReg(srcOp.mem.segment), getReg(srcOp.mem.base),
-                        getReg(srcOp.mem.index), srcOp.mem.scale,           srcOp.mem.disp.value };
+            // With broadcast the operand size is the size of a single element.
+            auto mem = Mem{ toBitSize(srcOp.size),   getReg(srcOp.mem.segment), getReg(srcOp.mem.base),
+                            getReg(srcOp.mem.index), srcOp.mem.scale,           srcOp.mem.disp.value };
+            mem.setBroadcast(getBroadcast(instr));
+            return mem;
         }
         if (srcOp.type == ZydisOperandType::ZYDIS_OPERAND_TYPE_IMMEDIATE)
         {
@@ -74,6 +105,38 @@ namespace zasm
         return res;
     }
 
+    static constexpr Instruction::Attribs getEvexAttribs(const ZydisDecodedInstruction& instr) noexcept
+    {
+        x86::Attribs res{};
+        if (instr.avx.mask.mode == ZYDIS_MASK_MODE_ZEROING || instr.avx.mask.mode == ZYDIS_MASK_MODE_CONTROL_ZEROING)
+        {
+            res = res | x86::Attribs::Zeroing;
+        }
+        switch (instr.avx.rounding.mode)
+        {
+            case ZYDIS_ROUNDING_MODE_RN:
+                res = res | x86::Attribs::RnSae;
+                break;
+            case ZYDIS_ROUNDING_MODE_RD:
+                res = res | x86::Attribs::RdSae;
+                break;
+            case ZYDIS_ROUNDING_MODE_RU:
+                res = res | x86::Attribs::RuSae;
+                break;
+            case ZYDIS_ROUNDING_MODE_RZ:
+                res = res | x86::Attribs::RzSae;
+                break;
+            default:
+                // Sae is only reported on its own, the rounding modes imply it.
+                if (instr.avx.has_sae != 0)
+                {
+                    res = res | x86::Attribs::Sae;
+                }
+                break;
+        }
+        return static_cast<Instruction::Attribs>(res);
+    }
+
     static constexpr Instruction::Category getCategory(ZydisInstructionCategory category) noexcept
     {
         return static_cast<Instruction::Category>(category);
@@ -181,7 +244,8 @@ namespace zasm
             vis.set(i, translateOperandVisibility(op.visibility));
         }
 
-        const auto attribs = getAttribs(instr.attributes);
+        const auto attribs = static_cast<Instruction::Attribs>(
+            static_cast<std::uint32_t>(getAttribs(instr.attributes)) | static_cast<std::uint32_t>(getEvexAttribs(instr)));
         const auto category = getCategory(instr.meta.category);
 
         return Instruction(
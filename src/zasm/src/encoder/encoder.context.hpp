@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 #include <zasm/core/stringpool.hpp>
 #include <zasm/program/label.hpp>
@@ -69,14 +70,30 @@ namespace zasm
             std::int64_t address{};
             std::int32_t offset{};
             std::int32_t length{};
+            // Padding inserted in front of the node.
+            std::int32_t padding{};
+            // Set once the branch group was padded after the first pass, it stays aligned from then on.
+            bool keepAligned{};
             RelocationType relocKind{};
             RelocationData relocData{};
             Label::Id relocLabel{ Label::Id::Invalid };
         };
 
+        // Branch island for a target outside of the rel32 range, the veneer jumps through an 8 byte slot.
+        struct Veneer
+        {
+        public:
+            static constexpr std::int64_t kUnplacedVA = -1;
+
+            std::int64_t target{};
+            std::int64_t address{ kUnplacedVA };
+        };
+
         std::vector<EncoderSection> sections;
         std::vector<LabelLink> labelLinks;
         std::vector<Node> nodes;
+        std::vector<Veneer> veneers;
+        std::unordered_map<std::int64_t, std::size_t> veneerIndices;
 
         LabelLink& getOrCreateLabelLink(Label::Id id)
         {
@@ -113,5 +130,24 @@ namespace zasm
 
             return entry.boundVA;
         }
+
+        // Returns the address of the veneer for the target, the veneer is created on first use and
+        // placed by the serializer at the end of the pass.
+        std::optional<std::int64_t> getVeneerAddress(std::int64_t target)
+        {
+            const auto [it, inserted] = veneerIndices.try_emplace(target, veneers.size());
+            if (inserted)
+            {
+                veneers.push_back({ target });
+            }
+
+            const auto& entry = veneers[it->second];
+            if (entry.address == Veneer::kUnplacedVA)
+            {
+                return std::nullopt;
+            }
+
+            return entry.address;
+        }
     };
 } // namespace zasm
@@ -1,6 +1,7 @@
 #include "zasm/encoder/encoder.hpp"
 
 #include "../program/program.state.hpp"
+#include "../x86/x86.controlflow.hpp"
 #include "encoder.context.hpp"
 #include "zasm/x86/instruction.hpp"
 
@@ -34,7 +35,6 @@ namespace zasm
 
     struct EncodeVariantsInfo
     {
-        bool isControlFlow{};
         std::int8_t encodeSizeRel8{ -1 };
         std::int8_t encodeSizeRel32{ -1 };
 
@@ -54,32 +54,32 @@ namespace zasm
         std::array<EncodeVariantsInfo, ZydisMnemonic::ZYDIS_MNEMONIC_MAX_VALUE> data{};
 
         // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
-        data[ZYDIS_MNEMONIC_JMP] = EncodeVariantsInfo{ true, 2, 5 };
-        data[ZYDIS_MNEMONIC_JB] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JBE] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JCXZ] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_JECXZ] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_JKNZD] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_JKZD] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_JRCXZ] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_JL] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JLE] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNB] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNBE] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNL] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNLE] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNO] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNP] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNS] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JNZ] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JO] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JP] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JS] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_JZ] = EncodeVariantsInfo{ true, 2, 6 };
-        data[ZYDIS_MNEMONIC_LOOP] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_LOOPE] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_LOOPNE] = EncodeVariantsInfo{ true, 2, -1 };
-        data[ZYDIS_MNEMONIC_CALL] = EncodeVariantsInfo{ true, -1, 5 };
+        data[ZYDIS_MNEMONIC_JMP] = EncodeVariantsInfo{ 2, 5 };
+        data[ZYDIS_MNEMONIC_JB] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JBE] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JCXZ] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_JECXZ] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_JKNZD] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_JKZD] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_JRCXZ] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_JL] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JLE] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNB] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNBE] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNL] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNLE] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNO] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNP] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNS] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JNZ] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JO] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JP] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JS] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_JZ] = EncodeVariantsInfo{ 2, 6 };
+        data[ZYDIS_MNEMONIC_LOOP] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_LOOPE] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_LOOPNE] = EncodeVariantsInfo{ 2, -1 };
+        data[ZYDIS_MNEMONIC_CALL] = EncodeVariantsInfo{ -1, 5 };
         // NOLINTEND(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers)
 
         return data;
@@ -92,6 +92,11 @@ namespace zasm
         return encoderVariantData[mnemonic]; // NOLINT
     }
 
+    static bool isControlFlowTarget(const EncoderState& state) noexcept
+    {
+        return state.operandIndex == 0 && x86::isRelativeControlFlow(static_cast<Instruction::Mnemonic>(state.req.mnemonic));
+    }
+
     static bool isLabelExternal(detail::ProgramState* state, Label::Id labelId)
     {
         const auto idx = static_cast<std::size_t>(labelId);
@@ -136,8 +141,60 @@ namespace zasm
         return res;
     }
 
+    static ZydisBroadcastMode getBroadcastMode(Mem::Broadcast broadcast) noexcept
+    {
+        switch (broadcast)
+        {
+            case Mem::Broadcast::_1to2:
+                return ZYDIS_BROADCAST_MODE_1_TO_2;
+            case Mem::Broadcast::_1to4:
+                return ZYDIS_BROADCAST_MODE_1_TO_4;
+            case Mem::Broadcast::_1to8:
+                return ZYDIS_BROADCAST_MODE_1_TO_8;
+            case Mem::Broadcast::_1to16:
+                return ZYDIS_BROADCAST_MODE_1_TO_16;
+            case Mem::Broadcast::_1to32:
+                return ZYDIS_BROADCAST_MODE_1_TO_32;
+            case Mem::Broadcast::_1to64:
+                return ZYDIS_BROADCAST_MODE_1_TO_64;
+            default:
+                break;
+        }
+        return ZYDIS_BROADCAST_MODE_INVALID;
+    }
+
+    static void applyEvexAttribs(ZydisEncoderRequest& req, x86::Attribs attribs) noexcept
+    {
+        req.evex.zeroing_mask = hasAttrib(attribs, x86::Attribs::Zeroing) ? ZYAN_TRUE : ZYAN_FALSE;
+
+        if (hasAttrib(attribs, x86::Attribs::RnSae))
+        {
+            req.evex.rounding = ZYDIS_ROUNDING_MODE_RN;
+        }
+        else if (hasAttrib(attribs, x86::Attribs::RdSae))
+        {
+            req.evex.rounding = ZYDIS_ROUNDING_MODE_RD;
+        }
+        else if (hasAttrib(attribs, x86::Attribs::RuSae))
+        {
+            req.evex.rounding = ZYDIS_ROUNDING_MODE_RU;
+        }
+        else if (hasAttrib(attribs, x86::Attribs::RzSae))
+        {
+            req.evex.rounding = ZYDIS_ROUNDING_MODE_RZ;
+        }
+
+        // Embedded rounding implies sae, this matches what the decoder reports.
+        if (hasAttrib(attribs, x86::Attribs::Sae) || req.evex.rounding != ZYDIS_ROUNDING_MODE_INVALID)
+        {
+            req.evex.sae = ZYAN_TRUE;
+        }
+    }
+
+    // A fixed target is outside of the code, it is reached with rel32 when possible so that the use can be
+    // adjusted once the code is relocated.
     static std::pair<int64_t, ZydisBranchType> processRelAddress(
-        const EncodeVariantsInfo& info, EncoderContext* ctx, int64_t targetAddress)
+        const EncodeVariantsInfo& info, EncoderContext* ctx, int64_t targetAddress, bool fixedTarget)
     {
         std::int64_t res{};
         auto desiredBranchType = ZydisBranchType::ZYDIS_BRANCH_TYPE_NONE;
@@ -149,7 +206,7 @@ namespace zasm
         }
         else
         {
-            if (info.canEncodeRel8())
+            if (info.canEncodeRel8() && (!fixedTarget || !info.canEncodeRel32()))
             {
                 const auto rel = getRelativeAddress(ctx->va, targetAddress, info.encodeSizeRel8);
                 if (std::abs(rel) <= std::numeric_limits<std::int8_t>::max())
@@ -167,6 +224,20 @@ namespace zasm
                     res = rel;
                     desiredBranchType = ZydisBranchType::ZYDIS_BRANCH_TYPE_NEAR;
                 }
+                else if (ctx->program->mode == MachineMode::AMD64)
+                {
+                    // Out of range, branch to a veneer that jumps through an absolute slot.
+                    if (const auto veneerVA = ctx->getVeneerAddress(targetAddress); veneerVA.has_value())
+                    {
+                        res = getRelativeAddress(ctx->va, *veneerVA, info.encodeSizeRel32);
+                    }
+                    else
+                    {
+                        res = kTemporaryRel32Value;
+                        ctx->needsExtraPass = true;
+                    }
+                    desiredBranchType = ZydisBranchType::ZYDIS_BRANCH_TYPE_NEAR;
+                }
             }
         }
 
@@ -209,28 +280,42 @@ namespace zasm
         // context is provided.
         std::int64_t immValue = getTemporaryRel(state);
 
+        // External labels only have an address if it was provided to the serializer.
         std::optional<std::int64_t> labelVA;
-        if (ctx != nullptr && !isLabelExternal(ctx->program, src.getId()))
+        bool knownExternal = false;
+        if (ctx != nullptr)
         {
-            labelVA = ctx != nullptr ? ctx->getLabelAddress(src.getId()) : std::nullopt;
-            if (!labelVA.has_value() && ctx != nullptr)
+            labelVA = ctx->getLabelAddress(src.getId());
+            const bool isExternal = isLabelExternal(ctx->program, src.getId());
+            if (!labelVA.has_value() && !isExternal)
             {
                 ctx->needsExtraPass = true;
             }
+            knownExternal = labelVA.has_value() && isExternal;
         }
 
         // Check if this operand is used as the control flow target.
         const auto& encodeInfo = getEncodeVariantInfo(state.req.mnemonic);
-        if (state.operandIndex == 0 && encodeInfo.isControlFlow)
+        if (isControlFlowTarget(state))
         {
             const auto targetAddress = labelVA.has_value() ? *labelVA : immValue;
 
-            const auto [addrRel, branchType] = processRelAddress(encodeInfo, ctx, targetAddress);
+            const auto [addrRel, branchType] = processRelAddress(encodeInfo, ctx, targetAddress, knownExternal);
 
             immValue = addrRel;
             desiredBranchType = branchType;
 
             assert(desiredBranchType != ZydisBranchType::ZYDIS_BRANCH_TYPE_NONE);
+
+            // The address of a known external does not move with the code, a direct branch to it has to be
+            // adjusted on relocation. Branches through a veneer only reference the code.
+            if (knownExternal && desiredBranchType == ZydisBranchType::ZYDIS_BRANCH_TYPE_NEAR
+                && std::abs(getRelativeAddress(ctx->va, *labelVA, encodeInfo.encodeSizeRel32))
+                    <= std::numeric_limits<std::int32_t>::max())
+            {
+                state.relocKind = RelocationType::Rel32;
+                state.relocData = RelocationData::Immediate;
+            }
         }
         else
         {
@@ -271,10 +356,10 @@ namespace zasm
 
         // Check if this operand is used as the control flow target.
         const auto& encodeInfo = getEncodeVariantInfo(state.req.mnemonic);
-        if (state.operandIndex == 0 && encodeInfo.isControlFlow)
+        if (isControlFlowTarget(state))
         {
             const auto targetAddress = immValue;
-            const auto [addrRel, branchType] = processRelAddress(encodeInfo, ctx, targetAddress);
+            const auto [addrRel, branchType] = processRelAddress(encodeInfo, ctx, targetAddress, false);
 
             immValue = addrRel;
             desiredBranchType = branchType;
@@ -307,22 +392,42 @@ namespace zasm
 
         bool usingLabel = false;
         bool externalLabel = false;
+        bool knownExternal = false;
 
         if (const auto labelId = src.getLabelId(); labelId != Label::Id::Invalid)
         {
             if (ctx != nullptr)
             {
-                externalLabel = isLabelExternal(ctx->program, labelId);
+                const bool isExternal = isLabelExternal(ctx->program, labelId);
 
                 auto labelVA = ctx->getLabelAddress(labelId);
+
+                // A known external address outside of the rip relative range is left to the relocation.
+                const bool isRipRel = dst.mem.base == ZYDIS_REGISTER_RIP
+                    || (state.req.machine_mode == ZYDIS_MACHINE_MODE_LONG_64 && dst.mem.base == ZYDIS_REGISTER_NONE
+                        && dst.mem.index == ZYDIS_REGISTER_NONE);
+                if (labelVA.has_value() && isExternal && isRipRel)
+                {
+                    const auto rel = getRelativeAddress(address, *labelVA + displacement, ctx->instrSize);
+                    if (std::abs(rel) > std::numeric_limits<std::int32_t>::max())
+                    {
+                        labelVA.reset();
+                    }
+                }
+
                 if (labelVA.has_value())
                 {
                     displacement += *labelVA;
+                    knownExternal = isExternal;
                 }
                 else
                 {
                     displacement += kTemporaryRel32Value;
-                    if (!externalLabel)
+                    if (isExternal)
+                    {
+                        externalLabel = true;
+                    }
+                    else
                     {
                         ctx->needsExtraPass = true;
                     }
@@ -373,10 +478,21 @@ namespace zasm
                 state.relocData = RelocationData::Memory;
                 state.relocLabel = src.getLabelId();
             }
+            else if (knownExternal)
+            {
+                // Relative to a fixed address, only adjusted on relocation.
+                state.relocKind = RelocationType::Rel32;
+                state.relocData = RelocationData::Memory;
+            }
         }
 
         dst.mem.displacement = displacement;
 
+        if (src.hasBroadcast())
+        {
+            state.req.evex.broadcast = getBroadcastMode(src.getBroadcast());
+        }
+
         // Handling segment
         const auto segmentId = static_cast<ZydisRegister>(src.getSegment().getId());
         if (segmentId == ZYDIS_REGISTER_GS)
@@ -485,6 +601,7 @@ namespace zasm
         }
         req.mnemonic = static_cast<ZydisMnemonic>(mnemonic);
         req.prefixes = getAttribs(attribs);
+        applyEvexAttribs(req, attribs);
 
         if (hasAttrib(attribs, x86::Attribs::OperandSize8))
         {
@@ -1,48 +1,12 @@
 #include "generator.hpp"
 
+#include "../x86/x86.controlflow.hpp"
+
 #include <Zydis/Zydis.h>
 #include <zasm/x86/instruction.hpp>
 
 namespace zasm
 {
-    // FIXME: Duplicate code, move this somewhere.
-    static bool isImmediateControlFlow(Instruction::Mnemonic mnemonic) noexcept
-    {
-        switch (static_cast<x86::Mnemonic>(mnemonic))
-        {
-            case x86::Mnemonic::Call:
-            case x86::Mnemonic::Jb:
-            case x86::Mnemonic::Jbe:
-            case x86::Mnemonic::Jcxz:
-            case x86::Mnemonic::Jecxz:
-            case x86::Mnemonic::Jknzd:
-            case x86::Mnemonic::Jkzd:
-            case x86::Mnemonic::Jl:
-            case x86::Mnemonic::Jle:
-            case x86::Mnemonic::Jmp:
-            case x86::Mnemonic::Jnb:
-            case x86::Mnemonic::Jnbe:
-            case x86::Mnemonic::Jnl:
-            case x86::Mnemonic::Jnle:
-            case x86::Mnemonic::Jno:
-            case x86::Mnemonic::Jnp:
-            case x86::Mnemonic::Jns:
-            case x86::Mnemonic::Jnz:
-            case x86::Mnemonic::Jo:
-            case x86::Mnemonic::Jp:
-            case x86::Mnemonic::Jrcxz:
-            case x86::Mnemonic::Js:
-            case x86::Mnemonic::Jz:
-            case x86::Mnemonic::Loop:
-            case x86::Mnemonic::Loope:
-            case x86::Mnemonic::Loopne:
-                return true;
-            default:
-                break;
-        }
-        return false;
-    }
-
     InstrGenerator::InstrGenerator(MachineMode mode) noexcept
         : _decoder(mode)
         , _mode(mode)
@@ -94,14 +58,15 @@ namespace zasm
                 if (opMem->hasLabel())
                 {
                     newOps[i] = Mem(
-                        opMem->getBitSize(), decodedMemOp.getSegment(), opMem->getLabel(), opMem->getBase(), opMem->getIndex(),
-                        opMem->getScale(), opMem->getDisplacement());
+                                    opMem->getBitSize(), decodedMemOp.getSegment(), opMem->getLabel(), opMem->getBase(),
+                                    opMem->getIndex(), opMem->getScale(), opMem->getDisplacement())
+                                    .setBroadcast(decodedMemOp.getBroadcast());
                 }
             }
             if (opSrc.holds<Imm>())
             {
                 const auto mnemonic = decodedInstr.getMnemonic();
-                if (i == 0 && isImmediateControlFlow(mnemonic))
+                if (i == 0 && x86::isRelativeControlFlow(mnemonic))
                 {
                     newOps[i] = opSrc;
                 }
@@ -162,6 +162,11 @@ namespace zasm::formatter
 
         static void opToString(Context& ctx, const Reg& opReg)
         {
+            if (opReg.isVirtual())
+            {
+                ctx.format("v%zu", opReg.getVirtualIndex());
+                return;
+            }
             const char* str = ZydisRegisterGetString(static_cast<ZydisRegister>(opReg.getId()));
             ctx.appendString(str);
         }
@@ -334,6 +339,30 @@ namespace zasm::formatter
             }
 
             ctx.appendLiteral("]");
+
+            switch (opMem.getBroadcast())
+            {
+                case Mem::Broadcast::_1to2:
+                    ctx.appendLiteral("{1to2}");
+                    break;
+                case Mem::Broadcast::_1to4:
+                    ctx.appendLiteral("{1to4}");
+                    break;
+                case Mem::Broadcast::_1to8:
+                    ctx.appendLiteral("{1to8}");
+                    break;
+                case Mem::Broadcast::_1to16:
+                    ctx.appendLiteral("{1to16}");
+                    break;
+                case Mem::Broadcast::_1to32:
+                    ctx.appendLiteral("{1to32}");
+                    break;
+                case Mem::Broadcast::_1to64:
+                    ctx.appendLiteral("{1to64}");
+                    break;
+                default:
+                    break;
+            }
         }
 
         static void nodeToString([[maybe_unused]] Context& ctx, [[maybe_unused]] const NodePoint& node) noexcept
@@ -457,6 +486,90 @@ namespace zasm::formatter
             }
         }
 
+        static void nodeToString(Context& ctx, const Align& node)
+        {
+            ctx.format(".align %" PRId32, node.getAlignment());
+            if (!node.isNopFill())
+            {
+                ctx.format(", 0x%02" PRIx8, node.getFillByte());
+            }
+        }
+
+        // The opmask of EVEX instructions is the operand following the destination, instructions operating
+        // on mask registers or reading them as source have no opmask.
+        static bool isOpmaskOperand(const Instruction& node, std::size_t opIndex)
+        {
+            if (opIndex != 1)
+            {
+                return false;
+            }
+
+            const auto* reg = node.getOperandIf<Reg>(opIndex);
+            if (reg == nullptr || ZydisRegisterGetClass(static_cast<ZydisRegister>(reg->getId())) != ZYDIS_REGCLASS_MASK)
+            {
+                return false;
+            }
+
+            const auto mnemonic = static_cast<ZydisMnemonic>(node.getMnemonic());
+            switch (static_cast<x86::Mnemonic>(mnemonic))
+            {
+                case x86::Mnemonic::Vpbroadcastmb2q:
+                case x86::Mnemonic::Vpbroadcastmw2d:
+                case x86::Mnemonic::Vpmovm2b:
+                case x86::Mnemonic::Vpmovm2d:
+                case x86::Mnemonic::Vpmovm2q:
+                case x86::Mnemonic::Vpmovm2w:
+                    return false;
+                default:
+                    break;
+            }
+
+            const char* str = ZydisMnemonicGetString(mnemonic);
+            return str != nullptr && str[0] != 'k';
+        }
+
+        static void opmaskToString(Context& ctx, const Instruction& node, const Reg& opReg)
+        {
+            // k0 encodes no masking.
+            if (static_cast<ZydisRegister>(opReg.getId()) == ZYDIS_REGISTER_K0)
+            {
+                return;
+            }
+
+            ctx.appendLiteral("{");
+            opToString(ctx, opReg);
+            ctx.appendLiteral("}");
+
+            if (node.hasAttrib(x86::Attribs::Zeroing))
+            {
+                ctx.appendLiteral("{z}");
+            }
+        }
+
+        static void roundingToString(Context& ctx, const Instruction& node)
+        {
+            if (node.hasAttrib(x86::Attribs::RnSae))
+            {
+                ctx.appendLiteral(", {rn-sae}");
+            }
+            else if (node.hasAttrib(x86::Attribs::RdSae))
+            {
+                ctx.appendLiteral(", {rd-sae}");
+            }
+            else if (node.hasAttrib(x86::Attribs::RuSae))
+            {
+                ctx.appendLiteral(", {ru-sae}");
+            }
+            else if (node.hasAttrib(x86::Attribs::RzSae))
+            {
+                ctx.appendLiteral(", {rz-sae}");
+            }
+            else if (node.hasAttrib(x86::Attribs::Sae))
+            {
+                ctx.appendLiteral(", {sae}");
+            }
+        }
+
         static void nodeToString(Context& ctx, const Instruction& node)
         {
             if (node.hasAttrib(x86::Attribs::Lock))
@@ -491,6 +604,13 @@ namespace zasm::formatter
                     continue;
                 }
 
+                if (isOpmaskOperand(node, opIndex))
+                {
+                    opmaskToString(ctx, node, operand.get<Reg>());
+                    opIndex++;
+                    continue;
+                }
+
                 operand.visit([&](auto&& opVal) {
                     if (opIndex == 0)
                     {
@@ -505,6 +625,8 @@ namespace zasm::formatter
 
                 opIndex++;
             }
+
+            roundingToString(ctx, node);
         }
 
     } // namespace detail
@@ -0,0 +1,378 @@
+#include "zasm/instrumentation/blockcounters.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <array>
+#include <utility>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/memory.hpp>
+
+namespace zasm
+{
+    // inc does not modify CF.
+    static constexpr FlagsLiveness::FlagsMask kIncFlags = FlagsLiveness::kStatusFlags & ~FlagsLiveness::kCF;
+
+    // The System V ABI allows leaf functions to use the 128 bytes below rsp, pushfq must not overwrite them.
+    static constexpr std::int64_t kRedZoneSize = 128;
+
+    // rbp and rsp are never used as scratch registers to keep frame pointers intact.
+    static constexpr std::array<x86::Gp64, 14> kScratchRegs = {
+        x86::rax, x86::rcx, x86::rdx, x86::rsi, x86::rdi, x86::r8,  x86::r9,
+        x86::r10, x86::r11, x86::rbx, x86::r12, x86::r13, x86::r14, x86::r15,
+    };
+
+    namespace
+    {
+        struct Site
+        {
+            std::size_t counter{};
+            Reg::Id reg{ Reg::Id::None };
+        };
+
+        struct Edge
+        {
+            const Node* branch{};
+            Label trampoline{};
+            Site taken{};
+            Site fallthrough{};
+            bool hasFallthrough{};
+        };
+    } // namespace
+
+    BlockCounters::BlockCounters(Program& program, Options options)
+        : _program(program)
+        , _assembler(program)
+        , _cfg(program)
+        , _flags(program, _cfg)
+        , _regs(program, _cfg)
+        , _options(options)
+    {
+    }
+
+    void BlockCounters::setOptions(Options options) noexcept
+    {
+        _options = options;
+    }
+
+    BlockCounters::Options BlockCounters::getOptions() const noexcept
+    {
+        return _options;
+    }
+
+    Error BlockCounters::run()
+    {
+        _stats = {};
+        _counters.clear();
+        _blockCounters.clear();
+
+        if (_program.getMode() != MachineMode::AMD64)
+        {
+            return Error::InvalidMode;
+        }
+
+        if (auto err = _flags.run(); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = _regs.run(); err != Error::None)
+        {
+            return err;
+        }
+
+        const bool isAtomic = (_options & Options::Atomic) != Options::None;
+        const bool countEdges = (_options & Options::Edges) != Options::None;
+
+        // Picks the cheapest update that preserves the live state at the node.
+        const auto addCounter = [&](Kind kind, const Node* node, const Label& target, const Node* liveAt) -> Site {
+            Site site{};
+            site.counter = _counters.size();
+
+            Counter counter{};
+            counter.kind = kind;
+            counter.form = Form::SaveFlags;
+            counter.label = _assembler.createLabel();
+            counter.target = target;
+            counter.node = node;
+
+            if ((_flags.getLiveBefore(liveAt) & kIncFlags) == 0)
+            {
+                counter.form = Form::Inc;
+            }
+            else if (!isAtomic)
+            {
+                const auto liveRegs = _regs.getLiveBefore(liveAt);
+                for (const auto& reg : kScratchRegs)
+                {
+                    if ((liveRegs & RegisterLiveness::getRegMask(MachineMode::AMD64, reg)) == 0)
+                    {
+                        counter.form = Form::Register;
+                        site.reg = reg.getId();
+                        break;
+                    }
+                }
+            }
+
+            _counters.push_back(counter);
+            return site;
+        };
+
+        // Collect the counters before modifying the program, the liveness only covers the original nodes.
+        std::vector<std::pair<const Node*, Site>> blockSites;
+        std::vector<Edge> edges;
+
+        bool isExecutable = true;
+        for (const auto* node = _program.getHead(); node != nullptr;)
+        {
+            const auto& block = _cfg.getBlock(_cfg.getBlockOf(node));
+            node = block.tail->getNext();
+
+            if (const auto* section = block.head->getIf<Section>(); section != nullptr)
+            {
+                isExecutable = (_program.getSectionAttribs(*section) & Section::Attribs::Exec) != Section::Attribs::None;
+            }
+            if (!isExecutable)
+            {
+                continue;
+            }
+
+            // The counter goes after the leading labels, all of them map to the same counter.
+            Label blockLabel{};
+            const Node* first = block.head;
+            while (first != block.tail && (first->holds<Label>() || first->holds<Section>()))
+            {
+                if (const auto* label = first->getIf<Label>(); label != nullptr && !blockLabel.isValid())
+                {
+                    blockLabel = *label;
+                }
+                first = first->getNext();
+            }
+            if (!first->holds<Instruction>())
+            {
+                continue;
+            }
+
+            const auto site = addCounter(Kind::Block, first, blockLabel, first);
+            blockSites.emplace_back(first, site);
+            _stats.blockCounters++;
+
+            for (const auto* labelNode = block.head; labelNode != first; labelNode = labelNode->getNext())
+            {
+                if (const auto* label = labelNode->getIf<Label>(); label != nullptr)
+                {
+                    const auto labelIdx = static_cast<std::size_t>(label->getId());
+                    if (labelIdx >= _blockCounters.size())
+                    {
+                        _blockCounters.resize(labelIdx + 1);
+                    }
+                    _blockCounters[labelIdx] = site.counter + 1;
+                }
+            }
+
+            if (!countEdges)
+            {
+                continue;
+            }
+
+            // Only branches that have a rel32 form can be redirected into the edge section, which are
+            // the ones with an inverse condition, this excludes loop and jrcxz.
+            const auto* branch = block.tail->getIf<Instruction>();
+            if (branch == nullptr || !x86::isConditionalBranch(branch->getMnemonic())
+                || x86::getInvertedCondition(branch->getMnemonic()) == x86::Mnemonic::Invalid)
+            {
+                continue;
+            }
+
+            const auto* target = branch->getOperandIf<Label>(0);
+            if (target == nullptr)
+            {
+                continue;
+            }
+            const auto targetId = _cfg.getBlockOf(*target);
+            if (targetId == ControlFlowGraph::BlockId::Invalid)
+            {
+                continue;
+            }
+
+            Edge edge{};
+            edge.branch = block.tail;
+            edge.trampoline = _assembler.createLabel();
+            edge.taken = addCounter(Kind::Taken, block.tail, *target, _cfg.getBlock(targetId).head);
+            if (block.tail->getNext() != nullptr)
+            {
+                edge.fallthrough = addCounter(Kind::Fallthrough, block.tail, Label{}, block.tail->getNext());
+                edge.hasFallthrough = true;
+            }
+            edges.push_back(edge);
+        }
+
+        const auto emitUpdate = [&](const Site& site) -> Error {
+            const auto& counter = _counters[site.counter];
+            const auto mem = x86::qword_ptr(x86::rip, counter.label);
+
+            const auto emitInc = [&]() {
+                if (isAtomic)
+                {
+                    return _assembler.lock().inc(mem);
+                }
+                return _assembler.inc(mem);
+            };
+
+            switch (counter.form)
+            {
+                case Form::Inc:
+                    _stats.incForms++;
+                    return emitInc();
+                case Form::Register:
+                {
+                    _stats.registerForms++;
+                    const x86::Gp64 reg(site.reg);
+                    if (auto err = _assembler.mov(reg, mem); err != Error::None)
+                    {
+                        return err;
+                    }
+                    if (auto err = _assembler.lea(reg, x86::qword_ptr(reg, 1)); err != Error::None)
+                    {
+                        return err;
+                    }
+                    return _assembler.mov(mem, reg);
+                }
+                case Form::SaveFlags:
+                {
+                    _stats.saveFlagsForms++;
+                    if (auto err = _assembler.lea(x86::rsp, x86::qword_ptr(x86::rsp, -kRedZoneSize)); err != Error::None)
+                    {
+                        return err;
+                    }
+                    if (auto err = _assembler.pushfq(); err != Error::None)
+                    {
+                        return err;
+                    }
+                    if (auto err = emitInc(); err != Error::None)
+                    {
+                        return err;
+                    }
+                    if (auto err = _assembler.popfq(); err != Error::None)
+                    {
+                        return err;
+                    }
+                    return _assembler.lea(x86::rsp, x86::qword_ptr(x86::rsp, kRedZoneSize));
+                }
+            }
+            return Error::InvalidOperation;
+        };
+
+        for (const auto& [first, site] : blockSites)
+        {
+            _assembler.setCursor(first->getPrev());
+            if (auto err = emitUpdate(site); err != Error::None)
+            {
+                return err;
+            }
+        }
+
+        // Redirect the branches to the trampolines and count the fallthrough right after the branch.
+        for (auto& edge : edges)
+        {
+            const auto mnemonic = static_cast<x86::Mnemonic>(edge.branch->get<Instruction>().getMnemonic());
+
+            _assembler.setCursor(edge.branch);
+            if (auto err = _assembler.emit(mnemonic, edge.trampoline); err != Error::None)
+            {
+                return err;
+            }
+            _program.destroy(edge.branch);
+            edge.branch = _assembler.getCursor();
+
+            _counters[edge.taken.counter].node = edge.branch;
+            _stats.edgeCounters++;
+
+            if (edge.hasFallthrough)
+            {
+                _counters[edge.fallthrough.counter].node = edge.branch;
+                if (auto err = emitUpdate(edge.fallthrough); err != Error::None)
+                {
+                    return err;
+                }
+                _stats.edgeCounters++;
+            }
+        }
+
+        _assembler.setCursor(_program.getTail());
+
+        if (!edges.empty())
+        {
+            if (auto err = _assembler.section(kEdgeSectionName, Section::Attribs::Code); err != Error::None)
+            {
+                return err;
+            }
+            for (const auto& edge : edges)
+            {
+                if (auto err = _assembler.bind(edge.trampoline); err != Error::None)
+                {
+                    return err;
+                }
+                if (auto err = emitUpdate(edge.taken); err != Error::None)
+                {
+                    return err;
+                }
+                if (auto err = _assembler.jmp(_counters[edge.taken.counter].target); err != Error::None)
+                {
+                    return err;
+                }
+            }
+        }
+
+        if (_counters.empty())
+        {
+            return Error::None;
+        }
+
+        if (auto err = _assembler.section(kCounterSectionName, Section::Attribs::Data); err != Error::None)
+        {
+            return err;
+        }
+        for (const auto& counter : _counters)
+        {
+            if (auto err = _assembler.bind(counter.label); err != Error::None)
+            {
+                return err;
+            }
+            if (auto err = _assembler.dq(0); err != Error::None)
+            {
+                return err;
+            }
+        }
+
+        return Error::None;
+    }
+
+    std::size_t BlockCounters::getCounterCount() const noexcept
+    {
+        return _counters.size();
+    }
+
+    const BlockCounters::Counter* BlockCounters::getCounter(std::size_t index) const noexcept
+    {
+        if (index >= _counters.size())
+        {
+            return nullptr;
+        }
+        return &_counters[index];
+    }
+
+    const BlockCounters::Counter* BlockCounters::findBlockCounter(const Label& label) const noexcept
+    {
+        const auto labelIdx = static_cast<std::size_t>(label.getId());
+        if (labelIdx >= _blockCounters.size() || _blockCounters[labelIdx] == 0)
+        {
+            return nullptr;
+        }
+        return &_counters[_blockCounters[labelIdx] - 1];
+    }
+
+    const BlockCounters::Stats& BlockCounters::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+} // namespace zasm
@@ -0,0 +1,286 @@
+#include "zasm/optimization/blocklayout.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+#include "optimization.blocks.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
+
+namespace zasm
+{
+    using EdgeWeights = BlockLayout::EdgeWeights;
+
+    using detail::getBranchLabel;
+    using detail::getMnemonic;
+    using detail::kMeasureBase;
+    using detail::kNoBlock;
+
+    namespace
+    {
+        struct LayoutBlock : detail::OrderedBlock
+        {
+            EdgeWeights weights{};
+            // Chain links of the new layout.
+            std::size_t prev{ kNoBlock };
+            std::size_t next{ kNoBlock };
+        };
+
+        struct LayoutEdge
+        {
+            std::size_t from{};
+            std::size_t to{};
+            std::uint64_t weight{};
+            bool isFallthrough{};
+        };
+    } // namespace
+
+    // Counts the branches to labels that were encoded with a rel8 displacement.
+    static std::size_t countShortBranches(const Program& program, const Serializer& serializer)
+    {
+        // Both jmp rel32 and jcc rel32 take at least 5 bytes.
+        constexpr std::int32_t kMinNearBranchLength = 5;
+
+        std::size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (getBranchLabel(node) == nullptr)
+            {
+                continue;
+            }
+            const auto length = serializer.getNodeLength(node);
+            if (length > 0 && length < kMinNearBranchLength)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    BlockLayout::BlockLayout(Program& program)
+        : _program(program)
+        , _assembler(program)
+        , _cfg(program)
+        , _weights(program)
+    {
+    }
+
+    void BlockLayout::setEdgeWeights(const Node* node, const EdgeWeights& weights)
+    {
+        _weights.set(node, weights);
+    }
+
+    void BlockLayout::setEdgeWeights(const Profile& profile)
+    {
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* label = getBranchLabel(node);
+            if (label == nullptr)
+            {
+                continue;
+            }
+
+            EdgeWeights weights{};
+            weights.taken = profile.getLabelWeight(*label);
+
+            if (const auto* next = node->getNext(); next != nullptr)
+            {
+                const auto* nextLabel = next->getIf<Label>();
+                weights.fallthrough = nextLabel != nullptr ? profile.getLabelWeight(*nextLabel)
+                                                           : profile.getNodeWeight(next);
+            }
+
+            _weights.set(node, weights);
+        }
+    }
+
+    Error BlockLayout::run()
+    {
+        _stats = {};
+
+        Serializer serializer;
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.sizeBefore = static_cast<std::int64_t>(serializer.getCodeSize());
+        _stats.shortBranchesBefore = countShortBranches(_program, serializer);
+
+        if (auto err = _cfg.update(); err != Error::None)
+        {
+            return err;
+        }
+
+        std::vector<LayoutBlock> blocks;
+        detail::collectBlocks(_program, _cfg, blocks);
+        for (auto& block : blocks)
+        {
+            block.weights = _weights.get(block.tail);
+        }
+
+        if (blocks.size() < 2)
+        {
+            _stats.sizeAfter = _stats.sizeBefore;
+            _stats.shortBranchesAfter = _stats.shortBranchesBefore;
+            return Error::None;
+        }
+
+        // Gather the edges that can become a fallthrough.
+        std::vector<LayoutEdge> edges;
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            const auto& block = blocks[i];
+
+            const auto addEdge = [&](std::size_t to, std::uint64_t weight, bool isFallthrough) {
+                if (to == kNoBlock || to == i || blocks[to].isRegionStart || blocks[to].region != block.region)
+                {
+                    return;
+                }
+                // Blocks without a label can only be reached by falling through.
+                if (isFallthrough && !blocks[to].head->holds<Label>())
+                {
+                    weight = std::numeric_limits<std::uint64_t>::max();
+                }
+                edges.push_back({ i, to, weight, isFallthrough });
+            };
+
+            addEdge(block.fallthrough, block.weights.fallthrough, true);
+            addEdge(block.taken, block.weights.taken, false);
+        }
+
+        std::stable_sort(edges.begin(), edges.end(), [](const LayoutEdge& lhs, const LayoutEdge& rhs) {
+            if (lhs.weight != rhs.weight)
+            {
+                return lhs.weight > rhs.weight;
+            }
+            return lhs.isFallthrough && !rhs.isFallthrough;
+        });
+
+        // Greedily join the blocks into chains, the heaviest edges first.
+        std::vector<std::size_t> chainOf(blocks.size());
+        for (std::size_t i = 0; i < chainOf.size(); ++i)
+        {
+            chainOf[i] = i;
+        }
+
+        const auto findChain = [&](std::size_t idx) {
+            while (chainOf[idx] != idx)
+            {
+                chainOf[idx] = chainOf[chainOf[idx]];
+                idx = chainOf[idx];
+            }
+            return idx;
+        };
+
+        for (const auto& edge : edges)
+        {
+            auto& from = blocks[edge.from];
+            auto& to = blocks[edge.to];
+            if (from.next != kNoBlock || to.prev != kNoBlock)
+            {
+                continue;
+            }
+
+            const auto chainFrom = findChain(edge.from);
+            const auto chainTo = findChain(edge.to);
+            if (chainFrom == chainTo)
+            {
+                continue;
+            }
+
+            from.next = edge.to;
+            to.prev = edge.from;
+            chainOf[chainTo] = chainFrom;
+        }
+
+        // Chains are placed in the order of their first block, this keeps the first
+        // block of each region in place.
+        std::vector<std::size_t> order;
+        order.reserve(blocks.size());
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i].prev != kNoBlock)
+            {
+                continue;
+            }
+            for (auto idx = i; idx != kNoBlock; idx = blocks[idx].next)
+            {
+                order.push_back(idx);
+            }
+        }
+
+        // Move the nodes into the new order.
+        const Node* pos = blocks[order[0]].tail;
+        for (std::size_t k = 1; k < order.size(); ++k)
+        {
+            const auto& block = blocks[order[k]];
+            if (block.head->getPrev() == pos)
+            {
+                pos = block.tail;
+                continue;
+            }
+
+            const auto* node = block.head;
+            while (true)
+            {
+                const auto* next = node->getNext();
+                const bool isLast = node == block.tail;
+
+                pos = _program.moveAfter(pos, node);
+                if (isLast)
+                {
+                    break;
+                }
+                node = next;
+            }
+
+            _stats.blocksMoved++;
+        }
+
+        if (auto err = detail::repairFallthroughs(
+                _program, _assembler, blocks, order, _stats.branchesInverted, _stats.jumpsInserted);
+            err != Error::None)
+        {
+            return err;
+        }
+
+        // Jumps to the block that now follows are no longer needed.
+        for (std::size_t k = 0; k + 1 < order.size(); ++k)
+        {
+            const auto& block = blocks[order[k]];
+            if (x86::isUnconditionalBranch(getMnemonic(block.tail)) && block.taken == order[k + 1])
+            {
+                _program.destroy(block.tail);
+                _stats.jumpsRemoved++;
+            }
+        }
+
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.sizeAfter = static_cast<std::int64_t>(serializer.getCodeSize());
+        _stats.shortBranchesAfter = countShortBranches(_program, serializer);
+
+        return Error::None;
+    }
+
+    const BlockLayout::Stats& BlockLayout::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+    std::int64_t BlockLayout::getBytesSaved() const noexcept
+    {
+        return _stats.sizeBefore - _stats.sizeAfter;
+    }
+
+    std::int64_t BlockLayout::getBranchesShortened() const noexcept
+    {
+        return static_cast<std::int64_t>(_stats.shortBranchesAfter) - static_cast<std::int64_t>(_stats.shortBranchesBefore);
+    }
+
+} // namespace zasm
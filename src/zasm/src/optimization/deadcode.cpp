@@ -0,0 +1,297 @@
+#include "zasm/optimization/deadcode.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+#include "optimization.blocks.hpp"
+
+#include <Zydis/Zydis.h>
+#include <utility>
+#include <vector>
+#include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm
+{
+    using BlockId = ControlFlowGraph::BlockId;
+    using detail::kMeasureBase;
+
+    DeadCodeElimination::DeadCodeElimination(Program& program)
+        : _program(program)
+        , _cfg(program)
+        , _regLiveness(program, _cfg)
+        , _flagsLiveness(program, _cfg)
+    {
+    }
+
+    void DeadCodeElimination::addExport(const Label& label)
+    {
+        _exports.push_back(label);
+    }
+
+    Error DeadCodeElimination::run(std::size_t maxPasses)
+    {
+        _stats = {};
+
+        Serializer serializer;
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.sizeBefore = static_cast<std::int64_t>(serializer.getCodeSize());
+
+        if (auto err = removeUnreachableBlocks(); err != Error::None)
+        {
+            return err;
+        }
+
+        for (std::size_t pass = 0; pass < maxPasses; ++pass)
+        {
+            bool changed = false;
+            if (auto err = removeDeadInstructions(changed); err != Error::None)
+            {
+                return err;
+            }
+            if (!changed)
+            {
+                break;
+            }
+        }
+
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.sizeAfter = static_cast<std::int64_t>(serializer.getCodeSize());
+
+        return Error::None;
+    }
+
+    const DeadCodeElimination::Stats& DeadCodeElimination::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+    std::int64_t DeadCodeElimination::getBytesEliminated() const noexcept
+    {
+        return _stats.sizeBefore - _stats.sizeAfter;
+    }
+
+    Error DeadCodeElimination::removeUnreachableBlocks()
+    {
+        if (auto err = _cfg.update(); err != Error::None)
+        {
+            return err;
+        }
+
+        std::vector<bool> reachable(_cfg.getBlockCount());
+        std::vector<BlockId> worklist;
+
+        const auto markBlock = [&](BlockId id) {
+            if (id == BlockId::Invalid || reachable[static_cast<std::size_t>(id)])
+            {
+                return;
+            }
+            reachable[static_cast<std::size_t>(id)] = true;
+            worklist.push_back(id);
+        };
+        const auto markLabel = [&](const Label& label) {
+            if (label.isValid())
+            {
+                markBlock(_cfg.getBlockOf(label));
+            }
+        };
+
+        markBlock(_cfg.getEntryBlock());
+        for (const auto& label : _exports)
+        {
+            markLabel(label);
+        }
+
+        // Blocks of data sections and blocks whose address is taken are roots.
+        bool isExecutable = true;
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* section = node->getIf<Section>(); section != nullptr)
+            {
+                isExecutable = (_program.getSectionAttribs(*section) & Section::Attribs::Exec) != Section::Attribs::None;
+            }
+            if (!isExecutable)
+            {
+                markBlock(_cfg.getBlockOf(node));
+            }
+
+            if (const auto* embedded = node->getIf<EmbeddedLabel>(); embedded != nullptr)
+            {
+                markLabel(embedded->getLabel());
+                markLabel(embedded->getRelativeLabel());
+            }
+            else if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                const bool isBranch = x86::isBranch(instr->getMnemonic());
+                for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+                {
+                    const auto& op = instr->getOperand(i);
+                    if (const auto* label = op.getIf<Label>(); label != nullptr && !isBranch)
+                    {
+                        markLabel(*label);
+                    }
+                    else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                    {
+                        markLabel(mem->getLabel());
+                    }
+                }
+            }
+        }
+
+        while (!worklist.empty())
+        {
+            const auto id = worklist.back();
+            worklist.pop_back();
+
+            for (const auto succ : _cfg.getSuccessors(id))
+            {
+                markBlock(succ);
+            }
+        }
+
+        // The block data is invalidated by the removal, collect the ranges first.
+        std::vector<std::pair<const Node*, const Node*>> unreachable;
+        for (std::size_t i = 0; i < _cfg.getBlockCount(); ++i)
+        {
+            const auto& block = _cfg.getBlock(static_cast<BlockId>(i));
+            if (block.isValid() && !reachable[i])
+            {
+                unreachable.emplace_back(block.head, block.tail);
+            }
+        }
+
+        for (const auto& [head, tail] : unreachable)
+        {
+            bool removed = false;
+            for (const auto* node = head; node != nullptr;)
+            {
+                const auto* next = node->getNext();
+                const bool isTail = node == tail;
+
+                if (node->holds<Instruction>())
+                {
+                    _stats.instructionsRemoved++;
+                    _program.destroy(node);
+                    removed = true;
+                }
+                else if (node->holds<Label>())
+                {
+                    _program.destroy(node);
+                    removed = true;
+                }
+
+                if (isTail)
+                {
+                    break;
+                }
+                node = next;
+            }
+
+            if (removed)
+            {
+                _stats.blocksRemoved++;
+            }
+        }
+
+        return Error::None;
+    }
+
+    Error DeadCodeElimination::removeDeadInstructions(bool& changed)
+    {
+        if (auto err = _regLiveness.run(); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = _flagsLiveness.run(); err != Error::None)
+        {
+            return err;
+        }
+
+        // Removing a dead instruction never makes the results of another one live, all dead
+        // instructions found with the current liveness can be removed at once.
+        std::vector<const Node*> dead;
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr != nullptr && isDead(node, *instr))
+            {
+                dead.push_back(node);
+            }
+        }
+
+        for (const auto* node : dead)
+        {
+            _program.destroy(node);
+        }
+
+        _stats.instructionsRemoved += dead.size();
+        _stats.deadInstructions += dead.size();
+        changed = !dead.empty();
+
+        return Error::None;
+    }
+
+    bool DeadCodeElimination::isDead(const Node* node, const Instruction& instr) const noexcept
+    {
+        if (!instr.isMetaDataValid() || x86::hasSideEffects(instr))
+        {
+            return false;
+        }
+
+        const auto mode = _program.getMode();
+
+        bool writes = false;
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            if ((instr.getOperandAccess(i) & Operand::Access::MaskWrite) == Operand::Access::None)
+            {
+                continue;
+            }
+
+            const auto& op = instr.getOperand(i);
+            if (op.holds<Mem>())
+            {
+                return false;
+            }
+
+            const auto* reg = op.getIf<Reg>();
+            if (reg == nullptr)
+            {
+                continue;
+            }
+            if (!reg->isVirtual()
+                && ZydisRegisterGetClass(static_cast<ZydisRegister>(reg->getId())) == ZYDIS_REGCLASS_FLAGS)
+            {
+                // Handled by the cpu flags.
+                continue;
+            }
+
+            // Segment, control and other untracked registers are assumed to be observed.
+            if (RegisterLiveness::getRegMask(mode, *reg) == 0 || _regLiveness.isLiveAfter(node, *reg))
+            {
+                return false;
+            }
+            writes = true;
+        }
+
+        const auto& flags = instr.getCPUFlags();
+        const auto flagsWritten = flags.write | flags.undefined;
+        if (flagsWritten != 0)
+        {
+            if ((_flagsLiveness.getLiveAfter(node) & flagsWritten) != 0)
+            {
+                return false;
+            }
+            writes = true;
+        }
+
+        // Instructions without any output such as nop or prefetch are kept.
+        return writes;
+    }
+
+} // namespace zasm
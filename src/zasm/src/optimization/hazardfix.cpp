@@ -0,0 +1,665 @@
+#include "zasm/optimization/hazardfix.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <Zydis/Zydis.h>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/instruction.hpp>
+#include <zasm/x86/register.hpp>
+
+namespace zasm
+{
+    static bool usesVirtualRegs(const Instruction& instr) noexcept
+    {
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = instr.getOperand(i);
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr && reg->isVirtual())
+            {
+                return true;
+            }
+            if (const auto* mem = op.getIf<Mem>(); mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool hasRoot(MachineMode mode, const Reg& reg, const Reg& root) noexcept
+    {
+        return reg.isValid() && !reg.isVirtual() && reg.getRoot(mode) == root;
+    }
+
+    // Returns true if any operand, including memory addresses, refers to the root register.
+    static bool referencesRoot(MachineMode mode, const Instruction& instr, const Reg& root) noexcept
+    {
+        for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            const auto& op = instr.getOperand(i);
+            if (const auto* reg = op.getIf<Reg>(); reg != nullptr && hasRoot(mode, *reg, root))
+            {
+                return true;
+            }
+            if (const auto* mem = op.getIf<Mem>();
+                mem != nullptr && (hasRoot(mode, mem->getBase(), root) || hasRoot(mode, mem->getIndex(), root)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Legacy SSE scalar instructions only read the low element of their register operands and
+    // keep the upper bits of the destination, returns the element size in bits or 0.
+    static std::int32_t getScalarElementWidth(const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Addss:
+            case x86::Mnemonic::Subss:
+            case x86::Mnemonic::Mulss:
+            case x86::Mnemonic::Divss:
+            case x86::Mnemonic::Minss:
+            case x86::Mnemonic::Maxss:
+            case x86::Mnemonic::Sqrtss:
+            case x86::Mnemonic::Rcpss:
+            case x86::Mnemonic::Rsqrtss:
+            case x86::Mnemonic::Roundss:
+            case x86::Mnemonic::Cmpss:
+            case x86::Mnemonic::Comiss:
+            case x86::Mnemonic::Ucomiss:
+            case x86::Mnemonic::Cvtss2sd:
+            case x86::Mnemonic::Cvtss2si:
+            case x86::Mnemonic::Cvttss2si:
+            case x86::Mnemonic::Cvtsi2ss:
+            case x86::Mnemonic::Movss:
+                return 32;
+            case x86::Mnemonic::Addsd:
+            case x86::Mnemonic::Subsd:
+            case x86::Mnemonic::Mulsd:
+            case x86::Mnemonic::Divsd:
+            case x86::Mnemonic::Minsd:
+            case x86::Mnemonic::Maxsd:
+            case x86::Mnemonic::Sqrtsd:
+            case x86::Mnemonic::Roundsd:
+            case x86::Mnemonic::Cmpsd:
+            case x86::Mnemonic::Comisd:
+            case x86::Mnemonic::Ucomisd:
+            case x86::Mnemonic::Cvtsd2ss:
+            case x86::Mnemonic::Cvtsd2si:
+            case x86::Mnemonic::Cvttsd2si:
+            case x86::Mnemonic::Cvtsi2sd:
+            case x86::Mnemonic::Movsd:
+                return 64;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    // Returns true if the instruction replaces at least the low 128 bits of the vector register
+    // without depending on them.
+    static bool isFullVectorWrite(MachineMode mode, const Instruction& instr, const Reg& root) noexcept
+    {
+        const auto* dst = instr.getOperandIf<Reg>(0);
+        if (dst == nullptr || !hasRoot(mode, *dst, root))
+        {
+            return false;
+        }
+
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Movaps:
+            case x86::Mnemonic::Movups:
+            case x86::Mnemonic::Movapd:
+            case x86::Mnemonic::Movupd:
+            case x86::Mnemonic::Movdqa:
+            case x86::Mnemonic::Movdqu:
+            case x86::Mnemonic::Movd:
+            case x86::Mnemonic::Movq:
+            case x86::Mnemonic::Vmovaps:
+            case x86::Mnemonic::Vmovups:
+            case x86::Mnemonic::Vmovapd:
+            case x86::Mnemonic::Vmovupd:
+            case x86::Mnemonic::Vmovdqa:
+            case x86::Mnemonic::Vmovdqu:
+            case x86::Mnemonic::Vmovd:
+            case x86::Mnemonic::Vmovq:
+            {
+                // Merge masking keeps the unselected elements.
+                for (std::size_t i = 1; i < instr.getOperandCount(); ++i)
+                {
+                    const auto* reg = instr.getOperandIf<Reg>(i);
+                    if (reg != nullptr && !reg->isVirtual()
+                        && ZydisRegisterGetClass(static_cast<ZydisRegister>(reg->getId())) == ZYDIS_REGCLASS_MASK)
+                    {
+                        return false;
+                    }
+                }
+                const auto* src = instr.getOperandIf<Reg>(1);
+                return src == nullptr || !hasRoot(mode, *src, root);
+            }
+            case x86::Mnemonic::Movss:
+            case x86::Mnemonic::Movsd:
+            case x86::Mnemonic::Vmovss:
+            case x86::Mnemonic::Vmovsd:
+                // Loads zero the upper elements.
+                return instr.getExplicitOperandCount() == 2 && instr.getOperandIf<Mem>(1) != nullptr;
+            case x86::Mnemonic::Xorps:
+            case x86::Mnemonic::Xorpd:
+            case x86::Mnemonic::Pxor:
+            {
+                const auto* src = instr.getOperandIf<Reg>(1);
+                return src != nullptr && *src == *dst;
+            }
+            case x86::Mnemonic::Vxorps:
+            case x86::Mnemonic::Vxorpd:
+            case x86::Mnemonic::Vpxor:
+            {
+                const auto* srcA = instr.getOperandIf<Reg>(1);
+                const auto* srcB = instr.getOperandIf<Reg>(2);
+                return srcA != nullptr && srcB != nullptr && *srcA == *srcB;
+            }
+            default:
+                break;
+        }
+        return false;
+    }
+
+    static bool isImm8(std::int64_t value) noexcept
+    {
+        const auto value16 = static_cast<std::int16_t>(static_cast<std::uint16_t>(value));
+        return value16 >= -128 && value16 <= 127;
+    }
+
+    // Scratch registers in order of preference, the stack and frame pointer are never used.
+    static constexpr x86::Gp64 kScratchRegs64[] = {
+        x86::rax, x86::rcx, x86::rdx, x86::r8,  x86::r9,  x86::r10, x86::r11,
+        x86::rsi, x86::rdi, x86::rbx, x86::r12, x86::r13, x86::r14, x86::r15,
+    };
+    static constexpr x86::Gp32 kScratchRegs32[] = {
+        x86::eax, x86::ecx, x86::edx, x86::esi, x86::edi, x86::ebx,
+    };
+
+    HazardFix::HazardFix(Program& program)
+        : _program(program)
+        , _assembler(program)
+        , _cfg(program)
+        , _regLiveness(program, _cfg)
+    {
+    }
+
+    Error HazardFix::run(Fixes fixes)
+    {
+        _stats = {};
+
+        if (auto err = _regLiveness.run(); err != Error::None)
+        {
+            return err;
+        }
+
+        // The rewrites only modify values proven dead, the liveness of the remaining
+        // original nodes stays valid.
+        const auto* node = _program.getHead();
+        while (node != nullptr)
+        {
+            const auto* next = node->getNext();
+
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || !instr->isMetaDataValid() || usesVirtualRegs(*instr))
+            {
+                node = next;
+                continue;
+            }
+
+            bool fixed = false;
+            if ((fixes & Fixes::PartialRegister) != Fixes::None)
+            {
+                if (auto err = fixPartialRegister(node, *instr, fixed); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            if (!fixed && (fixes & Fixes::FalseDependency) != Fixes::None)
+            {
+                if (auto err = fixFalseDependency(node, *instr, fixed); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            if (!fixed && (fixes & Fixes::LengthChangingPrefix) != Fixes::None)
+            {
+                if (auto err = fixLengthChangingPrefix(node, *instr, fixed); err != Error::None)
+                {
+                    return err;
+                }
+            }
+
+            node = next;
+        }
+
+        return Error::None;
+    }
+
+    const HazardFix::Stats& HazardFix::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+    // mov r8/r16, r/m8/r/m16 -> movzx r32, r/m8/r/m16
+    Error HazardFix::fixPartialRegister(const Node* node, const Instruction& instr, bool& fixed)
+    {
+        if (instr.getMnemonic() != x86::Mnemonic::Mov || instr.getExplicitOperandCount() != 2)
+        {
+            return Error::None;
+        }
+
+        const auto mode = _program.getMode();
+
+        const auto* dst = instr.getOperandIf<Reg>(0);
+        if (dst == nullptr || !(dst->isGp8Lo() || dst->isGp16()))
+        {
+            return Error::None;
+        }
+        const auto width = getBitSize(dst->getBitSize(mode));
+
+        const auto& src = instr.getOperand(1);
+        if (const auto* srcReg = src.getIf<Reg>(); srcReg != nullptr)
+        {
+            if (srcReg->isGp8Hi() || getBitSize(srcReg->getBitSize(mode)) != width)
+            {
+                return Error::None;
+            }
+        }
+        else if (const auto* srcMem = src.getIf<Mem>(); srcMem != nullptr)
+        {
+            if (getBitSize(srcMem->getBitSize(mode)) != width)
+            {
+                return Error::None;
+            }
+        }
+        else
+        {
+            return Error::None;
+        }
+
+        if (!isUpperDead(node, *dst, width) && !isUpperZero(node, *dst, width))
+        {
+            return Error::None;
+        }
+
+        _assembler.setCursor(node);
+        if (auto err = _assembler.emit(x86::Mnemonic::Movzx, x86::Gp(dst->getId()).r32(), src); err != Error::None)
+        {
+            return err;
+        }
+        _program.destroy(node);
+
+        _stats.partialRegisterWrites++;
+        fixed = true;
+
+        return Error::None;
+    }
+
+    // popcnt r, r/m -> xor r, r; popcnt r, r/m
+    // cvtsi2ss xmm, r/m -> xorps xmm, xmm; cvtsi2ss xmm, r/m
+    Error HazardFix::fixFalseDependency(const Node* node, const Instruction& instr, bool& fixed)
+    {
+        const auto mnemonic = static_cast<x86::Mnemonic>(instr.getMnemonic());
+        if (instr.getExplicitOperandCount() != 2)
+        {
+            return Error::None;
+        }
+
+        const auto mode = _program.getMode();
+
+        const auto* dst = instr.getOperandIf<Reg>(0);
+        if (dst == nullptr)
+        {
+            return Error::None;
+        }
+        const auto root = dst->getRoot(mode);
+
+        // The source must not depend on the destination.
+        const auto& src = instr.getOperand(1);
+        if (const auto* srcReg = src.getIf<Reg>(); srcReg != nullptr && hasRoot(mode, *srcReg, root))
+        {
+            return Error::None;
+        }
+        if (const auto* srcMem = src.getIf<Mem>();
+            srcMem != nullptr && (hasRoot(mode, srcMem->getBase(), root) || hasRoot(mode, srcMem->getIndex(), root)))
+        {
+            return Error::None;
+        }
+
+        x86::Mnemonic zeroIdiom{};
+        Reg zeroReg{};
+        switch (mnemonic)
+        {
+            case x86::Mnemonic::Popcnt:
+            case x86::Mnemonic::Lzcnt:
+            case x86::Mnemonic::Tzcnt:
+                // 16 bit destinations merge with the old value.
+                if (!dst->isGp32() && !dst->isGp64())
+                {
+                    return Error::None;
+                }
+                // The flags written by the zero idiom are overwritten by the instruction.
+                zeroIdiom = x86::Mnemonic::Xor;
+                zeroReg = x86::Gp(dst->getId()).r32();
+                break;
+            case x86::Mnemonic::Cvtsi2ss:
+            case x86::Mnemonic::Cvtsi2sd:
+                // Only the low element is written, the upper elements are zeroed by the idiom.
+                if (!dst->isXmm() || !isUpperDead(node, *dst, mnemonic == x86::Mnemonic::Cvtsi2ss ? 32 : 64))
+                {
+                    return Error::None;
+                }
+                zeroIdiom = x86::Mnemonic::Xorps;
+                zeroReg = *dst;
+                break;
+            default:
+                return Error::None;
+        }
+
+        // Already broken by a previous run or by the code generator.
+        if (const auto* prev = node->getPrev(); prev != nullptr)
+        {
+            if (const auto* prevInstr = prev->getIf<Instruction>(); prevInstr != nullptr && prevInstr->getMnemonic() == zeroIdiom)
+            {
+                const auto* a = prevInstr->getOperandIf<Reg>(0);
+                const auto* b = prevInstr->getOperandIf<Reg>(1);
+                if (a != nullptr && b != nullptr && *a == zeroReg && *b == zeroReg)
+                {
+                    return Error::None;
+                }
+            }
+        }
+
+        _assembler.setCursor(node->getPrev());
+        if (auto err = _assembler.emit(zeroIdiom, zeroReg, zeroReg); err != Error::None)
+        {
+            return err;
+        }
+
+        _stats.falseDependencies++;
+        fixed = true;
+
+        return Error::None;
+    }
+
+    // add r/m16, imm16 -> mov r32, imm; add r/m16, r16
+    Error HazardFix::fixLengthChangingPrefix(const Node* node, const Instruction& instr, bool& fixed)
+    {
+        if (instr.getExplicitOperandCount() != 2)
+        {
+            return Error::None;
+        }
+
+        const auto mode = _program.getMode();
+
+        const auto* imm = instr.getOperandIf<Imm>(1);
+        if (imm == nullptr)
+        {
+            return Error::None;
+        }
+
+        const auto& dst = instr.getOperand(0);
+        const auto* dstReg = dst.getIf<Reg>();
+        const auto* dstMem = dst.getIf<Mem>();
+        const bool is16 = (dstReg != nullptr && dstReg->isGp16())
+            || (dstMem != nullptr && dstMem->getBitSize(mode) == BitSize::_16);
+        if (!is16)
+        {
+            return Error::None;
+        }
+
+        const auto value = imm->value<std::int64_t>();
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Add:
+            case x86::Mnemonic::Or:
+            case x86::Mnemonic::Adc:
+            case x86::Mnemonic::Sbb:
+            case x86::Mnemonic::And:
+            case x86::Mnemonic::Sub:
+            case x86::Mnemonic::Xor:
+            case x86::Mnemonic::Cmp:
+                // Small values use the sign extended imm8 form.
+                if (isImm8(value))
+                {
+                    return Error::None;
+                }
+                break;
+            case x86::Mnemonic::Test:
+                break;
+            case x86::Mnemonic::Mov:
+                // The register form is not affected by the stall.
+                if (dstMem == nullptr)
+                {
+                    return Error::None;
+                }
+                break;
+            default:
+                return Error::None;
+        }
+
+        // Find a register that is not used by the instruction and whose value is not needed.
+        x86::Gp scratch{};
+        const auto tryScratch = [&](const x86::Gp& reg) {
+            if (scratch.isValid() || referencesRoot(mode, instr, reg.getRoot(mode)))
+            {
+                return;
+            }
+            if (RegisterLiveness::getRegMask(mode, reg) == 0 || _regLiveness.isLiveBefore(node, reg))
+            {
+                return;
+            }
+            scratch = reg;
+        };
+        if (mode == MachineMode::AMD64)
+        {
+            for (const auto& reg : kScratchRegs64)
+            {
+                tryScratch(reg);
+            }
+        }
+        else
+        {
+            for (const auto& reg : kScratchRegs32)
+            {
+                tryScratch(reg);
+            }
+        }
+        if (!scratch.isValid())
+        {
+            return Error::None;
+        }
+
+        _assembler.setCursor(node);
+        if (auto err = _assembler.emit(x86::Mnemonic::Mov, scratch.r32(), Imm(value & 0xFFFF)); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = _assembler.emit(
+                static_cast<x86::Attribs>(instr.getAttribs()), static_cast<x86::Mnemonic>(instr.getMnemonic()), 2,
+                { dst, scratch.r16() });
+            err != Error::None)
+        {
+            return err;
+        }
+        _program.destroy(node);
+
+        _stats.lengthChangingPrefixes++;
+        fixed = true;
+
+        return Error::None;
+    }
+
+    bool HazardFix::isUpperDead(const Node* node, const Reg& reg, std::int32_t width) const noexcept
+    {
+        const auto mode = _program.getMode();
+        const auto root = reg.getRoot(mode);
+        const bool isGp = reg.isGp();
+
+        const Node* last = node;
+        for (const auto* cur = node->getNext(); cur != nullptr; cur = cur->getNext())
+        {
+            const auto* instr = cur->getIf<Instruction>();
+            if (instr == nullptr || !instr->isMetaDataValid() || x86::isBlockTerminator(instr->getMnemonic())
+                || x86::isCall(instr->getMnemonic()))
+            {
+                break;
+            }
+            last = cur;
+
+            if (!referencesRoot(mode, *instr, root))
+            {
+                continue;
+            }
+
+            const auto scalarWidth = isGp ? 0 : getScalarElementWidth(*instr);
+
+            bool fullWrite = false;
+            for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+            {
+                const auto& op = instr->getOperand(i);
+                if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    // Addresses use the entire register.
+                    if (hasRoot(mode, mem->getBase(), root) || hasRoot(mode, mem->getIndex(), root))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                const auto* opReg = op.getIf<Reg>();
+                if (opReg == nullptr || !hasRoot(mode, *opReg, root))
+                {
+                    continue;
+                }
+
+                const auto access = instr->getOperandAccess(i);
+                const bool reads = (access & (Operand::Access::MaskRead | Operand::Access::CondWrite))
+                    != Operand::Access::None;
+                const bool writes = (access & Operand::Access::MaskWrite) != Operand::Access::None;
+                const auto opWidth = getBitSize(opReg->getBitSize(mode));
+
+                if (isGp)
+                {
+                    if (reads && (opWidth > width || (opReg->isGp8Hi() && width == 8)))
+                    {
+                        return false;
+                    }
+                    // 32 bit writes zero extend into the full register.
+                    if (writes && !reads && opWidth >= 32)
+                    {
+                        fullWrite = true;
+                    }
+                }
+                else if (scalarWidth != 0)
+                {
+                    // The destination keeps its upper elements, continue with the next instruction.
+                    if (reads && scalarWidth > width && !(i == 0 && isFullVectorWrite(mode, *instr, root)))
+                    {
+                        return false;
+                    }
+                    fullWrite |= isFullVectorWrite(mode, *instr, root);
+                }
+                else if (isFullVectorWrite(mode, *instr, root))
+                {
+                    fullWrite = true;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            if (fullWrite)
+            {
+                return true;
+            }
+        }
+
+        return !_regLiveness.isLiveAfter(last, root);
+    }
+
+    bool HazardFix::isUpperZero(const Node* node, const Reg& reg, std::int32_t width) const noexcept
+    {
+        const auto mode = _program.getMode();
+        const auto root = reg.getRoot(mode);
+
+        for (const auto* cur = node->getPrev(); cur != nullptr; cur = cur->getPrev())
+        {
+            const auto* instr = cur->getIf<Instruction>();
+            if (instr == nullptr || !instr->isMetaDataValid() || x86::isBlockTerminator(instr->getMnemonic())
+                || x86::isCall(instr->getMnemonic()))
+            {
+                return false;
+            }
+
+            bool writesRoot = false;
+            for (std::size_t i = 0; i < instr->getOperandCount(); ++i)
+            {
+                const auto* opReg = instr->getOperandIf<Reg>(i);
+                if (opReg != nullptr && hasRoot(mode, *opReg, root)
+                    && (instr->getOperandAccess(i) & Operand::Access::MaskWrite) != Operand::Access::None)
+                {
+                    writesRoot = true;
+                }
+            }
+            if (!writesRoot)
+            {
+                continue;
+            }
+
+            // The last definition before the node has to leave the bits above the width zero.
+            const auto* dst = instr->getOperandIf<Reg>(0);
+            if (dst == nullptr || !hasRoot(mode, *dst, root) || !(dst->isGp32() || dst->isGp64()))
+            {
+                return false;
+            }
+
+            switch (static_cast<x86::Mnemonic>(instr->getMnemonic()))
+            {
+                case x86::Mnemonic::Xor:
+                case x86::Mnemonic::Sub:
+                {
+                    const auto* src = instr->getOperandIf<Reg>(1);
+                    return src != nullptr && *src == *dst;
+                }
+                case x86::Mnemonic::Movzx:
+                {
+                    const auto& src = instr->getOperand(1);
+                    if (const auto* srcReg = src.getIf<Reg>(); srcReg != nullptr)
+                    {
+                        return !srcReg->isGp8Hi() && getBitSize(srcReg->getBitSize(mode)) <= width;
+                    }
+                    if (const auto* srcMem = src.getIf<Mem>(); srcMem != nullptr)
+                    {
+                        return getBitSize(srcMem->getBitSize(mode)) <= width;
+                    }
+                    return false;
+                }
+                case x86::Mnemonic::Mov:
+                {
+                    const auto* imm = instr->getOperandIf<Imm>(1);
+                    if (imm == nullptr)
+                    {
+                        return false;
+                    }
+                    const auto value = imm->value<std::int64_t>();
+                    return value >= 0 && value < (std::int64_t{ 1 } << width);
+                }
+                default:
+                    break;
+            }
+            return false;
+        }
+        return false;
+    }
+
+} // namespace zasm
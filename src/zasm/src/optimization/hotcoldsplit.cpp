@@ -0,0 +1,268 @@
+#include "zasm/optimization/hotcoldsplit.hpp"
+
+#include "optimization.blocks.hpp"
+
+#include <cstring>
+#include <vector>
+#include <zasm/analysis/profile.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
+
+namespace zasm
+{
+    using detail::kMeasureBase;
+
+    namespace
+    {
+        struct SplitBlock : detail::OrderedBlock
+        {
+            bool isCold{};
+        };
+    } // namespace
+
+    static std::int64_t getHotSize(const Serializer& serializer)
+    {
+        std::int64_t size = 0;
+        for (std::size_t i = 0; i < serializer.getSectionCount(); ++i)
+        {
+            const auto* info = serializer.getSectionInfo(i);
+            if ((info->attribs & Section::Attribs::Exec) == Section::Attribs::None)
+            {
+                continue;
+            }
+            if (info->name != nullptr && std::strcmp(info->name, HotColdSplit::kColdSectionName) == 0)
+            {
+                continue;
+            }
+            size += info->physicalSize;
+        }
+        return size;
+    }
+
+    static std::int64_t getColdSize(const Serializer& serializer)
+    {
+        std::int64_t size = 0;
+        for (std::size_t i = 0; i < serializer.getSectionCount(); ++i)
+        {
+            const auto* info = serializer.getSectionInfo(i);
+            if (info->name != nullptr && std::strcmp(info->name, HotColdSplit::kColdSectionName) == 0)
+            {
+                size += info->physicalSize;
+            }
+        }
+        return size;
+    }
+
+    HotColdSplit::HotColdSplit(Program& program)
+        : _program(program)
+        , _assembler(program)
+        , _cfg(program)
+        , _coldNodes(program)
+    {
+    }
+
+    void HotColdSplit::markCold(const Label& label)
+    {
+        const auto labelIdx = static_cast<std::size_t>(label.getId());
+        if (labelIdx >= _coldLabels.size())
+        {
+            _coldLabels.resize(labelIdx + 1);
+        }
+        _coldLabels[labelIdx] = true;
+    }
+
+    void HotColdSplit::markCold(const Node* node)
+    {
+        _coldNodes.set(node, true);
+    }
+
+    void HotColdSplit::markCold(const Profile& profile, std::uint64_t threshold)
+    {
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* label = node->getIf<Label>();
+            if (label != nullptr && profile.getLabelWeight(*label) <= threshold)
+            {
+                markCold(*label);
+            }
+        }
+    }
+
+    void HotColdSplit::clearMarks()
+    {
+        _coldNodes.clear();
+        _coldLabels.clear();
+    }
+
+    Error HotColdSplit::run()
+    {
+        _stats = {};
+
+        Serializer serializer;
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.hotSizeBefore = getHotSize(serializer);
+
+        if (auto err = _cfg.update(); err != Error::None)
+        {
+            return err;
+        }
+
+        const auto isMarked = [&](const Node* head, const Node* tail) {
+            if (const auto* label = head->getIf<Label>(); label != nullptr)
+            {
+                const auto labelIdx = static_cast<std::size_t>(label->getId());
+                if (labelIdx < _coldLabels.size() && _coldLabels[labelIdx])
+                {
+                    return true;
+                }
+            }
+            for (const auto* node = head;; node = node->getNext())
+            {
+                if (_coldNodes.get(node))
+                {
+                    return true;
+                }
+                if (node == tail)
+                {
+                    break;
+                }
+            }
+            return false;
+        };
+
+        std::vector<SplitBlock> blocks;
+        detail::collectBlocks(_program, _cfg, blocks);
+
+        // The first block of each region stays in place, blocks moved by a previous run are already cold.
+        std::size_t coldRegion = detail::kNoBlock;
+        std::size_t lastColdBlock = detail::kNoBlock;
+        std::size_t coldCount = 0;
+        bool isExecutable = true;
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            auto& block = blocks[i];
+            if (const auto* section = block.head->getIf<Section>(); section != nullptr)
+            {
+                isExecutable = (_program.getSectionAttribs(*section) & Section::Attribs::Exec) != Section::Attribs::None;
+
+                const auto* name = _program.getSectionName(*section);
+                if (coldRegion == detail::kNoBlock && name != nullptr && std::strcmp(name, kColdSectionName) == 0)
+                {
+                    coldRegion = block.region;
+                }
+            }
+
+            if (block.region == coldRegion)
+            {
+                lastColdBlock = i;
+                continue;
+            }
+
+            block.isCold = isExecutable && !block.isRegionStart && isMarked(block.head, block.tail);
+            if (block.isCold)
+            {
+                coldCount++;
+            }
+        }
+
+        if (coldCount == 0)
+        {
+            _stats.hotSizeAfter = _stats.hotSizeBefore;
+            return Error::None;
+        }
+
+        // Hot blocks keep their order, the cold blocks follow at the end of the cold section.
+        std::vector<std::size_t> order;
+        order.reserve(blocks.size());
+
+        const auto appendColdBlocks = [&]() {
+            for (std::size_t i = 0; i < blocks.size(); ++i)
+            {
+                if (blocks[i].isCold)
+                {
+                    order.push_back(i);
+                }
+            }
+        };
+
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (!blocks[i].isCold)
+            {
+                order.push_back(i);
+            }
+            if (i == lastColdBlock)
+            {
+                appendColdBlocks();
+            }
+        }
+
+        const Node* pos = nullptr;
+        if (lastColdBlock != detail::kNoBlock)
+        {
+            pos = blocks[lastColdBlock].tail;
+        }
+        else
+        {
+            appendColdBlocks();
+
+            const auto coldSection = _program.createSection(kColdSectionName, Section::Attribs::Code, Section::kDefaultAlign);
+            const auto sectionNode = _program.bindSection(coldSection);
+            if (!sectionNode.hasValue())
+            {
+                return sectionNode.error();
+            }
+            pos = _program.insertAfter(_program.getTail(), sectionNode.value());
+        }
+
+        for (const auto& block : blocks)
+        {
+            if (!block.isCold)
+            {
+                continue;
+            }
+
+            const auto* node = block.head;
+            while (true)
+            {
+                const auto* next = node->getNext();
+                const bool isLast = node == block.tail;
+
+                pos = _program.moveAfter(pos, node);
+                if (isLast)
+                {
+                    break;
+                }
+                node = next;
+            }
+
+            _stats.blocksMoved++;
+        }
+
+        // Replace the fallthroughs that now lead into the other section.
+        if (auto err = detail::repairFallthroughs(
+                _program, _assembler, blocks, order, _stats.branchesInverted, _stats.jumpsInserted);
+            err != Error::None)
+        {
+            return err;
+        }
+
+        if (auto err = serializer.serialize(_program, kMeasureBase); err != Error::None)
+        {
+            return err;
+        }
+        _stats.hotSizeAfter = getHotSize(serializer);
+        _stats.coldSize = getColdSize(serializer);
+
+        return Error::None;
+    }
+
+    const HotColdSplit::Stats& HotColdSplit::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+} // namespace zasm
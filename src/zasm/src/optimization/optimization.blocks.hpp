@@ -0,0 +1,180 @@
+#pragma once
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/assembler.hpp>
+
+namespace zasm::detail
+{
+    // Arbitrary base used to measure the code, relative branches do not depend on it.
+    inline constexpr std::int64_t kMeasureBase = 0x1000;
+
+    inline constexpr std::size_t kNoBlock = std::numeric_limits<std::size_t>::max();
+
+    // Basic block in program order, passes that reorder blocks derive from it to add their own data.
+    struct OrderedBlock
+    {
+        const Node* head{};
+        const Node* tail{};
+        // The first block and blocks that start a section.
+        bool isRegionStart{};
+        std::size_t region{};
+        std::size_t fallthrough{ kNoBlock };
+        std::size_t taken{ kNoBlock };
+        // Label created for blocks that did not start with one.
+        Label label{};
+    };
+
+    inline Instruction::Mnemonic getMnemonic(const Node* node) noexcept
+    {
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr)
+        {
+            return static_cast<Instruction::Mnemonic>(x86::Mnemonic::Invalid);
+        }
+        return instr->getMnemonic();
+    }
+
+    inline const Label* getBranchLabel(const Node* node) noexcept
+    {
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr || !x86::isBranch(instr->getMnemonic()))
+        {
+            return nullptr;
+        }
+        return instr->getOperandIf<Label>(0);
+    }
+
+    // Collects the blocks of the graph in program order and resolves the successors to block indices.
+    template<typename TBlock>
+    void collectBlocks(const Program& program, const ControlFlowGraph& cfg, std::vector<TBlock>& blocks)
+    {
+        using BlockId = ControlFlowGraph::BlockId;
+
+        blocks.clear();
+        std::vector<std::size_t> blockIndices(cfg.getBlockCount(), kNoBlock);
+
+        for (const auto* node = program.getHead(); node != nullptr;)
+        {
+            const auto id = cfg.getBlockOf(node);
+            const auto& block = cfg.getBlock(id);
+
+            TBlock entry{};
+            entry.head = block.head;
+            entry.tail = block.tail;
+            entry.isRegionStart = blocks.empty() || block.head->holds<Section>();
+            entry.region = blocks.empty() ? 0 : blocks.back().region + (entry.isRegionStart ? 1 : 0);
+
+            blockIndices[static_cast<std::size_t>(id)] = blocks.size();
+            blocks.push_back(entry);
+
+            node = block.tail->getNext();
+        }
+
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            auto& block = blocks[i];
+
+            const auto mnemonic = getMnemonic(block.tail);
+
+            // Sections are placed independently, running off the end of one does not lead into the next.
+            if (!x86::isUnconditionalBranch(mnemonic) && !x86::isReturn(mnemonic) && i + 1 < blocks.size()
+                && !blocks[i + 1].isRegionStart)
+            {
+                block.fallthrough = i + 1;
+            }
+
+            if (const auto* label = getBranchLabel(block.tail); label != nullptr)
+            {
+                const auto targetId = cfg.getBlockOf(*label);
+                if (targetId != BlockId::Invalid)
+                {
+                    block.taken = blockIndices[static_cast<std::size_t>(targetId)];
+                }
+            }
+        }
+    }
+
+    // Returns the label the block starts with, creates and binds one in front of the block if there is none.
+    inline Label getBlockLabel(x86::Assembler& assembler, OrderedBlock& block)
+    {
+        if (const auto* label = block.head->getIf<Label>(); label != nullptr)
+        {
+            return *label;
+        }
+        if (block.label.isValid())
+        {
+            return block.label;
+        }
+
+        block.label = assembler.createLabel();
+
+        // Labels are placed after the section node so they are part of the section.
+        assembler.setCursor(block.head->holds<Section>() ? block.head : block.head->getPrev());
+        assembler.bind(block.label);
+
+        return block.label;
+    }
+
+    // Replaces the fallthroughs that no longer lead to the next block of the order, a conditional branch
+    // is inverted if its target became the next block otherwise a jmp to the old fallthrough is inserted.
+    template<typename TBlock>
+    Error repairFallthroughs(
+        Program& program, x86::Assembler& assembler, std::vector<TBlock>& blocks, const std::vector<std::size_t>& order,
+        std::size_t& branchesInverted, std::size_t& jumpsInserted)
+    {
+        for (std::size_t k = 0; k < order.size(); ++k)
+        {
+            auto& block = blocks[order[k]];
+            const auto nextIdx = k + 1 < order.size() ? order[k + 1] : kNoBlock;
+
+            if (block.fallthrough == kNoBlock || block.fallthrough == nextIdx)
+            {
+                continue;
+            }
+
+            const auto fallthroughLabel = getBlockLabel(assembler, blocks[block.fallthrough]);
+
+            const auto mnemonic = getMnemonic(block.tail);
+            if (x86::isConditionalBranch(mnemonic) && block.taken != kNoBlock && block.taken == nextIdx)
+            {
+                const auto inverted = x86::getInvertedCondition(mnemonic);
+                if (inverted != x86::Mnemonic::Invalid)
+                {
+                    assembler.setCursor(block.tail);
+                    if (auto err = assembler.emit(inverted, fallthroughLabel); err != Error::None)
+                    {
+                        return err;
+                    }
+
+                    // The block now ends with the new branch, the old node is freed.
+                    const auto* oldTail = block.tail;
+                    if (block.head == oldTail)
+                    {
+                        block.head = assembler.getCursor();
+                    }
+                    block.tail = assembler.getCursor();
+                    program.destroy(oldTail);
+                    branchesInverted++;
+                    continue;
+                }
+            }
+
+            assembler.setCursor(block.tail);
+            if (auto err = assembler.jmp(fallthroughLabel); err != Error::None)
+            {
+                return err;
+            }
+            jumpsInserted++;
+        }
+
+        return Error::None;
+    }
+
+} // namespace zasm::detail
@@ -0,0 +1,309 @@
+#include "zasm/optimization/peephole.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    using Window = Peephole::Window;
+    using Context = Peephole::Context;
+
+    static bool isImm(const Instruction& instr, std::size_t index, std::int64_t value) noexcept
+    {
+        const auto* imm = instr.getOperandIf<Imm>(index);
+        return imm != nullptr && imm->value<std::int64_t>() == value;
+    }
+
+    // mov reg, 0 -> xor reg32, reg32
+    static bool matchMovZero(const Context& ctx, const Window& window)
+    {
+        const auto& instr = window.get(0);
+        const auto* reg = instr.getOperandIf<Reg>(0);
+        if (reg == nullptr || !(reg->isGp32() || reg->isGp64()) || !isImm(instr, 1, 0))
+        {
+            return false;
+        }
+        return !ctx.flagsLiveness.isLiveAfter(window.getNode(0), FlagsLiveness::kStatusFlags);
+    }
+
+    static Error rewriteMovZero(Context& ctx, const Window& window)
+    {
+        const auto* node = window.getNode(0);
+
+        // Writing the 32 bit register zero extends into the 64 bit register.
+        const auto reg = x86::Gp(window.get(0).getOperand<Reg>(0).getId()).r32();
+
+        ctx.assembler.setCursor(node);
+        if (auto err = ctx.assembler.emit(x86::Mnemonic::Xor, reg, reg); err != Error::None)
+        {
+            return err;
+        }
+
+        ctx.program.destroy(node);
+        return Error::None;
+    }
+
+    // add reg, 1 -> inc reg, sub reg, 1 -> dec reg
+    static bool matchAddSubOne(const Context& ctx, const Window& window)
+    {
+        const auto& instr = window.get(0);
+        const auto* reg = instr.getOperandIf<Reg>(0);
+        if (reg == nullptr || !reg->isGp())
+        {
+            return false;
+        }
+        if (!isImm(instr, 1, 1) && !isImm(instr, 1, -1))
+        {
+            return false;
+        }
+        // inc and dec do not update the carry flag.
+        return !ctx.flagsLiveness.isLiveAfter(window.getNode(0), FlagsLiveness::kCF);
+    }
+
+    static Error rewriteAddSubOne(Context& ctx, const Window& window)
+    {
+        const auto* node = window.getNode(0);
+        const auto& instr = window.get(0);
+
+        const bool isAdd = static_cast<x86::Mnemonic>(instr.getMnemonic()) == x86::Mnemonic::Add;
+        const bool isIncrement = isAdd == isImm(instr, 1, 1);
+
+        ctx.assembler.setCursor(node);
+        const auto err = ctx.assembler.emit(
+            isIncrement ? x86::Mnemonic::Inc : x86::Mnemonic::Dec, instr.getOperand<Reg>(0));
+        if (err != Error::None)
+        {
+            return err;
+        }
+
+        ctx.program.destroy(node);
+        return Error::None;
+    }
+
+    // mov a, b; mov b, a -> mov a, b
+    static bool matchMovSwapBack(const Context& ctx, const Window& window)
+    {
+        const auto& first = window.get(0);
+        const auto& second = window.get(1);
+
+        const auto* dstA = first.getOperandIf<Reg>(0);
+        const auto* srcA = first.getOperandIf<Reg>(1);
+        const auto* dstB = second.getOperandIf<Reg>(0);
+        const auto* srcB = second.getOperandIf<Reg>(1);
+        if (dstA == nullptr || srcA == nullptr || dstB == nullptr || srcB == nullptr)
+        {
+            return false;
+        }
+        if (*dstA != *srcB || *srcA != *dstB || !dstA->isGp())
+        {
+            return false;
+        }
+
+        // Writing a 32 bit register clears the upper half, the second move is not a no-op.
+        return !(ctx.program.getMode() == MachineMode::AMD64 && dstA->isGp32());
+    }
+
+    static Error rewriteMovSwapBack(Context& ctx, const Window& window)
+    {
+        ctx.program.destroy(window.getNode(1));
+        return Error::None;
+    }
+
+    // Returns true if the label follows the node with only labels in between.
+    static bool isLabelNext(const Node* node, const Label& label) noexcept
+    {
+        for (const auto* next = node->getNext(); next != nullptr; next = next->getNext())
+        {
+            const auto* nextLabel = next->getIf<Label>();
+            if (nextLabel == nullptr)
+            {
+                return false;
+            }
+            if (nextLabel->getId() == label.getId())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // jmp/jcc label; label: -> label:
+    static bool matchBranchToNext([[maybe_unused]] const Context& ctx, const Window& window)
+    {
+        const auto& instr = window.get(0);
+
+        const auto mnemonic = instr.getMnemonic();
+        if (!x86::isBranch(mnemonic))
+        {
+            return false;
+        }
+
+        // The loop instructions also decrement the counter.
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Loop:
+            case x86::Mnemonic::Loope:
+            case x86::Mnemonic::Loopne:
+                return false;
+            default:
+                break;
+        }
+
+        const auto* label = instr.getOperandIf<Label>(0);
+        if (label == nullptr)
+        {
+            return false;
+        }
+        return isLabelNext(window.getNode(0), *label);
+    }
+
+    static Error rewriteBranchToNext(Context& ctx, const Window& window)
+    {
+        ctx.program.destroy(window.getNode(0));
+        return Error::None;
+    }
+
+    Peephole::Peephole(Program& program)
+        : _program(program)
+        , _assembler(program)
+        , _cfg(program)
+        , _regLiveness(program, _cfg)
+        , _flagsLiveness(program, _cfg)
+    {
+    }
+
+    void Peephole::addRule(const Rule& rule)
+    {
+        _rules.push_back(rule);
+        _ruleHits.push_back(0);
+    }
+
+    void Peephole::addDefaultRules()
+    {
+        using x86::Mnemonic;
+
+        addRule({ "mov-zero", { Mnemonic::Mov }, 1, matchMovZero, rewriteMovZero });
+        addRule({ "add-one", { Mnemonic::Add }, 1, matchAddSubOne, rewriteAddSubOne });
+        addRule({ "sub-one", { Mnemonic::Sub }, 1, matchAddSubOne, rewriteAddSubOne });
+        addRule({ "mov-swap-back", { Mnemonic::Mov, Mnemonic::Mov }, 2, matchMovSwapBack, rewriteMovSwapBack });
+        addRule({ "branch-to-next", { Mnemonic::Invalid }, 1, matchBranchToNext, rewriteBranchToNext });
+    }
+
+    static bool matchesMnemonics(const Peephole::Rule& rule, const Window& window) noexcept
+    {
+        if (rule.windowSize > window.size)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < rule.windowSize; ++i)
+        {
+            const auto expected = rule.mnemonics[i];
+            if (expected != x86::Mnemonic::Invalid && static_cast<x86::Mnemonic>(window.get(i).getMnemonic()) != expected)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Error Peephole::run(std::size_t maxPasses)
+    {
+        Context ctx{ _program, _assembler, _regLiveness, _flagsLiveness };
+
+        for (std::size_t pass = 0; pass < maxPasses; ++pass)
+        {
+            if (auto err = _regLiveness.run(); err != Error::None)
+            {
+                return err;
+            }
+            if (auto err = _flagsLiveness.run(); err != Error::None)
+            {
+                return err;
+            }
+
+            bool changed = false;
+
+            const auto* node = _program.getHead();
+            while (node != nullptr)
+            {
+                Window window{};
+                for (const auto* cur = node; cur != nullptr && window.size < kMaxWindowSize; cur = cur->getNext())
+                {
+                    if (!cur->holds<Instruction>())
+                    {
+                        break;
+                    }
+                    window.nodes[window.size++] = cur;
+                }
+
+                if (window.size == 0)
+                {
+                    node = node->getNext();
+                    continue;
+                }
+
+                const Node* next = node->getNext();
+                for (std::size_t i = 0; i < _rules.size(); ++i)
+                {
+                    const auto& rule = _rules[i];
+                    if (!matchesMnemonics(rule, window) || !rule.match(ctx, window))
+                    {
+                        continue;
+                    }
+
+                    // The rewrite may remove any node of the window.
+                    next = window.nodes[rule.windowSize - 1]->getNext();
+
+                    if (auto err = rule.rewrite(ctx, window); err != Error::None)
+                    {
+                        return err;
+                    }
+
+                    _ruleHits[i]++;
+                    changed = true;
+                    break;
+                }
+
+                node = next;
+            }
+
+            if (!changed)
+            {
+                break;
+            }
+        }
+
+        return Error::None;
+    }
+
+    std::size_t Peephole::getRuleCount() const noexcept
+    {
+        return _rules.size();
+    }
+
+    const Peephole::Rule& Peephole::getRule(std::size_t index) const noexcept
+    {
+        return _rules[index];
+    }
+
+    std::size_t Peephole::getRuleHits(std::size_t index) const noexcept
+    {
+        if (index >= _ruleHits.size())
+        {
+            return 0;
+        }
+        return _ruleHits[index];
+    }
+
+    std::size_t Peephole::getRewriteCount() const noexcept
+    {
+        std::size_t count = 0;
+        for (const auto hits : _ruleHits)
+        {
+            count += hits;
+        }
+        return count;
+    }
+
+} // namespace zasm
@@ -0,0 +1,485 @@
+#include "zasm/optimization/scheduler.hpp"
+
+#include "../x86/x86.controlflow.hpp"
+#include "../x86/x86.regaccess.hpp"
+
+#include <Zydis/Zydis.h>
+#include <algorithm>
+#include <zasm/program/program.hpp>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm
+{
+    static constexpr std::int32_t kNoWriter = -1;
+
+    // Every flag bit has its own slot after the physical registers, followed by the virtual registers.
+    static constexpr std::uint32_t kFlagSlot = ZYDIS_REGISTER_MAX_VALUE + 1;
+    static constexpr std::uint32_t kFlagSlotCount = 32;
+    static constexpr std::uint32_t kVirtualRegSlot = kFlagSlot + kFlagSlotCount;
+
+    static bool isBarrier(const Instruction& instr) noexcept
+    {
+        return !instr.isMetaDataValid() || x86::hasSideEffects(instr);
+    }
+
+    static std::uint32_t getRegSlot(MachineMode mode, const Reg& reg) noexcept
+    {
+        if (reg.isVirtual())
+        {
+            return kVirtualRegSlot + static_cast<std::uint32_t>(reg.getVirtualIndex());
+        }
+        return static_cast<std::uint32_t>(reg.getRoot(mode).getId());
+    }
+
+    Scheduler::Scheduler(Program& program, const MachineModel& model)
+        : _program(program)
+        , _model(model)
+        , _analyzer(program, model)
+    {
+    }
+
+    Error Scheduler::run()
+    {
+        _stats = {};
+
+        const auto slotCount = kVirtualRegSlot + _program.getVirtualRegCount();
+        _lastWriter.assign(slotCount, kNoWriter);
+        _readers.resize(slotCount);
+        _deadFlagsWriters.resize(kFlagSlotCount);
+        _nodes.clear();
+
+        for (const auto* node = _program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || isBarrier(*instr))
+            {
+                // The node stays in place, the nodes before it are a complete region.
+                scheduleRegion();
+                continue;
+            }
+
+            SchedNode entry{};
+            entry.node = node;
+            _nodes.push_back(entry);
+        }
+        scheduleRegion();
+
+        return Error::None;
+    }
+
+    const Scheduler::Stats& Scheduler::getStats() const noexcept
+    {
+        return _stats;
+    }
+
+    void Scheduler::scheduleRegion()
+    {
+        if (_nodes.size() < 2)
+        {
+            _nodes.clear();
+            return;
+        }
+
+        _stats.regions++;
+        _stats.instructions += _nodes.size();
+
+        buildGraph();
+
+        _order.resize(_nodes.size());
+        for (std::uint32_t i = 0; i < _order.size(); ++i)
+        {
+            _order[i] = i;
+        }
+        const auto cyclesBefore = estimateCycles(_order);
+
+        listSchedule();
+        const auto cyclesAfter = estimateCycles(_order);
+        _stats.cyclesBefore += cyclesBefore;
+
+        // Keep the original order unless the new one is estimated to be faster.
+        if (cyclesAfter >= cyclesBefore)
+        {
+            _stats.cyclesAfter += cyclesBefore;
+            _nodes.clear();
+            return;
+        }
+        _stats.cyclesAfter += cyclesAfter;
+
+        const auto* pos = _nodes.front().node->getPrev();
+        for (const auto index : _order)
+        {
+            const auto* node = _nodes[index].node;
+            const auto* expected = pos != nullptr ? pos->getNext() : _program.getHead();
+            if (node != expected)
+            {
+                _program.moveAfter(pos, node);
+                _stats.instructionsMoved++;
+            }
+            pos = node;
+        }
+
+        _nodes.clear();
+    }
+
+    void Scheduler::addEdge(std::uint32_t from, std::uint32_t to, std::int32_t latency)
+    {
+        if (from == to)
+        {
+            return;
+        }
+        // Flags are tracked per bit, the same pair is usually added for each bit in a row.
+        if (!_edges.empty() && _edges.back().from == from && _edges.back().to == to)
+        {
+            return;
+        }
+        _edges.push_back(Edge{ from, to, latency });
+    }
+
+    void Scheduler::buildGraph()
+    {
+        const auto mode = _program.getMode();
+        const auto count = static_cast<std::uint32_t>(_nodes.size());
+
+        _edges.clear();
+
+        for (auto& entry : _nodes)
+        {
+            const auto& instr = entry.node->get<Instruction>();
+            const auto& flags = instr.getCPUFlags();
+            entry.latency = _analyzer.getLatency(instr);
+            entry.flagsRead = flags.read;
+            entry.flagsWritten = flags.write | flags.undefined;
+        }
+
+        // Same as the FlagsLiveness, all flags may be read after the region.
+        std::uint32_t flagsLive = ~std::uint32_t{ 0 };
+        for (auto i = count; i-- > 0;)
+        {
+            auto& entry = _nodes[i];
+            entry.flagsLive = entry.flagsWritten & flagsLive;
+            flagsLive = (flagsLive & ~entry.flagsWritten) | entry.flagsRead;
+        }
+
+        std::int32_t lastStore = kNoWriter;
+        std::vector<std::uint32_t> loads;
+
+        const auto readSlot = [&](std::uint32_t index, std::uint32_t slot) {
+            if (_readers[slot].empty() && _lastWriter[slot] == kNoWriter)
+            {
+                _touchedSlots.push_back(slot);
+            }
+            if (const auto writer = _lastWriter[slot]; writer != kNoWriter)
+            {
+                addEdge(static_cast<std::uint32_t>(writer), index, _nodes[writer].latency);
+            }
+            _readers[slot].push_back(index);
+        };
+
+        const auto writeSlot = [&](std::uint32_t index, std::uint32_t slot) {
+            if (_readers[slot].empty() && _lastWriter[slot] == kNoWriter)
+            {
+                _touchedSlots.push_back(slot);
+            }
+            if (const auto writer = _lastWriter[slot]; writer != kNoWriter)
+            {
+                addEdge(static_cast<std::uint32_t>(writer), index, 0);
+            }
+            for (const auto reader : _readers[slot])
+            {
+                addEdge(reader, index, 0);
+            }
+            _readers[slot].clear();
+            _lastWriter[slot] = static_cast<std::int32_t>(index);
+        };
+
+        // A flag that is written but never read only has to stay out of the ranges between the
+        // other writes and their readers, dead writes may be reordered among each other.
+        const auto writeFlag = [&](std::uint32_t index, std::uint32_t bit, bool live) {
+            const auto slot = kFlagSlot + bit;
+            auto& deadWriters = _deadFlagsWriters[bit];
+            if (live)
+            {
+                for (const auto writer : deadWriters)
+                {
+                    addEdge(writer, index, 0);
+                }
+                deadWriters.clear();
+                writeSlot(index, slot);
+                return;
+            }
+            if (const auto writer = _lastWriter[slot]; writer != kNoWriter)
+            {
+                addEdge(static_cast<std::uint32_t>(writer), index, 0);
+            }
+            for (const auto reader : _readers[slot])
+            {
+                addEdge(reader, index, 0);
+            }
+            deadWriters.push_back(index);
+        };
+
+        for (std::uint32_t index = 0; index < count; ++index)
+        {
+            const auto& entry = _nodes[index];
+            const auto& instr = entry.node->get<Instruction>();
+
+            bool loadsMem = false;
+            bool storesMem = false;
+
+            // Inputs first so instructions that read and write a register do not depend on themselves.
+            for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                const auto& op = instr.getOperand(i);
+                const auto access = instr.getOperandAccess(i);
+                const bool reads = (access & (Operand::Access::MaskRead | Operand::Access::CondWrite))
+                    != Operand::Access::None;
+                const bool writes = (access & Operand::Access::MaskWrite) != Operand::Access::None;
+
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr && x86::isTrackedReg(*reg))
+                {
+                    if (reads || (writes && x86::isPartialWrite(mode, *reg)))
+                    {
+                        readSlot(index, getRegSlot(mode, *reg));
+                    }
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    if (x86::isTrackedReg(mem->getBase()))
+                    {
+                        readSlot(index, getRegSlot(mode, mem->getBase()));
+                    }
+                    if (x86::isTrackedReg(mem->getIndex()))
+                    {
+                        readSlot(index, getRegSlot(mode, mem->getIndex()));
+                    }
+                    loadsMem |= (access & Operand::Access::MaskRead) != Operand::Access::None;
+                    storesMem |= writes;
+                }
+            }
+
+            for (std::size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                const auto* reg = instr.getOperandIf<Reg>(i);
+                if (reg == nullptr || !x86::isTrackedReg(*reg))
+                {
+                    continue;
+                }
+                if ((instr.getOperandAccess(i) & Operand::Access::MaskWrite) != Operand::Access::None)
+                {
+                    writeSlot(index, getRegSlot(mode, *reg));
+                }
+            }
+
+            // Memory is assumed to alias, loads are only ordered against stores.
+            if (loadsMem)
+            {
+                if (lastStore != kNoWriter)
+                {
+                    addEdge(static_cast<std::uint32_t>(lastStore), index, 0);
+                }
+                loads.push_back(index);
+            }
+            if (storesMem)
+            {
+                if (lastStore != kNoWriter)
+                {
+                    addEdge(static_cast<std::uint32_t>(lastStore), index, 0);
+                }
+                for (const auto load : loads)
+                {
+                    addEdge(load, index, 0);
+                }
+                loads.clear();
+                lastStore = static_cast<std::int32_t>(index);
+            }
+
+            // Reads first so instructions like adc do not depend on themselves.
+            for (std::uint32_t bit = 0; bit < kFlagSlotCount; ++bit)
+            {
+                if ((entry.flagsRead & (1U << bit)) != 0)
+                {
+                    readSlot(index, kFlagSlot + bit);
+                }
+            }
+            for (std::uint32_t bit = 0; bit < kFlagSlotCount; ++bit)
+            {
+                if ((entry.flagsWritten & (1U << bit)) != 0)
+                {
+                    writeFlag(index, bit, (entry.flagsLive & (1U << bit)) != 0);
+                }
+            }
+        }
+
+        for (const auto slot : _touchedSlots)
+        {
+            _lastWriter[slot] = kNoWriter;
+            _readers[slot].clear();
+        }
+        _touchedSlots.clear();
+        for (auto& deadWriters : _deadFlagsWriters)
+        {
+            deadWriters.clear();
+        }
+
+        // Successor lists sorted by the source node.
+        for (auto& entry : _nodes)
+        {
+            entry.succCount = 0;
+            entry.predCount = 0;
+        }
+        for (const auto& edge : _edges)
+        {
+            _nodes[edge.from].succCount++;
+            _nodes[edge.to].predCount++;
+        }
+        std::uint32_t offset = 0;
+        for (auto& entry : _nodes)
+        {
+            entry.firstSucc = offset;
+            offset += entry.succCount;
+            entry.succCount = 0;
+        }
+        _succs.resize(_edges.size());
+        _succLatencies.resize(_edges.size());
+        for (const auto& edge : _edges)
+        {
+            auto& from = _nodes[edge.from];
+            _succs[from.firstSucc + from.succCount] = edge.to;
+            _succLatencies[from.firstSucc + from.succCount] = edge.latency;
+            from.succCount++;
+        }
+
+        // Edges always point forward so the reverse program order visits successors first.
+        for (auto i = count; i-- > 0;)
+        {
+            auto& entry = _nodes[i];
+            entry.height = entry.latency;
+            for (std::uint32_t j = 0; j < entry.succCount; ++j)
+            {
+                const auto succ = _succs[entry.firstSucc + j];
+                entry.height = std::max(entry.height, _succLatencies[entry.firstSucc + j] + _nodes[succ].height);
+            }
+        }
+    }
+
+    void Scheduler::listSchedule()
+    {
+        const auto count = static_cast<std::uint32_t>(_nodes.size());
+        const auto issueWidth = std::max(_model.issueWidth, 1);
+
+        // Min heap on the earliest cycle the instruction can start.
+        const auto laterStart = [this](std::uint32_t a, std::uint32_t b) {
+            if (_nodes[a].earliest != _nodes[b].earliest)
+            {
+                return _nodes[a].earliest > _nodes[b].earliest;
+            }
+            return a > b;
+        };
+        // Max heap on the height, ties prefer the original order.
+        const auto lowerPriority = [this](std::uint32_t a, std::uint32_t b) {
+            if (_nodes[a].height != _nodes[b].height)
+            {
+                return _nodes[a].height < _nodes[b].height;
+            }
+            return a > b;
+        };
+
+        _order.clear();
+        _available.clear();
+        _ready.clear();
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            _nodes[i].earliest = 0;
+            if (_nodes[i].predCount == 0)
+            {
+                _available.push_back(i);
+            }
+        }
+        std::make_heap(_available.begin(), _available.end(), laterStart);
+
+        std::int32_t cycle = 0;
+        std::int32_t issued = 0;
+        while (_order.size() < count)
+        {
+            while (!_available.empty() && _nodes[_available.front()].earliest <= cycle)
+            {
+                std::pop_heap(_available.begin(), _available.end(), laterStart);
+                _ready.push_back(_available.back());
+                _available.pop_back();
+                std::push_heap(_ready.begin(), _ready.end(), lowerPriority);
+            }
+
+            if (_ready.empty())
+            {
+                // Stall until the next instruction has its inputs.
+                cycle = _nodes[_available.front()].earliest;
+                issued = 0;
+                continue;
+            }
+
+            std::pop_heap(_ready.begin(), _ready.end(), lowerPriority);
+            const auto index = _ready.back();
+            _ready.pop_back();
+            _order.push_back(index);
+
+            const auto& entry = _nodes[index];
+            for (std::uint32_t j = 0; j < entry.succCount; ++j)
+            {
+                const auto succ = _succs[entry.firstSucc + j];
+                auto& succEntry = _nodes[succ];
+                succEntry.earliest = std::max(succEntry.earliest, cycle + _succLatencies[entry.firstSucc + j]);
+                if (--succEntry.predCount == 0)
+                {
+                    _available.push_back(succ);
+                    std::push_heap(_available.begin(), _available.end(), laterStart);
+                }
+            }
+
+            if (++issued == issueWidth)
+            {
+                cycle++;
+                issued = 0;
+            }
+        }
+    }
+
+    std::int64_t Scheduler::estimateCycles(const std::vector<std::uint32_t>& order)
+    {
+        const auto issueWidth = std::max(_model.issueWidth, 1);
+
+        for (auto& entry : _nodes)
+        {
+            entry.earliest = 0;
+        }
+
+        // In-order issue, an instruction waits for its inputs and blocks the following ones.
+        std::int32_t cycle = 0;
+        std::int32_t issued = 0;
+        std::int32_t end = 0;
+        for (const auto index : order)
+        {
+            const auto& entry = _nodes[index];
+            if (entry.earliest > cycle)
+            {
+                cycle = entry.earliest;
+                issued = 0;
+            }
+
+            for (std::uint32_t j = 0; j < entry.succCount; ++j)
+            {
+                auto& succEntry = _nodes[_succs[entry.firstSucc + j]];
+                succEntry.earliest = std::max(succEntry.earliest, cycle + _succLatencies[entry.firstSucc + j]);
+            }
+            end = std::max(end, cycle + std::max(entry.latency, 1));
+
+            if (++issued == issueWidth)
+            {
+                cycle++;
+                issued = 0;
+            }
+        }
+        return end;
+    }
+
+} // namespace zasm
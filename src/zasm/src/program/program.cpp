@@ -262,14 +262,14 @@ namespace zasm
 
     const Node* Program::moveAfter(const Node* pos, const Node* node) noexcept
     {
-        detach_<false>(node, *_state);
-        return insertAfter_<false>(pos, node, *_state);
+        detach_<true>(node, *_state);
+        return insertAfter_<true>(pos, node, *_state);
     }
 
     const Node* Program::moveBefore(const Node* pos, const Node* node) noexcept
     {
-        detach_<false>(node, *_state);
-        return insertBefore_<false>(pos, node, *_state);
+        detach_<true>(node, *_state);
+        return insertBefore_<true>(pos, node, *_state);
     }
 
     void Program::destroy(const Node* node)
@@ -303,6 +303,10 @@ namespace zasm
         _state->sections.clear();
         _state->labels.clear();
         _state->symbolNames.clear();
+        _state->constants.clear();
+        _state->constantBytes.clear();
+        _state->constantsByHash.clear();
+        _state->virtualRegs.clear();
     }
 
     void Program::setEntryPoint(const Label& label)
@@ -359,6 +363,11 @@ namespace zasm
         return createNode_(*_state, label);
     }
 
+    const Node* Program::createNode(const Align& align)
+    {
+        return createNode_(*_state, align);
+    }
+
     static StringPool::Id getStringId(detail::ProgramState& state, const char* str)
     {
         if (str == nullptr)
@@ -412,7 +421,7 @@ namespace zasm
             return makeUnexpected(Error::ExternalLabelNotBindable);
         }
 
-        if (entry.node != nullptr)
+        if (entry.node != nullptr || (entry.flags & LabelFlags::Constant) != LabelFlags::None)
         {
             return makeUnexpected(Error::LabelAlreadyBound);
         }
@@ -491,6 +500,122 @@ namespace zasm
         return res;
     }
 
+    static std::size_t getConstantHash(const std::uint8_t* data, std::size_t size) noexcept
+    {
+        // FNV-1a
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 0x00000100000001B3ULL;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+
+    Label Program::getOrCreateConstant(const void* data, std::size_t size, std::int32_t align)
+    {
+        if (data == nullptr || size == 0)
+        {
+            return Label{};
+        }
+        if (align <= 0 || align > Section::kDefaultAlign || (align & (align - 1)) != 0)
+        {
+            return Label{};
+        }
+
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+        const auto hash = getConstantHash(bytes, size);
+
+        auto& state = *_state;
+
+        const auto [first, last] = state.constantsByHash.equal_range(hash);
+        for (auto it = first; it != last; ++it)
+        {
+            auto& entry = state.constants[it->second];
+            if (entry.size == size && std::memcmp(state.constantBytes.data() + entry.offset, bytes, size) == 0)
+            {
+                entry.align = std::max(entry.align, align);
+                return Label{ entry.label };
+            }
+        }
+
+        const auto label = createLabel_(state, StringPool::Id::Invalid, StringPool::Id::Invalid, LabelFlags::Constant);
+
+        auto& entry = state.constants.emplace_back();
+        entry.label = label.getId();
+        entry.align = align;
+        entry.hash = hash;
+        entry.offset = state.constantBytes.size();
+        entry.size = size;
+
+        state.constantBytes.insert(state.constantBytes.end(), bytes, bytes + size);
+        state.constantsByHash.emplace(hash, state.constants.size() - 1);
+
+        return label;
+    }
+
+    bool Program::isLabelConstant(const Label& label) const noexcept
+    {
+        return hasLabelFlags(*_state, label.getId(), LabelFlags::Constant);
+    }
+
+    std::size_t Program::getConstantCount() const noexcept
+    {
+        return _state->constants.size();
+    }
+
+    static bool isValidVirtualReg(MachineMode mode, Reg::VirtualClass cls, BitSize size) noexcept
+    {
+        switch (cls)
+        {
+            case Reg::VirtualClass::Gp:
+                return size == BitSize::_8 || size == BitSize::_16 || size == BitSize::_32
+                    || (size == BitSize::_64 && mode == MachineMode::AMD64);
+            case Reg::VirtualClass::Vec:
+                return size == BitSize::_128 || size == BitSize::_256 || size == BitSize::_512;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    Reg Program::createVirtualReg(Reg::VirtualClass cls, BitSize size)
+    {
+        auto& state = *_state;
+        if (!isValidVirtualReg(state.mode, cls, size) || state.virtualRegs.size() >= Reg::kMaxVirtualRegs)
+        {
+            return Reg{};
+        }
+
+        const auto reg = Reg::fromVirtualIndex(state.virtualRegs.size());
+        state.virtualRegs.push_back({ cls, size });
+
+        return reg;
+    }
+
+    Reg::VirtualClass Program::getVirtualRegClass(const Reg& reg) const noexcept
+    {
+        if (!reg.isVirtual() || reg.getVirtualIndex() >= _state->virtualRegs.size())
+        {
+            return Reg::VirtualClass::Invalid;
+        }
+        return _state->virtualRegs[reg.getVirtualIndex()].cls;
+    }
+
+    BitSize Program::getVirtualRegSize(const Reg& reg) const noexcept
+    {
+        if (!reg.isVirtual() || reg.getVirtualIndex() >= _state->virtualRegs.size())
+        {
+            return BitSize::_0;
+        }
+        return _state->virtualRegs[reg.getVirtualIndex()].size;
+    }
+
+    std::size_t Program::getVirtualRegCount() const noexcept
+    {
+        return _state->virtualRegs.size();
+    }
+
     Section Program::createSection(const char* name, Section::Attribs attribs, std::int32_t align)
     {
         const auto sectId = static_cast<Section::Id>(_state->sections.size());
@@ -606,4 +731,16 @@ namespace zasm
         return Error::None;
     }
 
+    Section::Attribs Program::getSectionAttribs(const Section& section) const noexcept
+    {
+        auto sectEntry = getSectionData(*_state, section.getId());
+        if (!sectEntry.hasValue())
+        {
+            return Section::Attribs::None;
+        }
+
+        const auto* entry = sectEntry.value();
+        return entry->attribs;
+    }
+
 } // namespace zasm
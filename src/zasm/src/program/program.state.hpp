@@ -9,10 +9,12 @@
 #include "zasm/program/label.hpp"
 #include "zasm/program/labeldata.hpp"
 #include "zasm/program/node.hpp"
+#include "zasm/program/register.hpp"
 #include "zasm/program/section.hpp"
 
 #include <Zydis/Zydis.h>
 #include <cstddef>
+#include <unordered_map>
 #include <vector>
 
 namespace zasm
@@ -47,6 +49,29 @@ namespace zasm::detail
         const zasm::Node* node{};
     };
 
+    struct ConstantData
+    {
+        Label::Id label{ Label::Id::Invalid };
+        std::int32_t align{};
+        std::size_t hash{};
+        // Location of the bytes in ConstPool::constantBytes.
+        std::size_t offset{};
+        std::size_t size{};
+    };
+
+    struct ConstPool
+    {
+        std::vector<ConstantData> constants;
+        std::vector<std::uint8_t> constantBytes;
+        std::unordered_multimap<std::size_t, std::size_t> constantsByHash;
+    };
+
+    struct VirtualRegData
+    {
+        Reg::VirtualClass cls{ Reg::VirtualClass::Invalid };
+        BitSize size{ BitSize::_0 };
+    };
+
     struct NodeStorage
     {
         ObjectPool<Node, PoolSize> nodePool;
@@ -65,12 +90,13 @@ namespace zasm::detail
         StringPool symbolNames;
     };
 
-    struct ProgramState : NodeStorage, NodeList, Symbols
+    struct ProgramState : NodeStorage, NodeList, Symbols, ConstPool
     {
         MachineMode mode{};
 
         std::vector<LabelData> labels;
         std::vector<SectionData> sections;
+        std::vector<VirtualRegData> virtualRegs;
         std::vector<Observer*> observer;
 
         Label entryPoint{ Label::Id::Invalid };
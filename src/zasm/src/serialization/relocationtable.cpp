@@ -0,0 +1,205 @@
+#include "zasm/serialization/relocationtable.hpp"
+
+#include "zasm/serialization/serializer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace zasm
+{
+    static constexpr std::size_t kBlockHeaderSize = sizeof(std::uint32_t) * 2;
+    static constexpr std::int32_t kEntryTypeShift = 12;
+    static constexpr std::uint16_t kEntryOffsetMask = 0x0FFF;
+
+    template<typename T> static void appendValue(std::vector<std::uint8_t>& data, T value)
+    {
+        std::uint8_t bytes[sizeof(T)]{};
+        std::memcpy(bytes, &value, sizeof(T));
+        data.insert(data.end(), std::begin(bytes), std::end(bytes));
+    }
+
+    template<typename T> static T readValue(const std::uint8_t* data) noexcept
+    {
+        T value{};
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    template<typename T> static void writeValue(std::uint8_t* data, T value) noexcept
+    {
+        std::memcpy(data, &value, sizeof(T));
+    }
+
+    Error RelocationTable::build(const Serializer& serializer)
+    {
+        _data.clear();
+        _entryCount = 0;
+        _base = serializer.getBase();
+
+        // Offset in the upper bits and the type in the lower bits, sorting groups the pages.
+        std::vector<std::uint64_t> entries;
+        entries.reserve(serializer.getRelocationCount());
+        for (std::size_t i = 0; i < serializer.getRelocationCount(); ++i)
+        {
+            const auto* reloc = serializer.getRelocation(i);
+            if (reloc->kind != RelocationType::Abs)
+            {
+                return Error::ImpossibleRelocation;
+            }
+
+            std::uint16_t type{};
+            if (reloc->size == BitSize::_32)
+            {
+                type = kTypeHighLow;
+            }
+            else if (reloc->size == BitSize::_64)
+            {
+                type = kTypeDir64;
+            }
+            else
+            {
+                return Error::ImpossibleRelocation;
+            }
+
+            entries.push_back((static_cast<std::uint64_t>(reloc->offset) << 4) | type);
+        }
+        std::sort(entries.begin(), entries.end());
+
+        std::size_t blockStart = 0;
+        std::uint32_t blockPage = 0;
+
+        const auto finishBlock = [&]() {
+            // Keep the next header aligned.
+            if ((_data.size() - blockStart) % sizeof(std::uint32_t) != 0)
+            {
+                appendValue<std::uint16_t>(_data, kTypeAbsolute << kEntryTypeShift);
+            }
+            const auto blockSize = static_cast<std::uint32_t>(_data.size() - blockStart);
+            writeValue(_data.data() + blockStart + sizeof(std::uint32_t), blockSize);
+        };
+
+        for (const auto entry : entries)
+        {
+            const auto offset = static_cast<std::uint32_t>(entry >> 4);
+            const auto type = static_cast<std::uint16_t>(entry & 0xF);
+            const auto page = offset & ~static_cast<std::uint32_t>(kPageSize - 1);
+
+            if (_entryCount == 0 || page != blockPage)
+            {
+                if (_entryCount != 0)
+                {
+                    finishBlock();
+                }
+
+                blockStart = _data.size();
+                blockPage = page;
+                appendValue<std::uint32_t>(_data, page);
+                appendValue<std::uint32_t>(_data, 0);
+            }
+
+            const auto value = static_cast<std::uint16_t>((type << kEntryTypeShift) | (offset & kEntryOffsetMask));
+            appendValue<std::uint16_t>(_data, value);
+            _entryCount++;
+        }
+
+        if (_entryCount != 0)
+        {
+            finishBlock();
+        }
+
+        return Error::None;
+    }
+
+    const std::uint8_t* RelocationTable::getData() const noexcept
+    {
+        if (_data.empty())
+        {
+            return nullptr;
+        }
+        return _data.data();
+    }
+
+    std::size_t RelocationTable::getSize() const noexcept
+    {
+        return _data.size();
+    }
+
+    std::size_t RelocationTable::getEntryCount() const noexcept
+    {
+        return _entryCount;
+    }
+
+    std::int64_t RelocationTable::getBase() const noexcept
+    {
+        return _base;
+    }
+
+    Error RelocationTable::apply(std::uint8_t* code, std::size_t codeSize, std::int64_t newBase) const
+    {
+        return apply(_data.data(), _data.size(), code, codeSize, newBase - _base);
+    }
+
+    Error RelocationTable::apply(
+        const std::uint8_t* data, std::size_t size, std::uint8_t* code, std::size_t codeSize, std::int64_t delta)
+    {
+        std::size_t pos = 0;
+        while (pos < size)
+        {
+            if (size - pos < kBlockHeaderSize)
+            {
+                return Error::InvalidParameter;
+            }
+
+            const auto page = readValue<std::uint32_t>(data + pos);
+            const auto blockSize = readValue<std::uint32_t>(data + pos + sizeof(std::uint32_t));
+            if (blockSize < kBlockHeaderSize || blockSize > size - pos || (blockSize % sizeof(std::uint16_t)) != 0)
+            {
+                return Error::InvalidParameter;
+            }
+
+            const auto* entry = data + pos + kBlockHeaderSize;
+            const auto* blockEnd = data + pos + blockSize;
+            for (; entry != blockEnd; entry += sizeof(std::uint16_t))
+            {
+                const auto value = readValue<std::uint16_t>(entry);
+                const auto type = static_cast<std::uint16_t>(value >> kEntryTypeShift);
+                const auto offset = static_cast<std::size_t>(page) + (value & kEntryOffsetMask);
+
+                if (type == kTypeHighLow)
+                {
+                    if (offset + sizeof(std::uint32_t) > codeSize)
+                    {
+                        return Error::OutOfBounds;
+                    }
+
+                    const auto newValue = static_cast<std::int64_t>(readValue<std::uint32_t>(code + offset)) + delta;
+                    if (newValue < 0 || newValue > std::numeric_limits<std::uint32_t>::max())
+                    {
+                        return Error::ImpossibleRelocation;
+                    }
+                    writeValue(code + offset, static_cast<std::uint32_t>(newValue));
+                }
+                else if (type == kTypeDir64)
+                {
+                    if (offset + sizeof(std::uint64_t) > codeSize)
+                    {
+                        return Error::OutOfBounds;
+                    }
+
+                    const auto newValue = readValue<std::uint64_t>(code + offset) + static_cast<std::uint64_t>(delta);
+                    writeValue(code + offset, newValue);
+                }
+                else if (type != kTypeAbsolute)
+                {
+                    return Error::InvalidParameter;
+                }
+            }
+
+            pos += blockSize;
+        }
+
+        return Error::None;
+    }
+
+} // namespace zasm
@@ -1,15 +1,24 @@
 #include "zasm/serialization/serializer.hpp"
 
 #include "../encoder/encoder.context.hpp"
+#include "../encoder/generator.hpp"
 #include "../program/program.state.hpp"
+#include "../x86/x86.controlflow.hpp"
+#include "../x86/x86.nops.hpp"
 #include "zasm/core/math.hpp"
 #include "zasm/encoder/encoder.hpp"
+#include "zasm/program/nodemap.hpp"
+#include "zasm/x86/register.hpp"
 
 #include <Zydis/Decoder.h>
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <unordered_map>
+#include <utility>
 
 namespace zasm
 {
@@ -27,20 +36,53 @@ namespace zasm
 
         struct SerializerState
         {
+            SerializerOptions options{};
             std::int64_t base{};
             std::vector<SectionInfo> sections;
             std::vector<std::uint8_t> code;
             std::vector<RelocationInfo> relocations;
             std::vector<RelocationInfo> externalRelocations;
             std::vector<LabelInfo> labels;
+            std::vector<VeneerInfo> veneers;
+            std::vector<RelocationInfo> importSlots;
+
+            // Addresses of external labels known before serialization.
+            std::vector<std::pair<Label::Id, std::int64_t>> externalAddresses;
+
+            // Serialized nodes in program order, offsets and addresses are ascending.
+            std::vector<const Node*> nodes;
+            std::vector<std::int32_t> nodeOffsets;
+            std::vector<std::int32_t> nodeLengths;
+            std::vector<std::int64_t> nodeAddresses;
+
+            // Index into the node arrays.
+            NodeMap<std::uint32_t> nodeIndices{ kInvalidNodeIndex };
+
+            static constexpr std::uint32_t kInvalidNodeIndex = ~std::uint32_t{ 0 };
         };
 
     } // namespace detail
 
+    struct ImportSlot
+    {
+        static constexpr std::int32_t kUnplacedOffset = -1;
+
+        Label::Id label{ Label::Id::Invalid };
+        std::int32_t offset{ kUnplacedOffset };
+        std::int64_t address{};
+    };
+
     struct SerializeContext
     {
         EncoderContext& ctx;
-        std::vector<std::uint8_t> buffer;
+        std::vector<std::uint8_t> buffer{};
+        Serializer::Options options{};
+        // Node currently serialized and the end of the serialized range.
+        const Node* node{};
+        const Node* endNode{};
+        // Import slots in order of the first use, they persist across passes.
+        std::vector<ImportSlot> importSlots{};
+        std::unordered_map<Label::Id, std::size_t> importSlotIndices{};
     };
 
     static bool isLabelExternal(const detail::ProgramState& prog, Label::Id labelId) noexcept
@@ -55,6 +97,18 @@ namespace zasm
         return (entry.flags & LabelFlags::External) != LabelFlags::None;
     }
 
+    static bool isLabelImport(const detail::ProgramState& prog, Label::Id labelId) noexcept
+    {
+        const auto labelIdx = static_cast<std::size_t>(labelId);
+        if (labelIdx >= prog.labels.size())
+        {
+            return false;
+        }
+
+        const auto& entry = prog.labels[labelIdx];
+        return (entry.flags & LabelFlags::Import) != LabelFlags::None;
+    }
+
     static Error serializeNode(
         [[maybe_unused]] detail::ProgramState& program, SerializeContext& state, [[maybe_unused]] const NodePoint& node)
     {
@@ -75,11 +129,333 @@ namespace zasm
         return Error::None;
     }
 
+    // Returns true if the status flags are written before being read by the code that follows the current node,
+    // this only looks at a few instructions of straight line code within the serialized range.
+    static bool areStatusFlagsDead(const SerializeContext& state) noexcept
+    {
+        // CF, PF, AF, ZF, SF, OF
+        constexpr std::uint32_t kStatusFlags = (1U << 0) | (1U << 2) | (1U << 4) | (1U << 6) | (1U << 7) | (1U << 11);
+        constexpr std::size_t kMaxScanNodes = 16;
+
+        std::uint32_t pending = kStatusFlags;
+
+        std::size_t scanned = 0;
+        for (const auto* node = state.node->getNext(); node != state.endNode && scanned < kMaxScanNodes;
+             node = node->getNext(), ++scanned)
+        {
+            if (node->holds<Label>() || node->holds<NodePoint>() || node->holds<Align>())
+            {
+                continue;
+            }
+
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || !instr->isMetaDataValid())
+            {
+                return false;
+            }
+
+            const auto mnemonic = instr->getMnemonic();
+            const auto& flags = instr->getCPUFlags();
+            if ((flags.read & pending) != 0 || x86::isBlockTerminator(mnemonic) || x86::isCall(mnemonic))
+            {
+                return false;
+            }
+
+            pending &= ~(flags.write | flags.undefined);
+            if (pending == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Rewrites the instruction into a shorter form with identical behavior, returns false if there is none.
+    static bool getShortestForm(const SerializeContext& state, MachineMode mode, const Instruction& instr, Instruction& res)
+    {
+        if (mode != MachineMode::AMD64 || !instr.isMetaDataValid())
+        {
+            return false;
+        }
+
+        const auto* dst = instr.getOperandIf<Reg>(0);
+        if (dst == nullptr || !dst->isGp64())
+        {
+            return false;
+        }
+
+        // Writes to 32 bit registers zero extend into the 64 bit register and need no REX.W prefix.
+        const auto dst32 = x86::Gp(dst->getId()).r32();
+
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Mov:
+            {
+                const auto* imm = instr.getOperandIf<Imm>(1);
+                if (imm == nullptr)
+                {
+                    return false;
+                }
+
+                const auto value = imm->value<std::int64_t>();
+                if (value < 0 || value > std::numeric_limits<std::uint32_t>::max())
+                {
+                    return false;
+                }
+
+                if (value == 0 && areStatusFlagsDead(state))
+                {
+                    // The meta data of mov does not apply to xor, generate the instruction like the assembler does.
+                    InstrGenerator generator(mode);
+                    auto xorForm = generator.generate(
+                        instr.getAttribs(), static_cast<Instruction::Mnemonic>(x86::Mnemonic::Xor), 2,
+                        EncoderOperands{ dst32, dst32 });
+                    if (xorForm)
+                    {
+                        res = std::move(*xorForm);
+                        return true;
+                    }
+                }
+
+                // The 32 bit immediate is not sign extended, pass it as signed value so it always fits.
+                res = instr;
+                res.setOperand(0, dst32);
+                res.setOperand(1, Imm(static_cast<std::int32_t>(static_cast<std::uint32_t>(value))));
+                return true;
+            }
+            case x86::Mnemonic::Xor:
+            case x86::Mnemonic::Sub:
+            {
+                // Zero idiom, the flags are identical for the 32 bit form.
+                const auto* src = instr.getOperandIf<Reg>(1);
+                if (src == nullptr || *src != *dst)
+                {
+                    return false;
+                }
+
+                res = instr;
+                res.setOperand(0, dst32);
+                res.setOperand(1, dst32);
+                return true;
+            }
+            default:
+                break;
+        }
+
+        return false;
+    }
+
+    // Returns a memory operand referencing the slot of the import, the slot is created on first use.
+    static Mem getImportSlotMem(SerializeContext& state, MachineMode mode, Label::Id labelId, BitSize bitSize)
+    {
+        auto& ctx = state.ctx;
+
+        const auto [it, inserted] = state.importSlotIndices.try_emplace(labelId, state.importSlots.size());
+        if (inserted)
+        {
+            state.importSlots.push_back({ labelId });
+        }
+
+        // Until the slot is placed use the current address, this keeps the displacement in range.
+        const auto& slot = state.importSlots[it->second];
+        std::int64_t slotAddress = ctx.va;
+        if (slot.offset != ImportSlot::kUnplacedOffset)
+        {
+            slotAddress = slot.address;
+        }
+        else
+        {
+            ctx.needsExtraPass = true;
+        }
+
+        if (mode == MachineMode::AMD64)
+        {
+            return Mem(bitSize, Reg{}, x86::rip, Reg{}, 0, slotAddress);
+        }
+
+        // Absolute address, relocated like any other absolute memory operand.
+        return Mem(bitSize, Reg{}, Reg{}, Reg{}, 0, slotAddress);
+    }
+
+    // Rewrites references to import labels into memory operands of the import slot, returns false if the
+    // instruction has no such reference. Only uses that take the address of the import are rewritten, memory
+    // operands and other instructions such as lea keep their external relocation.
+    static bool getImportSlotForm(
+        SerializeContext& state, const detail::ProgramState& prog, const Instruction& instr, Instruction& res)
+    {
+        const auto mnemonic = static_cast<x86::Mnemonic>(instr.getMnemonic());
+        const auto slotSize = prog.mode == MachineMode::AMD64 ? BitSize::_64 : BitSize::_32;
+
+        bool rewritten = false;
+        for (std::size_t i = 0; i < instr.getExplicitOperandCount(); ++i)
+        {
+            const auto& op = instr.getOperand(i);
+            if (const auto* label = op.getIf<Label>(); label != nullptr && isLabelImport(prog, label->getId()))
+            {
+                // call import -> call [slot]
+                if (i == 0 && (mnemonic == x86::Mnemonic::Call || mnemonic == x86::Mnemonic::Jmp))
+                {
+                    if (!rewritten)
+                    {
+                        res = instr;
+                    }
+                    res.setOperand(i, getImportSlotMem(state, prog.mode, label->getId(), slotSize));
+                    rewritten = true;
+                }
+                // mov reg, import -> mov reg, [slot]
+                else if (const auto* dst = instr.getOperandIf<Reg>(0);
+                         i == 1 && mnemonic == x86::Mnemonic::Mov && dst != nullptr)
+                {
+                    if (!rewritten)
+                    {
+                        res = instr;
+                    }
+                    res.setOperand(i, getImportSlotMem(state, prog.mode, label->getId(), dst->getBitSize(prog.mode)));
+                    rewritten = true;
+                }
+            }
+        }
+
+        return rewritten;
+    }
+
+    static constexpr std::int64_t kBranchBoundary = 32;
+
+    // Upper bound for the layout passes, the layout decisions only grow so this is never reached by valid input.
+    static constexpr std::int32_t kMaxPasses = 64;
+
+    // Instructions that can macro fuse with a following conditional jump.
+    static bool isMacroFusible(const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Cmp:
+            case x86::Mnemonic::Test:
+            case x86::Mnemonic::Add:
+            case x86::Mnemonic::Sub:
+            case x86::Mnemonic::And:
+            case x86::Mnemonic::Inc:
+            case x86::Mnemonic::Dec:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    static bool isFusibleJcc(const Instruction& instr) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(instr.getMnemonic()))
+        {
+            case x86::Mnemonic::Jcxz:
+            case x86::Mnemonic::Jecxz:
+            case x86::Mnemonic::Jrcxz:
+            case x86::Mnemonic::Jknzd:
+            case x86::Mnemonic::Jkzd:
+            case x86::Mnemonic::Loop:
+            case x86::Mnemonic::Loope:
+            case x86::Mnemonic::Loopne:
+                return false;
+            default:
+                break;
+        }
+        return x86::isConditionalBranch(instr.getMnemonic());
+    }
+
+    static bool isFusedPair(const Node* first, const Node* second) noexcept
+    {
+        if (first == nullptr || second == nullptr)
+        {
+            return false;
+        }
+        const auto* instrA = first->getIf<Instruction>();
+        const auto* instrB = second->getIf<Instruction>();
+        return instrA != nullptr && instrB != nullptr && isMacroFusible(*instrA) && isFusibleJcc(*instrB);
+    }
+
+    // Returns true if the node starts a jump or fused pair that must stay within a 32 byte window.
+    static bool isBranchGroupStart(const SerializeContext& state, const Instruction& instr) noexcept
+    {
+        // The second instruction of a fused pair is aligned as part of the pair.
+        if (state.ctx.nodeIndex > 0 && isFusedPair(state.node->getPrev(), state.node))
+        {
+            return false;
+        }
+        const auto* next = state.node->getNext();
+        return x86::isBranch(instr.getMnemonic()) || (next != state.endNode && isFusedPair(state.node, next));
+    }
+
+    // Returns the amount of bytes that must stay within a 32 byte window starting at the current node.
+    static std::int32_t getBranchGroupLength(const SerializeContext& state, std::int32_t length)
+    {
+        const auto& ctx = state.ctx;
+
+        if (x86::isBranch(state.node->get<Instruction>().getMnemonic()))
+        {
+            return length;
+        }
+
+        // The jcc is not encoded yet, use the length from the previous pass or assume rel32.
+        constexpr std::int32_t kMaxJccLength = 6;
+        const auto& nextEntry = ctx.nodes[ctx.nodeIndex + 1];
+        return length + (nextEntry.length != 0 ? nextEntry.length : kMaxJccLength);
+    }
+
+    // Returns true if the bytes cross or end on a 32 byte boundary.
+    static bool crossesBranchBoundary(std::int64_t va, std::int32_t length) noexcept
+    {
+        const auto end = va + length;
+        return (va / kBranchBoundary) != ((end - 1) / kBranchBoundary) || (end % kBranchBoundary) == 0;
+    }
+
     static Error serializeNode(const detail::ProgramState& prog, SerializeContext& state, const Instruction& instr)
     {
         auto& ctx = state.ctx;
 
-        auto res = encode(state.ctx, prog.mode, instr);
+        const Instruction* instrToEncode = &instr;
+
+        Instruction shortestForm;
+        if ((state.options & Serializer::Options::ShortestEncoding) != Serializer::Options::None
+            && getShortestForm(state, prog.mode, instr, shortestForm))
+        {
+            instrToEncode = &shortestForm;
+        }
+
+        Instruction importSlotForm;
+        if ((state.options & Serializer::Options::ImportSlots) != Serializer::Options::None
+            && getImportSlotForm(state, prog, *instrToEncode, importSlotForm))
+        {
+            instrToEncode = &importSlotForm;
+        }
+
+        std::int32_t padding = 0;
+        if ((state.options & Serializer::Options::AlignBranches) != Serializer::Options::None
+            && isBranchGroupStart(state, instr))
+        {
+            // Encode at the current address to get the length, relative operands depend on the address
+            // so the final encoding happens after the padding.
+            auto probe = encode(state.ctx, prog.mode, *instrToEncode);
+            if (!probe)
+            {
+                return probe.error();
+            }
+
+            // The group length depends on the padding of the nodes that follow, giving the padding back
+            // could flip the decision on every pass.
+            const auto groupLength = getBranchGroupLength(state, static_cast<std::int32_t>(probe->length));
+            if (ctx.nodes[ctx.nodeIndex].keepAligned || crossesBranchBoundary(ctx.va, groupLength))
+            {
+                padding = static_cast<std::int32_t>(math::alignTo<std::int64_t>(ctx.va, kBranchBoundary) - ctx.va);
+
+                ctx.va += padding;
+                ctx.offset += padding;
+                ctx.sections[ctx.sectionIndex].rawSize += padding;
+                x86::appendNops(state.buffer, static_cast<std::size_t>(padding));
+            }
+        }
+
+        auto res = encode(state.ctx, prog.mode, *instrToEncode);
         if (!res)
         {
             return res.error();
@@ -87,6 +463,16 @@ namespace zasm
 
         {
             auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+            // The padding depends on the layout, any change moves the nodes that follow.
+            if (ctx.pass > 1 && nodeEntry.padding != padding)
+            {
+                ctx.needsExtraPass = true;
+            }
+            nodeEntry.padding = padding;
+            if (ctx.pass > 1 && padding != 0)
+            {
+                nodeEntry.keepAligned = true;
+            }
             if (nodeEntry.length != 0)
             {
                 if (res->length < nodeEntry.length)
@@ -246,6 +632,46 @@ namespace zasm
         return Error::None;
     }
 
+    static Error serializeNode([[maybe_unused]] const detail::ProgramState& program, SerializeContext& state, const Align& align)
+    {
+        auto& ctx = state.ctx;
+
+        const auto alignedVA = math::alignTo<std::int64_t>(ctx.va, align.getAlignment());
+        const auto padding = static_cast<std::int32_t>(alignedVA - ctx.va);
+
+        {
+            auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+            // The padding depends on the layout, any change moves the nodes that follow.
+            if (ctx.pass > 1 && nodeEntry.length != padding)
+            {
+                ctx.needsExtraPass = true;
+            }
+            nodeEntry.offset = ctx.offset;
+            nodeEntry.address = ctx.va;
+            nodeEntry.length = padding;
+            ctx.nodeIndex++;
+        }
+
+        ctx.va += padding;
+        ctx.offset += padding;
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += padding;
+
+        auto& buffer = state.buffer;
+        if (align.isNopFill() && (sect.attribs & Section::Attribs::Exec) != Section::Attribs::None)
+        {
+            x86::appendNops(buffer, static_cast<std::size_t>(padding));
+        }
+        else
+        {
+            const std::uint8_t fill = align.isNopFill() ? 0x00 : align.getFillByte();
+            buffer.insert(buffer.end(), static_cast<std::size_t>(padding), fill);
+        }
+
+        return Error::None;
+    }
+
     static Error serializeNode(const detail::ProgramState& program, SerializeContext& state, const EmbeddedLabel& data)
     {
         auto& ctx = state.ctx;
@@ -351,6 +777,140 @@ namespace zasm
         return Error::None;
     }
 
+    // Starts a section for data appended after the last node unless the current section already matches.
+    static void beginAppendedSection(SerializeContext& state, Section::Attribs attribs, StringPool::Id nameId)
+    {
+        auto& ctx = state.ctx;
+
+        EncoderSection newSect{};
+        newSect.attribs = attribs;
+        newSect.nameId = nameId;
+        newSect.align = Section::kDefaultAlign;
+
+        if (isSameSection(ctx.sections[ctx.sectionIndex], newSect))
+        {
+            return;
+        }
+
+        finalizeCurSection(state);
+
+        newSect.index = static_cast<int32_t>(ctx.sections.size());
+        newSect.offset = ctx.offset;
+        newSect.address = ctx.va;
+
+        ctx.sections.push_back(newSect);
+        ctx.sectionIndex++;
+    }
+
+    // Appends the constant pool as a read-only section after the last node, order holds the indices of
+    // the constants sorted by descending alignment so padding is only needed between unevenly sized entries.
+    static Error serializeConstPool(
+        const detail::ProgramState& program, SerializeContext& state, const std::vector<std::size_t>& order,
+        StringPool::Id nameId)
+    {
+        auto& ctx = state.ctx;
+
+        beginAppendedSection(state, Section::Attribs::RData, nameId);
+
+        auto& buffer = state.buffer;
+        for (const auto constantIdx : order)
+        {
+            const auto& constant = program.constants[constantIdx];
+
+            const auto padding = static_cast<std::int32_t>(math::alignTo<std::int64_t>(ctx.va, constant.align) - ctx.va);
+            const auto size = static_cast<std::int32_t>(constant.size);
+
+            buffer.insert(buffer.end(), static_cast<std::size_t>(padding), 0x00);
+            ctx.va += padding;
+            ctx.offset += padding;
+
+            auto& linkEntry = ctx.getOrCreateLabelLink(constant.label);
+            linkEntry.boundOffset = ctx.offset;
+            linkEntry.boundVA = ctx.va;
+
+            const auto* bytes = program.constantBytes.data() + constant.offset;
+            buffer.insert(buffer.end(), bytes, bytes + constant.size);
+            ctx.va += size;
+            ctx.offset += size;
+
+            ctx.sections[ctx.sectionIndex].rawSize += padding + size;
+        }
+
+        return Error::None;
+    }
+
+    // Appends the import slots as a data section after the last node, the slots are zero until the loader
+    // patches them. A slot that moved since the previous pass requires another pass for its uses.
+    static Error serializeImportSlots(
+        const detail::ProgramState& program, SerializeContext& state, StringPool::Id nameId)
+    {
+        auto& ctx = state.ctx;
+
+        beginAppendedSection(state, Section::Attribs::Data, nameId);
+
+        const auto slotSize = static_cast<std::int32_t>(
+            program.mode == MachineMode::AMD64 ? sizeof(std::uint64_t) : sizeof(std::uint32_t));
+
+        auto& buffer = state.buffer;
+        for (auto& slot : state.importSlots)
+        {
+            const auto padding = static_cast<std::int32_t>(math::alignTo<std::int64_t>(ctx.va, slotSize) - ctx.va);
+            buffer.insert(buffer.end(), static_cast<std::size_t>(padding), 0x00);
+            ctx.va += padding;
+            ctx.offset += padding;
+
+            if (slot.offset != ctx.offset || slot.address != ctx.va)
+            {
+                slot.offset = ctx.offset;
+                slot.address = ctx.va;
+                ctx.needsExtraPass = true;
+            }
+
+            buffer.insert(buffer.end(), static_cast<std::size_t>(slotSize), 0x00);
+            ctx.va += slotSize;
+            ctx.offset += slotSize;
+
+            ctx.sections[ctx.sectionIndex].rawSize += padding + slotSize;
+        }
+
+        return Error::None;
+    }
+
+    // jmp qword ptr [rip+2], the slot follows after two bytes of int3 padding so it is naturally aligned.
+    static constexpr std::array<std::uint8_t, 8> kVeneerCode = { 0xFF, 0x25, 0x02, 0x00, 0x00, 0x00, 0xCC, 0xCC };
+    static_assert(kVeneerCode.size() + sizeof(std::int64_t) == Serializer::kVeneerSize);
+
+    // Appends the veneers created so far as an executable section after the last node, a veneer that moved
+    // since the previous pass requires another pass for the branches using it.
+    static Error serializeVeneers(SerializeContext& state, StringPool::Id nameId)
+    {
+        auto& ctx = state.ctx;
+
+        beginAppendedSection(state, Section::kDefaultAttribs, nameId);
+
+        auto& buffer = state.buffer;
+        for (auto& veneer : ctx.veneers)
+        {
+            if (veneer.address != ctx.va)
+            {
+                veneer.address = ctx.va;
+                ctx.needsExtraPass = true;
+            }
+
+            buffer.insert(buffer.end(), kVeneerCode.begin(), kVeneerCode.end());
+
+            std::array<std::uint8_t, sizeof(std::int64_t)> slot{};
+            std::memcpy(slot.data(), &veneer.target, sizeof(veneer.target));
+            buffer.insert(buffer.end(), slot.begin(), slot.end());
+
+            ctx.va += Serializer::kVeneerSize;
+            ctx.offset += Serializer::kVeneerSize;
+            ctx.sections[ctx.sectionIndex].rawSize += Serializer::kVeneerSize;
+        }
+
+        return Error::None;
+    }
+
     Serializer::Serializer()
         : _state(std::make_unique<detail::SerializerState>())
     {
@@ -371,6 +931,32 @@ namespace zasm
         return *this;
     }
 
+    void Serializer::setOptions(Options options) noexcept
+    {
+        _state->options = options;
+    }
+
+    Serializer::Options Serializer::getOptions() const noexcept
+    {
+        return _state->options;
+    }
+
+    void Serializer::setExternalLabelAddress(const Label& label, std::int64_t address)
+    {
+        auto& addresses = _state->externalAddresses;
+
+        auto it = std::find_if(
+            addresses.begin(), addresses.end(), [&](const auto& entry) { return entry.first == label.getId(); });
+        if (it != addresses.end())
+        {
+            it->second = address;
+        }
+        else
+        {
+            addresses.emplace_back(label.getId(), address);
+        }
+    }
+
     Error Serializer::serialize(const Program& program, std::int64_t newBase)
     {
         return serialize(program, newBase, program.getHead(), program.getTail());
@@ -402,7 +988,17 @@ namespace zasm
         encoderCtx.nodes.resize(nodeCount);
         encoderCtx.baseVA = newBase;
 
-        SerializeContext state{ encoderCtx, {} };
+        SerializeContext state{ encoderCtx, {}, _state->options, nullptr, lastNode, {}, {} };
+
+        // Known external addresses resolve like bound labels but have no position in the code.
+        for (const auto& [labelId, address] : _state->externalAddresses)
+        {
+            if (!isLabelExternal(programState, labelId))
+            {
+                return Error::InvalidLabel;
+            }
+            encoderCtx.getOrCreateLabelLink(labelId).boundVA = address;
+        }
 
         std::int32_t codeDiff = 0;
         std::int32_t codeSize = 0;
@@ -414,6 +1010,25 @@ namespace zasm
         defaultSect.address = newBase;
         defaultSect.nameId = programState.symbolNames.aquire(".text");
 
+        // The constant pool is only emitted when the range covers the end of the program.
+        std::vector<std::size_t> constPoolOrder;
+        StringPool::Id constPoolNameId{ StringPool::Id::Invalid };
+        if (lastNode == nullptr && !programState.constants.empty())
+        {
+            constPoolOrder.resize(programState.constants.size());
+            for (std::size_t i = 0; i < constPoolOrder.size(); ++i)
+            {
+                constPoolOrder[i] = i;
+            }
+            std::stable_sort(constPoolOrder.begin(), constPoolOrder.end(), [&](std::size_t lhs, std::size_t rhs) {
+                return programState.constants[lhs].align > programState.constants[rhs].align;
+            });
+            constPoolNameId = programState.symbolNames.aquire(Program::kConstPoolSectionName);
+        }
+
+        const auto veneerNameId = programState.symbolNames.aquire(kVeneerSectionName);
+        const auto importNameId = programState.symbolNames.aquire(kImportSectionName);
+
         const auto serializePass = [&]() {
             state.buffer.clear();
 
@@ -431,6 +1046,8 @@ namespace zasm
 
             for (const auto* node = first; node != lastNode; node = node->getNext())
             {
+                state.node = node;
+
                 const auto status = node->visit([&](auto&& n) { return serializeNode(programState, state, n); });
                 if (status != Error::None)
                 {
@@ -438,6 +1055,31 @@ namespace zasm
                 }
             }
 
+            if (!constPoolOrder.empty())
+            {
+                if (const auto status = serializeConstPool(programState, state, constPoolOrder, constPoolNameId);
+                    status != Error::None)
+                {
+                    return status;
+                }
+            }
+
+            if (!state.importSlots.empty())
+            {
+                if (const auto status = serializeImportSlots(programState, state, importNameId); status != Error::None)
+                {
+                    return status;
+                }
+            }
+
+            if (!encoderCtx.veneers.empty())
+            {
+                if (const auto status = serializeVeneers(state, veneerNameId); status != Error::None)
+                {
+                    return status;
+                }
+            }
+
             const auto newSize = static_cast<int32_t>(state.buffer.size());
             codeDiff = newSize - codeSize;
             codeSize = newSize;
@@ -465,6 +1107,10 @@ namespace zasm
         // Second or more passes.
         while (encoderCtx.needsExtraPass || encoderCtx.drift != 0)
         {
+            if (encoderCtx.pass >= kMaxPasses)
+            {
+                return Error::PassLimitReached;
+            }
             if (const auto status = serializePass(); status != Error::None)
             {
                 return status;
@@ -512,6 +1158,7 @@ namespace zasm
         }
 
         _state->relocations.clear();
+        _state->externalRelocations.clear();
         for (auto& node : encoderCtx.nodes)
         {
             if (node.relocKind == RelocationType::None)
@@ -527,6 +1174,13 @@ namespace zasm
             if (reloc.label != Label::Id::Invalid)
             {
                 isExternal = isLabelExternal(programState, reloc.label);
+
+                // Encoded with the known absolute address, nothing to patch. Rip relative uses of a known address
+                // that is out of range still need the relocation.
+                if (isExternal && reloc.kind == RelocationType::Abs && encoderCtx.getLabelAddress(reloc.label).has_value())
+                {
+                    continue;
+                }
             }
 
             if (node.relocData == RelocationData::Data)
@@ -550,7 +1204,8 @@ namespace zasm
 
                 if (node.relocData == RelocationData::Immediate)
                 {
-                    if (instr.raw.imm[0].is_relative == ZYAN_TRUE)
+                    // Only branches to known external addresses keep a relative immediate.
+                    if (instr.raw.imm[0].is_relative == ZYAN_TRUE && reloc.kind != RelocationType::Rel32)
                     {
                         continue;
                     }
@@ -595,6 +1250,48 @@ namespace zasm
             }
         }
 
+        // Keep the node layout for address queries.
+        _state->nodes.clear();
+        _state->nodeOffsets.clear();
+        _state->nodeLengths.clear();
+        _state->nodeAddresses.clear();
+        _state->nodeIndices.clear();
+
+        _state->nodes.reserve(nodeCount);
+        _state->nodeOffsets.reserve(nodeCount);
+        _state->nodeLengths.reserve(nodeCount);
+        _state->nodeAddresses.reserve(nodeCount);
+
+        std::size_t nodeIndex = 0;
+        for (const auto* node = first; node != lastNode; node = node->getNext(), ++nodeIndex)
+        {
+            const auto& nodeEntry = encoderCtx.nodes[nodeIndex];
+
+            _state->nodeIndices.set(node, static_cast<std::uint32_t>(nodeIndex));
+            _state->nodes.push_back(node);
+            _state->nodeOffsets.push_back(nodeEntry.offset);
+            _state->nodeLengths.push_back(nodeEntry.length);
+            _state->nodeAddresses.push_back(nodeEntry.address);
+        }
+
+        _state->importSlots.clear();
+        for (const auto& slot : state.importSlots)
+        {
+            RelocationInfo reloc;
+            reloc.offset = slot.offset;
+            reloc.address = slot.address;
+            reloc.size = programState.mode == MachineMode::AMD64 ? BitSize::_64 : BitSize::_32;
+            reloc.kind = RelocationType::Abs;
+            reloc.label = slot.label;
+            _state->importSlots.push_back(reloc);
+        }
+
+        _state->veneers.clear();
+        for (const auto& veneer : encoderCtx.veneers)
+        {
+            _state->veneers.push_back({ veneer.address, veneer.target });
+        }
+
         _state->code = std::move(state.buffer);
 
         _state->sections.clear();
@@ -633,7 +1330,23 @@ namespace zasm
         std::vector<RelocationInfo> relocs = _state->relocations;
         for (auto& reloc : relocs)
         {
-            if (reloc.size == BitSize::_32)
+            if (reloc.kind == RelocationType::Rel32)
+            {
+                // Relative to a known external address, the target stays where it is.
+                std::int32_t value{};
+                std::memcpy(&value, code.data() + reloc.offset, sizeof(value));
+
+                const std::int64_t newValue = static_cast<std::int64_t>(value) - (newBase - oldBase);
+                if (newValue < std::numeric_limits<std::int32_t>::min()
+                    || newValue > std::numeric_limits<std::int32_t>::max())
+                {
+                    return Error::ImpossibleRelocation;
+                }
+
+                value = static_cast<std::int32_t>(newValue);
+                std::memcpy(code.data() + reloc.offset, &value, sizeof(value));
+            }
+            else if (reloc.size == BitSize::_32)
             {
                 std::uint32_t value{};
                 std::memcpy(&value, code.data() + reloc.offset, sizeof(value));
@@ -679,10 +1392,36 @@ namespace zasm
         std::vector<detail::LabelInfo> labels = _state->labels;
         for (auto& label : labels)
         {
+            // Unbound and external labels have no position in the code.
+            if (label.boundOffset == detail::LabelInfo::kUnboundOffset)
+            {
+                continue;
+            }
             label.boundAddress -= oldBase;
             label.boundAddress += newBase;
         }
 
+        // Adjust node addresses.
+        for (auto& nodeAddress : _state->nodeAddresses)
+        {
+            nodeAddress -= oldBase;
+            nodeAddress += newBase;
+        }
+
+        // Adjust import slots.
+        for (auto& slot : _state->importSlots)
+        {
+            slot.address -= oldBase;
+            slot.address += newBase;
+        }
+
+        // Adjust veneers, the slots hold absolute targets.
+        for (auto& veneer : _state->veneers)
+        {
+            veneer.address -= oldBase;
+            veneer.address += newBase;
+        }
+
         // Adjust sections
         std::vector<SectionInfo> sections = _state->sections;
         for (auto& sect : sections)
@@ -760,6 +1499,82 @@ namespace zasm
         return _state->labels[idx].boundAddress;
     }
 
+    // Returns the index of the node in the last serialization, the map may hold stale entries of destroyed nodes.
+    static std::uint32_t findNodeIndex(const detail::SerializerState& state, const Node* node) noexcept
+    {
+        if (node == nullptr)
+        {
+            return detail::SerializerState::kInvalidNodeIndex;
+        }
+        const auto idx = state.nodeIndices.get(node);
+        if (idx == detail::SerializerState::kInvalidNodeIndex || state.nodes[idx] != node)
+        {
+            return detail::SerializerState::kInvalidNodeIndex;
+        }
+        return idx;
+    }
+
+    std::int32_t Serializer::getNodeOffset(const Node* node) const noexcept
+    {
+        const auto idx = findNodeIndex(*_state, node);
+        if (idx == detail::SerializerState::kInvalidNodeIndex)
+        {
+            return -1;
+        }
+        return _state->nodeOffsets[idx];
+    }
+
+    std::int64_t Serializer::getNodeAddress(const Node* node) const noexcept
+    {
+        const auto idx = findNodeIndex(*_state, node);
+        if (idx == detail::SerializerState::kInvalidNodeIndex)
+        {
+            return -1;
+        }
+        return _state->nodeAddresses[idx];
+    }
+
+    std::int32_t Serializer::getNodeLength(const Node* node) const noexcept
+    {
+        const auto idx = findNodeIndex(*_state, node);
+        if (idx == detail::SerializerState::kInvalidNodeIndex)
+        {
+            return -1;
+        }
+        return _state->nodeLengths[idx];
+    }
+
+    template<typename T>
+    static const Node* findNode(
+        const std::vector<T>& positions, const std::vector<std::int32_t>& lengths, const std::vector<const Node*>& nodes,
+        T position) noexcept
+    {
+        // Find the last node that starts at or before the position, zero sized nodes such as labels
+        // share the position with the node that follows so the last one is the one with data.
+        const auto it = std::upper_bound(positions.begin(), positions.end(), position);
+        if (it == positions.begin())
+        {
+            return nullptr;
+        }
+
+        const auto idx = static_cast<std::size_t>(std::distance(positions.begin(), it)) - 1;
+        if (position >= positions[idx] + lengths[idx])
+        {
+            return nullptr;
+        }
+        return nodes[idx];
+    }
+
+    const Node* Serializer::findNodeAt(std::int64_t address) const noexcept
+    {
+        return findNode(_state->nodeAddresses, _state->nodeLengths, _state->nodes, address);
+    }
+
+    const Node* Serializer::findNodeAtOffset(std::int32_t offset) const noexcept
+    {
+        return findNode(_state->nodeOffsets, _state->nodeLengths, _state->nodes, offset);
+    }
+
     std::size_t Serializer::getRelocationCount() const noexcept
     {
         return _state->relocations.size();
@@ -788,12 +1603,47 @@ namespace zasm
         return &_state->externalRelocations[index];
     }
 
+    std::size_t Serializer::getImportSlotCount() const noexcept
+    {
+        return _state->importSlots.size();
+    }
+
+    const RelocationInfo* Serializer::getImportSlot(const std::size_t index) const noexcept
+    {
+        if (index >= _state->importSlots.size())
+        {
+            return nullptr;
+        }
+        return &_state->importSlots[index];
+    }
+
+    std::size_t Serializer::getVeneerCount() const noexcept
+    {
+        return _state->veneers.size();
+    }
+
+    const VeneerInfo* Serializer::getVeneer(const std::size_t index) const noexcept
+    {
+        if (index >= _state->veneers.size())
+        {
+            return nullptr;
+        }
+        return &_state->veneers[index];
+    }
+
     void Serializer::clear() noexcept
     {
         _state->base = 0;
         _state->code.clear();
+        _state->importSlots.clear();
+        _state->veneers.clear();
         _state->sections.clear();
         _state->labels.clear();
+        _state->nodes.clear();
+        _state->nodeOffsets.clear();
+        _state->nodeLengths.clear();
+        _state->nodeAddresses.clear();
+        _state->nodeIndices.clear();
     }
 
 } // namespace zasm
@@ -1,6 +1,7 @@
 #include "../encoder/generator.hpp"
 
 #include <algorithm>
+#include <array>
 #include <zasm/program/program.hpp>
 #include <zasm/x86/assembler.hpp>
 
@@ -38,6 +39,31 @@ namespace zasm::x86
         return _program.getOrCreateImportLabel(moduleName, entryName);
     }
 
+    Label Assembler::constPool(const void* data, std::size_t size, std::int32_t align)
+    {
+        return _program.getOrCreateConstant(data, size, align);
+    }
+
+    Gp Assembler::createVirtualGp(BitSize size)
+    {
+        return Gp{ _program.createVirtualReg(Reg::VirtualClass::Gp, size).getId() };
+    }
+
+    Xmm Assembler::createVirtualXmm()
+    {
+        return Xmm{ _program.createVirtualReg(Reg::VirtualClass::Vec, BitSize::_128).getId() };
+    }
+
+    Ymm Assembler::createVirtualYmm()
+    {
+        return Ymm{ _program.createVirtualReg(Reg::VirtualClass::Vec, BitSize::_256).getId() };
+    }
+
+    Zmm Assembler::createVirtualZmm()
+    {
+        return Zmm{ _program.createVirtualReg(Reg::VirtualClass::Vec, BitSize::_512).getId() };
+    }
+
     Error Assembler::bind(const Label& label)
     {
         const auto labelNode = _program.bindLabel(label);
@@ -67,6 +93,23 @@ namespace zasm::x86
         return Error::None;
     }
 
+    Error Assembler::align(std::int32_t alignment, std::int32_t fill /*= Align::kFillNop*/)
+    {
+        if (alignment <= 0 || (alignment & (alignment - 1)) != 0)
+        {
+            return Error::InvalidParameter;
+        }
+        if (fill != Align::kFillNop && (fill < 0 || fill > 0xFF))
+        {
+            return Error::InvalidParameter;
+        }
+
+        const auto* node = _program.createNode(Align(alignment, fill));
+        _cursor = _program.insertAfter(_cursor, node);
+
+        return Error::None;
+    }
+
     Error Assembler::db(std::uint8_t val, std::size_t repeatCount /*= 1*/)
     {
         Data data(val, repeatCount);
@@ -117,9 +160,259 @@ namespace zasm::x86
         return Error::None;
     }
 
+    namespace
+    {
+        // Maps the virtual registers of a single instruction to physical placeholders so the
+        // instruction can be validated and its meta data obtained from the encoder.
+        class VirtualRegBinding
+        {
+            struct Entry
+            {
+                Reg virtualReg;
+                Reg placeholder;
+            };
+
+            static constexpr std::size_t kMaxEntries = ZYDIS_ENCODER_MAX_OPERANDS * 2;
+
+            const Program& _program;
+            std::array<Entry, kMaxEntries> _entries{};
+            std::size_t _count{};
+            // Physical indices of the registers used by the instruction and the placeholders.
+            std::uint32_t _usedGp{};
+            std::uint32_t _usedVec{};
+
+        public:
+            explicit VirtualRegBinding(const Program& program) noexcept
+                : _program(program)
+            {
+            }
+
+            bool empty() const noexcept
+            {
+                return _count == 0;
+            }
+
+            void reservePhysical(const Reg& reg) noexcept
+            {
+                if (!reg.isValid() || reg.isVirtual())
+                {
+                    return;
+                }
+                const auto index = reg.getPhysicalIndex();
+                if (index < 0 || index >= 32)
+                {
+                    return;
+                }
+                if (reg.isGp())
+                {
+                    _usedGp |= 1U << index;
+                }
+                else if (reg.isXmm() || reg.isYmm() || reg.isZmm())
+                {
+                    _usedVec |= 1U << index;
+                }
+            }
+
+            void reservePhysical(const Operand& op) noexcept
+            {
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                {
+                    reservePhysical(*reg);
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    reservePhysical(mem->getBase());
+                    reservePhysical(mem->getIndex());
+                }
+            }
+
+            Error bind(const Reg& reg, Reg& placeholder) noexcept
+            {
+                for (std::size_t i = 0; i < _count; ++i)
+                {
+                    if (_entries[i].virtualReg == reg)
+                    {
+                        placeholder = _entries[i].placeholder;
+                        return Error::None;
+                    }
+                }
+
+                const auto cls = _program.getVirtualRegClass(reg);
+                const auto size = _program.getVirtualRegSize(reg);
+                const bool isAMD64 = _program.getMode() == MachineMode::AMD64;
+
+                // The upper registers are preferred in 64 bit mode, they are never used implicitly.
+                static constexpr std::array<std::int8_t, 8> kGpAMD64 = { 8, 9, 10, 11, 12, 13, 14, 15 };
+                static constexpr std::array<std::int8_t, 6> kGpI386 = { 0, 1, 2, 3, 6, 7 };
+                static constexpr std::array<std::int8_t, 8> kVecAMD64 = { 8, 9, 10, 11, 12, 13, 14, 15 };
+                static constexpr std::array<std::int8_t, 8> kVecI386 = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+                const auto pick = [](const auto& candidates, std::uint32_t& used, std::size_t limit) -> std::int8_t {
+                    for (std::size_t i = 0; i < candidates.size() && i < limit; ++i)
+                    {
+                        const auto index = candidates[i];
+                        if ((used & (1U << index)) == 0)
+                        {
+                            used |= 1U << index;
+                            return index;
+                        }
+                    }
+                    return -1;
+                };
+
+                if (cls == Reg::VirtualClass::Gp)
+                {
+                    // Only al, cl, dl and bl have a low byte in 32 bit mode.
+                    const auto limit = (!isAMD64 && size == BitSize::_8) ? 4 : kGpI386.size();
+                    const auto index = isAMD64 ? pick(kGpAMD64, _usedGp, kGpAMD64.size()) : pick(kGpI386, _usedGp, limit);
+                    if (index < 0)
+                    {
+                        return Error::InvalidOperation;
+                    }
+                    const auto root = Gp{ static_cast<Reg::Id>(ZydisRegisterEncode(ZYDIS_REGCLASS_GPR32, index)) };
+                    switch (size)
+                    {
+                        case BitSize::_8:
+                            placeholder = root.r8();
+                            break;
+                        case BitSize::_16:
+                            placeholder = root.r16();
+                            break;
+                        case BitSize::_32:
+                            placeholder = root;
+                            break;
+                        case BitSize::_64:
+                            placeholder = root.r64();
+                            break;
+                        default:
+                            return Error::InvalidOperation;
+                    }
+                }
+                else if (cls == Reg::VirtualClass::Vec)
+                {
+                    const auto index = isAMD64 ? pick(kVecAMD64, _usedVec, kVecAMD64.size())
+                                               : pick(kVecI386, _usedVec, kVecI386.size());
+                    if (index < 0)
+                    {
+                        return Error::InvalidOperation;
+                    }
+                    const auto regClass = size == BitSize::_128
+                        ? ZYDIS_REGCLASS_XMM
+                        : (size == BitSize::_256 ? ZYDIS_REGCLASS_YMM : ZYDIS_REGCLASS_ZMM);
+                    placeholder = Reg{ static_cast<Reg::Id>(ZydisRegisterEncode(regClass, index)) };
+                }
+                else
+                {
+                    // Not created by this program.
+                    return Error::InvalidOperation;
+                }
+
+                if (_count >= _entries.size())
+                {
+                    return Error::InvalidOperation;
+                }
+                _entries[_count++] = { reg, placeholder };
+
+                return Error::None;
+            }
+
+            Error bind(Operand& op) noexcept
+            {
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                {
+                    if (!reg->isVirtual())
+                    {
+                        return Error::None;
+                    }
+                    Reg placeholder;
+                    if (auto err = bind(*reg, placeholder); err != Error::None)
+                    {
+                        return err;
+                    }
+                    op = placeholder;
+                }
+                else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                {
+                    if (!mem->getBase().isVirtual() && !mem->getIndex().isVirtual())
+                    {
+                        return Error::None;
+                    }
+                    auto newMem = *mem;
+                    Reg placeholder;
+                    if (mem->getBase().isVirtual())
+                    {
+                        if (auto err = bind(mem->getBase(), placeholder); err != Error::None)
+                        {
+                            return err;
+                        }
+                        newMem.setBase(placeholder);
+                    }
+                    if (mem->getIndex().isVirtual())
+                    {
+                        if (auto err = bind(mem->getIndex(), placeholder); err != Error::None)
+                        {
+                            return err;
+                        }
+                        newMem.setIndex(placeholder);
+                    }
+                    op = newMem;
+                }
+                return Error::None;
+            }
+
+            Reg unbind(const Reg& reg) const noexcept
+            {
+                for (std::size_t i = 0; i < _count; ++i)
+                {
+                    if (_entries[i].placeholder == reg)
+                    {
+                        return _entries[i].virtualReg;
+                    }
+                }
+                return reg;
+            }
+
+            // Swaps the placeholders in the generated instruction back to the virtual registers.
+            void unbind(Instruction& instr, std::size_t numOps) const noexcept
+            {
+                for (std::size_t i = 0; i < numOps && i < instr.getOperandCount(); ++i)
+                {
+                    const auto& op = instr.getOperand(i);
+                    if (const auto* reg = op.getIf<Reg>(); reg != nullptr)
+                    {
+                        instr.setOperand(i, unbind(*reg));
+                    }
+                    else if (const auto* mem = op.getIf<Mem>(); mem != nullptr)
+                    {
+                        auto newMem = *mem;
+                        newMem.setBase(unbind(mem->getBase()));
+                        newMem.setIndex(unbind(mem->getIndex()));
+                        instr.setOperand(i, newMem);
+                    }
+                }
+            }
+        };
+    } // namespace
+
     Error Assembler::emit(
         Attribs attribs, Mnemonic mnemonic, std::size_t numOps, std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS>&& ops)
     {
+        VirtualRegBinding binding(_program);
+        if (_program.getVirtualRegCount() != 0)
+        {
+            for (std::size_t i = 0; i < numOps; ++i)
+            {
+                binding.reservePhysical(ops[i]);
+            }
+            for (std::size_t i = 0; i < numOps; ++i)
+            {
+                if (auto err = binding.bind(ops[i]); err != Error::None)
+                {
+                    return err;
+                }
+            }
+        }
+
         auto genResult = _generator->generate(
             static_cast<Instruction::Attribs>(attribs), static_cast<Instruction::Mnemonic>(mnemonic), numOps, std::move(ops));
         if (!genResult)
@@ -127,6 +420,11 @@ namespace zasm::x86
             return genResult.error();
         }
 
+        if (!binding.empty())
+        {
+            binding.unbind(*genResult, numOps);
+        }
+
         const auto* node = _program.createNode(std::move(*genResult));
         _cursor = _program.insertAfter(_cursor, node);
 
@@ -186,6 +484,12 @@ namespace zasm::x86
 
     void Assembler::onNodeDestroy(const Node* node) noexcept
     {
+        // Jump tables whose dispatch got removed can no longer be compacted.
+        _jumpTables.erase(
+            std::remove_if(
+                _jumpTables.begin(), _jumpTables.end(), [node](const JumpTable& table) { return table.load == node; }),
+            _jumpTables.end());
+
         if (node != _cursor)
         {
             return;
@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
+#include <zasm/x86/assembler.hpp>
+#include <zasm/x86/memory.hpp>
+
+namespace zasm::x86
+{
+    // Ranges with at most this many cases are lowered to a linear sequence of compares.
+    static constexpr std::size_t kMaxLinearCases = 3;
+
+    static bool isInt32(std::int64_t value) noexcept
+    {
+        return value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max();
+    }
+
+    // Amount of values covered by the cases, saturates at the maximum.
+    static std::uint64_t getCaseRange(const Assembler::SwitchCase* cases, std::size_t count) noexcept
+    {
+        const auto first = static_cast<std::uint64_t>(cases[0].value);
+        const auto last = static_cast<std::uint64_t>(cases[count - 1].value);
+        const auto range = last - first;
+        if (range == std::numeric_limits<std::uint64_t>::max())
+        {
+            return range;
+        }
+        return range + 1;
+    }
+
+    static bool isJumpTableRange(const Assembler::SwitchCase* cases, std::size_t count) noexcept
+    {
+        if (count < Assembler::kMinJumpTableCases)
+        {
+            return false;
+        }
+        if (!isInt32(cases[0].value))
+        {
+            return false;
+        }
+        const auto range = getCaseRange(cases, count);
+        if (range > Assembler::kMaxJumpTableEntries)
+        {
+            return false;
+        }
+        return count * 100 >= range * Assembler::kMinJumpTableDensity;
+    }
+
+    static BitSize getRequiredEntrySize(std::int64_t maxDistance) noexcept
+    {
+        if (maxDistance <= std::numeric_limits<std::int8_t>::max())
+        {
+            return BitSize::_8;
+        }
+        if (maxDistance <= std::numeric_limits<std::int16_t>::max())
+        {
+            return BitSize::_16;
+        }
+        return BitSize::_32;
+    }
+
+    static std::int32_t getEntryBytes(BitSize entrySize) noexcept
+    {
+        return getBitSize(entrySize) / 8;
+    }
+
+    Error Assembler::switchJump(
+        const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget)
+    {
+        if (!defaultTarget.isValid() || (cases == nullptr && count != 0))
+        {
+            return Error::InvalidParameter;
+        }
+
+        const bool isAMD64 = _program.getMode() == MachineMode::AMD64;
+        const auto isValidReg = [&](const Gp& reg) { return reg.isGp32() || (isAMD64 && reg.isGp64()); };
+        if (!isValidReg(value) || !isValidReg(scratch) || value.getRoot(_program.getMode()) == scratch.getRoot(_program.getMode()))
+        {
+            return Error::InvalidParameter;
+        }
+
+        if (count == 0)
+        {
+            return jmp(defaultTarget);
+        }
+
+        std::vector<SwitchCase> sorted(cases, cases + count);
+        std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.value < rhs.value; });
+
+        for (std::size_t i = 0; i < sorted.size(); ++i)
+        {
+            if (!sorted[i].target.isValid())
+            {
+                return Error::InvalidLabel;
+            }
+            if (i > 0 && sorted[i].value == sorted[i - 1].value)
+            {
+                return Error::InvalidParameter;
+            }
+            if (value.isGp32() && !isInt32(sorted[i].value))
+            {
+                return Error::InvalidParameter;
+            }
+        }
+
+        return lowerSwitchRange(value, scratch, sorted.data(), sorted.size(), defaultTarget);
+    }
+
+    Error Assembler::lowerSwitchRange(
+        const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget)
+    {
+        if (isJumpTableRange(cases, count))
+        {
+            return emitJumpTable(value, scratch, cases, count, defaultTarget);
+        }
+
+        const auto emitCompare = [&](std::int64_t caseValue) -> Error {
+            if (isInt32(caseValue))
+            {
+                return cmp(value, Imm(caseValue));
+            }
+            // Only 64 bit values can reach here, cmp has no imm64 form.
+            const auto tmp = Gp(scratch.getId()).r64();
+            if (auto err = mov(tmp, Imm(caseValue)); err != Error::None)
+            {
+                return err;
+            }
+            return cmp(value, tmp);
+        };
+
+        if (count <= kMaxLinearCases)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (auto err = emitCompare(cases[i].value); err != Error::None)
+                {
+                    return err;
+                }
+                if (auto err = jz(cases[i].target); err != Error::None)
+                {
+                    return err;
+                }
+            }
+            return jmp(defaultTarget);
+        }
+
+        // Split at the median, each half may still use a jump table for a dense cluster.
+        const auto mid = count / 2;
+        const auto labelUpper = createLabel();
+
+        if (auto err = emitCompare(cases[mid].value); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = jnl(labelUpper); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = lowerSwitchRange(value, scratch, cases, mid, defaultTarget); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = bind(labelUpper); err != Error::None)
+        {
+            return err;
+        }
+        return lowerSwitchRange(value, scratch, cases + mid, count - mid, defaultTarget);
+    }
+
+    Error Assembler::emitJumpTable(
+        const Gp& value, const Gp& scratch, const SwitchCase* cases, std::size_t count, const Label& defaultTarget)
+    {
+        const bool isAMD64 = _program.getMode() == MachineMode::AMD64;
+
+        const auto minValue = cases[0].value;
+        const auto range = static_cast<std::int64_t>(getCaseRange(cases, count));
+
+        const auto index = isAMD64 ? Gp(value.getId()).r64() : value;
+        const auto base = isAMD64 ? Gp(scratch.getId()).r64() : scratch;
+
+        // The index is computed in the full register so negative values wrap and fail the bounds check.
+        if (isAMD64 && value.isGp32())
+        {
+            if (auto err = movsxd(index, value); err != Error::None)
+            {
+                return err;
+            }
+        }
+        if (minValue != 0)
+        {
+            if (auto err = sub(index, Imm(minValue)); err != Error::None)
+            {
+                return err;
+            }
+        }
+        if (auto err = cmp(index, Imm(range - 1)); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = jnbe(defaultTarget); err != Error::None)
+        {
+            return err;
+        }
+
+        JumpTable table{};
+        table.table = createLabel();
+        table.index = index.getId();
+        table.base = base.getId();
+        table.entrySize = BitSize::_32;
+        table.entryCount = static_cast<std::size_t>(range);
+
+        if (isAMD64)
+        {
+            if (auto err = lea(base, qword_ptr(rip, table.table)); err != Error::None)
+            {
+                return err;
+            }
+        }
+        else
+        {
+            if (auto err = lea(base, dword_ptr(table.table)); err != Error::None)
+            {
+                return err;
+            }
+        }
+        if (auto err = emitJumpTableLoad(table); err != Error::None)
+        {
+            return err;
+        }
+        table.load = getCursor();
+
+        if (auto err = add(index, base); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = jmp(index); err != Error::None)
+        {
+            return err;
+        }
+
+        if (auto err = align(getEntryBytes(BitSize::_32)); err != Error::None)
+        {
+            return err;
+        }
+        if (auto err = bind(table.table); err != Error::None)
+        {
+            return err;
+        }
+
+        std::size_t caseIndex = 0;
+        for (std::int64_t i = 0; i < range; ++i)
+        {
+            auto target = defaultTarget;
+            if (cases[caseIndex].value == minValue + i)
+            {
+                target = cases[caseIndex].target;
+                caseIndex++;
+            }
+            if (auto err = embedLabelRel(target, table.table, table.entrySize); err != Error::None)
+            {
+                return err;
+            }
+        }
+
+        _jumpTables.push_back(table);
+
+        return Error::None;
+    }
+
+    Error Assembler::emitJumpTableLoad(const JumpTable& table)
+    {
+        const auto index = Gp(table.index);
+        const auto base = Gp(table.base);
+        const auto scale = getEntryBytes(table.entrySize);
+
+        switch (table.entrySize)
+        {
+            case BitSize::_8:
+                return movsx(index, byte_ptr(base, index, scale, 0));
+            case BitSize::_16:
+                return movsx(index, word_ptr(base, index, scale, 0));
+            case BitSize::_32:
+                if (index.isGp64())
+                {
+                    return movsxd(index, dword_ptr(base, index, scale, 0));
+                }
+                return mov(index, dword_ptr(base, index, scale, 0));
+            default:
+                break;
+        }
+        return Error::InvalidParameter;
+    }
+
+    Error Assembler::resizeJumpTable(JumpTable& table, BitSize entrySize, const Node*& cursor)
+    {
+        const auto labelData = _program.getLabelData(table.table);
+        if (!labelData.hasValue() || labelData.value().node == nullptr)
+        {
+            return Error::LabelNotFound;
+        }
+
+        // Replaces the node with the one emitted after it and keeps the saved cursor valid.
+        const auto replace = [&](const Node* node) {
+            if (cursor == node)
+            {
+                cursor = getCursor();
+            }
+            _program.destroy(node);
+        };
+
+        table.entrySize = entrySize;
+
+        const auto* node = labelData.value().node->getNext();
+        for (std::size_t i = 0; i < table.entryCount; ++i)
+        {
+            const auto* entry = node != nullptr ? node->getIf<EmbeddedLabel>() : nullptr;
+            if (entry == nullptr)
+            {
+                return Error::InvalidOperation;
+            }
+
+            setCursor(node);
+            if (auto err = embedLabelRel(entry->getLabel(), entry->getRelativeLabel(), entrySize); err != Error::None)
+            {
+                return err;
+            }
+
+            const auto* next = getCursor()->getNext();
+            replace(node);
+            node = next;
+        }
+
+        const auto* load = table.load;
+        setCursor(load);
+        if (auto err = emitJumpTableLoad(table); err != Error::None)
+        {
+            return err;
+        }
+        table.load = getCursor();
+        replace(load);
+
+        return Error::None;
+    }
+
+    Error Assembler::compactJumpTables()
+    {
+        if (_jumpTables.empty())
+        {
+            return Error::None;
+        }
+
+        auto cursor = getCursor();
+
+        Serializer serializer;
+
+        // The first layout uses 32 bit entries, shrinking tables can only grow the distances by alignment
+        // padding so afterwards tables are only widened until the layout is stable.
+        bool isFirstPass = true;
+        while (true)
+        {
+            if (auto err = serializer.serialize(_program, 0); err != Error::None)
+            {
+                setCursor(cursor);
+                return err;
+            }
+
+            bool changed = false;
+            for (auto& table : _jumpTables)
+            {
+                const auto tableAddress = serializer.getLabelAddress(table.table.getId());
+
+                std::int64_t maxDistance = 0;
+
+                const auto* node = _program.getLabelData(table.table).value().node->getNext();
+                for (std::size_t i = 0; i < table.entryCount && node != nullptr; ++i, node = node->getNext())
+                {
+                    const auto& entry = node->get<EmbeddedLabel>();
+                    const auto distance = serializer.getLabelAddress(entry.getLabel().getId()) - tableAddress;
+                    maxDistance = std::max(maxDistance, distance < 0 ? -(distance + 1) : distance);
+                }
+
+                const auto entrySize = getRequiredEntrySize(maxDistance);
+                const bool needsResize = isFirstPass ? entrySize != table.entrySize
+                                                     : getBitSize(entrySize) > getBitSize(table.entrySize);
+                if (!needsResize)
+                {
+                    continue;
+                }
+
+                if (auto err = resizeJumpTable(table, entrySize, cursor); err != Error::None)
+                {
+                    setCursor(cursor);
+                    return err;
+                }
+                changed = true;
+            }
+
+            isFirstPass = false;
+            if (!changed)
+            {
+                break;
+            }
+        }
+
+        setCursor(cursor);
+
+        return Error::None;
+    }
+
+} // namespace zasm::x86
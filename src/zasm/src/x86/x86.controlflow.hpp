@@ -0,0 +1,197 @@
+#pragma once
+
+#include <zasm/program/instruction.hpp>
+#include <zasm/x86/instruction.hpp>
+
+namespace zasm::x86
+{
+    // Instructions that take an immediate/label as relative branch target as the first operand.
+    constexpr bool isRelativeControlFlow(Instruction::Mnemonic mnemonic) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Call:
+            case x86::Mnemonic::Jb:
+            case x86::Mnemonic::Jbe:
+            case x86::Mnemonic::Jcxz:
+            case x86::Mnemonic::Jecxz:
+            case x86::Mnemonic::Jknzd:
+            case x86::Mnemonic::Jkzd:
+            case x86::Mnemonic::Jl:
+            case x86::Mnemonic::Jle:
+            case x86::Mnemonic::Jmp:
+            case x86::Mnemonic::Jnb:
+            case x86::Mnemonic::Jnbe:
+            case x86::Mnemonic::Jnl:
+            case x86::Mnemonic::Jnle:
+            case x86::Mnemonic::Jno:
+            case x86::Mnemonic::Jnp:
+            case x86::Mnemonic::Jns:
+            case x86::Mnemonic::Jnz:
+            case x86::Mnemonic::Jo:
+            case x86::Mnemonic::Jp:
+            case x86::Mnemonic::Jrcxz:
+            case x86::Mnemonic::Js:
+            case x86::Mnemonic::Jz:
+            case x86::Mnemonic::Loop:
+            case x86::Mnemonic::Loope:
+            case x86::Mnemonic::Loopne:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    // Branches that fall through to the next instruction when not taken.
+    constexpr bool isConditionalBranch(Instruction::Mnemonic mnemonic) noexcept
+    {
+        return isRelativeControlFlow(mnemonic) && static_cast<x86::Mnemonic>(mnemonic) != x86::Mnemonic::Call
+            && static_cast<x86::Mnemonic>(mnemonic) != x86::Mnemonic::Jmp;
+    }
+
+    constexpr bool isUnconditionalBranch(Instruction::Mnemonic mnemonic) noexcept
+    {
+        return static_cast<x86::Mnemonic>(mnemonic) == x86::Mnemonic::Jmp;
+    }
+
+    constexpr bool isBranch(Instruction::Mnemonic mnemonic) noexcept
+    {
+        return isConditionalBranch(mnemonic) || isUnconditionalBranch(mnemonic);
+    }
+
+    constexpr bool isCall(Instruction::Mnemonic mnemonic) noexcept
+    {
+        return static_cast<x86::Mnemonic>(mnemonic) == x86::Mnemonic::Call;
+    }
+
+    // Instructions after which execution never continues with the next instruction and
+    // that have no target within the program.
+    constexpr bool isReturn(Instruction::Mnemonic mnemonic) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Ret:
+            case x86::Mnemonic::Iret:
+            case x86::Mnemonic::Iretd:
+            case x86::Mnemonic::Iretq:
+            case x86::Mnemonic::Sysret:
+            case x86::Mnemonic::Sysexit:
+            case x86::Mnemonic::Ud2:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    // Instructions that terminate a basic block.
+    constexpr bool isBlockTerminator(Instruction::Mnemonic mnemonic) noexcept
+    {
+        return isBranch(mnemonic) || isReturn(mnemonic);
+    }
+
+    // Instructions that affect the machine beyond their register and memory operands, these
+    // must neither be removed nor reordered with memory accesses.
+    inline bool hasSideEffects(const Instruction& instr) noexcept
+    {
+        const auto mnemonic = instr.getMnemonic();
+        if (isBlockTerminator(mnemonic) || isCall(mnemonic) || instr.hasAttrib(x86::Attribs::Lock))
+        {
+            return true;
+        }
+
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::In:
+            case x86::Mnemonic::Insb:
+            case x86::Mnemonic::Insw:
+            case x86::Mnemonic::Insd:
+            case x86::Mnemonic::Out:
+            case x86::Mnemonic::Outsb:
+            case x86::Mnemonic::Outsw:
+            case x86::Mnemonic::Outsd:
+            case x86::Mnemonic::Cpuid:
+            case x86::Mnemonic::Rdtsc:
+            case x86::Mnemonic::Rdtscp:
+            case x86::Mnemonic::Rdpmc:
+            case x86::Mnemonic::Rdmsr:
+            case x86::Mnemonic::Wrmsr:
+            case x86::Mnemonic::Rdrand:
+            case x86::Mnemonic::Rdseed:
+            case x86::Mnemonic::Xgetbv:
+            case x86::Mnemonic::Xsetbv:
+            case x86::Mnemonic::Lfence:
+            case x86::Mnemonic::Mfence:
+            case x86::Mnemonic::Sfence:
+            case x86::Mnemonic::Serialize:
+            case x86::Mnemonic::Pause:
+            case x86::Mnemonic::Hlt:
+            case x86::Mnemonic::Int:
+            case x86::Mnemonic::Int1:
+            case x86::Mnemonic::Int3:
+            case x86::Mnemonic::Into:
+            case x86::Mnemonic::Syscall:
+            case x86::Mnemonic::Sysenter:
+            case x86::Mnemonic::Cli:
+            case x86::Mnemonic::Sti:
+            case x86::Mnemonic::Popf:
+            case x86::Mnemonic::Popfd:
+            case x86::Mnemonic::Popfq:
+            case x86::Mnemonic::Xbegin:
+            case x86::Mnemonic::Xend:
+            case x86::Mnemonic::Xabort:
+                return true;
+            case x86::Mnemonic::Xchg:
+                // Implicitly locked with a memory operand.
+                return instr.getOperandIf<Mem>(0) != nullptr || instr.getOperandIf<Mem>(1) != nullptr;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    // Returns the conditional branch with the opposite condition, x86::Mnemonic::Invalid if there is none.
+    constexpr x86::Mnemonic getInvertedCondition(Instruction::Mnemonic mnemonic) noexcept
+    {
+        switch (static_cast<x86::Mnemonic>(mnemonic))
+        {
+            case x86::Mnemonic::Jb:
+                return x86::Mnemonic::Jnb;
+            case x86::Mnemonic::Jnb:
+                return x86::Mnemonic::Jb;
+            case x86::Mnemonic::Jbe:
+                return x86::Mnemonic::Jnbe;
+            case x86::Mnemonic::Jnbe:
+                return x86::Mnemonic::Jbe;
+            case x86::Mnemonic::Jl:
+                return x86::Mnemonic::Jnl;
+            case x86::Mnemonic::Jnl:
+                return x86::Mnemonic::Jl;
+            case x86::Mnemonic::Jle:
+                return x86::Mnemonic::Jnle;
+            case x86::Mnemonic::Jnle:
+                return x86::Mnemonic::Jle;
+            case x86::Mnemonic::Jo:
+                return x86::Mnemonic::Jno;
+            case x86::Mnemonic::Jno:
+                return x86::Mnemonic::Jo;
+            case x86::Mnemonic::Jp:
+                return x86::Mnemonic::Jnp;
+            case x86::Mnemonic::Jnp:
+                return x86::Mnemonic::Jp;
+            case x86::Mnemonic::Js:
+                return x86::Mnemonic::Jns;
+            case x86::Mnemonic::Jns:
+                return x86::Mnemonic::Js;
+            case x86::Mnemonic::Jz:
+                return x86::Mnemonic::Jnz;
+            case x86::Mnemonic::Jnz:
+                return x86::Mnemonic::Jz;
+            default:
+                break;
+        }
+        return x86::Mnemonic::Invalid;
+    }
+
+} // namespace zasm::x86
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zasm::x86
+{
+    constexpr std::size_t kMaxNopLength = 15;
+
+    // Recommended multi-byte NOP sequences, index is the length minus one.
+    // Sequences longer than 9 bytes add 0x66 and a CS segment override prefix to nopw.
+    // clang-format off
+    constexpr std::uint8_t kNopSequences[kMaxNopLength][kMaxNopLength] = {
+        { 0x90 },
+        { 0x66, 0x90 },
+        { 0x0F, 0x1F, 0x00 },
+        { 0x0F, 0x1F, 0x40, 0x00 },
+        { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    };
+    // clang-format on
+
+    // Appends the fewest NOP instructions that cover the given amount of bytes.
+    inline void appendNops(std::vector<std::uint8_t>& buffer, std::size_t length)
+    {
+        while (length > 0)
+        {
+            const auto chunk = length < kMaxNopLength ? length : kMaxNopLength;
+            const auto* seq = kNopSequences[chunk - 1];
+            buffer.insert(buffer.end(), seq, seq + chunk);
+            length -= chunk;
+        }
+    }
+
+} // namespace zasm::x86
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <zasm/base/mode.hpp>
+#include <zasm/program/register.hpp>
+
+namespace zasm::x86
+{
+    // Registers that form dependencies through the operands, the flags are tracked with the cpu flags
+    // of the instruction and the instruction pointer is implicitly ordered by the program.
+    inline bool isTrackedReg(const Reg& reg) noexcept
+    {
+        if (!reg.isValid())
+        {
+            return false;
+        }
+        if (reg.isVirtual())
+        {
+            return true;
+        }
+        const auto regClass = ZydisRegisterGetClass(static_cast<ZydisRegister>(reg.getId()));
+        return regClass != ZYDIS_REGCLASS_FLAGS && regClass != ZYDIS_REGCLASS_IP;
+    }
+
+    // Writes to 8 and 16 bit registers merge with the previous value, 32 bit writes only zero extend in 64 bit mode.
+    inline bool isPartialWrite(MachineMode mode, const Reg& reg) noexcept
+    {
+        if (reg.isVirtual() || !reg.isGp())
+        {
+            return false;
+        }
+        if (reg.isGp32())
+        {
+            return mode != MachineMode::AMD64;
+        }
+        return reg.isGp8() || reg.isGp16();
+    }
+
+} // namespace zasm::x86